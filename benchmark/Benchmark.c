@@ -0,0 +1,646 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "BitmapFont.h"
+#include "Cpu.h"
+#include "DepthBuffer.h"
+#include "Draw.h"
+#include "FillRect.h"
+#include "Font.h"
+#include "Mesh.h"
+#include "Path.h"
+#include "PixelFormat.h"
+#include "Surface.h"
+#include "Transform.h"
+#include "Triangle.h"
+
+// Measures throughput of raster hot paths for every built-in format and a few sizes, results are written as JSON
+//
+// usage: LGLBenchmark [--output file.json] [--filter text] [--min-time seconds] [--font file.ttf]
+//                     [--simd scalar|sse2|sse4.1|avx2]
+
+#define DEFAULT_MIN_TIME 0.2
+#define FONT_PIXEL_SIZE 16
+// Sphere of draw_mesh has this many rings of quads around it, each made of twice as many quads
+#define SPHERE_RINGS 24
+#define SPHERE_SEGMENTS (2 * SPHERE_RINGS)
+
+typedef struct NamedFormat {
+    const char* name;
+    const PixelFormat* format;
+} NamedFormat;
+
+static const NamedFormat formats[] = {
+    { "RGBA8888", &FORMAT_RGBA8888 },
+    { "ABGR8888", &FORMAT_ABGR8888 },
+    { "ARGB8888", &FORMAT_ARGB8888 },
+    { "BGRA8888", &FORMAT_BGRA8888 },
+    { "RGB565", &FORMAT_RGB565 },
+    { "BGR565", &FORMAT_BGR565 },
+    { "RGB332", &FORMAT_RGB332 },
+    { "BGR233", &FORMAT_BGR233 },
+    { "RGBA8888_PREMUL", &FORMAT_RGBA8888_PREMUL },
+    { "ABGR8888_PREMUL", &FORMAT_ABGR8888_PREMUL },
+    { "ARGB8888_PREMUL", &FORMAT_ARGB8888_PREMUL },
+    { "BGRA8888_PREMUL", &FORMAT_BGRA8888_PREMUL },
+};
+
+static const int sizes[] = { 64, 256, 1024 };
+
+#define NUM_FORMATS (int)(sizeof(formats) / sizeof(formats[0]))
+#define NUM_SIZES (int)(sizeof(sizes) / sizeof(sizes[0]))
+
+// State shared by benchmarks of one format and size. Every benchmark returns number of pixels it processed
+typedef struct Bench {
+    Surface dest;
+    Surface opaque;       // same format as dest, without alpha
+    Surface alpha;        // same format as dest, random alpha, only for formats with alpha channel
+    Surface keyed;        // same format as dest, half of pixels equal to color key
+    Surface argb;         // ARGB8888 source for converting blits
+    Surface argbAlpha;
+    Path path;            // rebuilt by every run of draw_path, keeps its memory
+    DepthBuffer depth;
+    Mesh sphere;
+    const Font* font;
+    int size;
+} Bench;
+
+typedef long long (*BenchFunction)(Bench* bench);
+
+typedef struct Options {
+    const char* output;
+    const char* filter;
+    const char* fontPath;
+    double minTime;
+} Options;
+
+static double Now(void) {
+    struct timespec t;
+    timespec_get(&t, TIME_UTC);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static const char* sampleText = "The quick brown fox jumps over the lazy dog 0123456789";
+
+static MeshVertex sphereVertices[(SPHERE_RINGS + 1) * (SPHERE_SEGMENTS + 1)];
+static uint16_t sphereIndices[SPHERE_RINGS * SPHERE_SEGMENTS * 6];
+
+// Unit sphere with texture wrapped around it, seams have their own vertices
+static void BuildSphere(void) {
+    const float pi = 3.14159265f;
+    for (int ring = 0; ring <= SPHERE_RINGS; ++ring) {
+        const float theta = pi * (float)ring / SPHERE_RINGS;
+        for (int segment = 0; segment <= SPHERE_SEGMENTS; ++segment) {
+            const float phi = 2.0f * pi * (float)segment / SPHERE_SEGMENTS;
+            sphereVertices[ring * (SPHERE_SEGMENTS + 1) + segment] = (MeshVertex){
+                sinf(theta) * cosf(phi), cosf(theta), -sinf(theta) * sinf(phi),
+                (float)segment / SPHERE_SEGMENTS, (float)ring / SPHERE_RINGS, WHITE,
+            };
+        }
+    }
+    int count = 0;
+    for (int ring = 0; ring < SPHERE_RINGS; ++ring) {
+        for (int segment = 0; segment < SPHERE_SEGMENTS; ++segment) {
+            const uint16_t top = (uint16_t)(ring * (SPHERE_SEGMENTS + 1) + segment);
+            const uint16_t bottom = (uint16_t)(top + SPHERE_SEGMENTS + 1);
+            const uint16_t quad[6] = { top, bottom, (uint16_t)(bottom + 1), top, (uint16_t)(bottom + 1),
+                                       (uint16_t)(top + 1) };
+            for (int i = 0; i < 6; ++i) sphereIndices[count++] = quad[i];
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static long long BenchFillRect(Bench* bench) {
+    const Rect rect = { 0, 0, bench->size, bench->size };
+    FillRect(bench->dest, &rect, ColorToPixel(bench->dest.format, (Color){ 0x20, 0x40, 0x80, 0xFF }));
+    return (long long)bench->size * bench->size;
+}
+
+static long long BenchBlendFillRect(Bench* bench) {
+    const Rect rect = { 0, 0, bench->size, bench->size };
+    BlendFillRect(bench->dest, &rect, (Color){ 0x20, 0x40, 0x80, 0x80 });
+    return (long long)bench->size * bench->size;
+}
+
+static long long BenchBlit(Bench* bench) {
+    SurfaceBlit(bench->dest, bench->opaque, 0, 0);
+    return (long long)bench->size * bench->size;
+}
+
+static long long BenchBlitAlpha(Bench* bench) {
+    SurfaceBlit(bench->dest, bench->alpha, 0, 0);
+    return (long long)bench->size * bench->size;
+}
+
+static long long BenchBlitColorKey(Bench* bench) {
+    SurfaceBlit(bench->dest, bench->keyed, 0, 0);
+    return (long long)bench->size * bench->size;
+}
+
+static long long BenchBlitConvert(Bench* bench) {
+    SurfaceBlit(bench->dest, bench->argb, 0, 0);
+    return (long long)bench->size * bench->size;
+}
+
+static long long BenchBlitConvertAlpha(Bench* bench) {
+    SurfaceBlit(bench->dest, bench->argbAlpha, 0, 0);
+    return (long long)bench->size * bench->size;
+}
+
+static long long BenchDrawCircle(Bench* bench) {
+    const int r = bench->size / 2 - 1;
+    DrawCircle(bench->dest, bench->size / 2, bench->size / 2, r, (Color){ 0xC0, 0x30, 0x30, 0xFF });
+    return (long long)(3.14159265 * r * r);
+}
+
+static long long BenchBlendCircle(Bench* bench) {
+    const int r = bench->size / 2 - 1;
+    DrawCircle(bench->dest, bench->size / 2, bench->size / 2, r, (Color){ 0xC0, 0x30, 0x30, 0x80 });
+    return (long long)(3.14159265 * r * r);
+}
+
+static long long BenchDrawTriangle(Bench* bench) {
+    const int s = bench->size - 1;
+    DrawTriangle(bench->dest, 0, 0, s, s / 3, s / 3, s, (Color){ 0x30, 0xC0, 0x30, 0xFF });
+    return (long long)s * s / 2;
+}
+
+static long long BenchBlendTriangle(Bench* bench) {
+    const int s = bench->size - 1;
+    DrawTriangle(bench->dest, 0, 0, s, s / 3, s / 3, s, (Color){ 0x30, 0xC0, 0x30, 0x80 });
+    return (long long)s * s / 2;
+}
+
+// Same triangle as draw_triangle, with the source surface mapped on it
+static long long DrawVertexTriangle(Bench* bench, bool textured, TriangleFlags flags) {
+    const float s = (float)(bench->size - 1);
+    const Vertex v1 = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, (Color){ 0xFF, 0x40, 0x40, 0xFF } };
+    const Vertex v2 = { s, s / 3.0f, 2.0f, 1.0f, 0.3f, (Color){ 0x40, 0xFF, 0x40, 0xFF } };
+    const Vertex v3 = { s / 3.0f, s, 3.0f, 0.3f, 1.0f, (Color){ 0x40, 0x40, 0xFF, 0xFF } };
+    if (textured) {
+        DrawTriangleTextured(bench->dest, &v1, &v2, &v3, bench->opaque, flags);
+    }
+    else {
+        DrawTriangleShaded(bench->dest, &v1, &v2, &v3, flags);
+    }
+    return (long long)(s * s / 2.0f);
+}
+
+static long long BenchDrawTriangleShaded(Bench* bench) {
+    return DrawVertexTriangle(bench, false, TRIANGLE_FLAG_NONE);
+}
+
+static long long BenchDrawTriangleTextured(Bench* bench) {
+    const float s = (float)(bench->size - 1);
+    const Vertex v1 = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, WHITE };
+    const Vertex v2 = { s, s / 3.0f, 1.0f, 1.0f, 0.3f, WHITE };
+    const Vertex v3 = { s / 3.0f, s, 1.0f, 0.3f, 1.0f, WHITE };
+    DrawTriangleTextured(bench->dest, &v1, &v2, &v3, bench->opaque, TRIANGLE_FLAG_NONE);
+    return (long long)(s * s / 2.0f);
+}
+
+static long long BenchDrawTriangleBilinear(Bench* bench) {
+    return DrawVertexTriangle(bench, true, TRIANGLE_FLAG_BILINEAR | TRIANGLE_FLAG_PERSPECTIVE);
+}
+
+// Textured sphere of a few thousand triangles filling most of the surface, back faces culled, depth buffer cleared
+// every frame
+static long long BenchDrawMesh(Bench* bench) {
+    const Mat4 projection = Mat4Perspective(1.0f, 1.0f, 0.5f, 10.0f);
+    const Mat4 translation = Mat4Translation(0.0f, 0.0f, -3.0f);
+    const Mat4 rotation = Mat4RotationY(0.5f);
+    const Mat4 model = Mat4Multiply(&translation, &rotation);
+    const Mat4 transform = Mat4Multiply(&projection, &model);
+    DepthBufferClear(bench->depth);
+    DrawMesh(bench->dest, &bench->depth, &bench->sphere, &transform, &bench->opaque,
+             TRIANGLE_FLAG_CULL_BACK | TRIANGLE_FLAG_PERSPECTIVE);
+    // sphere 3 units away spans asin(1 / 3) around the center, projected with focal length 1 / tan(0.5)
+    const double r = tan(asin(1.0 / 3.0)) / tan(0.5) * bench->size / 2.0;
+    return (long long)(3.14159265 * r * r);
+}
+
+static long long BenchDrawLine(Bench* bench) {
+    const int s = bench->size - 1;
+    DrawLine(bench->dest, 0, 0, s, s / 2, (Color){ 0x30, 0x30, 0xC0, 0xFF });
+    DrawLine(bench->dest, 0, s, s / 2, 0, (Color){ 0x30, 0x30, 0xC0, 0xFF });
+    return 2LL * s;
+}
+
+static long long BenchDrawLineAA(Bench* bench) {
+    const float s = (float)(bench->size - 1);
+    DrawLineAA(bench->dest, 0.25f, 0.5f, s, s * 0.5f, (Color){ 0x30, 0x30, 0xC0, 0xFF });
+    DrawLineAA(bench->dest, 0.5f, s, s * 0.5f, 0.25f, (Color){ 0x30, 0x30, 0xC0, 0xFF });
+    // two pixels for every step along major axis
+    return 4LL * (bench->size - 1);
+}
+
+static long long BenchDrawPolyline(Bench* bench) {
+    // zig-zag chart line with sharp joins, every segment crosses the whole height
+    Point points[32];
+    const float s = (float)bench->size;
+    for (int i = 0; i < 32; ++i) {
+        points[i] = (Point){ s * (float)i / 31.0f, (i & 1) ? s * 0.9f : s * 0.1f };
+    }
+    const StrokeStyle style = { 3.0f, LINE_JOIN_MITER, LINE_CAP_BUTT, 4.0f };
+    DrawPolyline(bench->dest, points, 32, false, &style, (Color){ 0x30, 0x30, 0xC0, 0xFF });
+    return (long long)(3.0f * 31.0f * sqrtf((s / 31.0f) * (s / 31.0f) + (s * 0.8f) * (s * 0.8f)));
+}
+
+static long long BenchDrawPolygon(Bench* bench) {
+    // self-intersecting star, concave with a hole in even-odd mode
+    Point points[5];
+    const float s = (float)bench->size;
+    for (int i = 0; i < 5; ++i) {
+        const float angle = 3.14159265f * (0.8f * (float)i - 0.5f) * 2.0f;
+        points[i] = (Point){ s * (0.5f + 0.5f * cosf(angle)), s * (0.5f + 0.5f * sinf(angle)) };
+    }
+    DrawPolygon(bench->dest, points, 5, FILL_RULE_EVEN_ODD, (Color){ 0x30, 0x30, 0xC0, 0xFF });
+    // star without its inner pentagon covers about a fifth of the square
+    return (long long)(s * s / 5.0f);
+}
+
+static long long BenchDrawPath(Bench* bench) {
+    // ring made of two circles of cubics, the inner one cut out by the even-odd rule
+    const float s = (float)bench->size;
+    const float c = s * 0.5f;
+    const float radii[2] = { s * 0.45f, s * 0.3f };
+    PathReset(&bench->path);
+    for (int i = 0; i < 2; ++i) {
+        const float r = radii[i];
+        const float k = 0.5523f * r;
+        PathMoveTo(&bench->path, c + r, c);
+        PathCubicTo(&bench->path, c + r, c + k, c + k, c + r, c, c + r);
+        PathCubicTo(&bench->path, c - k, c + r, c - r, c + k, c - r, c);
+        PathCubicTo(&bench->path, c - r, c - k, c - k, c - r, c, c - r);
+        PathCubicTo(&bench->path, c + k, c - r, c + r, c - k, c + r, c);
+        PathClose(&bench->path);
+    }
+    DrawPath(bench->dest, &bench->path, FILL_RULE_EVEN_ODD, (Color){ 0xC0, 0x30, 0x30, 0xFF });
+    return (long long)(3.14159265f * (radii[0] * radii[0] - radii[1] * radii[1]));
+}
+
+static long long BenchTransformScale(Bench* bench) {
+    Surface scaled = TransformScale(bench->opaque, bench->size * 3 / 2, bench->size * 3 / 2);
+    const long long pixels = (long long)scaled.width * scaled.height;
+    SurfaceDestroy(&scaled);
+    return pixels;
+}
+
+static long long BenchTransformScaleBilinear(Bench* bench) {
+    Surface scaled = TransformScaleFiltered(bench->opaque, bench->size * 3 / 2, bench->size * 3 / 2,
+                                            SCALE_FILTER_BILINEAR);
+    const long long pixels = (long long)scaled.width * scaled.height;
+    SurfaceDestroy(&scaled);
+    return pixels;
+}
+
+// Thumbnail a third of the size, counted in source pixels, which are all read
+static long long BenchTransformScaleArea(Bench* bench) {
+    Surface scaled = TransformScaleFiltered(bench->opaque, bench->size / 3, bench->size / 3, SCALE_FILTER_AREA);
+    SurfaceDestroy(&scaled);
+    return (long long)bench->size * bench->size;
+}
+
+static long long BenchTransformRotate(Bench* bench) {
+    Surface rotated = TransformRotate(bench->opaque, 30);
+    const long long pixels = (long long)rotated.width * rotated.height;
+    SurfaceDestroy(&rotated);
+    return pixels;
+}
+
+static long long BenchTransformScale2x(Bench* bench) {
+    Surface scaled = TransformScale2x(bench->opaque);
+    const long long pixels = (long long)scaled.width * scaled.height;
+    SurfaceDestroy(&scaled);
+    return pixels;
+}
+
+static long long BenchTransformScale3x(Bench* bench) {
+    Surface scaled = TransformScale3x(bench->opaque);
+    const long long pixels = (long long)scaled.width * scaled.height;
+    SurfaceDestroy(&scaled);
+    return pixels;
+}
+
+static long long BenchTransformHq2x(Bench* bench) {
+    Surface scaled = TransformHq2x(bench->opaque);
+    const long long pixels = (long long)scaled.width * scaled.height;
+    SurfaceDestroy(&scaled);
+    return pixels;
+}
+
+// Enlarged onto the destination, which clips it to its own size
+static long long BenchTransformScale2xBlit(Bench* bench) {
+    TransformScale2xBlit(bench->dest, bench->opaque, 0, 0);
+    return (long long)bench->size * bench->size;
+}
+
+// Keyed sprite enlarged straight onto the destination, which clips it to its own size
+static long long BenchTransformScaleBlit(Bench* bench) {
+    TransformScaleBlit(bench->dest, bench->keyed, 0, 0, bench->size * 3 / 2, bench->size * 3 / 2);
+    return (long long)bench->size * bench->size;
+}
+
+// Box of the rotated sprite covers the whole destination, pixels outside of the sprite are only visited
+static long long BenchTransformRotateBlit(Bench* bench) {
+    const int offset = -bench->size / 4;
+    TransformRotateBlit(bench->dest, bench->opaque, offset, offset, 30);
+    return (long long)bench->size * bench->size;
+}
+
+// Sprite rotated by 30 degrees and shrunk to 0.7 around its center fits into the destination, only its area is visited
+static long long DrawRotozoom(Bench* bench, ScaleFilter filter) {
+    const int center = bench->size / 2;
+    TransformRotozoomBlit(bench->dest, bench->opaque, center, center, 30 << 16, 45875, center, center, filter);
+    return (long long)bench->size * bench->size * 49 / 100;
+}
+
+static long long BenchTransformRotozoom(Bench* bench) {
+    return DrawRotozoom(bench, SCALE_FILTER_NEAREST);
+}
+
+static long long BenchTransformRotozoomBilinear(Bench* bench) {
+    return DrawRotozoom(bench, SCALE_FILTER_BILINEAR);
+}
+
+// Shrunk to 3/4 and skewed by 1/4 of y, so the parallelogram still fits the destination
+static long long BenchSurfaceBlitTransformed(Bench* bench) {
+    const Mat2x3 matrix = { { { 3 << 14, 1 << 14, 0 }, { 0, 3 << 14, 0 } } };
+    SurfaceBlitTransformed(bench->dest, bench->opaque, &matrix, SCALE_FILTER_BILINEAR, true);
+    return (long long)bench->size * bench->size * 9 / 16;
+}
+
+static long long BenchSurfaceConvert(Bench* bench) {
+    Surface converted = SurfaceConvert(bench->argb, bench->dest.format);
+    SurfaceDestroy(&converted);
+    return (long long)bench->size * bench->size;
+}
+
+static long long DrawTextRows(Bench* bench, bool bitmap) {
+    int width = 0, height = 0;
+    if (bitmap) MeasureBitmapFontText(sampleText, &DEFAULT_BITMAP_FONT, &width, &height);
+    else MeasureFontText(sampleText, bench->font, &width, &height);
+    if (height <= 0) return 0;
+
+    long long pixels = 0;
+    for (int y = 0; y + height <= bench->size; y += height) {
+        if (bitmap) DrawTextBitmapFont(bench->dest, 0, y, sampleText, &DEFAULT_BITMAP_FONT, WHITE);
+        else DrawFontText(bench->dest, 0, y, sampleText, bench->font, WHITE);
+        pixels += (long long)(width < bench->size ? width : bench->size) * height;
+    }
+    return pixels;
+}
+
+static long long BenchBitmapText(Bench* bench) {
+    return DrawTextRows(bench, true);
+}
+
+static long long BenchFontText(Bench* bench) {
+    return DrawTextRows(bench, false);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+typedef struct BenchCase {
+    const char* name;
+    BenchFunction function;
+    bool needsAlpha;
+    bool needsFont;
+} BenchCase;
+
+static const BenchCase cases[] = {
+    { "fill_rect", BenchFillRect, false, false },
+    { "blend_fill_rect", BenchBlendFillRect, false, false },
+    { "blit_same_format", BenchBlit, false, false },
+    { "blit_same_format_alpha", BenchBlitAlpha, true, false },
+    { "blit_color_key", BenchBlitColorKey, false, false },
+    { "blit_from_argb8888", BenchBlitConvert, false, false },
+    { "blit_from_argb8888_alpha", BenchBlitConvertAlpha, false, false },
+    { "draw_circle", BenchDrawCircle, false, false },
+    { "blend_circle", BenchBlendCircle, false, false },
+    { "draw_triangle", BenchDrawTriangle, false, false },
+    { "blend_triangle", BenchBlendTriangle, false, false },
+    { "draw_triangle_shaded", BenchDrawTriangleShaded, false, false },
+    { "draw_triangle_textured", BenchDrawTriangleTextured, false, false },
+    { "draw_triangle_bilinear", BenchDrawTriangleBilinear, false, false },
+    { "draw_mesh", BenchDrawMesh, false, false },
+    { "draw_line", BenchDrawLine, false, false },
+    { "draw_line_aa", BenchDrawLineAA, false, false },
+    { "draw_polyline", BenchDrawPolyline, false, false },
+    { "draw_polygon", BenchDrawPolygon, false, false },
+    { "draw_path", BenchDrawPath, false, false },
+    { "transform_scale", BenchTransformScale, false, false },
+    { "transform_scale_bilinear", BenchTransformScaleBilinear, false, false },
+    { "transform_scale_area", BenchTransformScaleArea, false, false },
+    { "transform_rotate", BenchTransformRotate, false, false },
+    { "transform_scale2x", BenchTransformScale2x, false, false },
+    { "transform_scale3x", BenchTransformScale3x, false, false },
+    { "transform_hq2x", BenchTransformHq2x, false, false },
+    { "transform_scale2x_blit", BenchTransformScale2xBlit, false, false },
+    { "transform_scale_blit", BenchTransformScaleBlit, false, false },
+    { "transform_rotate_blit", BenchTransformRotateBlit, false, false },
+    { "transform_rotozoom", BenchTransformRotozoom, false, false },
+    { "transform_rotozoom_bilinear", BenchTransformRotozoomBilinear, false, false },
+    { "surface_blit_transformed", BenchSurfaceBlitTransformed, false, false },
+    { "surface_convert_from_argb8888", BenchSurfaceConvert, false, false },
+    { "bitmap_font_text", BenchBitmapText, false, false },
+    { "font_text", BenchFontText, false, true },
+};
+
+#define NUM_CASES (int)(sizeof(cases) / sizeof(cases[0]))
+
+static void FillSurface(Surface surface, bool randomAlpha) {
+    srand(1);
+    for (int y = 0; y < surface.height; ++y) {
+        uint8_t* row = (uint8_t*)surface.pixels + y * surface.stride;
+        for (int x = 0; x < surface.width; ++x) {
+            Color color = { rand() & 0xFF, rand() & 0xFF, rand() & 0xFF, 0xFF };
+            // mix of transparent, opaque and translucent pixels, like in typical sprites
+            if (randomAlpha) color.a = (x & 16) ? 0xFF : (y & 16) ? 0 : rand() & 0xFF;
+            const uint32_t pixel = ColorToPixel(surface.format, color);
+            memcpy(row + x * surface.format->bytesPerPixel, &pixel, surface.format->bytesPerPixel);
+        }
+    }
+}
+
+static Bench CreateBench(const PixelFormat* format, int size, const Font* font) {
+    Bench bench = { .font = font, .size = size };
+    bench.dest = SurfaceCreate(size, size, format);
+    bench.opaque = SurfaceCreate(size, size, format);
+    FillSurface(bench.opaque, false);
+    bench.opaque.flags &= ~SURFACE_FLAG_HAS_ALPHA;
+
+    if (format->aMask != 0) {
+        bench.alpha = SurfaceCreate(size, size, format);
+        FillSurface(bench.alpha, true);
+    }
+
+    const Color key = { 0xFF, 0x00, 0xFF, 0xFF };
+    bench.keyed = SurfaceCopy(bench.opaque);
+    for (int y = 0; y < size; ++y) {
+        for (int x = (y & 1); x < size; x += 2) {
+            const uint32_t pixel = ColorToPixel(format, key);
+            memcpy((uint8_t*)bench.keyed.pixels + y * bench.keyed.stride + x * format->bytesPerPixel, &pixel,
+                   format->bytesPerPixel);
+        }
+    }
+    SurfaceSetColorKey(&bench.keyed, key);
+
+    bench.argb = SurfaceCreate(size, size, &FORMAT_ARGB8888);
+    FillSurface(bench.argb, false);
+    bench.argb.flags &= ~SURFACE_FLAG_HAS_ALPHA;
+    bench.argbAlpha = SurfaceCreate(size, size, &FORMAT_ARGB8888);
+    FillSurface(bench.argbAlpha, true);
+    bench.path = PathCreate();
+    bench.depth = DepthBufferCreate(size, size);
+    bench.sphere = MeshCreate(sphereVertices, (SPHERE_RINGS + 1) * (SPHERE_SEGMENTS + 1), sphereIndices,
+                              SPHERE_RINGS * SPHERE_SEGMENTS * 2);
+    return bench;
+}
+
+static void DestroyBench(Bench* bench) {
+    SurfaceDestroy(&bench->dest);
+    SurfaceDestroy(&bench->opaque);
+    if (bench->alpha.pixels != NULL) SurfaceDestroy(&bench->alpha);
+    SurfaceDestroy(&bench->keyed);
+    SurfaceDestroy(&bench->argb);
+    SurfaceDestroy(&bench->argbAlpha);
+    PathDestroy(&bench->path);
+    DepthBufferDestroy(&bench->depth);
+    MeshDestroy(&bench->sphere);
+}
+
+// Runs function in batches of growing size until minTime passes, so timer overhead is negligible for tiny inputs
+static void RunCase(FILE* out, bool* first, const BenchCase* benchCase, const NamedFormat* format, Bench* bench,
+                    double minTime) {
+    benchCase->function(bench);  // warm up caches and lazily built tables
+
+    long long iterations = 0;
+    long long pixels = 0;
+    long long batch = 1;
+    const double start = Now();
+    double elapsed = 0.0;
+    do {
+        for (long long i = 0; i < batch; ++i) {
+            pixels += benchCase->function(bench);
+        }
+        iterations += batch;
+        batch <<= 1;
+        elapsed = Now() - start;
+    } while (elapsed < minTime);
+
+    const double megapixels = (double)pixels / elapsed / 1e6;
+    fprintf(out, "%s\n    { \"name\": \"%s\", \"format\": \"%s\", \"size\": %d, \"iterations\": %lld, "
+                 "\"seconds\": %.6f, \"ns_per_iteration\": %.1f, \"megapixels_per_second\": %.3f }",
+            *first ? "" : ",", benchCase->name, format->name, bench->size, iterations, elapsed,
+            elapsed * 1e9 / (double)iterations, megapixels);
+    fprintf(stderr, "%-32s %-16s %5d %12.3f MP/s\n", benchCase->name, format->name, bench->size, megapixels);
+    *first = false;
+}
+
+static bool ParseSimdLevel(const char* name, SimdLevel* level) {
+    for (SimdLevel l = SIMD_LEVEL_SCALAR; l <= SIMD_LEVEL_AVX2; ++l) {
+        const char* levelName = SimdLevelName(l);
+        bool same = strlen(levelName) == strlen(name);
+        for (size_t i = 0; same && name[i] != '\0'; ++i) {
+            same = (name[i] | 0x20) == (levelName[i] | 0x20);
+        }
+        if (same) {
+            *level = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseOptions(int argc, char** argv, Options* options) {
+    *options = (Options){ .minTime = DEFAULT_MIN_TIME };
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            options->output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+            options->filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            // without time to measure there would be nothing to divide rates by
+            char* end;
+            options->minTime = strtod(argv[++i], &end);
+            if (*end != '\0' || !(options->minTime > 0.0)) return false;
+        }
+        else if (strcmp(argv[i], "--font") == 0 && hasValue) {
+            options->fontPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--simd") == 0 && hasValue) {
+            SimdLevel level;
+            if (!ParseSimdLevel(argv[++i], &level)) return false;
+            CpuForceSimdLevel(level);
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        fprintf(stderr, "usage: %s [--output file.json] [--filter text] [--min-time seconds] [--font file.ttf] "
+                        "[--simd scalar|sse2|sse4.1|avx2]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (options.output != NULL) {
+        out = fopen(options.output, "w");
+        if (out == NULL) {
+            fprintf(stderr, "can't open %s\n", options.output);
+            return 1;
+        }
+    }
+
+    Font font = { 0 };
+    if (options.fontPath != NULL) {
+        font = FontLoad(options.fontPath, FONT_PIXEL_SIZE);
+        if (font.internal == NULL) {
+            fprintf(stderr, "can't load font %s\n", options.fontPath);
+            if (out != stdout) fclose(out);
+            return 1;
+        }
+    }
+    BuildSphere();
+
+    fprintf(out, "{\n  \"simd\": \"%s\",\n  \"cores\": %d,\n  \"results\": [",
+            SimdLevelName(CpuGetSimdLevel()), CpuGetCoreCount());
+    bool first = true;
+    for (int s = 0; s < NUM_SIZES; ++s) {
+        for (int f = 0; f < NUM_FORMATS; ++f) {
+            Bench bench = CreateBench(formats[f].format, sizes[s], options.fontPath != NULL ? &font : NULL);
+            for (int c = 0; c < NUM_CASES; ++c) {
+                const BenchCase* benchCase = &cases[c];
+                if (benchCase->needsAlpha && bench.alpha.pixels == NULL) continue;
+                if (benchCase->needsFont && bench.font == NULL) continue;
+                if (options.filter != NULL && strstr(benchCase->name, options.filter) == NULL &&
+                    strstr(formats[f].name, options.filter) == NULL) continue;
+                RunCase(out, &first, benchCase, &formats[f], &bench, options.minTime);
+            }
+            DestroyBench(&bench);
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (options.fontPath != NULL) {
+        FontFree(&font);
+        ShutdownFontModule();
+    }
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef LGL_COMMAND_BUFFER_H
+#define LGL_COMMAND_BUFFER_H
+#include <stdint.h>
+
+#include "Color.h"
+#include "Rect.h"
+#include "Surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Target is split into square tiles of this size, every tile is rendered by one thread
+#define COMMAND_BUFFER_TILE_SIZE 64
+
+// Records drawing commands and renders them later on several threads. Every tile executes commands that touch it in
+// the order they were recorded, so the result is the same as drawing them immediately. Surfaces passed to
+// CommandBufferBlit are not copied and must stay valid and unchanged until CommandBufferSubmit
+typedef struct CommandBuffer {
+    void* commands;
+    int count;
+    int capacity;
+    void* pool;  // worker threads
+} CommandBuffer;
+
+// threadCount <= 0 uses every core
+CommandBuffer CommandBufferCreate(int threadCount);
+void CommandBufferDestroy(CommandBuffer* buffer);
+void CommandBufferClear(CommandBuffer* buffer);
+
+void CommandBufferFillRect(CommandBuffer* buffer, const Rect* rect, uint32_t color);
+void CommandBufferDrawRect(CommandBuffer* buffer, int x, int y, int w, int h, Color color);
+void CommandBufferDrawCircle(CommandBuffer* buffer, int x, int y, int r, Color color);
+void CommandBufferDrawTriangle(CommandBuffer* buffer, int x1, int y1, int x2, int y2, int x3, int y3, Color color);
+void CommandBufferDrawLine(CommandBuffer* buffer, int x1, int y1, int x2, int y2, Color color);
+void CommandBufferBlit(CommandBuffer* buffer, Surface src, int x, int y);
+
+// Renders all recorded commands onto target, waits until they are finished and clears the buffer
+void CommandBufferSubmit(CommandBuffer* buffer, Surface target);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_COMMAND_BUFFER_H
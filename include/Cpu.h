@@ -0,0 +1,28 @@
+#ifndef LGL_CPU_H
+#define LGL_CPU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef enum SimdLevel {
+    SIMD_LEVEL_AUTO   = -1,
+    SIMD_LEVEL_SCALAR = 0,
+    SIMD_LEVEL_SSE2   = 1,
+    SIMD_LEVEL_SSE4_1 = 2,
+    SIMD_LEVEL_AVX2   = 3,
+} SimdLevel;
+
+SimdLevel CpuDetectSimdLevel(void);
+SimdLevel CpuGetSimdLevel(void);
+void CpuForceSimdLevel(SimdLevel level);
+const char* SimdLevelName(SimdLevel level);
+
+// Number of logical processors available to the program, at least 1
+int CpuGetCoreCount(void);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_CPU_H
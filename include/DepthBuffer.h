@@ -0,0 +1,29 @@
+#ifndef LGL_DEPTH_BUFFER_H
+#define LGL_DEPTH_BUFFER_H
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Depth of the far plane, the near one has depth 0
+#define DEPTH_FAR 0xFFFF
+
+// Depth of every pixel of a surface of the same size, used by DrawMesh to hide pixels behind already drawn ones
+typedef struct DepthBuffer {
+    int width;
+    int height;
+    uint16_t* values;  // rows are width values long
+} DepthBuffer;
+
+// Created buffer is cleared
+DepthBuffer DepthBufferCreate(int width, int height);
+void DepthBufferDestroy(DepthBuffer* buffer);
+// Sets every value to DEPTH_FAR, usually at the beginning of a frame
+void DepthBufferClear(DepthBuffer buffer);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_DEPTH_BUFFER_H
@@ -7,10 +7,52 @@
 extern "C" {
 #endif  // __cplusplus
 
+typedef struct Point {
+    float x;
+    float y;
+} Point;
+
+typedef enum LineJoin {
+    LINE_JOIN_MITER,
+    LINE_JOIN_ROUND,
+    LINE_JOIN_BEVEL,
+} LineJoin;
+
+typedef enum LineCap {
+    LINE_CAP_BUTT,
+    LINE_CAP_SQUARE,  // extended by half of width past end points
+    LINE_CAP_ROUND,
+} LineCap;
+
+// Which parts of self-intersecting or nested polygons are inside
+typedef enum FillRule {
+    FILL_RULE_NON_ZERO,  // parts the outline winds around at least once
+    FILL_RULE_EVEN_ODD,  // parts crossed by a ray to infinity odd number of times, so holes can be cut out
+} FillRule;
+
+typedef struct StrokeStyle {
+    float width;
+    LineJoin join;
+    LineCap cap;
+    float miterLimit;  // miters longer than miterLimit * width are beveled, 4 is a good default
+} StrokeStyle;
+
 void DrawRect(Surface surface, int x, int y, int w, int h, Color color);
 void DrawCircle(Surface surface, int x, int y, int r, Color color);
+// Triangles fill pixels whose centers are inside, centers on top and left edges included, so triangles sharing an edge
+// draw every pixel of it once and meshes can be drawn with translucent colors. Pixel centers are at integer coordinates
 void DrawTriangle(Surface surface, int x1, int y1, int x2, int y2, int x3, int y3, Color color);
+// Same as DrawTriangle with sub-pixel vertices, snapped to 1/256 of a pixel
+void DrawTriangleF(Surface surface, Point p1, Point p2, Point p3, Color color);
 void DrawLine(Surface surface, int x1, int y1, int x2, int y2, Color color);
+// Anti-aliased line with sub-pixel endpoints. Pixel (x, y) is fully covered by a line passing through point (x, y)
+void DrawLineAA(Surface surface, float x1, float y1, float x2, float y2, Color color);
+// Stroke of connected segments, the last point is joined with the first one when closed. Pixel centers are at integer
+// coordinates like in DrawLineAA. The stroke is filled as one shape, so translucent joins aren't drawn twice
+void DrawPolyline(Surface surface, const Point* points, int count, bool closed, const StrokeStyle* style, Color color);
+// Polygon of any shape, concave and self-intersecting included. The last point is connected with the first one.
+// Pixels whose centers are inside are filled, with centers at integer coordinates
+void DrawPolygon(Surface surface, const Point* points, int count, FillRule rule, Color color);
 
 #ifdef __cplusplus
 }
@@ -1,20 +1,43 @@
 #ifndef LGL_FONT_H
 #define LGL_FONT_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "Surface.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif  // __cplusplus
 
+// Glyph atlas budget used by FontLoad, in bytes of coverage data
+#define FONT_DEFAULT_GLYPH_CACHE_BUDGET (256 * 1024)
+// Shaped strings remembered per font, bounded both by count and by bytes of text and glyph data
+#define FONT_SHAPE_CACHE_MAX_RUNS 128
+#define FONT_SHAPE_CACHE_BUDGET (64 * 1024)
+
 typedef struct Font {
     void* internal;
     void* hbFont;
     int size;
+    void* glyphCache;
+    void* shapeCache;
 } Font;
 
+typedef struct FontCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    int capacity;  // number of glyphs that fit into the atlas
+    int used;
+} FontCacheStats;
+
 Font FontLoad(const char* path, int pixelSize);
 void FontFree(Font* font);
+void FontSetGlyphCacheBudget(Font* font, size_t bytes);
+FontCacheStats FontGetGlyphCacheStats(const Font* font);
+void FontResetGlyphCacheStats(Font* font);
+void FontInvalidateShapeCache(Font* font);
 void DrawFontChar(Surface surface, int x, int y, char c, const Font* font, Color color);
 void DrawFontText(Surface surface, int x, int y, const char* text, const Font* font, Color color);
 void MeasureFontText(const char* text, const Font* font, int* outWidth, int* outHeight);
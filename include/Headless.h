@@ -0,0 +1,29 @@
+#ifndef LGL_HEADLESS_H
+#define LGL_HEADLESS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Available only in the headless backend (LGL_HEADLESS CMake option), which implements Window.h and Input.h without
+// any display. Window surface lives in memory, input never reports anything and time is virtual by default
+
+// Saves every presented frame as BMP. pathFormat is printf format with one int conversion for frame index, e.g.
+// "frames/%05d.bmp". NULL stops saving
+void HeadlessSetFrameDump(const char* pathFormat);
+
+// Every WindowEndFrame advances time by this many seconds without sleeping. By default it is the target frame time,
+// or 1/60 s when there is no target FPS. 0 switches to real time, still without sleeping
+void HeadlessSetFrameTime(double seconds);
+
+// WindowShouldClose starts returning true after this many frames, 0 means never
+void HeadlessSetFrameLimit(int frames);
+
+// Number of frames presented so far
+int HeadlessGetFrameCount(void);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_HEADLESS_H
@@ -0,0 +1,65 @@
+#ifndef LGL_MESH_H
+#define LGL_MESH_H
+#include <stdint.h>
+
+#include "Color.h"
+#include "DepthBuffer.h"
+#include "Surface.h"
+#include "Triangle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Row-major matrix multiplying column vectors, so Mat4Multiply(a, b) transforms by b first and by a then
+typedef struct Mat4 {
+    float m[4][4];
+} Mat4;
+
+Mat4 Mat4Identity(void);
+Mat4 Mat4Multiply(const Mat4* a, const Mat4* b);
+Mat4 Mat4Translation(float x, float y, float z);
+Mat4 Mat4Scaling(float x, float y, float z);
+// Angles are in radians, counter-clockwise when looking from the positive side of the axis
+Mat4 Mat4RotationX(float angle);
+Mat4 Mat4RotationY(float angle);
+Mat4 Mat4RotationZ(float angle);
+// Camera at (0, 0, 0) looking towards negative z, with y going up. Points at distance near and far are mapped to
+// depth 0 and DEPTH_FAR
+Mat4 Mat4Perspective(float fovY, float aspect, float near, float far);
+
+typedef struct MeshVertex {
+    float x;
+    float y;
+    float z;
+    float u;      // texture coordinates like in Vertex
+    float v;
+    Color color;
+} MeshVertex;
+
+// Indexed triangle list. Vertices and indices are owned by the caller and can be changed between draws, the mesh
+// only keeps memory for transformed vertices, so DrawMesh doesn't allocate
+typedef struct Mesh {
+    const MeshVertex* vertices;
+    int vertexCount;
+    const uint16_t* indices;  // three per triangle, front faces go counter-clockwise as seen by the camera
+    int triangleCount;
+    void* transformed;
+} Mesh;
+
+Mesh MeshCreate(const MeshVertex* vertices, int vertexCount, const uint16_t* indices, int triangleCount);
+void MeshDestroy(Mesh* mesh);
+
+// Transforms every vertex once by transform (usually projection * view * model), clips triangles against the near
+// and far planes in homogeneous coordinates and draws them like DrawTriangleTextured, or like DrawTriangleShaded when
+// texture is NULL. TRIANGLE_FLAG_CULL_BACK skips faces turned away from the camera before they are clipped. Depth
+// buffer can be NULL, then triangles are drawn in order. Its pixels are written also by blended triangles, so those
+// should be drawn after opaque ones, far to near. Triangles with indices out of vertices are skipped
+void DrawMesh(Surface surface, const DepthBuffer* depth, Mesh* mesh, const Mat4* transform, const Surface* texture,
+              TriangleFlags flags);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_MESH_H
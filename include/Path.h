@@ -0,0 +1,53 @@
+#ifndef LGL_PATH_H
+#define LGL_PATH_H
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "Draw.h"
+#include "Surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Curves are flattened to lines when added, so that no point of a line is further than this from the curve
+#define PATH_FLATTEN_TOLERANCE 0.2f
+
+// Outline made of contours. Points and the scratch memory of DrawPath are taken from the global allocator and kept
+// by PathReset, so a path rebuilt every frame doesn't allocate once it has grown
+typedef struct Path {
+    Point* points;     // flattened contours, one after another
+    int count;
+    int capacity;
+    int* contours;     // index of the first point of every contour
+    int contourCount;
+    int contourCapacity;
+    Point start;       // where current contour begins, PathClose returns there
+    bool closed;       // next drawing starts a new contour at start
+    void* scratch;
+    size_t scratchSize;
+} Path;
+
+Path PathCreate(void);
+void PathDestroy(Path* path);
+// Removes all contours and keeps memory
+void PathReset(Path* path);
+
+void PathMoveTo(Path* path, float x, float y);
+// Drawing without a preceding PathMoveTo starts a contour at (0, 0)
+void PathLineTo(Path* path, float x, float y);
+void PathQuadTo(Path* path, float cx, float cy, float x, float y);
+void PathCubicTo(Path* path, float c1x, float c1y, float c2x, float c2y, float x, float y);
+// Ends current contour; next one starts where this one began
+void PathClose(Path* path);
+
+// Fills the path with anti-aliasing. Contours are closed implicitly. Coverage is accumulated as exact area of pixels
+// under the outline, one row at a time, and pixels covered fully are filled as spans. Pixel centers are at integer
+// coordinates like in DrawPolygon
+void DrawPath(Surface surface, Path* path, FillRule rule, Color color);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_PATH_H
@@ -1,6 +1,7 @@
 #ifndef LGL_PIXEL_FORMAT_H
 #define LGL_PIXEL_FORMAT_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "Color.h"
@@ -26,6 +27,9 @@ typedef struct PixelFormat {
     uint8_t aLoss;
 
     uint8_t bytesPerPixel;
+
+    // color channels are stored already multiplied by alpha
+    bool premultiplied;
 } PixelFormat;
 
 extern const PixelFormat FORMAT_RGBA8888;
@@ -36,6 +40,10 @@ extern const PixelFormat FORMAT_RGB565;
 extern const PixelFormat FORMAT_BGR565;
 extern const PixelFormat FORMAT_RGB332;
 extern const PixelFormat FORMAT_BGR233;
+extern const PixelFormat FORMAT_RGBA8888_PREMUL;
+extern const PixelFormat FORMAT_ABGR8888_PREMUL;
+extern const PixelFormat FORMAT_ARGB8888_PREMUL;
+extern const PixelFormat FORMAT_BGRA8888_PREMUL;
 
 uint32_t ColorToPixel(const PixelFormat* format, Color color);
 Color PixelToColor(const PixelFormat* format, uint32_t pixel);
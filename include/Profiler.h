@@ -0,0 +1,91 @@
+#ifndef LGL_PROFILER_H
+#define LGL_PROFILER_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Number of finished frames kept by the profiler
+#define PROFILER_HISTORY_SIZE 120
+
+// Public entry points that are timed. Time and pixels of nested calls (e.g. FillRect called by DrawRect) belong to
+// the outermost one
+typedef enum ProfileZone {
+    PROFILE_ZONE_FILL_RECT,
+    PROFILE_ZONE_BLEND_FILL_RECT,
+    PROFILE_ZONE_SURFACE_FILL,
+    PROFILE_ZONE_SURFACE_BLIT,
+    PROFILE_ZONE_SURFACE_CONVERT,
+    PROFILE_ZONE_DRAW_RECT,
+    PROFILE_ZONE_DRAW_CIRCLE,
+    PROFILE_ZONE_DRAW_TRIANGLE,
+    PROFILE_ZONE_DRAW_TRIANGLE_SHADED,
+    PROFILE_ZONE_DRAW_TRIANGLE_TEXTURED,
+    PROFILE_ZONE_DRAW_MESH,
+    PROFILE_ZONE_DRAW_LINE,
+    PROFILE_ZONE_DRAW_LINE_AA,
+    PROFILE_ZONE_DRAW_POLYLINE,
+    PROFILE_ZONE_DRAW_POLYGON,
+    PROFILE_ZONE_DRAW_PATH,
+    PROFILE_ZONE_BITMAP_FONT_TEXT,
+    PROFILE_ZONE_FONT_TEXT,
+    PROFILE_ZONE_TRANSFORM,
+    PROFILE_ZONE_COMMAND_BUFFER_SUBMIT,
+    PROFILE_ZONE_WINDOW_END_FRAME,  // presenting, without waiting for target FPS
+    PROFILE_ZONE_COUNT
+} ProfileZone;
+
+typedef struct ProfileZoneStats {
+    uint32_t calls;
+    uint64_t pixels;  // pixels written, or presented for PROFILE_ZONE_WINDOW_END_FRAME
+    double seconds;
+} ProfileZoneStats;
+
+typedef struct ProfileFrame {
+    uint64_t index;
+    double seconds;  // from the end of previous frame to the end of this one
+    ProfileZoneStats zones[PROFILE_ZONE_COUNT];
+} ProfileFrame;
+
+// Instrumentation exists only when LGL is built with LGL_PROFILE defined, otherwise the profiler can't be enabled and
+// all queries return empty frames
+bool ProfilerIsAvailable(void);
+void ProfilerSetEnabled(bool enabled);
+bool ProfilerIsEnabled(void);
+void ProfilerReset(void);
+
+// Closes current frame and stores it in history. Called by WindowEndFrame, programs rendering without window call it
+// themselves
+void ProfilerNextFrame(void);
+
+// Frame that is being recorded
+const ProfileFrame* ProfilerGetCurrentFrame(void);
+// Finished frame, 0 is the latest one. Returns NULL when there is no such frame in history
+const ProfileFrame* ProfilerGetFrame(int age);
+int ProfilerGetFrameCount(void);
+
+const char* ProfileZoneName(ProfileZone zone);
+
+// Trace capture in Chrome trace JSON format, viewable in chrome://tracing or ui.perfetto.dev. While recording, every
+// instrumented call on every thread is stored as a span, together with frames, waits for presentation and glyph
+// rasterization. Threads append to their own buffers without locking. Each buffer holds maxEventsPerThread events and
+// there is one for the thread calling ProfilerTraceBegin and one for every core, events that don't fit are dropped.
+// Tracing is independent of ProfilerSetEnabled and is available only when ProfilerIsAvailable returns true
+bool ProfilerTraceBegin(int maxEventsPerThread);
+void ProfilerTraceEnd(void);
+bool ProfilerIsTracing(void);
+// Number of events recorded by all threads and number of events dropped because buffers were full
+int ProfilerTraceGetEventCount(void);
+int ProfilerTraceGetDroppedCount(void);
+// Writes recorded events; the trace has to be ended first. Events stay in memory until ProfilerTraceFree or next
+// ProfilerTraceBegin
+bool ProfilerTraceSave(const char* path);
+void ProfilerTraceFree(void);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_PROFILER_H
@@ -15,6 +15,7 @@ typedef struct Rect {
 } Rect;
 
 bool RectIntersection(const Rect* a, const Rect* b, Rect* result);
+Rect RectUnion(const Rect* a, const Rect* b);
 
 #ifdef __cplusplus
 }
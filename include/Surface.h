@@ -1,5 +1,6 @@
 #ifndef LGL_SURFACE_H
 #define LGL_SURFACE_H
+#include <stdbool.h>
 
 #include "PixelFormat.h"
 #include "Rect.h"
@@ -22,6 +23,7 @@ typedef struct Surface {
     int stride;
     SurfaceFlags flags;
     const PixelFormat* format;
+    void* rle;  // transparent, opaque and translucent runs of the surface, created by SurfaceCompileRle
 } Surface;
 
 Surface SurfaceCreate(int width, int height, const PixelFormat* format);
@@ -37,6 +39,12 @@ void SurfaceSetColorKey(Surface* surface, Color color);
 Color SurfaceGetColorKey(Surface surface);
 void SurfaceUnsetColorKey(Surface* surface);
 
+// Compiles color-keyed or alpha surface into runs used by SurfaceBlit to skip transparent pixels and copy opaque ones
+// without testing every pixel. Runs are not updated automatically, so the surface has to be compiled again after
+// its transparency changes (e.g. after drawing on it or transforming it in place)
+bool SurfaceCompileRle(Surface* surface);
+void SurfaceUncompileRle(Surface* surface);
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
@@ -1,17 +1,61 @@
 #ifndef LGL_TRANSFORM_H
 #define LGL_TRANSFORM_H
 
+#include <stdint.h>
+
 #include "Surface.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif  // __cplusplus
 
+typedef enum ScaleFilter {
+    SCALE_FILTER_NEAREST  = 0,
+    SCALE_FILTER_BILINEAR = 1,  // blends the nearest 2x2 source pixels, for enlarging
+    SCALE_FILTER_AREA     = 2,  // averages all source pixels under the destination one, for shrinking
+    SCALE_FILTER_AUTO     = 3,  // bilinear along axes that grow and area along axes that shrink
+} ScaleFilter;
+
 void TransformFlipX(Surface surface);
 void TransformFlipY(Surface surface);
 Surface TransformRotate(Surface src, int angle);
 Surface TransformScale(Surface src, int destWidth, int destHeight);
+// Straight alpha is filtered premultiplied, so transparent pixels don't leave dark fringes around opaque ones.
+// Surfaces with 8-bit channels are filtered with SSE2 when available, others are converted row by row
+Surface TransformScaleFiltered(Surface src, int destWidth, int destHeight, ScaleFilter filter);
+// Pixel-art upscalers, which enlarge src by an integer factor and smooth diagonal edges of flat areas. Scale2x and
+// Scale3x only copy pixels, hq2x also blends colors along the edges, treating pixels that differ a little in luma,
+// chroma or alpha as the same
 Surface TransformScale2x(Surface original);
+Surface TransformScale3x(Surface original);
+Surface TransformHq2x(Surface original);
+
+// Draw what the functions above return at x, y of dest, clipped and blended like SurfaceBlit would do with src's
+// color key and alpha, without allocating the transformed surface. Pixels of the rotated box outside of rotated src
+// are left untouched
+void TransformScaleBlit(Surface dest, Surface src, int x, int y, int destWidth, int destHeight);
+void TransformRotateBlit(Surface dest, Surface src, int x, int y, int angle);
+void TransformScale2xBlit(Surface dest, Surface src, int x, int y);
+void TransformScale3xBlit(Surface dest, Surface src, int x, int y);
+void TransformHq2xBlit(Surface dest, Surface src, int x, int y);
+
+// Draw src rotated by angle degrees clockwise and scaled by scale, both in 16.16 fixed point, with its point pivotX,
+// pivotY (0, 0 is the top-left corner of src) placed at x, y of dest. Alpha and color key work like in SurfaceBlit.
+// Only the part of every destination row that lands inside of src is visited. Filters other than nearest sample the
+// 2x2 nearest source pixels, except for color keyed sources, whose key color would be blended into their edges
+void TransformRotozoomBlit(Surface dest, Surface src, int x, int y, int32_t angle, int32_t scale, int pivotX,
+                           int pivotY, ScaleFilter filter);
+
+// Affine map in 16.16 fixed point, point x, y of src lands at m[0][0] * x + m[0][1] * y + m[0][2],
+// m[1][0] * x + m[1][1] * y + m[1][2] of dest
+typedef struct Mat2x3 {
+    int32_t m[2][3];
+} Mat2x3;
+
+// Draws src mapped by matrix into dest, visiting only destination pixels whose centers map inside of src. Sampling is
+// like in TransformRotozoomBlit. With blend, alpha and color key work like in SurfaceBlit, without it transformed
+// pixels are just converted to the format of dest. Matrices that can't be inverted are invalid params
+void SurfaceBlitTransformed(Surface dest, Surface src, const Mat2x3* matrix, ScaleFilter filter, bool blend);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,40 @@
+#ifndef LGL_TRIANGLE_H
+#define LGL_TRIANGLE_H
+#include "Color.h"
+#include "Surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef struct Vertex {
+    float x;      // position, pixel centers are at integer coordinates like in DrawTriangleF
+    float y;
+    float w;      // w of projected point, used by TRIANGLE_FLAG_PERSPECTIVE, must be positive; 1 for flat triangles
+    float u;      // texture coordinates, (0, 0) is top left corner of texture and (1, 1) bottom right one
+    float v;
+    Color color;  // color of untextured triangles, textured ones have their texels multiplied by it
+} Vertex;
+
+typedef enum TriangleFlags {
+    TRIANGLE_FLAG_NONE        = 0,
+    TRIANGLE_FLAG_BLEND       = (1 << 0),  // blend by alpha of texels and vertex colors, otherwise pixels are copied
+    TRIANGLE_FLAG_BILINEAR    = (1 << 1),  // filter texels bilinearly instead of taking nearest one
+    TRIANGLE_FLAG_PERSPECTIVE = (1 << 2),  // interpolate texture coordinates perspective-correct, using w of vertices
+    TRIANGLE_FLAG_CULL_BACK   = (1 << 3),  // skip triangles whose vertices go clockwise as seen on screen
+} TriangleFlags;
+
+// Triangles with colors interpolated between vertices. Pixels are the same as drawn by DrawTriangleF, so meshes don't
+// draw shared edges twice
+void DrawTriangleShaded(Surface surface, const Vertex* v1, const Vertex* v2, const Vertex* v3, TriangleFlags flags);
+// Triangles mapped with a texture of any format. Texture coordinates outside of it are clamped to its edge. Colors are
+// interpolated linearly on screen, texture coordinates too unless TRIANGLE_FLAG_PERSPECTIVE is set, in which case
+// they are exact every 16 pixels and interpolated between
+void DrawTriangleTextured(Surface surface, const Vertex* v1, const Vertex* v2, const Vertex* v3, Surface texture,
+                          TriangleFlags flags);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_TRIANGLE_H
@@ -9,6 +9,8 @@
 extern "C" {
 #endif  // __cplusplus
 
+#define WINDOW_MAX_BUFFERS 3
+
 Surface WindowInit(int width, int height, const char* title);
 void WindowDestroy();
 void WindowSetClose(bool close);
@@ -17,6 +19,19 @@ void WindowSetTitle(const char* title);
 void WindowBeginFrame();
 void WindowEndFrame();
 
+// Number of buffers frames are rendered into, set before WindowInit. With more than one buffer WindowEndFrame
+// doesn't wait for presentation to finish and next frame is rendered into another buffer, so surface returned by
+// WindowInit is valid only for the first frame and WindowGetSurface has to be called every frame. With damage tracking
+// contents of previous frame are kept, without it every frame has to be drawn whole. Backends that can't present
+// asynchronously always use one buffer
+void WindowSetBufferCount(int count);
+Surface WindowGetSurface(void);
+
+// With damage tracking enabled only areas changed by LGL drawing functions are presented. Pixels written directly
+// to window surface have to be reported with WindowMarkDirty
+void WindowSetDamageTracking(bool enabled);
+void WindowMarkDirty(Rect rect);
+
 void WindowSetTargetFPS(int fps);
 float WindowGetFrameTime(void);
 double WindowGetTime(void);
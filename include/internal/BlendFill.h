@@ -0,0 +1,30 @@
+#ifndef LGL_BLEND_FILL_H
+#define LGL_BLEND_FILL_H
+#include <stdbool.h>
+
+#include "Color.h"
+#include "Rect.h"
+#include "Surface.h"
+#include "internal/RowKernels.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Blending kernel of a surface, picked once per primitive instead of once for every span it fills
+typedef struct BlendFill {
+    Surface surface;
+    const RowKernels* kernels;  // NULL unless surface has 32-bit pixels with byte-aligned alpha
+    bool byteAligned;
+} BlendFill;
+
+BlendFill BlendFillInit(Surface surface);
+// Part of BlendFillRect picking between straight and premultiplied kernels, without clipping, damage and profiling.
+// Clipped has to lie inside of surface
+void BlendFillClipped(const BlendFill* fill, Rect clipped, Color color);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_BLEND_FILL_H
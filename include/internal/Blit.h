@@ -0,0 +1,18 @@
+#ifndef LGL_BLIT_H
+#define LGL_BLIT_H
+#include "Rect.h"
+#include "Surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Part of SurfaceBlit choosing between copy, conversion, color key, alpha and RLE paths, without clipping, damage
+// and profiling. Clipped has to lie inside of dest and of src placed at x, y
+void BlitClipped(Surface dest, Surface src, int x, int y, Rect clipped);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_BLIT_H
@@ -0,0 +1,36 @@
+#ifndef LGL_CONVERT_H
+#define LGL_CONVERT_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "PixelFormat.h"
+#include "internal/RowKernels.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef struct PixelConverter PixelConverter;
+typedef void (*ConvertRowFunction)(void* dst, const void* src, int n, const PixelConverter* converter);
+
+// Row conversion between two formats, chosen once per blit. Pairs of built-in formats get specialized kernels,
+// custom formats fall back to PixelToColor + ColorToPixel
+struct PixelConverter {
+    ConvertRowFunction convertRow;
+    const PixelFormat* dstFormat;
+    const PixelFormat* srcFormat;
+    const RowKernels* kernels;
+    RowShuffle shuffle;  // 32-bit to 32-bit with runtime selected kernels
+    ByteLayout dstLayout;
+    ByteLayout srcLayout;
+    bool simd;           // SSE2 loops are allowed for current SIMD level
+    uint32_t lut[256];   // 8-bit sources
+};
+
+void PixelConverterInit(PixelConverter* converter, const PixelFormat* dst, const PixelFormat* src);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_CONVERT_H
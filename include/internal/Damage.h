@@ -0,0 +1,38 @@
+#ifndef LGL_DAMAGE_H
+#define LGL_DAMAGE_H
+#include <stdbool.h>
+
+#include "Rect.h"
+#include "Surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define DAMAGE_MAX_RECTS 16
+// when damaged rects cover more than this percent of the window, the whole frame is presented instead
+#define DAMAGE_FULL_FRAME_PERCENT 60
+
+// Window surface whose damage is tracked, set by platform backends. NULL stops tracking. Collected damage is kept,
+// so backends can switch between buffers of the same size
+void DamageSetTarget(const Surface* target);
+
+// Called by drawing functions with area they modified, in coordinates of the surface they drew on. Surfaces that
+// are not window surface or its subsurface are ignored
+void DamageAdd(Surface surface, Rect rect);
+// Whole window has to be presented, e.g. after it was exposed
+void DamageAddFull(void);
+// While suspended DamageAdd ignores everything, so it can be called from worker threads of renderers that record
+// damage themselves
+void DamageSuspend(bool suspended);
+
+bool DamageIsEnabled(void);
+// Stores rects to present and resets damage for next frame. Returns 0 when nothing changed, and one rect covering
+// whole window when tracking is disabled or damage is too big
+int DamageCollect(Rect* rects, int maxRects);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_DAMAGE_H
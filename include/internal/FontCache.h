@@ -0,0 +1,131 @@
+#ifndef LGL_FONT_CACHE_H
+#define LGL_FONT_CACHE_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Font.h"
+#include "Surface.h"
+
+#define SHAPE_CACHE_BUCKETS 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef struct LruLink {
+    int prev;
+    int next;
+} LruLink;
+
+typedef struct LruList {
+    int head;  // most recently used
+    int tail;  // least recently used, evicted first
+} LruList;
+
+static inline void LruUnlink(LruList* list, LruLink* links, int index) {
+    LruLink* link = &links[index];
+    if (link->prev != -1) links[link->prev].next = link->next;
+    else list->head = link->next;
+    if (link->next != -1) links[link->next].prev = link->prev;
+    else list->tail = link->prev;
+}
+
+static inline void LruPushFront(LruList* list, LruLink* links, int index) {
+    LruLink* link = &links[index];
+    link->prev = -1;
+    link->next = list->head;
+    if (list->head != -1) links[list->head].prev = index;
+    list->head = index;
+    if (list->tail == -1) list->tail = index;
+}
+
+static inline void LruTouch(LruList* list, LruLink* links, int index) {
+    if (list->head == index) return;
+    LruUnlink(list, links, index);
+    LruPushFront(list, links, index);
+}
+
+typedef struct GlyphEntry {
+    uint32_t key;
+    int16_t left;
+    int16_t top;
+    uint16_t width;
+    uint16_t height;
+    int hashNext;
+} GlyphEntry;
+
+// Atlas is a grid of equally sized cells, so every entry owns exactly one cell and eviction never fragments it.
+// Cells are big enough for almost every glyph of the face, the rest is rendered without caching.
+typedef struct GlyphCache {
+    Surface atlas;
+    int cellWidth;
+    int cellHeight;
+    int columns;
+    int capacity;
+    int used;
+    GlyphEntry* entries;
+    LruLink* links;
+    int* buckets;
+    uint32_t bucketMask;
+    LruList lru;
+    FontCacheStats stats;
+} GlyphCache;
+
+static inline int GlyphCacheCapacity(int cellWidth, int cellHeight, size_t budget) {
+    return (int)(budget / (size_t)(cellWidth * cellHeight));
+}
+
+// Returns NULL without error when budget doesn't fit a single glyph
+GlyphCache* GlyphCacheCreate(int cellWidth, int cellHeight, size_t budget);
+void GlyphCacheDestroy(GlyphCache* cache);
+// Counts a hit or a miss, found glyph becomes the most recently used one
+const GlyphEntry* GlyphCacheFind(GlyphCache* cache, uint32_t key);
+// Copies 8-bit coverage of a rendered glyph into the least recently used cell. Returns NULL for glyphs bigger than
+// a cell
+const GlyphEntry* GlyphCacheInsert(GlyphCache* cache, uint32_t key, const uint8_t* coverage, int pitch, int width,
+                                   int height, int left, int top);
+// Coverage of a cached glyph, rows are atlas.stride apart
+const uint8_t* GlyphCacheCoverage(const GlyphCache* cache, const GlyphEntry* entry);
+
+// Glyph infos and positions of a shaped string. Text, infos and positions share one allocation.
+typedef struct ShapedRun {
+    uint32_t hash;
+    int length;
+    uint32_t direction;  // as requested from the shaper, runs of the same text shaped differently are kept apart
+    uint32_t script;
+    unsigned int glyphCount;
+    size_t bytes;
+    char* text;
+    void* infos;         // glyphCount elements of sizes given to ShapeCacheInsert
+    void* positions;
+    int hashNext;
+} ShapedRun;
+
+typedef struct ShapeCache {
+    ShapedRun runs[FONT_SHAPE_CACHE_MAX_RUNS];
+    LruLink links[FONT_SHAPE_CACHE_MAX_RUNS];
+    int buckets[SHAPE_CACHE_BUCKETS];
+    int freeList;
+    size_t bytes;
+    LruList lru;
+} ShapeCache;
+
+void ShapeCacheInit(ShapeCache* cache);
+// Frees every cached run, cache stays usable
+void ShapeCacheClear(ShapeCache* cache);
+uint32_t ShapeCacheHash(const char* text, int length, uint32_t direction, uint32_t script);
+// Found run becomes the most recently used one
+const ShapedRun* ShapeCacheFind(ShapeCache* cache, const char* text, int length, uint32_t direction,
+                                uint32_t script);
+// Copies a shaped string, evicting least recently used runs to stay within FONT_SHAPE_CACHE_MAX_RUNS and
+// FONT_SHAPE_CACHE_BUDGET. Infos and positions are arrays of 32-bit fields. Returns NULL without error for runs
+// bigger than the budget and when memory can't be allocated, caching is only an optimization
+const ShapedRun* ShapeCacheInsert(ShapeCache* cache, const char* text, int length, uint32_t direction,
+                                  uint32_t script, unsigned int glyphCount, const void* infos, size_t infoSize,
+                                  const void* positions, size_t positionSize);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_FONT_CACHE_H
@@ -1,6 +1,9 @@
 #ifndef LGL_INLINES_H
 #define LGL_INLINES_H
 #include <stddef.h>
+#include <stdint.h>
+
+#include "PixelFormat.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,6 +17,10 @@ inline static void Memset4(void* ptr, uint32_t value, size_t n) {
     }
 }
 
+// Exact x / 255 for x in [0, 255 * 255], truncated and rounded to nearest
+#define DIV255(x) (((x) + 1 + ((x) >> 8)) >> 8)
+#define DIV255_ROUND(x) (((x) + 128 + (((x) + 128) >> 8)) >> 8)
+
 inline static Color BlendColors(Color src, Color dst, uint8_t a, uint8_t invA) {
     dst.r = (src.r * a + dst.r * invA) / 255;
     dst.g = (src.g * a + dst.g * invA) / 255;
@@ -22,20 +29,101 @@ inline static Color BlendColors(Color src, Color dst, uint8_t a, uint8_t invA) {
     return dst;
 }
 
+// PixelToColor and ColorToPixel for loops converting every pixel, inlined for straight alpha formats
+static inline Color UnpackPixel(const PixelFormat* format, uint32_t pixel) {
+    if (format->premultiplied) return PixelToColor(format, pixel);
+    return (Color){
+        (uint8_t)(((pixel & format->rMask) >> format->rShift) << format->rLoss),
+        (uint8_t)(((pixel & format->gMask) >> format->gShift) << format->gLoss),
+        (uint8_t)(((pixel & format->bMask) >> format->bShift) << format->bLoss),
+        (uint8_t)(format->aMask == 0 ? 255 : ((pixel & format->aMask) >> format->aShift) << format->aLoss),
+    };
+}
+
+static inline uint32_t PackColor(const PixelFormat* format, Color color) {
+    if (format->premultiplied) return ColorToPixel(format, color);
+    return ((uint32_t)(color.r >> format->rLoss) << format->rShift) |
+           ((uint32_t)(color.g >> format->gLoss) << format->gShift) |
+           ((uint32_t)(color.b >> format->bLoss) << format->bShift) |
+           ((uint32_t)(color.a >> format->aLoss) << format->aShift);
+}
+
+// Single pixel writes for primitives that don't fill spans
+static inline void SetPixel(uint8_t* pixel, uint32_t color, uint8_t bpp) {
+    switch (bpp) {
+        case 1: {
+            *pixel = (uint8_t)color;
+        } break;
+        case 2: {
+            *(uint16_t*)pixel = (uint16_t)color;
+        } break;
+        case 4: {
+            *(uint32_t*)pixel = color;
+        } break;
+        default: break;
+    }
+}
+
+static inline void BlendColorToPixel(uint8_t* pixel, Color color, int a, int invA, uint8_t bpp, const PixelFormat* format) {
+    switch (bpp) {
+        case 1: {
+            Color c = PixelToColor(format, *pixel);
+            c = BlendColors(color, c, a, invA);
+            *pixel = (uint8_t)ColorToPixel(format, c);
+        } break;
+        case 2: {
+            Color c = PixelToColor(format, *(uint16_t*)pixel);
+            c = BlendColors(color, c, a, invA);
+            *(uint16_t*)pixel = (uint16_t)ColorToPixel(format, c);
+        } break;
+        case 4: {
+            Color c = PixelToColor(format, *(uint32_t*)pixel);
+            c = BlendColors(color, c, a, invA);
+            *(uint32_t*)pixel = ColorToPixel(format, c);
+        } break;
+        default: break;
+    }
+}
+
+// Premultiplied source over premultiplied destination: every byte is s + d * (255 - a) / 255, alpha byte included
+static inline uint32_t BlendPremultipliedPixel(uint32_t s, uint32_t d, int alphaShift) {
+    const uint32_t invA = 255 - ((s >> alphaShift) & 0xFF);
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        const uint32_t v = ((s >> shift) & 0xFF) + DIV255_ROUND(((d >> shift) & 0xFF) * invA);
+        out |= ((v > 255) ? 255 : v) << shift;
+    }
+    return out;
+}
+
+// Every byte of a moved towards b by f / 256, for channels of 32-bit pixels in any order
+static inline uint32_t LerpPixelBytes(uint32_t a, uint32_t b, int f) {
+    const uint32_t rb = ((a & 0x00FF00FF) * (uint32_t)(256 - f) + (b & 0x00FF00FF) * (uint32_t)f) >> 8;
+    const uint32_t ag = ((a >> 8) & 0x00FF00FF) * (uint32_t)(256 - f) + ((b >> 8) & 0x00FF00FF) * (uint32_t)f;
+    return (rb & 0x00FF00FF) | (ag & 0xFF00FF00);
+}
+
+// Same result as ColorToPixel(dstFmt, PixelToColor(srcFmt, pixel))
 static inline uint32_t ConvertPixel(uint32_t pixel, const PixelFormat* srcFmt, const PixelFormat* dstFmt) {
-    uint32_t r = 0, g = 0, b = 0, a = 0;
+    if (srcFmt->premultiplied || dstFmt->premultiplied) {
+        return ColorToPixel(dstFmt, PixelToColor(srcFmt, pixel));
+    }
+
+    uint32_t r = 0, g = 0, b = 0, a = 255;
 
     r = ((pixel & srcFmt->rMask) >> srcFmt->rShift) << srcFmt->rLoss;
     g = ((pixel & srcFmt->gMask) >> srcFmt->gShift) << srcFmt->gLoss;
     b = ((pixel & srcFmt->bMask) >> srcFmt->bShift) << srcFmt->bLoss;
-    a = ((pixel & srcFmt->aMask) >> srcFmt->aShift) << srcFmt->aLoss;
+    if (srcFmt->aMask != 0) {
+        a = ((pixel & srcFmt->aMask) >> srcFmt->aShift) << srcFmt->aLoss;
+    }
 
     uint32_t out = 0;
 
-    out |= (r << dstFmt->rShift) >> dstFmt->rLoss;
-    out |= (g << dstFmt->gShift) >> dstFmt->gLoss;
-    out |= (b << dstFmt->bShift) >> dstFmt->bLoss;
-    out |= (a << dstFmt->aShift) >> dstFmt->aLoss;
+    out |= (r >> dstFmt->rLoss) << dstFmt->rShift;
+    out |= (g >> dstFmt->gLoss) << dstFmt->gShift;
+    out |= (b >> dstFmt->bLoss) << dstFmt->bShift;
+    out |= (a >> dstFmt->aLoss) << dstFmt->aShift;
 
     return out;
 }
@@ -0,0 +1,54 @@
+#ifndef LGL_PROFILE_H
+#define LGL_PROFILE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Profiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#ifdef LGL_PROFILE
+
+typedef struct ProfileScope {
+    double start;
+    uint64_t pixels;  // pixel counters of the calling thread when the scope was entered
+    uint64_t zonePixels;
+    bool active;      // only the outermost zone on the drawing thread records frame stats
+    bool traced;      // every scope on every thread becomes a trace event while a trace is recorded
+} ProfileScope;
+
+ProfileScope ProfilerBeginZone(void);
+void ProfilerEndZone(ProfileScope scope, ProfileZone zone);
+void ProfilerAddPixels(long long pixels);
+// While suspended frame stats aren't recorded, so worker threads can call instrumented functions. Traces still are
+void ProfilerSuspend(bool suspended);
+
+// Spans are only traced, for work that isn't a public entry point (glyph rasterization, waiting for present)
+ProfileScope ProfilerBeginSpan(void);
+void ProfilerEndSpan(ProfileScope scope, const char* name, const char* argName, long long arg);
+
+#define PROFILE_BEGIN() const ProfileScope profileScope = ProfilerBeginZone()
+#define PROFILE_END(zone) ProfilerEndZone(profileScope, zone)
+#define PROFILE_PIXELS(pixels) ProfilerAddPixels(pixels)
+#define PROFILE_SUSPEND(suspended) ProfilerSuspend(suspended)
+#define TRACE_BEGIN() const ProfileScope traceScope = ProfilerBeginSpan()
+#define TRACE_END(name, argName, arg) ProfilerEndSpan(traceScope, name, argName, arg)
+
+#else
+
+#define PROFILE_BEGIN() ((void)0)
+#define PROFILE_END(zone) ((void)0)
+#define PROFILE_PIXELS(pixels) ((void)sizeof(pixels))
+#define PROFILE_SUSPEND(suspended) ((void)0)
+#define TRACE_BEGIN() ((void)0)
+#define TRACE_END(name, argName, arg) ((void)sizeof(arg))
+
+#endif  // LGL_PROFILE
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_PROFILE_H
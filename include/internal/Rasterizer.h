@@ -0,0 +1,22 @@
+#ifndef LGL_RASTERIZER_H
+#define LGL_RASTERIZER_H
+#include "DepthBuffer.h"
+#include "Surface.h"
+#include "Triangle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Rasterizer of DrawTriangleShaded and DrawTriangleTextured, without damage and profiling, shared with DrawMesh.
+// Texture is NULL for shaded triangles. With a depth buffer of the same size as surface, depth of vertices (0 to
+// DEPTH_FAR) is interpolated linearly on screen, and pixels are only drawn, and their depth stored, when they are
+// nearer than what the buffer holds
+void RasterizeTriangle(Surface surface, const Vertex* vertices[3], const Surface* texture, TriangleFlags flags,
+                       const DepthBuffer* depthBuffer, const float depth[3]);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_RASTERIZER_H
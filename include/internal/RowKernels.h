@@ -0,0 +1,51 @@
+#ifndef LGL_ROW_KERNELS_H
+#define LGL_ROW_KERNELS_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "PixelFormat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// SSE4.1 and AVX2 kernels are compiled with per-function target attributes and picked at runtime,
+// so the library itself can be built for the baseline instruction set
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LGL_SIMD_DISPATCH 1
+#endif
+
+// Byte index of every channel in a 32-bit format with 8-bit channels, -1 when the channel is missing
+typedef struct ByteLayout {
+    int8_t r;
+    int8_t g;
+    int8_t b;
+    int8_t a;
+} ByteLayout;
+
+// Byte shuffle between two byte-aligned 32-bit formats, 0x80 in mask clears the byte, fill is ORed afterwards
+typedef struct RowShuffle {
+    uint8_t mask[16];
+    uint32_t fill;
+} RowShuffle;
+
+// Blending kernels require alpha channel in the destination format. Premul variants expect both source and
+// destination to be premultiplied, the rest work on straight alpha
+typedef struct RowKernels {
+    void (*blendRow)(uint32_t* dst, const uint32_t* src, int n, int alphaShift);
+    void (*blendSolidRow)(uint32_t* dst, int n, uint32_t pixel, uint8_t alpha, int alphaShift);
+    void (*shuffleRow)(uint32_t* dst, const uint32_t* src, int n, const RowShuffle* shuffle);
+    void (*shuffleBlendRow)(uint32_t* dst, const uint32_t* src, int n, const RowShuffle* shuffle, int alphaShift);
+    void (*blendPremulRow)(uint32_t* dst, const uint32_t* src, int n, int alphaShift);
+    void (*blendPremulSolidRow)(uint32_t* dst, int n, uint32_t pixel, int alphaShift);
+} RowKernels;
+
+bool GetByteLayout(const PixelFormat* format, ByteLayout* layout);
+RowShuffle MakeRowShuffle(ByteLayout src, ByteLayout dst);
+const RowKernels* GetRowKernels(void);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_ROW_KERNELS_H
@@ -0,0 +1,108 @@
+#ifndef LGL_SCANLINE_H
+#define LGL_SCANLINE_H
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Color.h"
+#include "Surface.h"
+#include "internal/BlendFill.h"
+#include "internal/FixedPoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Fill pixels [x0, x1) of row y, clipped to surface
+void FillHLine(Surface surface, int y, int x0, int x1, uint32_t color);
+// Blend color into pixels [x0, x1) of row y, clipped to surface. Damage is left to the caller
+void BlendFillHLine(const BlendFill* fill, int y, int x0, int x1, Color color);
+
+typedef struct ScanEdge {
+    fixed_t x;     // at center of current row
+    fixed_t dxdy;
+    int y0;        // first row whose center is on the edge
+    int y1;        // one past the last one
+    int winding;   // 1 for edges going down, -1 for edges going up
+} ScanEdge;
+
+// Edge table of polygons to fill, with rows clipped to a surface of given size. Memory for all edges and the active
+// edge list is taken once by EdgeListInit
+typedef struct EdgeList {
+    ScanEdge* edges;
+    int count;
+    int capacity;
+    int width;
+    int height;
+    int minY;
+    int maxY;
+} EdgeList;
+
+bool EdgeListInit(EdgeList* list, int maxEdges, int width, int height);
+void EdgeListFree(EdgeList* list);
+
+// Coordinates are 16.16 fixed point with pixel centers at .5. Horizontal edges, edges above or below the surface and
+// edges right of it don't change which pixels are filled, so they aren't stored. Edges past capacity are dropped
+void EdgeListAdd(EdgeList* list, fixed_t x0, fixed_t y0, fixed_t x1, fixed_t y1);
+
+// Fills pixels whose centers are inside with the non-zero or even-odd winding rule. Spans are filled from left to
+// right with every pixel written once, so translucent colors don't darken where polygons overlap
+void EdgeListFill(EdgeList* list, Surface surface, bool evenOdd, Color color);
+
+// Triangle vertices are 24.8 fixed point, which keeps edge functions of any vertices within TRIANGLE_GUARD_BAND
+// pixels from the surface exact in 64-bit integers
+#define TRIANGLE_SUBPIXEL_SHIFT 8
+#define TRIANGLE_SUBPIXEL_ONE (1 << TRIANGLE_SUBPIXEL_SHIFT)
+#define TRIANGLE_GUARD_BAND (1 << 20)
+#define TRIANGLE_BLOCK_ROWS 32
+
+// Edge function E is kept as quotient and remainder of its division by the step per pixel, so the first or last pixel
+// inside the edge is known in every row without dividing
+typedef struct TriangleEdge {
+    int64_t stepX;     // change of E per pixel to the right, positive for left edges, negative for right ones
+    int64_t stepY;     // change of E per row down
+    int64_t quotient;  // floor((E at pixel (0, y) - bias) / |stepX|)
+    int64_t remainder;
+    int64_t divisor;   // |stepX|, or 1 for horizontal edges
+    int64_t rowQuotient;
+    int64_t rowRemainder;
+} TriangleEdge;
+
+// Edge functions of a triangle, positive inside. Pixel (x, y) has its center at vertex coordinates (x, y) and is
+// drawn when the center is inside or on a top or left edge, so triangles sharing an edge never draw it twice
+typedef struct TriangleSetup {
+    TriangleEdge edges[3];
+    int64_t area;     // twice the area in squared subpixels
+    int y;            // first row of next call of TriangleSetupNextSpans
+    int maxY;         // last row that can have pixels, clipped to surface
+    int width;
+} TriangleSetup;
+
+// Returns false for triangles with no area or with no rows on a surface of given size. Vertices are ordered to make
+// edge functions positive, so both windings are drawn
+bool TriangleSetupInit(TriangleSetup* setup, const int32_t x[3], const int32_t y[3], int width, int height);
+// Snaps a coordinate to the subpixel grid, coordinates outside the guard band are clamped to it
+static inline int32_t FloatToSubpixel(float value) {
+    const float limit = (float)TRIANGLE_GUARD_BAND;
+    // NaN fails both comparisons and lands on the lower limit
+    if (!(value > -limit)) value = -limit;
+    if (value > limit) value = limit;
+    return (int32_t)lrintf(value * (float)TRIANGLE_SUBPIXEL_ONE);
+}
+
+typedef struct TriangleSpan {
+    int y;
+    int x0;
+    int x1;
+} TriangleSpan;
+
+// Walks rows from top to bottom, giving pixels [x0, x1) of up to maxSpans next rows inside the triangle clipped to
+// surface. Returns 0 after the last row. Filling spans of a whole block at once keeps stepping edges out of the fill
+// loop, which on big triangles is about twice as fast as interleaving them
+int TriangleSetupNextSpans(TriangleSetup* setup, TriangleSpan* spans, int maxSpans);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_SCANLINE_H
@@ -0,0 +1,26 @@
+#ifndef LGL_THREAD_POOL_H
+#define LGL_THREAD_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef void (*ThreadPoolTask)(void* context, int index);
+
+typedef struct ThreadPool ThreadPool;
+
+// Pool of threadCount - 1 workers, the thread calling ThreadPoolRun is the last one. Platforms without thread support
+// get a pool that runs everything on the calling thread
+ThreadPool* ThreadPoolCreate(int threadCount);
+void ThreadPoolDestroy(ThreadPool* pool);
+int ThreadPoolGetThreadCount(const ThreadPool* pool);
+
+// Calls task for every index in [0, count) and returns when all calls are finished. Indices are handed out one by one,
+// so uneven tasks are balanced between threads
+void ThreadPoolRun(ThreadPool* pool, int count, ThreadPoolTask task, void* context);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // LGL_THREAD_POOL_H
@@ -1,6 +1,8 @@
 #include "BitmapFont.h"
 #include "Error.h"
+#include "internal/Damage.h"
 #include "internal/Inlines.h"
+#include "internal/Profile.h"
 #include "PixelFormat.h"
 
 // Based on Thick 8x8 (https://frostyfreeze.itch.io/pixel-bitmap-fonts-png-xml) 
@@ -337,12 +339,26 @@ static void BlendText(Surface surface, int x, int y, const char* text, const Bit
 void DrawTextBitmapFont(Surface surface, int x, int y, const char* text, const BitmapFont* font, Color color) {
     if (text == NULL || color.a == 0) return;
 
+    int width = 0, height = 0;
+    MeasureBitmapFontText(text, font, &width, &height);
+    DamageAdd(surface, (Rect){ x, y, width, height });
+    PROFILE_BEGIN();
+
+#ifdef LGL_PROFILE
+    const Rect surfaceRect = { 0, 0, surface.width, surface.height };
+    Rect clipped;
+    if (RectIntersection(&surfaceRect, &(Rect){ x, y, width, height }, &clipped)) {
+        PROFILE_PIXELS((long long)clipped.width * clipped.height);
+    }
+#endif  // LGL_PROFILE
+
     if (color.a == 255) {
         FillText(surface, x, y, text, font, ColorToPixel(surface.format, color));
     }
     else {
         BlendText(surface, x, y, text, font, color);
     }
+    PROFILE_END(PROFILE_ZONE_BITMAP_FONT_TEXT);
 }
 
 void MeasureBitmapFontText(const char* text, const BitmapFont* font, int* outWidth, int* outHeight) {
@@ -0,0 +1,331 @@
+#include <string.h>
+
+#include "Allocator.h"
+#include "CommandBuffer.h"
+#include "Cpu.h"
+#include "Draw.h"
+#include "Error.h"
+#include "FillRect.h"
+#include "internal/Damage.h"
+#include "internal/Profile.h"
+#include "internal/ThreadPool.h"
+
+#define COMMAND_BUFFER_INITIAL_CAPACITY 64
+
+typedef enum CommandType {
+    COMMAND_FILL_RECT,
+    COMMAND_DRAW_RECT,
+    COMMAND_DRAW_CIRCLE,
+    COMMAND_DRAW_TRIANGLE,
+    COMMAND_DRAW_LINE,
+    COMMAND_BLIT,
+} CommandType;
+
+typedef struct Command {
+    CommandType type;
+    Rect bounds;  // every pixel the command may modify, used for binning
+    union {
+        struct {
+            Rect rect;
+            uint32_t color;
+        } fill;
+        struct {
+            int x[3];
+            int y[3];
+            int size;  // width of rect or radius of circle
+            int height;
+            Color color;
+        } shape;
+        struct {
+            Surface src;
+            int x;
+            int y;
+        } blit;
+    };
+} Command;
+
+typedef struct TileJob {
+    Surface target;
+    const Command* commands;
+    const int* binStart;  // commands of tile i are indices[binStart[i]] .. indices[binStart[i + 1] - 1]
+    const int* indices;
+    int tilesX;
+} TileJob;
+
+CommandBuffer CommandBufferCreate(int threadCount) {
+    if (threadCount <= 0) threadCount = CpuGetCoreCount();
+
+    // SIMD level is detected lazily, which must not happen on several threads at once
+    CpuDetectSimdLevel();
+
+    ThreadPool* pool = ThreadPoolCreate(threadCount);
+    if (pool == NULL) return (CommandBuffer){ 0 };
+    return (CommandBuffer){ NULL, 0, 0, pool };
+}
+
+void CommandBufferDestroy(CommandBuffer* buffer) {
+    if (buffer == NULL) return;
+    if (buffer->commands != NULL) AllocatorFree(buffer->commands);
+    ThreadPoolDestroy(buffer->pool);
+    *buffer = (CommandBuffer){ 0 };
+}
+
+void CommandBufferClear(CommandBuffer* buffer) {
+    if (buffer == NULL) return;
+    buffer->count = 0;
+}
+
+static Command* PushCommand(CommandBuffer* buffer, CommandType type, Rect bounds) {
+    if (buffer == NULL || buffer->pool == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return NULL;
+    }
+    // nothing would be drawn anyway
+    if (bounds.width <= 0 || bounds.height <= 0) return NULL;
+
+    if (buffer->count == buffer->capacity) {
+        const int capacity = buffer->capacity > 0 ? buffer->capacity << 1 : COMMAND_BUFFER_INITIAL_CAPACITY;
+        Command* commands = AllocatorAlloc(capacity * sizeof(Command));
+        if (commands == NULL) {
+            THROW_ERROR(ERR_OUT_OF_MEMORY);
+            return NULL;
+        }
+        if (buffer->commands != NULL) {
+            memcpy(commands, buffer->commands, buffer->count * sizeof(Command));
+            AllocatorFree(buffer->commands);
+        }
+        buffer->commands = commands;
+        buffer->capacity = capacity;
+    }
+
+    Command* command = (Command*)buffer->commands + buffer->count++;
+    command->type = type;
+    command->bounds = bounds;
+    return command;
+}
+
+void CommandBufferFillRect(CommandBuffer* buffer, const Rect* rect, uint32_t color) {
+    if (rect == NULL) return;
+    Command* command = PushCommand(buffer, COMMAND_FILL_RECT, *rect);
+    if (command == NULL) return;
+    command->fill.rect = *rect;
+    command->fill.color = color;
+}
+
+void CommandBufferDrawRect(CommandBuffer* buffer, int x, int y, int w, int h, Color color) {
+    if (color.a == 0) return;
+    Command* command = PushCommand(buffer, COMMAND_DRAW_RECT, (Rect){ x, y, w, h });
+    if (command == NULL) return;
+    command->shape.x[0] = x;
+    command->shape.y[0] = y;
+    command->shape.size = w;
+    command->shape.height = h;
+    command->shape.color = color;
+}
+
+void CommandBufferDrawCircle(CommandBuffer* buffer, int x, int y, int r, Color color) {
+    if (r <= 0 || color.a == 0) return;
+    Command* command = PushCommand(buffer, COMMAND_DRAW_CIRCLE, (Rect){ x - r, y - r, (r << 1) + 1, (r << 1) + 1 });
+    if (command == NULL) return;
+    command->shape.x[0] = x;
+    command->shape.y[0] = y;
+    command->shape.size = r;
+    command->shape.color = color;
+}
+
+static inline int Min3(int a, int b, int c) {
+    const int m = a < b ? a : b;
+    return m < c ? m : c;
+}
+
+static inline int Max3(int a, int b, int c) {
+    const int m = a > b ? a : b;
+    return m > c ? m : c;
+}
+
+void CommandBufferDrawTriangle(CommandBuffer* buffer, int x1, int y1, int x2, int y2, int x3, int y3, Color color) {
+    if (color.a == 0) return;
+    const int minX = Min3(x1, x2, x3);
+    const int minY = Min3(y1, y2, y3);
+    const Rect bounds = { minX, minY, Max3(x1, x2, x3) - minX + 1, Max3(y1, y2, y3) - minY + 1 };
+    Command* command = PushCommand(buffer, COMMAND_DRAW_TRIANGLE, bounds);
+    if (command == NULL) return;
+    command->shape.x[0] = x1;
+    command->shape.y[0] = y1;
+    command->shape.x[1] = x2;
+    command->shape.y[1] = y2;
+    command->shape.x[2] = x3;
+    command->shape.y[2] = y3;
+    command->shape.color = color;
+}
+
+void CommandBufferDrawLine(CommandBuffer* buffer, int x1, int y1, int x2, int y2, Color color) {
+    if (color.a == 0) return;
+    const int minX = x1 < x2 ? x1 : x2;
+    const int minY = y1 < y2 ? y1 : y2;
+    const Rect bounds = { minX, minY, (x1 < x2 ? x2 : x1) - minX + 1, (y1 < y2 ? y2 : y1) - minY + 1 };
+    Command* command = PushCommand(buffer, COMMAND_DRAW_LINE, bounds);
+    if (command == NULL) return;
+    command->shape.x[0] = x1;
+    command->shape.y[0] = y1;
+    command->shape.x[1] = x2;
+    command->shape.y[1] = y2;
+    command->shape.color = color;
+}
+
+void CommandBufferBlit(CommandBuffer* buffer, Surface src, int x, int y) {
+    if (src.pixels == NULL) return;
+    Command* command = PushCommand(buffer, COMMAND_BLIT, (Rect){ x, y, src.width, src.height });
+    if (command == NULL) return;
+    command->blit.src = src;
+    command->blit.x = x;
+    command->blit.y = y;
+}
+
+// Tile is a subsurface, so coordinates are moved by its position. All primitives are rasterized relative to their
+// own vertices and clipped per pixel or per row, which makes the result independent of that translation
+static void ExecuteCommand(Surface tile, const Command* command, int dx, int dy) {
+    switch (command->type) {
+        case COMMAND_FILL_RECT: {
+            Rect rect = command->fill.rect;
+            rect.x -= dx;
+            rect.y -= dy;
+            FillRect(tile, &rect, command->fill.color);
+        } break;
+        case COMMAND_DRAW_RECT: {
+            const int* x = command->shape.x;
+            const int* y = command->shape.y;
+            DrawRect(tile, x[0] - dx, y[0] - dy, command->shape.size, command->shape.height, command->shape.color);
+        } break;
+        case COMMAND_DRAW_CIRCLE: {
+            const int* x = command->shape.x;
+            const int* y = command->shape.y;
+            DrawCircle(tile, x[0] - dx, y[0] - dy, command->shape.size, command->shape.color);
+        } break;
+        case COMMAND_DRAW_TRIANGLE: {
+            const int* x = command->shape.x;
+            const int* y = command->shape.y;
+            DrawTriangle(tile, x[0] - dx, y[0] - dy, x[1] - dx, y[1] - dy, x[2] - dx, y[2] - dy, command->shape.color);
+        } break;
+        case COMMAND_DRAW_LINE: {
+            const int* x = command->shape.x;
+            const int* y = command->shape.y;
+            DrawLine(tile, x[0] - dx, y[0] - dy, x[1] - dx, y[1] - dy, command->shape.color);
+        } break;
+        case COMMAND_BLIT: {
+            SurfaceBlit(tile, command->blit.src, command->blit.x - dx, command->blit.y - dy);
+        } break;
+        default: break;
+    }
+}
+
+static void RenderTile(void* context, int index) {
+    const TileJob* job = context;
+    const int x = (index % job->tilesX) * COMMAND_BUFFER_TILE_SIZE;
+    const int y = (index / job->tilesX) * COMMAND_BUFFER_TILE_SIZE;
+    const int w = job->target.width - x;
+    const int h = job->target.height - y;
+    const Rect rect = {
+        x, y,
+        w < COMMAND_BUFFER_TILE_SIZE ? w : COMMAND_BUFFER_TILE_SIZE,
+        h < COMMAND_BUFFER_TILE_SIZE ? h : COMMAND_BUFFER_TILE_SIZE
+    };
+    const Surface tile = SurfaceGetSubsurfaceUnchecked(job->target, rect);
+
+    TRACE_BEGIN();
+    for (int i = job->binStart[index]; i < job->binStart[index + 1]; ++i) {
+        ExecuteCommand(tile, &job->commands[job->indices[i]], x, y);
+    }
+    TRACE_END("RenderTile", "commands", job->binStart[index + 1] - job->binStart[index]);
+}
+
+void CommandBufferSubmit(CommandBuffer* buffer, Surface target) {
+    if (buffer == NULL || buffer->pool == NULL || target.pixels == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    if (buffer->count == 0) return;
+    PROFILE_BEGIN();
+
+    const int tilesX = (target.width + COMMAND_BUFFER_TILE_SIZE - 1) / COMMAND_BUFFER_TILE_SIZE;
+    const int tilesY = (target.height + COMMAND_BUFFER_TILE_SIZE - 1) / COMMAND_BUFFER_TILE_SIZE;
+    const int tileCount = tilesX * tilesY;
+    Command* commands = buffer->commands;
+
+    // bins are built in two passes: the first one counts commands of every tile, the second one fills them
+    int* binStart = AllocatorAlloc((2 * tileCount + 1) * sizeof(int));
+    if (binStart == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        PROFILE_END(PROFILE_ZONE_COMMAND_BUFFER_SUBMIT);
+        return;
+    }
+    int* binFill = binStart + tileCount + 1;
+    memset(binStart, 0, (tileCount + 1) * sizeof(int));
+
+    const Rect targetRect = { 0, 0, target.width, target.height };
+    for (int i = 0; i < buffer->count; ++i) {
+        Command* command = &commands[i];
+        Rect clipped;
+        if (!RectIntersection(&targetRect, &command->bounds, &clipped)) {
+            command->bounds.width = 0;
+            continue;
+        }
+        command->bounds = clipped;
+        // workers draw with damage tracking and profiling suspended, so both are recorded here
+        DamageAdd(target, clipped);
+        PROFILE_PIXELS((long long)clipped.width * clipped.height);
+
+        const int tx0 = clipped.x / COMMAND_BUFFER_TILE_SIZE;
+        const int tx1 = (clipped.x + clipped.width - 1) / COMMAND_BUFFER_TILE_SIZE;
+        const int ty0 = clipped.y / COMMAND_BUFFER_TILE_SIZE;
+        const int ty1 = (clipped.y + clipped.height - 1) / COMMAND_BUFFER_TILE_SIZE;
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                ++binStart[ty * tilesX + tx + 1];
+            }
+        }
+    }
+    for (int i = 0; i < tileCount; ++i) {
+        binStart[i + 1] += binStart[i];
+        binFill[i] = binStart[i];
+    }
+
+    const int total = binStart[tileCount];
+    int* indices = total > 0 ? AllocatorAlloc(total * sizeof(int)) : NULL;
+    if (total > 0 && indices == NULL) {
+        AllocatorFree(binStart);
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        PROFILE_END(PROFILE_ZONE_COMMAND_BUFFER_SUBMIT);
+        return;
+    }
+
+    // commands are visited in recorded order, so every bin keeps painter's order
+    for (int i = 0; i < buffer->count; ++i) {
+        const Rect* bounds = &commands[i].bounds;
+        if (bounds->width == 0) continue;
+
+        const int tx0 = bounds->x / COMMAND_BUFFER_TILE_SIZE;
+        const int tx1 = (bounds->x + bounds->width - 1) / COMMAND_BUFFER_TILE_SIZE;
+        const int ty0 = bounds->y / COMMAND_BUFFER_TILE_SIZE;
+        const int ty1 = (bounds->y + bounds->height - 1) / COMMAND_BUFFER_TILE_SIZE;
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                indices[binFill[ty * tilesX + tx]++] = i;
+            }
+        }
+    }
+
+    if (total > 0) {
+        const TileJob job = { target, commands, binStart, indices, tilesX };
+        DamageSuspend(true);
+        PROFILE_SUSPEND(true);
+        ThreadPoolRun(buffer->pool, tileCount, RenderTile, (void*)&job);
+        PROFILE_SUSPEND(false);
+        DamageSuspend(false);
+        AllocatorFree(indices);
+    }
+
+    AllocatorFree(binStart);
+    buffer->count = 0;
+    PROFILE_END(PROFILE_ZONE_COMMAND_BUFFER_SUBMIT);
+}
@@ -0,0 +1,369 @@
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif  // __SSE2__
+#include <stddef.h>
+
+#include "Cpu.h"
+#include "internal/Convert.h"
+#include "internal/Inlines.h"
+
+// Channel layouts of built-in formats: shift and number of bits of r, g, b and a, 0 bits means missing channel
+#define LAYOUT_RGBA8888 24, 8, 16, 8,  8, 8,  0, 8
+#define LAYOUT_ABGR8888  0, 8,  8, 8, 16, 8, 24, 8
+#define LAYOUT_ARGB8888 16, 8,  8, 8,  0, 8, 24, 8
+#define LAYOUT_BGRA8888  8, 8, 16, 8, 24, 8,  0, 8
+#define LAYOUT_RGB565   11, 5,  5, 6,  0, 5,  0, 0
+#define LAYOUT_BGR565    0, 5,  5, 6, 11, 5,  0, 0
+#define LAYOUT_RGB332    5, 3,  2, 3,  0, 2,  0, 0
+#define LAYOUT_BGR233    0, 3,  3, 3,  6, 2,  0, 0
+
+// Moves one channel between layouts with the same result as going through 8-bit Color, missing source channel is
+// treated as 255 (only alpha can be missing)
+static inline uint32_t MoveChannel(uint32_t p, int sShift, int sBits, int dShift, int dBits) {
+    if (dBits == 0) return 0;
+    if (sBits == 0) return ((1u << dBits) - 1) << dShift;
+    const uint32_t v = (p >> sShift) & ((1u << sBits) - 1);
+    return (dBits >= sBits ? v << (dBits - sBits) : v >> (sBits - dBits)) << dShift;
+}
+
+// Every argument except p is a constant, so whole function folds into few shifts and masks
+static inline uint32_t RepackPixel(uint32_t p,
+                                   int sr, int srBits, int sg, int sgBits, int sb, int sbBits, int sa, int saBits,
+                                   int dr, int drBits, int dg, int dgBits, int db, int dbBits, int da, int daBits) {
+    return MoveChannel(p, sr, srBits, dr, drBits) |
+           MoveChannel(p, sg, sgBits, dg, dgBits) |
+           MoveChannel(p, sb, sbBits, db, dbBits) |
+           MoveChannel(p, sa, saBits, da, daBits);
+}
+
+#define REPACK_PIXEL(p, SRC, DST) RepackPixel(p, LAYOUT_##SRC, LAYOUT_##DST)
+
+#ifdef __SSE2__
+
+static inline __m128i MoveChannel_SSE2(__m128i p, int sShift, int sBits, int dShift, int dBits) {
+    if (dBits == 0) return _mm_setzero_si128();
+    if (sBits == 0) return _mm_set1_epi32((int)(((1u << dBits) - 1) << dShift));
+    // keep only bits which survive the conversion, then move them straight to destination position
+    const int kept = (dBits < sBits) ? dBits : sBits;
+    const int from = sShift + sBits - kept;
+    const int to = dShift + dBits - kept;
+    const __m128i v = _mm_and_si128(p, _mm_set1_epi32((int)(((1u << kept) - 1) << from)));
+    return (from >= to) ? _mm_srli_epi32(v, from - to) : _mm_slli_epi32(v, to - from);
+}
+
+static inline __m128i RepackPixels_SSE2(__m128i p,
+                                        int sr, int srBits, int sg, int sgBits, int sb, int sbBits, int sa, int saBits,
+                                        int dr, int drBits, int dg, int dgBits, int db, int dbBits, int da,
+                                        int daBits) {
+    return _mm_or_si128(
+        _mm_or_si128(MoveChannel_SSE2(p, sr, srBits, dr, drBits), MoveChannel_SSE2(p, sg, sgBits, dg, dgBits)),
+        _mm_or_si128(MoveChannel_SSE2(p, sb, sbBits, db, dbBits), MoveChannel_SSE2(p, sa, saBits, da, daBits))
+    );
+}
+
+#define REPACK_PIXELS_SSE2(p, SRC, DST) RepackPixels_SSE2(p, LAYOUT_##SRC, LAYOUT_##DST)
+
+// Packs 32-bit lanes holding 16-bit values, sign extension keeps _mm_packs_epi32 from saturating them
+static inline __m128i Pack32To16_SSE2(__m128i lo, __m128i hi) {
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+}
+
+#endif  // __SSE2__
+
+#define MAKE_CONVERT_FUNCTION(SRC, DST, SRC_TYPE, DST_TYPE)                                                        \
+static void Convert_##SRC##_##DST(void* dst, const void* src, int n, const PixelConverter* converter) {             \
+    (void)converter;                                                                                                \
+    DST_TYPE* d = dst;                                                                                              \
+    const SRC_TYPE* s = src;                                                                                        \
+    for (int i = 0; i < n; ++i) {                                                                                   \
+        d[i] = (DST_TYPE)REPACK_PIXEL(s[i], SRC, DST);                                                              \
+    }                                                                                                               \
+}
+
+#ifdef __SSE2__
+
+#define MAKE_CONVERT_32_TO_16_FUNCTION(SRC, DST)                                                                    \
+static void Convert_##SRC##_##DST(void* dst, const void* src, int n, const PixelConverter* converter) {             \
+    uint16_t* d = dst;                                                                                              \
+    const uint32_t* s = src;                                                                                        \
+    int i = 0;                                                                                                      \
+    if (converter->simd) {                                                                                          \
+        for (; i + 7 < n; i += 8) {                                                                                 \
+            const __m128i lo = REPACK_PIXELS_SSE2(_mm_loadu_si128((const __m128i*)(s + i)), SRC, DST);              \
+            const __m128i hi = REPACK_PIXELS_SSE2(_mm_loadu_si128((const __m128i*)(s + i + 4)), SRC, DST);          \
+            _mm_storeu_si128((__m128i*)(d + i), Pack32To16_SSE2(lo, hi));                                           \
+        }                                                                                                           \
+    }                                                                                                               \
+    for (; i < n; ++i) {                                                                                            \
+        d[i] = (uint16_t)REPACK_PIXEL(s[i], SRC, DST);                                                              \
+    }                                                                                                               \
+}
+
+#define MAKE_CONVERT_16_TO_32_FUNCTION(SRC, DST)                                                                    \
+static void Convert_##SRC##_##DST(void* dst, const void* src, int n, const PixelConverter* converter) {             \
+    uint32_t* d = dst;                                                                                              \
+    const uint16_t* s = src;                                                                                        \
+    int i = 0;                                                                                                      \
+    if (converter->simd) {                                                                                          \
+        const __m128i zero = _mm_setzero_si128();                                                                   \
+        for (; i + 7 < n; i += 8) {                                                                                 \
+            const __m128i p = _mm_loadu_si128((const __m128i*)(s + i));                                             \
+            _mm_storeu_si128((__m128i*)(d + i), REPACK_PIXELS_SSE2(_mm_unpacklo_epi16(p, zero), SRC, DST));         \
+            _mm_storeu_si128((__m128i*)(d + i + 4), REPACK_PIXELS_SSE2(_mm_unpackhi_epi16(p, zero), SRC, DST));     \
+        }                                                                                                           \
+    }                                                                                                               \
+    for (; i < n; ++i) {                                                                                            \
+        d[i] = REPACK_PIXEL(s[i], SRC, DST);                                                                        \
+    }                                                                                                               \
+}
+
+#define MAKE_CONVERT_32_TO_32_FUNCTION(SRC, DST)                                                                    \
+static void Convert_##SRC##_##DST(void* dst, const void* src, int n, const PixelConverter* converter) {             \
+    uint32_t* d = dst;                                                                                              \
+    const uint32_t* s = src;                                                                                        \
+    int i = 0;                                                                                                      \
+    if (converter->simd) {                                                                                          \
+        for (; i + 3 < n; i += 4) {                                                                                 \
+            const __m128i p = _mm_loadu_si128((const __m128i*)(s + i));                                             \
+            _mm_storeu_si128((__m128i*)(d + i), REPACK_PIXELS_SSE2(p, SRC, DST));                                   \
+        }                                                                                                           \
+    }                                                                                                               \
+    for (; i < n; ++i) {                                                                                            \
+        d[i] = REPACK_PIXEL(s[i], SRC, DST);                                                                        \
+    }                                                                                                               \
+}
+
+#else
+
+#define MAKE_CONVERT_32_TO_16_FUNCTION(SRC, DST) MAKE_CONVERT_FUNCTION(SRC, DST, uint32_t, uint16_t)
+#define MAKE_CONVERT_16_TO_32_FUNCTION(SRC, DST) MAKE_CONVERT_FUNCTION(SRC, DST, uint16_t, uint32_t)
+#define MAKE_CONVERT_32_TO_32_FUNCTION(SRC, DST) MAKE_CONVERT_FUNCTION(SRC, DST, uint32_t, uint32_t)
+
+#endif  // __SSE2__
+
+// 32-bit destinations
+#define MAKE_CONVERT_TO_32_FUNCTIONS(DST)                \
+    MAKE_CONVERT_16_TO_32_FUNCTION(RGB565, DST)          \
+    MAKE_CONVERT_16_TO_32_FUNCTION(BGR565, DST)
+
+// 16-bit and 8-bit destinations
+#define MAKE_CONVERT_FROM_32_FUNCTIONS(SRC)                         \
+    MAKE_CONVERT_32_TO_16_FUNCTION(SRC, RGB565)                     \
+    MAKE_CONVERT_32_TO_16_FUNCTION(SRC, BGR565)                     \
+    MAKE_CONVERT_FUNCTION(SRC, RGB332, uint32_t, uint8_t)           \
+    MAKE_CONVERT_FUNCTION(SRC, BGR233, uint32_t, uint8_t)
+
+MAKE_CONVERT_32_TO_32_FUNCTION(RGBA8888, ABGR8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(RGBA8888, ARGB8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(RGBA8888, BGRA8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(ABGR8888, RGBA8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(ABGR8888, ARGB8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(ABGR8888, BGRA8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(ARGB8888, RGBA8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(ARGB8888, ABGR8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(ARGB8888, BGRA8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(BGRA8888, RGBA8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(BGRA8888, ABGR8888)
+MAKE_CONVERT_32_TO_32_FUNCTION(BGRA8888, ARGB8888)
+
+MAKE_CONVERT_FROM_32_FUNCTIONS(RGBA8888)
+MAKE_CONVERT_FROM_32_FUNCTIONS(ABGR8888)
+MAKE_CONVERT_FROM_32_FUNCTIONS(ARGB8888)
+MAKE_CONVERT_FROM_32_FUNCTIONS(BGRA8888)
+
+MAKE_CONVERT_TO_32_FUNCTIONS(RGBA8888)
+MAKE_CONVERT_TO_32_FUNCTIONS(ABGR8888)
+MAKE_CONVERT_TO_32_FUNCTIONS(ARGB8888)
+MAKE_CONVERT_TO_32_FUNCTIONS(BGRA8888)
+
+MAKE_CONVERT_FUNCTION(RGB565, BGR565, uint16_t, uint16_t)
+MAKE_CONVERT_FUNCTION(BGR565, RGB565, uint16_t, uint16_t)
+MAKE_CONVERT_FUNCTION(RGB565, RGB332, uint16_t, uint8_t)
+MAKE_CONVERT_FUNCTION(RGB565, BGR233, uint16_t, uint8_t)
+MAKE_CONVERT_FUNCTION(BGR565, RGB332, uint16_t, uint8_t)
+MAKE_CONVERT_FUNCTION(BGR565, BGR233, uint16_t, uint8_t)
+
+// 8-bit sources have only 256 possible values, so every destination pixel is looked up in converter's table
+#define MAKE_CONVERT_LUT_FUNCTION(TYPE, BYTES)                                                                     \
+static void ConvertLut##BYTES(void* dst, const void* src, int n, const PixelConverter* converter) {                \
+    TYPE* d = dst;                                                                                                 \
+    const uint8_t* s = src;                                                                                        \
+    for (int i = 0; i < n; ++i) {                                                                                  \
+        d[i] = (TYPE)converter->lut[s[i]];                                                                         \
+    }                                                                                                              \
+}
+
+MAKE_CONVERT_LUT_FUNCTION(uint8_t, 1)
+MAKE_CONVERT_LUT_FUNCTION(uint16_t, 2)
+MAKE_CONVERT_LUT_FUNCTION(uint32_t, 4)
+
+#define LOAD_PIXEL(ptr, bpp)         \
+    ((bpp) == 1 ? *(uint8_t*)(ptr) : \
+    (bpp) == 2 ? *(uint16_t*)(ptr) : \
+                 *(uint32_t*)(ptr))
+
+#define STORE_PIXEL(ptr, bpp, value)                              \
+    do {                                                          \
+        switch (bpp) {                                            \
+            case 1: *(uint8_t*)(ptr)  = (uint8_t)(value); break;  \
+            case 2: *(uint16_t*)(ptr) = (uint16_t)(value); break; \
+            case 4: *(uint32_t*)(ptr) = (uint32_t)(value); break; \
+            default: break;                                       \
+        }                                                         \
+    } while (0)
+
+static void ConvertGeneric(void* dst, const void* src, int n, const PixelConverter* converter) {
+    const int srcBpp = converter->srcFormat->bytesPerPixel;
+    const int dstBpp = converter->dstFormat->bytesPerPixel;
+    const uint8_t* s = src;
+    uint8_t* d = dst;
+    while (n--) {
+        const Color c = PixelToColor(converter->srcFormat, LOAD_PIXEL(s, srcBpp));
+        STORE_PIXEL(d, dstBpp, ColorToPixel(converter->dstFormat, c));
+        s += srcBpp;
+        d += dstBpp;
+    }
+}
+
+static void ConvertShuffle(void* dst, const void* src, int n, const PixelConverter* converter) {
+    if (converter->kernels != NULL) {
+        converter->kernels->shuffleRow(dst, src, n, &converter->shuffle);
+        return;
+    }
+    uint32_t* d = dst;
+    const uint32_t* s = src;
+    const uint8_t* mask = converter->shuffle.mask;
+    for (int i = 0; i < n; ++i) {
+        uint32_t out = converter->shuffle.fill;
+        for (int byte = 0; byte < 4; ++byte) {
+            if (mask[byte] != 0x80) out |= ((s[i] >> (mask[byte] << 3)) & 0xFF) << (byte << 3);
+        }
+        d[i] = out;
+    }
+}
+
+// Straight to premultiplied conversion between byte-aligned 32-bit formats, used when loading sprites
+static void ConvertPremultiply(void* dst, const void* src, int n, const PixelConverter* converter) {
+    const ByteLayout sl = converter->srcLayout;
+    const ByteLayout dl = converter->dstLayout;
+    uint32_t* d = dst;
+    const uint32_t* s = src;
+    for (int i = 0; i < n; ++i) {
+        const uint32_t p = s[i];
+        const uint32_t a = (sl.a >= 0) ? (p >> (sl.a << 3)) & 0xFF : 255;
+        const uint32_t r = (p >> (sl.r << 3)) & 0xFF;
+        const uint32_t g = (p >> (sl.g << 3)) & 0xFF;
+        const uint32_t b = (p >> (sl.b << 3)) & 0xFF;
+        d[i] = (DIV255_ROUND(r * a) << (dl.r << 3)) |
+               (DIV255_ROUND(g * a) << (dl.g << 3)) |
+               (DIV255_ROUND(b * a) << (dl.b << 3)) |
+               (a << (dl.a << 3));
+    }
+}
+
+enum {
+    INDEX_RGBA8888,
+    INDEX_ABGR8888,
+    INDEX_ARGB8888,
+    INDEX_BGRA8888,
+    INDEX_RGB565,
+    INDEX_BGR565,
+    INDEX_RGB332,
+    INDEX_BGR233,
+    NUM_FORMATS
+};
+
+#define FROM_32(SRC)                                          \
+    [INDEX_##SRC] = {                                         \
+        [INDEX_RGB565] = Convert_##SRC##_RGB565,              \
+        [INDEX_BGR565] = Convert_##SRC##_BGR565,              \
+        [INDEX_RGB332] = Convert_##SRC##_RGB332,              \
+        [INDEX_BGR233] = Convert_##SRC##_BGR233,              \
+        [INDEX_RGBA8888] = Convert_##SRC##_RGBA8888,          \
+        [INDEX_ABGR8888] = Convert_##SRC##_ABGR8888,          \
+        [INDEX_ARGB8888] = Convert_##SRC##_ARGB8888,          \
+        [INDEX_BGRA8888] = Convert_##SRC##_BGRA8888,          \
+    }
+
+#define FROM_16(SRC)                                          \
+    [INDEX_##SRC] = {                                         \
+        [INDEX_RGB565] = Convert_##SRC##_RGB565,              \
+        [INDEX_BGR565] = Convert_##SRC##_BGR565,              \
+        [INDEX_RGBA8888] = Convert_##SRC##_RGBA8888,          \
+        [INDEX_ABGR8888] = Convert_##SRC##_ABGR8888,          \
+        [INDEX_ARGB8888] = Convert_##SRC##_ARGB8888,          \
+        [INDEX_BGRA8888] = Convert_##SRC##_BGRA8888,          \
+        [INDEX_RGB332] = Convert_##SRC##_RGB332,              \
+        [INDEX_BGR233] = Convert_##SRC##_BGR233,              \
+    }
+
+// pairs with the same format are never converted, so these entries stay NULL
+#define Convert_RGBA8888_RGBA8888 NULL
+#define Convert_ABGR8888_ABGR8888 NULL
+#define Convert_ARGB8888_ARGB8888 NULL
+#define Convert_BGRA8888_BGRA8888 NULL
+#define Convert_RGB565_RGB565 NULL
+#define Convert_BGR565_BGR565 NULL
+
+// Dispatch table indexed with [source][destination], 8-bit sources use lookup tables instead
+static const ConvertRowFunction convertFunctions[NUM_FORMATS][NUM_FORMATS] = {
+    FROM_32(RGBA8888),
+    FROM_32(ABGR8888),
+    FROM_32(ARGB8888),
+    FROM_32(BGRA8888),
+    FROM_16(RGB565),
+    FROM_16(BGR565),
+};
+
+static int FormatIndex(const PixelFormat* format) {
+    if (format == &FORMAT_RGBA8888) return INDEX_RGBA8888;
+    if (format == &FORMAT_ABGR8888) return INDEX_ABGR8888;
+    if (format == &FORMAT_ARGB8888) return INDEX_ARGB8888;
+    if (format == &FORMAT_BGRA8888) return INDEX_BGRA8888;
+    if (format == &FORMAT_RGB565) return INDEX_RGB565;
+    if (format == &FORMAT_BGR565) return INDEX_BGR565;
+    if (format == &FORMAT_RGB332) return INDEX_RGB332;
+    if (format == &FORMAT_BGR233) return INDEX_BGR233;
+    return -1;
+}
+
+void PixelConverterInit(PixelConverter* converter, const PixelFormat* dst, const PixelFormat* src) {
+    converter->dstFormat = dst;
+    converter->srcFormat = src;
+    converter->kernels = GetRowKernels();
+    converter->simd = CpuGetSimdLevel() >= SIMD_LEVEL_SSE2;
+    converter->convertRow = ConvertGeneric;
+
+    if (GetByteLayout(dst, &converter->dstLayout) && GetByteLayout(src, &converter->srcLayout)) {
+        const ByteLayout dl = converter->dstLayout;
+        const ByteLayout sl = converter->srcLayout;
+        // built-in straight pairs have faster scalar and SSE2 kernels below when runtime ones are missing
+        if (src->premultiplied == dst->premultiplied && (converter->kernels != NULL || src->premultiplied)) {
+            converter->shuffle = MakeRowShuffle(sl, dl);
+            converter->convertRow = ConvertShuffle;
+            return;
+        }
+        if (!src->premultiplied && dst->premultiplied && dl.r >= 0 && dl.g >= 0 && dl.b >= 0 && dl.a >= 0 &&
+            sl.r >= 0 && sl.g >= 0 && sl.b >= 0) {
+            converter->convertRow = ConvertPremultiply;
+            return;
+        }
+    }
+
+    if (src->bytesPerPixel == 1 && (dst->bytesPerPixel == 1 || dst->bytesPerPixel == 2 || dst->bytesPerPixel == 4)) {
+        for (int i = 0; i < 256; ++i) {
+            converter->lut[i] = ColorToPixel(dst, PixelToColor(src, (uint32_t)i));
+        }
+        converter->convertRow = (dst->bytesPerPixel == 1) ? ConvertLut1 :
+                                (dst->bytesPerPixel == 2) ? ConvertLut2 : ConvertLut4;
+        return;
+    }
+
+    const int srcIndex = FormatIndex(src);
+    const int dstIndex = FormatIndex(dst);
+    if (srcIndex >= 0 && dstIndex >= 0 && convertFunctions[srcIndex][dstIndex] != NULL) {
+        converter->convertRow = convertFunctions[srcIndex][dstIndex];
+    }
+}
@@ -0,0 +1,70 @@
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "Cpu.h"
+#include "internal/RowKernels.h"
+
+static SimdLevel detectedLevel = SIMD_LEVEL_AUTO;
+static SimdLevel forcedLevel = SIMD_LEVEL_AUTO;
+
+// Highest level supported by both the build and the CPU the program runs on
+SimdLevel CpuDetectSimdLevel(void) {
+    if (detectedLevel != SIMD_LEVEL_AUTO) return detectedLevel;
+
+    SimdLevel level = SIMD_LEVEL_SCALAR;
+#ifdef __SSE2__
+    level = SIMD_LEVEL_SSE2;
+#endif  // __SSE2__
+#ifdef LGL_SIMD_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        level = SIMD_LEVEL_AVX2;
+    }
+    else if (__builtin_cpu_supports("sse4.1")) {
+        level = SIMD_LEVEL_SSE4_1;
+    }
+#endif  // LGL_SIMD_DISPATCH
+
+    detectedLevel = level;
+    return level;
+}
+
+SimdLevel CpuGetSimdLevel(void) {
+    const SimdLevel detected = CpuDetectSimdLevel();
+    if (forcedLevel == SIMD_LEVEL_AUTO || forcedLevel > detected) return detected;
+    return forcedLevel;
+}
+
+// Levels above the detected one can't be executed, so they are clamped
+void CpuForceSimdLevel(SimdLevel level) {
+    forcedLevel = level;
+}
+
+int CpuGetCoreCount(void) {
+    static int count = 0;
+    if (count > 0) return count;
+
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = (int)info.dwNumberOfProcessors;
+#elif defined(__unix__) || defined(__APPLE__)
+    count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count < 1) count = 1;
+    return count;
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SIMD_LEVEL_AUTO:   return "auto";
+        case SIMD_LEVEL_SCALAR: return "scalar";
+        case SIMD_LEVEL_SSE2:   return "SSE2";
+        case SIMD_LEVEL_SSE4_1: return "SSE4.1";
+        case SIMD_LEVEL_AVX2:   return "AVX2";
+        default: return "";
+    }
+}
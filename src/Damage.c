@@ -0,0 +1,162 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal/Damage.h"
+#include "Window.h"
+
+typedef struct Damage {
+    bool enabled;
+    bool suspended;
+    bool full;
+    const uint8_t* pixels;  // window buffer, used to recognize window surface and its subsurfaces
+    int width;
+    int height;
+    int stride;
+    int bytesPerPixel;
+    int count;
+    Rect rects[DAMAGE_MAX_RECTS];
+} Damage;
+
+static Damage damage = { 0 };
+
+static inline long long RectArea(const Rect* rect) {
+    return (long long)rect->width * rect->height;
+}
+
+static inline bool RectContains(const Rect* outer, const Rect* inner) {
+    return inner->x >= outer->x && inner->y >= outer->y &&
+           inner->x + inner->width <= outer->x + outer->width &&
+           inner->y + inner->height <= outer->y + outer->height;
+}
+
+static void RemoveRect(int index) {
+    damage.rects[index] = damage.rects[--damage.count];
+}
+
+static void CheckFullFrameThreshold(void) {
+    long long area = 0;
+    for (int i = 0; i < damage.count; ++i) {
+        area += RectArea(&damage.rects[i]);
+    }
+    if (area * 100 > (long long)damage.width * damage.height * DAMAGE_FULL_FRAME_PERCENT) {
+        damage.full = true;
+        damage.count = 0;
+    }
+}
+
+// Rect is in window coordinates and already clipped
+static void AddWindowRect(Rect rect) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < damage.count; ++i) {
+            const Rect* existing = &damage.rects[i];
+            if (RectContains(existing, &rect)) return;
+
+            // rects are merged when their bounding box wastes no area, e.g. overlapping or touching rects of the
+            // same height, and the merged rect is added again, because it may now cover other rects
+            const Rect bounds = RectUnion(existing, &rect);
+            if (RectContains(&rect, existing) || RectArea(&bounds) <= RectArea(existing) + RectArea(&rect)) {
+                RemoveRect(i);
+                rect = bounds;
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (damage.count == DAMAGE_MAX_RECTS) {
+        // no free slot, so rect is merged with the one that grows least
+        int best = 0;
+        long long bestGrowth = -1;
+        for (int i = 0; i < damage.count; ++i) {
+            const Rect bounds = RectUnion(&damage.rects[i], &rect);
+            const long long growth = RectArea(&bounds) - RectArea(&damage.rects[i]);
+            if (bestGrowth < 0 || growth < bestGrowth) {
+                best = i;
+                bestGrowth = growth;
+            }
+        }
+        const Rect bounds = RectUnion(&damage.rects[best], &rect);
+        RemoveRect(best);
+        AddWindowRect(bounds);
+        return;
+    }
+
+    damage.rects[damage.count++] = rect;
+    CheckFullFrameThreshold();
+}
+
+void DamageSetTarget(const Surface* target) {
+    if (target == NULL || target->pixels == NULL) {
+        damage.pixels = NULL;
+        return;
+    }
+    damage.pixels = target->pixels;
+    damage.width = target->width;
+    damage.height = target->height;
+    damage.stride = target->stride;
+    damage.bytesPerPixel = target->format->bytesPerPixel;
+}
+
+void DamageAdd(Surface surface, Rect rect) {
+    if (!damage.enabled || damage.suspended || damage.full || damage.pixels == NULL) return;
+
+    // subsurfaces share window buffer, so their position is recovered from pixel pointer
+    const uint8_t* pixels = surface.pixels;
+    const ptrdiff_t offset = pixels - damage.pixels;
+    if (offset < 0 || offset >= (ptrdiff_t)damage.stride * damage.height) return;
+
+    rect.x += (int)(offset % damage.stride) / damage.bytesPerPixel;
+    rect.y += (int)(offset / damage.stride);
+
+    const Rect window = { 0, 0, damage.width, damage.height };
+    Rect clipped;
+    if (!RectIntersection(&window, &rect, &clipped)) return;
+
+    AddWindowRect(clipped);
+}
+
+void DamageAddFull(void) {
+    damage.full = true;
+    damage.count = 0;
+}
+
+void DamageSuspend(bool suspended) {
+    damage.suspended = suspended;
+}
+
+bool DamageIsEnabled(void) {
+    return damage.enabled;
+}
+
+int DamageCollect(Rect* rects, int maxRects) {
+    int count = 0;
+    if (!damage.enabled || damage.full || damage.count > maxRects) {
+        rects[0] = (Rect){ 0, 0, damage.width, damage.height };
+        count = 1;
+    }
+    else {
+        for (int i = 0; i < damage.count; ++i) {
+            rects[i] = damage.rects[i];
+        }
+        count = damage.count;
+    }
+
+    damage.full = false;
+    damage.count = 0;
+    return count;
+}
+
+void WindowSetDamageTracking(bool enabled) {
+    damage.enabled = enabled;
+    // anything could have changed while tracking was off
+    damage.full = true;
+    damage.count = 0;
+}
+
+void WindowMarkDirty(Rect rect) {
+    if (damage.pixels == NULL) return;
+    const Surface window = { .pixels = (void*)damage.pixels };
+    DamageAdd(window, rect);
+}
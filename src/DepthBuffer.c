@@ -0,0 +1,39 @@
+#include <stddef.h>
+
+#include "Allocator.h"
+#include "DepthBuffer.h"
+#include "Error.h"
+
+DepthBuffer DepthBufferCreate(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return (DepthBuffer){ 0 };
+    }
+
+    uint16_t* values = AllocatorAlloc((size_t)width * height * sizeof(uint16_t));
+    if (values == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return (DepthBuffer){ 0 };
+    }
+
+    const DepthBuffer buffer = { width, height, values };
+    DepthBufferClear(buffer);
+    return buffer;
+}
+
+void DepthBufferDestroy(DepthBuffer* buffer) {
+    if (buffer == NULL) return;
+    AllocatorFree(buffer->values);
+    *buffer = (DepthBuffer){ 0 };
+}
+
+void DepthBufferClear(DepthBuffer buffer) {
+    if (buffer.values == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    const size_t count = (size_t)buffer.width * buffer.height;
+    for (size_t i = 0; i < count; ++i) {
+        buffer.values[i] = DEPTH_FAR;
+    }
+}
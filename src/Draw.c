@@ -1,103 +1,39 @@
+#include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "Draw.h"
+#include "Error.h"
 #include "FillRect.h"
+#include "internal/BlendFill.h"
+#include "internal/Damage.h"
 #include "internal/FixedPoint.h"
 #include "internal/Inlines.h"
+#include "internal/Profile.h"
+#include "internal/Scanline.h"
+
+// BlendFillRect without its damage and profiling, which primitives do once for all they draw
+static void BlendRect(Surface surface, Rect rect, Color color) {
+    const Rect surfaceRect = { 0, 0, surface.width, surface.height };
+    Rect clipped;
+    if (!RectIntersection(&surfaceRect, &rect, &clipped)) return;
+    PROFILE_PIXELS((long long)clipped.width * clipped.height);
+    const BlendFill fill = BlendFillInit(surface);
+    BlendFillClipped(&fill, clipped, color);
+}
 
 void DrawRect(Surface surface, int x, int y, int w, int h, Color color) {
     const Rect rect = { x, y, w, h };
     if (color.a == 0) return;
+    PROFILE_BEGIN();
     if (color.a == 255) {
         FillRect(surface, &rect, ColorToPixel(surface.format, color));
     }
     else {
-        BlendFillRect(surface, &rect, color);
-    }
-}
-
-static void FillHLine(Surface surface, int y, int x0, int x1, uint32_t color) {
-    if (y < 0 || y >= surface.height) return;
-
-    if (x0 < 0) x0 = 0;
-    if (x1 > surface.width) x1 = surface.width;
-    if (x0 >= x1) return;
-
-    const int bpp = surface.format->bytesPerPixel;
-    const int w = x1 - x0;
-
-    uint8_t* row = (uint8_t*)surface.pixels + y * surface.stride + x0 * bpp;
-
-    switch (bpp) {
-        case 1: {
-            color |= color << 8;
-            color |= color << 16;
-            const int quads = w >> 2;
-            const int offset = quads << 2;
-            int rest = w & 3;
-            Memset4(row, color, quads);
-            uint8_t* p = row + offset;
-            while (rest--) {
-                *p++ = (uint8_t)color;
-            }
-        } break;
-        case 2: {
-            color |= color << 16;
-            const int pairs = w >> 1;
-            const int offset = pairs << 2;
-            const int odd = w & 1;
-            Memset4(row, color, pairs);
-            if (odd) {
-                *(uint16_t*)(row + offset) = (uint16_t)color;
-            }
-        } break;
-        case 4: {
-            Memset4(row, color, w);
-        } break;
-        default: break;
-    }
-}
-
-static void BlendFillHLine(Surface surface, int y, int x0, int x1, Color color) {
-    if (y < 0 || y >= surface.height) return;
-
-    if (x0 < 0) x0 = 0;
-    if (x1 > surface.width) x1 = surface.width;
-    if (x0 >= x1) return;
-
-    const uint8_t bpp = surface.format->bytesPerPixel;
-    const uint8_t a = color.a;
-    const uint8_t invA = 255 - a;
-
-    uint8_t* row = (uint8_t*)surface.pixels + y * surface.stride + x0 * bpp;
-    int n = x1 - x0;
-    switch (bpp) {
-        case 1: {
-            uint8_t* pixel = row;
-            while (n--) {
-                Color c = PixelToColor(surface.format, *pixel);
-                c = BlendColors(color, c, a, invA);
-                *pixel++ = (uint8_t)ColorToPixel(surface.format, c);
-            }
-        } break;
-        case 2: {
-            uint16_t* pixel = (uint16_t*)row;
-            while (n--) {
-                Color c = PixelToColor(surface.format, *pixel);
-                c = BlendColors(color, c, a, invA);
-                *pixel++ = (uint16_t)ColorToPixel(surface.format, c);
-            }
-        } break;
-        case 4: {
-            uint32_t* pixel = (uint32_t*)row;
-            while (n--) {
-                Color c = PixelToColor(surface.format, *pixel);
-                c = BlendColors(color, c, a, invA);
-                *pixel++ = ColorToPixel(surface.format, c);
-            }
-        } break;
-        default: break;
+        DamageAdd(surface, rect);
+        BlendRect(surface, rect, color);
     }
+    PROFILE_END(PROFILE_ZONE_DRAW_RECT);
 }
 
 // Based on https://stackoverflow.com/questions/10878209/midpoint-circle-algorithm-for-filled-circles by colinday
@@ -132,6 +68,7 @@ static void FillCircle(Surface surface, int cx, int cy, int r, uint32_t color) {
 }
 
 static void BlendFillCircle(Surface surface, int cx, int cy, int r, Color color) {
+    const BlendFill fill = BlendFillInit(surface);
     int x = r;
     int y = 0;
     int d = 1 - x;
@@ -139,9 +76,9 @@ static void BlendFillCircle(Surface surface, int cx, int cy, int r, Color color)
     while (x >= y) {
         int startX = cx - x;
         int endX = cx + x;
-        BlendFillHLine(surface, cy + y, startX, endX, color);
+        BlendFillHLine(&fill, cy + y, startX, endX, color);
         if (y != 0) {
-            BlendFillHLine(surface, cy - y, startX, endX, color);
+            BlendFillHLine(&fill, cy - y, startX, endX, color);
         }
         ++y;
 
@@ -152,8 +89,8 @@ static void BlendFillCircle(Surface surface, int cx, int cy, int r, Color color)
             if (x >= y) {
                 startX = cx - y + 1;
                 endX = cx + y - 1;
-                BlendFillHLine(surface, cy + x, startX, endX, color);
-                BlendFillHLine(surface, cy - x, startX, endX, color);
+                BlendFillHLine(&fill, cy + x, startX, endX, color);
+                BlendFillHLine(&fill, cy - x, startX, endX, color);
             }
             --x;
             d += (y - x + 1) << 1;
@@ -163,218 +100,542 @@ static void BlendFillCircle(Surface surface, int cx, int cy, int r, Color color)
 
 void DrawCircle(Surface surface, int x, int y, int r, Color color) {
     if (r <= 0 || color.a == 0) return;
+    DamageAdd(surface, (Rect){ x - r, y - r, (r << 1) + 1, (r << 1) + 1 });
+    PROFILE_BEGIN();
     if (color.a == 255) {
         FillCircle(surface, x, y, r, ColorToPixel(surface.format, color));
     }
     else {
         BlendFillCircle(surface, x, y, r, color);
     }
+    PROFILE_END(PROFILE_ZONE_DRAW_CIRCLE);
 }
 
-static void SortTrianglePointsAscendingByY(int* x1, int* y1, int* x2, int* y2, int* x3, int* y3) {
-    if (*y1 > *y3) {
-        const int tx = *x1, ty = *y1;
-        *x1 = *x3, *y1 = *y3;
-        *x3 = tx, *y3 = ty;
-    }
-
-    if (*y1 > *y2) {
-        const int tx = *x1, ty = *y1;
-        *x1 = *x2, *y1 = *y2;
-        *x2 = tx, *y2 = ty;
-    }
-
-    if (*y2 > *y3) {
-        const int tx = *x2, ty = *y2;
-        *x2 = *x3, *y2 = *y3;
-        *x3 = tx, *y3 = ty;
+static void FillTriangle(Surface surface, const int32_t x[3], const int32_t y[3], Color color) {
+    TriangleSetup setup;
+    if (!TriangleSetupInit(&setup, x, y, surface.width, surface.height)) return;
+
+    const uint32_t pixel = ColorToPixel(surface.format, color);
+    const BlendFill fill = BlendFillInit(surface);
+    TriangleSpan spans[TRIANGLE_BLOCK_ROWS];
+    int count;
+    while ((count = TriangleSetupNextSpans(&setup, spans, TRIANGLE_BLOCK_ROWS)) > 0) {
+        for (int i = 0; i < count; ++i) {
+            if (color.a == 255) {
+                FillHLine(surface, spans[i].y, spans[i].x0, spans[i].x1, pixel);
+            }
+            else {
+                BlendFillHLine(&fill, spans[i].y, spans[i].x0, spans[i].x1, color);
+            }
+        }
     }
 }
 
-static void SwapInts(int* a, int* b) {
-    const int temp = *a;
-    *a = *b;
-    *b = temp;
+static inline int32_t ClampToGuardBand(int value) {
+    if (value < -TRIANGLE_GUARD_BAND) return -TRIANGLE_GUARD_BAND;
+    if (value > TRIANGLE_GUARD_BAND) return TRIANGLE_GUARD_BAND;
+    return value;
 }
 
-// TODO: check if making exact copy of fill functions but for blending really enhances performance
+void DrawTriangle(Surface surface, int x1, int y1, int x2, int y2, int x3, int y3, Color color) {
+    if (color.a == 0) return;
+    const int minX = (x1 < x2) ? ((x1 < x3) ? x1 : x3) : ((x2 < x3) ? x2 : x3);
+    const int maxX = (x1 > x2) ? ((x1 > x3) ? x1 : x3) : ((x2 > x3) ? x2 : x3);
+    const int minY = (y1 < y2) ? ((y1 < y3) ? y1 : y3) : ((y2 < y3) ? y2 : y3);
+    const int maxY = (y1 > y2) ? ((y1 > y3) ? y1 : y3) : ((y2 > y3) ? y2 : y3);
+    DamageAdd(surface, (Rect){ minX, minY, maxX - minX + 1, maxY - minY + 1 });
+    PROFILE_BEGIN();
+    const int32_t x[3] = {
+        ClampToGuardBand(x1) * TRIANGLE_SUBPIXEL_ONE,
+        ClampToGuardBand(x2) * TRIANGLE_SUBPIXEL_ONE,
+        ClampToGuardBand(x3) * TRIANGLE_SUBPIXEL_ONE,
+    };
+    const int32_t y[3] = {
+        ClampToGuardBand(y1) * TRIANGLE_SUBPIXEL_ONE,
+        ClampToGuardBand(y2) * TRIANGLE_SUBPIXEL_ONE,
+        ClampToGuardBand(y3) * TRIANGLE_SUBPIXEL_ONE,
+    };
+    FillTriangle(surface, x, y, color);
+    PROFILE_END(PROFILE_ZONE_DRAW_TRIANGLE);
+}
 
-static void FillTriangleFlatTop(Surface surface, int x1, int x2, int y1_2, int x3, int y3, uint32_t color) {
-    const int dy = y3 - y1_2;
+void DrawTriangleF(Surface surface, Point p1, Point p2, Point p3, Color color) {
+    if (color.a == 0) return;
+    const float minX = fminf(p1.x, fminf(p2.x, p3.x));
+    const float maxX = fmaxf(p1.x, fmaxf(p2.x, p3.x));
+    const float minY = fminf(p1.y, fminf(p2.y, p3.y));
+    const float maxY = fmaxf(p1.y, fmaxf(p2.y, p3.y));
+    if (maxX < 0.0f || maxY < 0.0f || minX >= (float)surface.width || minY >= (float)surface.height) return;
+    DamageAdd(surface, (Rect){
+        (int)floorf(minX), (int)floorf(minY), (int)ceilf(maxX - minX) + 2, (int)ceilf(maxY - minY) + 2
+    });
+    PROFILE_BEGIN();
+    const int32_t x[3] = { FloatToSubpixel(p1.x), FloatToSubpixel(p2.x), FloatToSubpixel(p3.x) };
+    const int32_t y[3] = { FloatToSubpixel(p1.y), FloatToSubpixel(p2.y), FloatToSubpixel(p3.y) };
+    FillTriangle(surface, x, y, color);
+    PROFILE_END(PROFILE_ZONE_DRAW_TRIANGLE);
+}
 
-    fixed_t xl = TO_FIXED(x1);
-    fixed_t xr = TO_FIXED(x2);
+// Lines are walked along their major axis: pixel i is at m1 + sm * i on it and at n1 + sn * round(i * minor / major)
+// on the minor one, ties rounded up. Clipping computes the range of i inside the surface from that formula, so clipped
+// lines have exactly the pixels of unclipped ones and off-surface parts aren't visited at all
+static bool ClipLineSteps(int m1, int sm, int majorSize, int n1, int sn, int minorSize, int major, int minor,
+                          int* first, int* last) {
+    *first = 0;
+    *last = major;
+
+    const int majorLo = sm > 0 ? -m1 : m1 - (majorSize - 1);
+    const int majorHi = sm > 0 ? majorSize - 1 - m1 : m1;
+    if (majorLo > *first) *first = majorLo;
+    if (majorHi < *last) *last = majorHi;
+
+    // offsets on the minor axis, round(i * minor / major) >= lo <=> 2 * i * minor >= (2 * lo - 1) * major
+    const int minorLo = sn > 0 ? -n1 : n1 - (minorSize - 1);
+    const int minorHi = sn > 0 ? minorSize - 1 - n1 : n1;
+    if (minorHi < 0) return false;
+    if (minorLo > 0) {
+        const int64_t num = (2 * (int64_t)minorLo - 1) * major;
+        const int64_t den = 2 * (int64_t)minor;
+        const int64_t i = (num + den - 1) / den;
+        if (i > *first) *first = i > major ? major + 1 : (int)i;
+    }
+    {
+        const int64_t num = (2 * (int64_t)minorHi + 1) * major;
+        const int64_t den = 2 * (int64_t)minor;
+        const int64_t i = (num + den - 1) / den - 1;
+        if (i < *last) *last = (int)i;
+    }
+    return *first <= *last;
+}
 
-    const fixed_t dx1 = FIXED_DIV(x3 - x1, dy);
-    const fixed_t dx2 = FIXED_DIV(x3 - x2, dy);
+void DrawLine(Surface surface, int x1, int y1, int x2, int y2, Color color) {
+    if (color.a == 0) return;
+    DamageAdd(surface, (Rect){ (x1 < x2) ? x1 : x2, (y1 < y2) ? y1 : y2, abs(x2 - x1) + 1, abs(y2 - y1) + 1 });
+    PROFILE_BEGIN();
 
-    for (int y = y1_2; y <= y3; ++y) {
-        FillHLine(surface, y, FIXED_INT_PART(xl), FIXED_INT_PART(xr), color);
-        xl += dx1;
-        xr += dx2;
+    if (x1 == x2 || y1 == y2) {
+        // axis-aligned lines are one pixel wide rects, which are filled as spans
+        const Rect rect = { (x1 < x2) ? x1 : x2, (y1 < y2) ? y1 : y2, abs(x2 - x1) + 1, abs(y2 - y1) + 1 };
+        if (color.a == 255) {
+            FillRect(surface, &rect, ColorToPixel(surface.format, color));
+        }
+        else {
+            BlendRect(surface, rect, color);
+        }
+        PROFILE_END(PROFILE_ZONE_DRAW_LINE);
+        return;
     }
-}
 
-static void FillTriangleFlatBottom(Surface surface, int x1, int y1, int x2, int x3, int y2_3, uint32_t color) {
-    const int dy = y2_3 - y1;
+    const uint32_t c = ColorToPixel(surface.format, color);
+    const int a = color.a;
+    const int invA = 255 - a;
+    const uint8_t bpp = surface.format->bytesPerPixel;
 
-    fixed_t xl = TO_FIXED(x1);
-    fixed_t xr = TO_FIXED(x1);
+    const int dx = abs(x2 - x1);
+    const int dy = abs(y2 - y1);
+    const int sx = x1 < x2 ? 1 : -1;
+    const int sy = y1 < y2 ? 1 : -1;
+    const bool steep = dy > dx;
+
+    const int major = steep ? dy : dx;
+    const int minor = steep ? dx : dy;
+    const int sm = steep ? sy : sx;
+    const int sn = steep ? sx : sy;
+
+    int first, last;
+    const bool visible = steep
+        ? ClipLineSteps(y1, sy, surface.height, x1, sx, surface.width, major, minor, &first, &last)
+        : ClipLineSteps(x1, sx, surface.width, y1, sy, surface.height, major, minor, &first, &last);
+    if (!visible) {
+        PROFILE_END(PROFILE_ZONE_DRAW_LINE);
+        return;
+    }
 
-    const fixed_t dx1 = FIXED_DIV(x2 - x1, dy);
-    const fixed_t dx2 = FIXED_DIV(x3 - x1, dy);
+    // err is the remainder of 2 * i * minor + major divided by 2 * major
+    const int64_t num = 2 * (int64_t)first * minor + major;
+    const int q = (int)(num / (2 * (int64_t)major));
+    int err = (int)(num % (2 * (int64_t)major));
+    const int x = steep ? x1 + sn * q : x1 + sm * first;
+    const int y = steep ? y1 + sm * first : y1 + sn * q;
+
+    const ptrdiff_t majorStep = steep ? sm * (ptrdiff_t)surface.stride : sm * bpp;
+    const ptrdiff_t minorStep = steep ? sn * bpp : sn * (ptrdiff_t)surface.stride;
+    ptrdiff_t offset = (ptrdiff_t)y * surface.stride + (ptrdiff_t)x * bpp;
+
+    for (int i = first; i <= last; ++i) {
+        uint8_t* pixel = (uint8_t*)surface.pixels + offset;
+        if (a == 255) {
+            SetPixel(pixel, c, bpp);
+        }
+        else {
+            BlendColorToPixel(pixel, color, a, invA, bpp, surface.format);
+        }
 
-    for (int y = y1; y <= y2_3; ++y) {
-        FillHLine(surface, y, FIXED_INT_PART(xl), FIXED_INT_PART(xr), color);
-        xl += dx1;
-        xr += dx2;
+        err += minor << 1;
+        if (err >= major << 1) {
+            err -= major << 1;
+            offset += minorStep;
+        }
+        offset += majorStep;
     }
+    PROFILE_PIXELS(last - first + 1);
+    PROFILE_END(PROFILE_ZONE_DRAW_LINE);
 }
 
-static void BlendTriangleFlatTop(Surface surface, int x1, int x2, int y1_2, int x3, int y3, Color color) {
-    const int dy = y3 - y1_2;
-
-    fixed_t xl = TO_FIXED(x1);
-    fixed_t xr = TO_FIXED(x2);
+// Liang-Barsky clipping of a segment to [minX, maxX] x [minY, maxY]
+static bool ClipSegment(float* x1, float* y1, float* x2, float* y2, float minX, float minY, float maxX, float maxY) {
+    const float dx = *x2 - *x1;
+    const float dy = *y2 - *y1;
+    const float p[4] = { -dx, dx, -dy, dy };
+    const float q[4] = { *x1 - minX, maxX - *x1, *y1 - minY, maxY - *y1 };
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0f) {
+            if (q[i] < 0.0f) return false;
+            continue;
+        }
+        const float t = q[i] / p[i];
+        if (p[i] < 0.0f) {
+            if (t > t1) return false;
+            if (t > t0) t0 = t;
+        }
+        else {
+            if (t < t0) return false;
+            if (t < t1) t1 = t;
+        }
+    }
 
-    const fixed_t dx1 = FIXED_DIV(x3 - x1, dy);
-    const fixed_t dx2 = FIXED_DIV(x3 - x2, dy);
+    const float x0 = *x1;
+    const float y0 = *y1;
+    *x1 = x0 + t0 * dx;
+    *y1 = y0 + t0 * dy;
+    *x2 = x0 + t1 * dx;
+    *y2 = y0 + t1 * dy;
+    return true;
+}
 
-    for (int y = y1_2; y <= y3; ++y) {
-        BlendFillHLine(surface, y, FIXED_INT_PART(xl), FIXED_INT_PART(xr), color);
-        xl += dx1;
-        xr += dx2;
+// Coverage is in [0, 255]. Pixel (x, y) is covered fully by a line going through its integer coordinates
+static inline void PlotCoverage(Surface surface, int x, int y, int coverage, Color color, bool steep) {
+    if (steep) {
+        const int t = x;
+        x = y;
+        y = t;
     }
+    if (x < 0 || x >= surface.width || y < 0 || y >= surface.height) return;
+    const int a = (color.a * coverage + 127) / 255;
+    if (a == 0) return;
+    const uint8_t bpp = surface.format->bytesPerPixel;
+    uint8_t* pixel = (uint8_t*)surface.pixels + y * surface.stride + x * bpp;
+    BlendColorToPixel(pixel, color, a, 255 - a, bpp, surface.format);
 }
 
-static void BlendTriangleFlatBottom(Surface surface, int x1, int y1, int x2, int x3, int y2_3, Color color) {
-    const int dy = y2_3 - y1;
-
-    fixed_t xl = TO_FIXED(x1);                    
-    fixed_t xr = TO_FIXED(x2);                    
+void DrawLineAA(Surface surface, float x1, float y1, float x2, float y2, Color color) {
+    if (color.a == 0) return;
+    // a line covers pixels up to one pixel away from it, everything further out is cut before rasterizing
+    if (!ClipSegment(&x1, &y1, &x2, &y2, -1.0f, -1.0f, (float)surface.width, (float)surface.height)) return;
+    {
+        const int minX = (int)floorf(x1 < x2 ? x1 : x2);
+        const int minY = (int)floorf(y1 < y2 ? y1 : y2);
+        const int maxX = (int)ceilf(x1 > x2 ? x1 : x2);
+        const int maxY = (int)ceilf(y1 > y2 ? y1 : y2);
+        DamageAdd(surface, (Rect){ minX, minY, maxX - minX + 2, maxY - minY + 2 });
+    }
+    PROFILE_BEGIN();
 
-    const fixed_t dx1 = FIXED_DIV(x3 - x1, dy);   
-    const fixed_t dx2 = FIXED_DIV(x3 - x2, dy);   
+    // Xiaolin Wu's algorithm, walking along major axis with minor coordinate in fixed point
+    const bool steep = fabsf(y2 - y1) > fabsf(x2 - x1);
+    if (steep) {
+        float t = x1; x1 = y1; y1 = t;
+        t = x2; x2 = y2; y2 = t;
+    }
+    if (x1 > x2) {
+        float t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+    }
+    const float dx = x2 - x1;
+    const float gradient = dx == 0.0f ? 1.0f : (y2 - y1) / dx;
+    int drawn = 0;
+
+    // endpoints are weighted by how much of their pixel the line spans on major axis
+    const int xStart = (int)floorf(x1 + 0.5f);
+    const int xEnd = (int)floorf(x2 + 0.5f);
+    fixed_t intery = (fixed_t)((y1 + gradient * ((float)xStart - x1)) * FIXED_ONE);
+    const fixed_t step = (fixed_t)(gradient * FIXED_ONE);
+    {
+        const float gap = 1.0f - (x1 + 0.5f - floorf(x1 + 0.5f));
+        const int y = FIXED_INT_PART(intery);
+        const int frac = (intery & (FIXED_ONE - 1)) >> (FIXED_SHIFT - 8);
+        PlotCoverage(surface, xStart, y, (int)((255 - frac) * gap), color, steep);
+        PlotCoverage(surface, xStart, y + 1, (int)(frac * gap), color, steep);
+        drawn += 2;
+    }
+    if (xEnd != xStart) {
+        const fixed_t yEnd = (fixed_t)((y2 + gradient * ((float)xEnd - x2)) * FIXED_ONE);
+        const float gap = x2 + 0.5f - floorf(x2 + 0.5f);
+        const int y = FIXED_INT_PART(yEnd);
+        const int frac = (yEnd & (FIXED_ONE - 1)) >> (FIXED_SHIFT - 8);
+        PlotCoverage(surface, xEnd, y, (int)((255 - frac) * gap), color, steep);
+        PlotCoverage(surface, xEnd, y + 1, (int)(frac * gap), color, steep);
+        drawn += 2;
+    }
 
-    for (int y = y1; y <= y2_3; ++y) {
-        BlendFillHLine(surface, y, FIXED_INT_PART(xl), FIXED_INT_PART(xr), color);
-        xl += dx1;
-        xr += dx2;
+    intery += step;
+    for (int x = xStart + 1; x < xEnd; ++x) {
+        const int y = FIXED_INT_PART(intery);
+        const int frac = (intery & (FIXED_ONE - 1)) >> (FIXED_SHIFT - 8);
+        PlotCoverage(surface, x, y, 255 - frac, color, steep);
+        PlotCoverage(surface, x, y + 1, frac, color, steep);
+        intery += step;
+        drawn += 2;
     }
+    PROFILE_PIXELS(drawn);
+    PROFILE_END(PROFILE_ZONE_DRAW_LINE_AA);
 }
 
-void DrawTriangle(Surface surface, int x1, int y1, int x2, int y2, int x3, int y3, Color color) {
-    if (color.a == 0) return;
-    SortTrianglePointsAscendingByY(&x1, &y1, &x2, &y2, &x3, &y3);
-    const uint32_t c = ColorToPixel(surface.format, color);
+// Arcs of round joins and caps are split so that segments are about two pixels long
+static int ArcSegments(float radius) {
+    const int segments = (int)(radius * 3.14159265f);
+    return segments < 8 ? 8 : segments > 64 ? 64 : segments;
+}
 
-    if (y2 == y3) {
-        if (x2 > x3) {
-            SwapInts(&x2, &x3);
-        }
-        if (color.a == 255) {
-            FillTriangleFlatBottom(surface, x1, y1, x2, x3, y3, c);
-        }
-        else {
-            BlendTriangleFlatBottom(surface, x1, y1, x2, x3, y3, color);
+static inline fixed_t PointToFixed(double v) {
+    // points have pixel centers at integers, scanline coordinates at .5
+    return (fixed_t)lrint((v + 0.5) * (double)FIXED_ONE);
+}
+
+static void AddClampedEdge(EdgeList* list, double x0, double y0, double x1, double y1) {
+    const double left = -1.0;
+    const double right = (double)list->width + 1.0;
+    x0 = fmin(fmax(x0, left), right);
+    x1 = fmin(fmax(x1, left), right);
+    EdgeListAdd(list, PointToFixed(x0), PointToFixed(y0), PointToFixed(x1), PointToFixed(y1));
+}
+
+// 16.16 fixed point only reaches about 32767 pixels, so before converting edges are clipped to rows of the surface and
+// split where they cross columns one pixel past its left and right sides. Pieces left of them become vertical edges,
+// which still count towards winding of pixels right of them, pieces right of them are dropped. Every edge takes up to
+// two entries of the list
+static void AddEdge(EdgeList* list, Point a, Point b) {
+    double x0 = a.x, y0 = a.y, x1 = b.x, y1 = b.y;
+    if (!isfinite(x0) || !isfinite(y0) || !isfinite(x1) || !isfinite(y1) || y0 == y1) return;
+
+    const double top = -1.0;
+    const double bottom = (double)list->height + 1.0;
+    if ((y0 < top && y1 < top) || (y0 > bottom && y1 > bottom)) return;
+    // clipped ends are moved along the edge, so its direction doesn't change
+    const double slope = (x1 - x0) / (y1 - y0);
+    const double clipped0 = fmin(fmax(y0, top), bottom);
+    const double clipped1 = fmin(fmax(y1, top), bottom);
+    if (clipped0 != y0) x0 += (clipped0 - y0) * slope;
+    if (clipped1 != y1) x1 += (clipped1 - y1) * slope;
+    y0 = clipped0;
+    y1 = clipped1;
+
+    const double left = -1.0;
+    const double right = (double)list->width + 1.0;
+    const double borders[2] = { x0 < x1 ? left : right, x0 < x1 ? right : left };
+    for (int i = 0; i < 2; ++i) {
+        if ((x0 < borders[i]) != (x1 < borders[i])) {
+            const double y = y0 + (borders[i] - x0) * (y1 - y0) / (x1 - x0);
+            AddClampedEdge(list, x0, y0, borders[i], y);
+            x0 = borders[i];
+            y0 = y;
         }
     }
-    else if (y1 == y2) {
-        if (x1 > x2) {
-            SwapInts(&x1, &x2);
-        }
-        if (color.a == 255) {
-            FillTriangleFlatTop(surface, x1, x2, y2, x3, y3, c);
-        }
-        else {
-            BlendTriangleFlatTop(surface, x1, x2, y2, x3, y3, color);
-        }
+    AddClampedEdge(list, x0, y0, x1, y1);
+}
+
+// Every piece of a stroke is convex and added with the same orientation, so with non-zero rule their union is filled
+static void AddConvexPolygon(EdgeList* list, const Point* points, int count) {
+    float area = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        const Point* a = &points[i];
+        const Point* b = &points[(i + 1) % count];
+        area += a->x * b->y - b->x * a->y;
     }
-    else {
-        // TODO: use fixed point arithmetic here
-        int x4 = x1 + (int)(((float)(y2 - y1) / (float)(y3 - y1)) * (float)(x3 - x1));
-        if (x2 > x4) SwapInts(&x4, &x2);
-        if (color.a == 255) {
-            FillTriangleFlatBottom(surface, x1, y1, x2, x4, y2 - 1, c);
-            FillTriangleFlatTop(surface, x2, x4, y2, x3, y3, c);
-        }
-        else {
-            BlendTriangleFlatBottom(surface, x1, y1, x2, x4, y2 - 1, color);
-            BlendTriangleFlatTop(surface, x2, x4, y2, x3, y3, color);
+    for (int i = 0; i < count; ++i) {
+        const Point* a = &points[i];
+        const Point* b = &points[(i + 1) % count];
+        if (area < 0.0f) {
+            const Point* t = a; a = b; b = t;
         }
+        AddEdge(list, *a, *b);
     }
 }
 
-static inline void SetPixel(uint8_t* pixel, uint32_t color, uint8_t bpp) {
-    switch (bpp) {
-        case 1: {
-            *pixel = (uint8_t)color;
-        } break;
-        case 2: {
-            *(uint16_t*)pixel = (uint16_t)color;
-        } break;
-        case 4: {
-            *(uint32_t*)pixel = color;
-        } break;
-        default: break;
+static void AddDisc(EdgeList* list, Point center, float radius) {
+    Point points[64];
+    const int segments = ArcSegments(radius);
+    for (int i = 0; i < segments; ++i) {
+        const float angle = 2.0f * 3.14159265f * (float)i / (float)segments;
+        points[i] = (Point){ center.x + radius * cosf(angle), center.y + radius * sinf(angle) };
     }
+    AddConvexPolygon(list, points, segments);
 }
 
-static inline void BlendPixel(uint8_t* pixel, Color color, int a, int invA, uint8_t bpp, const PixelFormat* format) {
-    switch (bpp) {
-        case 1: {
-            Color c = PixelToColor(format, *pixel);
-            c = BlendColors(color, c, a, invA);
-            *pixel = (uint8_t)ColorToPixel(format, c);
-        } break;
-        case 2: {
-            Color c = PixelToColor(format, *(uint16_t*)pixel);
-            c = BlendColors(color, c, a, invA);
-            *(uint16_t*)pixel = (uint16_t)ColorToPixel(format, c);
-        } break;
-        case 4: {
-            Color c = PixelToColor(format, *(uint32_t*)pixel);
-            c = BlendColors(color, c, a, invA);
-            *(uint32_t*)pixel = ColorToPixel(format, c);
-        } break;
-        default: break;
+static void AddJoin(EdgeList* list, Point v, Point d0, Point d1, float halfWidth, const StrokeStyle* style) {
+    const float cross = d0.x * d1.y - d0.y * d1.x;
+    const float dot = d0.x * d1.x + d0.y * d1.y;
+    // straight continuation is covered by both segments
+    if (fabsf(cross) < 1e-6f && dot > 0.0f) return;
+    if (style->join == LINE_JOIN_ROUND) {
+        AddDisc(list, v, halfWidth);
+        return;
     }
-}
 
-void DrawLine(Surface surface, int x1, int y1, int x2, int y2, Color color) {
-    if (color.a == 0) return;
-    const uint32_t c = ColorToPixel(surface.format, color);
-    const int a = color.a;
-    const int invA = 255 - a;
-    const uint8_t bpp = surface.format->bytesPerPixel;
+    // joins fill the gap on the outer side of the turn
+    const float side = cross > 0.0f ? -halfWidth : halfWidth;
+    const Point o0 = { v.x - d0.y * side, v.y + d0.x * side };
+    const Point o1 = { v.x - d1.y * side, v.y + d1.x * side };
+
+    if (style->join == LINE_JOIN_MITER && dot > -0.999f) {
+        // miter length is width / cos(a / 2), a being the angle between normals of segments
+        const float cosHalf = sqrtf((1.0f + dot) * 0.5f);
+        if (1.0f / cosHalf <= style->miterLimit) {
+            const float nx = -(d0.y + d1.y);
+            const float ny = d0.x + d1.x;
+            const float scale = side / (cosHalf * sqrtf(nx * nx + ny * ny));
+            const Point quad[4] = { v, o0, { v.x + nx * scale, v.y + ny * scale }, o1 };
+            AddConvexPolygon(list, quad, 4);
+            return;
+        }
+    }
+    const Point triangle[3] = { v, o0, o1 };
+    AddConvexPolygon(list, triangle, 3);
+}
 
-    const int dx = abs(x2 - x1);
-    const int sx = x1 < x2 ? 1 : -1;
-    const int dy = -abs(y2 - y1);
-    const int sy = y1 < y2 ? 1 : -1;
+void DrawPolyline(Surface surface, const Point* points, int count, bool closed, const StrokeStyle* style, Color color) {
+    if (points == NULL || count <= 0 || style == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    if (style->width <= 0.0f || color.a == 0) return;
+    const float halfWidth = style->width * 0.5f;
+
+    float minX = points[0].x, maxX = points[0].x;
+    float minY = points[0].y, maxY = points[0].y;
+    for (int i = 1; i < count; ++i) {
+        minX = fminf(minX, points[i].x);
+        maxX = fmaxf(maxX, points[i].x);
+        minY = fminf(minY, points[i].y);
+        maxY = fmaxf(maxY, points[i].y);
+    }
+    // miters are the farthest a stroke gets from its points, square caps reach half width * sqrt(2)
+    const float reach = halfWidth * (style->join == LINE_JOIN_MITER && style->miterLimit > 1.5f
+        ? style->miterLimit : 1.5f) + 1.0f;
+    if (maxX + reach < 0.0f || minX - reach >= (float)surface.width ||
+        maxY + reach < 0.0f || minY - reach >= (float)surface.height) {
+        return;
+    }
+    DamageAdd(surface, (Rect){
+        (int)floorf(minX - reach), (int)floorf(minY - reach),
+        (int)ceilf(maxX - minX + 2.0f * reach) + 1, (int)ceilf(maxY - minY + 2.0f * reach) + 1
+    });
+    PROFILE_BEGIN();
+
+    const int arc = ArcSegments(halfWidth);
+    const int perJoin = style->join == LINE_JOIN_ROUND ? arc : 4;
+    const int caps = style->cap == LINE_CAP_ROUND ? 2 * arc : 0;
+    EdgeList list;
+    if (!EdgeListInit(&list, 2 * (count * (4 + perJoin) + caps + 4), surface.width, surface.height)) {
+        PROFILE_END(PROFILE_ZONE_DRAW_POLYLINE);
+        return;
+    }
 
-    int err = dx + dy;
+    // repeated points don't have a direction, so they are skipped
+    int segmentCount = 0;
+    Point start = points[0];
+    Point startDir = { 1.0f, 0.0f };
+    Point prevDir = { 1.0f, 0.0f };
+    Point prev = points[0];
+    const int last = closed ? count : count - 1;
+    for (int i = 1; i <= last; ++i) {
+        const Point p = points[i % count];
+        const float dx = p.x - prev.x;
+        const float dy = p.y - prev.y;
+        const float length = sqrtf(dx * dx + dy * dy);
+        if (length < 1e-4f) continue;
+        const Point dir = { dx / length, dy / length };
+
+        const float nx = -dir.y * halfWidth;
+        const float ny = dir.x * halfWidth;
+        const Point quad[4] = {
+            { prev.x + nx, prev.y + ny }, { p.x + nx, p.y + ny }, { p.x - nx, p.y - ny }, { prev.x - nx, prev.y - ny }
+        };
+        AddConvexPolygon(&list, quad, 4);
+
+        if (segmentCount == 0) {
+            start = prev;
+            startDir = dir;
+        }
+        else {
+            AddJoin(&list, prev, prevDir, dir, halfWidth, style);
+        }
+        prevDir = dir;
+        prev = p;
+        ++segmentCount;
+    }
 
-    while (x1 != x2 && y1 != y2) {
-        if (x1 >= 0 && x1 < surface.width && y1 >= 0 && y1 < surface.height) {
-            uint8_t* pixel = (uint8_t*)surface.pixels + y1 * surface.stride + x1 * bpp;
-            if (a == 255) {
-                SetPixel(pixel, c, bpp);
-            }
-            else {
-                BlendPixel(pixel, color, a, invA, bpp, surface.format);
-            }
+    if (closed && segmentCount > 0) {
+        AddJoin(&list, start, prevDir, startDir, halfWidth, style);
+    }
+    else if (style->cap == LINE_CAP_ROUND) {
+        AddDisc(&list, start, halfWidth);
+        if (segmentCount > 0) AddDisc(&list, prev, halfWidth);
+    }
+    else if (style->cap == LINE_CAP_SQUARE) {
+        // caps are half width squares past end points, a lone point gets a whole square
+        const Point dirs[2] = { { -startDir.x, -startDir.y }, prevDir };
+        const Point ends[2] = { start, prev };
+        for (int i = 0; i < (segmentCount > 0 ? 2 : 1); ++i) {
+            const Point e = ends[i];
+            const Point d = { dirs[i].x * halfWidth, dirs[i].y * halfWidth };
+            const Point back = segmentCount > 0 ? e : (Point){ e.x - d.x, e.y - d.y };
+            const Point quad[4] = {
+                { back.x - d.y, back.y + d.x }, { e.x + d.x - d.y, e.y + d.y + d.x },
+                { e.x + d.x + d.y, e.y + d.y - d.x }, { back.x + d.y, back.y - d.x }
+            };
+            AddConvexPolygon(&list, quad, 4);
         }
+    }
 
-        const int e2 = err << 1;
+    EdgeListFill(&list, surface, false, color);
+    EdgeListFree(&list);
+    PROFILE_END(PROFILE_ZONE_DRAW_POLYLINE);
+}
 
-        if (e2 >= dy) {
-            err += dy;
-            x1 += sx;
-        }
-        if (e2 <= dx) {
-            err += dx;
-            y1 += sy;
-        }
+void DrawPolygon(Surface surface, const Point* points, int count, FillRule rule, Color color) {
+    if (points == NULL || count < 0) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    if (count < 3 || color.a == 0) return;
+
+    float minX = points[0].x, maxX = points[0].x;
+    float minY = points[0].y, maxY = points[0].y;
+    for (int i = 1; i < count; ++i) {
+        minX = fminf(minX, points[i].x);
+        maxX = fmaxf(maxX, points[i].x);
+        minY = fminf(minY, points[i].y);
+        maxY = fmaxf(maxY, points[i].y);
+    }
+    if (maxX < 0.0f || minX >= (float)surface.width || maxY < 0.0f || minY >= (float)surface.height) return;
+    DamageAdd(surface, (Rect){
+        (int)floorf(minX), (int)floorf(minY), (int)ceilf(maxX - minX) + 2, (int)ceilf(maxY - minY) + 2
+    });
+    PROFILE_BEGIN();
+
+    EdgeList list;
+    if (!EdgeListInit(&list, 2 * count, surface.width, surface.height)) {
+        PROFILE_END(PROFILE_ZONE_DRAW_POLYGON);
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        AddEdge(&list, points[i], points[(i + 1) % count]);
     }
+    EdgeListFill(&list, surface, rule == FILL_RULE_EVEN_ODD, color);
+    EdgeListFree(&list);
+    PROFILE_END(PROFILE_ZONE_DRAW_POLYGON);
 }
@@ -3,7 +3,11 @@
 #endif  // __SSE2__
 
 #include "FillRect.h"
+#include "internal/BlendFill.h"
+#include "internal/Damage.h"
 #include "internal/Inlines.h"
+#include "internal/Profile.h"
+#include "internal/RowKernels.h"
 #include "Rect.h"
 
 #ifdef __SSE2__
@@ -142,6 +146,9 @@ void FillRect(Surface surface, const Rect* rect, uint32_t color) {
     Rect clipped;
 
     if (!RectIntersection(&surfaceRect, rect, &clipped)) return;
+    DamageAdd(surface, clipped);
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)clipped.width * clipped.height);
 
     uint8_t* row = (uint8_t*)surface.pixels + clipped.y * surface.stride + clipped.x * bpp;
 
@@ -172,6 +179,7 @@ void FillRect(Surface surface, const Rect* rect, uint32_t color) {
         } break;
         default: break;
     }
+    PROFILE_END(PROFILE_ZONE_FILL_RECT);
 }
 
 #define MAKE_BLEND_FILL_FUNCTION(TYPE, BYTES)                                                                         \
@@ -194,13 +202,35 @@ MAKE_BLEND_FILL_FUNCTION(uint8_t, 1)
 MAKE_BLEND_FILL_FUNCTION(uint16_t, 2)
 MAKE_BLEND_FILL_FUNCTION(uint32_t, 4)
 
-void BlendFillRect(Surface surface, const Rect* rect, Color color) {
-    const uint8_t bpp = surface.format->bytesPerPixel;
-    const Rect surfaceRect = { 0, 0, surface.width, surface.height };
-    Rect clipped;
+static void BlendPremultipliedFillRect4(uint8_t* target, int stride, int w, int h, uint32_t pixel, int alphaShift,
+                                        const RowKernels* kernels) {
+    while (h--) {
+        uint32_t* row = (uint32_t*)target;
+        if (kernels != NULL) {
+            kernels->blendPremulSolidRow(row, w, pixel, alphaShift);
+        }
+        else {
+            for (int i = 0; i < w; ++i) {
+                row[i] = BlendPremultipliedPixel(pixel, row[i], alphaShift);
+            }
+        }
+        target += stride;
+    }
+}
 
-    if (!RectIntersection(&surfaceRect, rect, &clipped)) return;
+BlendFill BlendFillInit(Surface surface) {
+    BlendFill fill = { surface, NULL, false };
+    if (surface.format->bytesPerPixel == 4) {
+        ByteLayout layout;
+        fill.byteAligned = GetByteLayout(surface.format, &layout) && layout.a >= 0;
+        fill.kernels = fill.byteAligned ? GetRowKernels() : NULL;
+    }
+    return fill;
+}
 
+void BlendFillClipped(const BlendFill* fill, Rect clipped, Color color) {
+    const Surface surface = fill->surface;
+    const uint8_t bpp = surface.format->bytesPerPixel;
     uint8_t* row = (uint8_t*)surface.pixels + clipped.y * surface.stride + clipped.x * bpp;
 
     switch (bpp) {
@@ -211,9 +241,37 @@ void BlendFillRect(Surface surface, const Rect* rect, Color color) {
             BlendFillRect2(row, surface.stride, clipped.width, clipped.height, color, surface.format);
         } break;
         case 4: {
-            BlendFillRect4(row, surface.stride, clipped.width, clipped.height, color, surface.format);
+            const RowKernels* kernels = fill->kernels;
+            const int alphaShift = surface.format->aShift;
+            if (fill->byteAligned && surface.format->premultiplied) {
+                const uint32_t pixel = ColorToPixel(surface.format, color);
+                BlendPremultipliedFillRect4(row, surface.stride, clipped.width, clipped.height, pixel, alphaShift,
+                                            kernels);
+            }
+            else if (kernels != NULL) {
+                const uint32_t pixel = ColorToPixel(surface.format, color);
+                for (int h = clipped.height; h--; row += surface.stride) {
+                    kernels->blendSolidRow((uint32_t*)row, clipped.width, pixel, color.a, alphaShift);
+                }
+            }
+            else {
+                BlendFillRect4(row, surface.stride, clipped.width, clipped.height, color, surface.format);
+            }
         } break;
         default: break;
     }
 }
 
+void BlendFillRect(Surface surface, const Rect* rect, Color color) {
+    const Rect surfaceRect = { 0, 0, surface.width, surface.height };
+    Rect clipped;
+
+    if (!RectIntersection(&surfaceRect, rect, &clipped)) return;
+    DamageAdd(surface, clipped);
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)clipped.width * clipped.height);
+    const BlendFill fill = BlendFillInit(surface);
+    BlendFillClipped(&fill, clipped, color);
+    PROFILE_END(PROFILE_ZONE_BLEND_FILL_RECT);
+}
+
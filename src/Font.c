@@ -1,10 +1,32 @@
+#include <string.h>
 #include <harfbuzz/hb.h>
 #include <harfbuzz/hb-ft.h>
 #include FT_FREETYPE_H
+#include FT_OUTLINE_H
 
+#include "Allocator.h"
 #include "Font.h"
 #include "Error.h"
+#include "internal/Damage.h"
+#include "internal/FontCache.h"
 #include "internal/Inlines.h"
+#include "internal/Profile.h"
+
+// Horizontal pen positions are quantized to quarter pixels, every position is cached as a separate glyph
+#define GLYPH_SUBPIXEL_BINS 4
+
+// Shaping state of a font, font->shapeCache points to it
+typedef struct Shaper {
+    hb_buffer_t* buffer;  // reused by every shaping call of the font
+    ShapeCache cache;
+} Shaper;
+
+// Result of shaping, points either into the cache or into the font's buffer, valid until the next shaping call
+typedef struct ShapedText {
+    unsigned int glyphCount;
+    const hb_glyph_info_t* infos;
+    const hb_glyph_position_t* positions;
+} ShapedText;
 
 static FT_Library ftLibrary = NULL;
 
@@ -17,6 +39,67 @@ static int EnsureFtLibrary() {
     return 0;
 }
 
+static inline int GlyphCellWidth(FT_Face face) {
+    return (int)(face->size->metrics.max_advance >> 6) + 2;
+}
+
+static inline int GlyphCellHeight(FT_Face face) {
+    return (int)((face->size->metrics.ascender - face->size->metrics.descender) >> 6) + 2;
+}
+
+static void ShaperDestroy(Shaper* shaper) {
+    if (shaper == NULL) return;
+    ShapeCacheClear(&shaper->cache);
+    hb_buffer_destroy(shaper->buffer);
+    AllocatorFree(shaper);
+}
+
+static Shaper* ShaperCreate() {
+    Shaper* shaper = AllocatorAlloc(sizeof(Shaper));
+    if (shaper == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    shaper->buffer = hb_buffer_create();
+    if (!hb_buffer_allocation_successful(shaper->buffer)) {
+        hb_buffer_destroy(shaper->buffer);
+        AllocatorFree(shaper);
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    ShapeCacheInit(&shaper->cache);
+
+    return shaper;
+}
+
+// Direction and script left as HB_DIRECTION_INVALID and HB_SCRIPT_INVALID are guessed from the text
+static ShapedText ShapeText(const Font* font, const char* text, int length, hb_direction_t direction, hb_script_t script) {
+    Shaper* shaper = font->shapeCache;
+    if (length <= 0 || shaper == NULL) return (ShapedText){ 0 };
+
+    const ShapedRun* run = ShapeCacheFind(&shaper->cache, text, length, direction, script);
+    if (run != NULL) return (ShapedText){ run->glyphCount, run->infos, run->positions };
+
+    hb_buffer_t* buf = shaper->buffer;
+    hb_buffer_reset(buf);
+    hb_buffer_add_utf8(buf, text, length, 0, length);
+    if (direction != HB_DIRECTION_INVALID) hb_buffer_set_direction(buf, direction);
+    if (script != HB_SCRIPT_INVALID) hb_buffer_set_script(buf, script);
+    hb_buffer_guess_segment_properties(buf);
+    TRACE_BEGIN();
+    hb_shape(font->hbFont, buf, NULL, 0);
+    TRACE_END("ShapeText", "bytes", length);
+
+    unsigned int glyphCount = 0;
+    hb_glyph_info_t* infos = hb_buffer_get_glyph_infos(buf, &glyphCount);
+    hb_glyph_position_t* positions = hb_buffer_get_glyph_positions(buf, NULL);
+    run = ShapeCacheInsert(&shaper->cache, text, length, direction, script, glyphCount, infos,
+                           sizeof(hb_glyph_info_t), positions, sizeof(hb_glyph_position_t));
+    if (run == NULL) return (ShapedText){ glyphCount, infos, positions };
+    return (ShapedText){ glyphCount, run->infos, run->positions };
+}
+
 Font FontLoad(const char* path, int pixelSize) {
     if (!path || pixelSize <= 0 || EnsureFtLibrary() != 0) {
         if (EnsureFtLibrary() != 0) THROW_ERROR(ERR_INTERNAL_ERROR);
@@ -43,11 +126,33 @@ Font FontLoad(const char* path, int pixelSize) {
         return (Font){ 0 };
     }
 
-    return (Font) { face, hbFont, pixelSize };
+    const int cellWidth = GlyphCellWidth(face);
+    const int cellHeight = GlyphCellHeight(face);
+    GlyphCache* glyphCache = GlyphCacheCreate(cellWidth, cellHeight, FONT_DEFAULT_GLYPH_CACHE_BUDGET);
+    const bool glyphCacheFailed =
+        glyphCache == NULL && GlyphCacheCapacity(cellWidth, cellHeight, FONT_DEFAULT_GLYPH_CACHE_BUDGET) > 0;
+    Shaper* shaper = glyphCacheFailed ? NULL : ShaperCreate();
+    if (glyphCacheFailed || shaper == NULL) {
+        GlyphCacheDestroy(glyphCache);
+        hb_font_destroy(hbFont);
+        FT_Done_Face(face);
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return (Font){ 0 };
+    }
+
+    return (Font) { face, hbFont, pixelSize, glyphCache, shaper };
 }
 
 void FontFree(Font* font) {
     if (font == NULL) return;
+    if (font->glyphCache != NULL) {
+        GlyphCacheDestroy(font->glyphCache);
+        font->glyphCache = NULL;
+    }
+    if (font->shapeCache != NULL) {
+        ShaperDestroy(font->shapeCache);
+        font->shapeCache = NULL;
+    }
     if (font->hbFont != NULL) {
         hb_font_destroy(font->hbFont);
         font->hbFont = NULL;
@@ -59,15 +164,57 @@ void FontFree(Font* font) {
     font->size = 0;
 }
 
+void FontSetGlyphCacheBudget(Font* font, size_t bytes) {
+    if (font == NULL || font->internal == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    GlyphCacheDestroy(font->glyphCache);
+    font->glyphCache = GlyphCacheCreate(GlyphCellWidth(font->internal), GlyphCellHeight(font->internal), bytes);
+}
+
+FontCacheStats FontGetGlyphCacheStats(const Font* font) {
+    if (font == NULL || font->glyphCache == NULL) return (FontCacheStats){ 0 };
+    const GlyphCache* cache = font->glyphCache;
+    FontCacheStats stats = cache->stats;
+    stats.used = cache->used;
+    return stats;
+}
+
+void FontResetGlyphCacheStats(Font* font) {
+    if (font == NULL || font->glyphCache == NULL) return;
+    GlyphCache* cache = font->glyphCache;
+    cache->stats.hits = 0;
+    cache->stats.misses = 0;
+    cache->stats.evictions = 0;
+}
+
+void FontInvalidateShapeCache(Font* font) {
+    if (font == NULL || font->shapeCache == NULL) return;
+    Shaper* shaper = font->shapeCache;
+    ShapeCacheClear(&shaper->cache);
+}
+
 static inline int ComputeBaselineFromTop(FT_Face face, int topY) {
     return topY + (face->size != NULL ? (int)(face->size->metrics.ascender >> 6) : 0);
 }
 
-static void BlitGlyphToSurface(Surface surface, const FT_Bitmap* bitmap, int dstX, int dstY, Color color) {
-    const int bpp = surface.format->bytesPerPixel;
+static bool RenderGlyph(FT_Face face, uint32_t glyphIndex, int subpixelShift) {
+    TRACE_BEGIN();
+    if (FT_Load_Glyph(face, glyphIndex, FT_LOAD_DEFAULT)) return false;
 
-    const int bmW = (int)bitmap->width;
-    const int bmH = (int)bitmap->rows;
+    if (face->glyph->format == FT_GLYPH_FORMAT_OUTLINE && subpixelShift != 0) {
+        FT_Outline_Translate(&face->glyph->outline, subpixelShift, 0);
+    }
+    const bool rendered =
+        face->glyph->format == FT_GLYPH_FORMAT_BITMAP || FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL) == 0;
+    TRACE_END("RasterizeGlyph", "glyph", (long long)glyphIndex);
+    return rendered;
+}
+
+static void BlitGlyphToSurface(Surface surface, const uint8_t* coverage, int pitch, int bmW, int bmH,
+                               int dstX, int dstY, Color color) {
+    const int bpp = surface.format->bytesPerPixel;
 
     int startX = 0, startY = 0;
     if (dstX < 0) startX = -dstX;
@@ -77,6 +224,8 @@ static void BlitGlyphToSurface(Surface surface, const FT_Bitmap* bitmap, int dst
     if (dstX + bmW > surface.width) endX = surface.width - dstX;
     if (dstY + bmH > surface.height) endY = surface.height - dstY;
     if (startX >= endX || startY >= endY) return;
+    DamageAdd(surface, (Rect){ dstX + startX, dstY + startY, endX - startX, endY - startY });
+    PROFILE_PIXELS((long long)(endX - startX) * (endY - startY));
 
     const int a = color.a;
     const int invA = 255 - a;
@@ -84,10 +233,10 @@ static void BlitGlyphToSurface(Surface surface, const FT_Bitmap* bitmap, int dst
 
     for (int gy = startY; gy < endY; ++gy) {
         const int sy = dstY + gy;
-        uint8_t* row = &((uint8_t*)surface.pixels)[sy * surface.width * bpp];
+        uint8_t* row = (uint8_t*)surface.pixels + sy * surface.stride;
         for (int gx = startX; gx < endX; ++gx) {
             const int sx = (dstX + gx) * bpp;
-            const uint8_t glyphAlpha = bitmap->buffer[gy * bitmap->pitch + gx];
+            const uint8_t glyphAlpha = coverage[gy * pitch + gx];
             if (glyphAlpha == 0) continue;
             const uint8_t combinedAlpha = (uint16_t)glyphAlpha * (uint16_t)color.a / 255;
             if (combinedAlpha == 0) continue;
@@ -137,22 +286,20 @@ void DrawFontChar(Surface surface, int x, int y, char c, const Font* font, Color
 }
 
 void DrawFontText(Surface surface, int x, int y, const char* text, const Font* font, Color color) {
-    if (text == NULL || color.a == 0) return;
+    if (text == NULL || font == NULL || font->internal == NULL || color.a == 0) return;
+    PROFILE_BEGIN();
     FT_Face face = font->internal;
-    hb_font_t* hbFont = font->hbFont;
+    GlyphCache* cache = font->glyphCache;
 
-    hb_buffer_t* buf = hb_buffer_create();
-    hb_buffer_add_utf8(buf, text, -1, 0, -1);
-    hb_buffer_guess_segment_properties(buf);
-    hb_shape(hbFont, buf, NULL, 0);
-
-    uint32_t glyphCount = 0;
-    hb_glyph_info_t* glyphInfo = hb_buffer_get_glyph_infos(buf, &glyphCount);
-    hb_glyph_position_t* glyphPos = hb_buffer_get_glyph_positions(buf, &glyphCount);
+    const ShapedText shaped = ShapeText(font, text, (int)strlen(text), HB_DIRECTION_INVALID, HB_SCRIPT_INVALID);
+    const uint32_t glyphCount = shaped.glyphCount;
+    const hb_glyph_info_t* glyphInfo = shaped.infos;
+    const hb_glyph_position_t* glyphPos = shaped.positions;
 
     const int baseline = ComputeBaselineFromTop(face, y);
 
-    long penX = x;
+    // horizontal pen position is kept in 26.6 fixed point, so subpixel advances are not lost
+    long penX = (long)x << 6;
     long penY = baseline;
 
     const int asc = (int)(face->size->metrics.ascender >> 6);
@@ -160,9 +307,11 @@ void DrawFontText(Surface surface, int x, int y, const char* text, const Font* f
     int lineHeight = asc - desc;
     if (lineHeight < 0) lineHeight = -lineHeight;
 
+    const int subpixelBins = FT_IS_SCALABLE(face) ? GLYPH_SUBPIXEL_BINS : 1;
+
     for (uint32_t i = 0; i < glyphCount; i++) {
         if (text[glyphInfo[i].cluster] == '\n') {
-            penX = x;
+            penX = (long)x << 6;
             penY += lineHeight;
             continue;
         }
@@ -172,45 +321,62 @@ void DrawFontText(Surface surface, int x, int y, const char* text, const Font* f
 
         uint32_t glyphIndex = gi.codepoint;
 
-        const int xOffset = (int)(gp.x_offset >> 6);
+        const long originX = penX + gp.x_offset;
         const int yOffset = (int)(gp.y_offset >> 6);
-        const int xAdvance = (int)(gp.x_advance >> 6);
         const int yAdvance = (int)(gp.y_advance >> 6);
 
-        if (FT_Load_Glyph(face, glyphIndex, FT_LOAD_DEFAULT)) {
-            penX += xAdvance;
-            penY += yAdvance;
-            continue;
+        const int subpixel = (int)(originX & 63) * subpixelBins >> 6;
+        const int subpixelShift = subpixel * (64 / subpixelBins);
+        const uint32_t key = glyphIndex * GLYPH_SUBPIXEL_BINS + subpixel;
+
+        const GlyphEntry* glyph = cache != NULL ? GlyphCacheFind(cache, key) : NULL;
+
+        const uint8_t* coverage;
+        int pitch, width, height, left, top;
+        if (glyph != NULL) {
+            coverage = GlyphCacheCoverage(cache, glyph);
+            pitch = cache->atlas.stride;
+            width = glyph->width;
+            height = glyph->height;
+            left = glyph->left;
+            top = glyph->top;
         }
-
-        if (face->glyph->format != FT_GLYPH_FORMAT_BITMAP) {
-            if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL)) {
-                penX += xAdvance;
+        else {
+            if (!RenderGlyph(face, glyphIndex, subpixelShift)) {
+                penX += gp.x_advance;
                 penY += yAdvance;
                 continue;
             }
+            const FT_Bitmap* bitmap = &face->glyph->bitmap;
+            if (cache != NULL && (bitmap->pixel_mode == FT_PIXEL_MODE_GRAY || bitmap->rows == 0)) {
+                GlyphCacheInsert(cache, key, bitmap->buffer, bitmap->pitch, (int)bitmap->width, (int)bitmap->rows,
+                                 face->glyph->bitmap_left, face->glyph->bitmap_top);
+            }
+            coverage = bitmap->buffer;
+            pitch = bitmap->pitch;
+            width = (int)bitmap->width;
+            height = (int)bitmap->rows;
+            left = face->glyph->bitmap_left;
+            top = face->glyph->bitmap_top;
         }
 
-        const FT_Bitmap* bitmap = &face->glyph->bitmap;
-        const int dstX = (int)(penX + xOffset) + face->glyph->bitmap_left;
-        const int dstY = (int)(penY + yOffset) - face->glyph->bitmap_top;
-        BlitGlyphToSurface(surface, bitmap, dstX, dstY, color);
+        const int dstX = (int)(originX >> 6) + left;
+        const int dstY = (int)(penY + yOffset) - top;
+        BlitGlyphToSurface(surface, coverage, pitch, width, height, dstX, dstY, color);
 
-        penX += xAdvance;
+        penX += gp.x_advance;
         penY += yAdvance;
     }
-
-    hb_buffer_destroy(buf);
+    PROFILE_END(PROFILE_ZONE_FONT_TEXT);
 }
 
 void MeasureFontText(const char* text, const Font* font, int* outWidth, int* outHeight) {
-    if (!text || !font || !font->internal || !font->hbFont) {
+    if (!text || !font || !font->internal || !font->hbFont || !font->shapeCache) {
         THROW_ERROR(ERR_INVALID_PARAMS);
         return;
     }
 
     FT_Face face = (FT_Face)font->internal;
-    hb_font_t* hbFont = (hb_font_t*)font->hbFont;
 
     int maxWidth = 0;
     int lines = 1;
@@ -229,23 +395,19 @@ void MeasureFontText(const char* text, const Font* font, int* outWidth, int* out
         const size_t len = p - start;
 
         if (len > 0) {
-            hb_buffer_t* buf = hb_buffer_create();
-            hb_buffer_add_utf8(buf, start, (int)len, 0, (int)len);
-            hb_buffer_guess_segment_properties(buf);
-            hb_shape(hbFont, buf, NULL, 0);
-
-            unsigned int glyphCount;
-            const hb_glyph_position_t* pos = hb_buffer_get_glyph_positions(buf, &glyphCount);
+            const ShapedText shaped = ShapeText(font, start, (int)len, HB_DIRECTION_INVALID, HB_SCRIPT_INVALID);
+            const unsigned int glyphCount = shaped.glyphCount;
+            const hb_glyph_position_t* pos = shaped.positions;
 
-            int lineWidth = 0;
+            // advances are summed in 26.6 fixed point, the same way DrawFontText moves its pen
+            long lineWidth26 = 0;
             for (unsigned int i = 0; i < glyphCount; i++) {
-                lineWidth += (pos[i].x_advance >> 6);
+                lineWidth26 += pos[i].x_advance;
             }
+            const int lineWidth = (int)((lineWidth26 + 63) >> 6);
 
             if (lineWidth > maxWidth)
                 maxWidth = lineWidth;
-
-            hb_buffer_destroy(buf);
         }
 
         if (*p == '\0') break;
@@ -0,0 +1,244 @@
+#include <string.h>
+
+#include "Allocator.h"
+#include "Error.h"
+#include "internal/FontCache.h"
+
+// Atlas stores only 8-bit coverage
+static const PixelFormat FORMAT_COVERAGE8 = {
+    .aMask = 0xFF,
+    .rLoss = 8,
+    .gLoss = 8,
+    .bLoss = 8,
+    .bytesPerPixel = 1,
+};
+
+void GlyphCacheDestroy(GlyphCache* cache) {
+    if (cache == NULL) return;
+    SurfaceDestroy(&cache->atlas);
+    AllocatorFree(cache->entries);
+    AllocatorFree(cache->links);
+    AllocatorFree(cache->buckets);
+    AllocatorFree(cache);
+}
+
+GlyphCache* GlyphCacheCreate(int cellWidth, int cellHeight, size_t budget) {
+    const int capacity = GlyphCacheCapacity(cellWidth, cellHeight, budget);
+    if (capacity <= 0) return NULL;
+
+    int columns = 1;
+    while (columns * columns < capacity) ++columns;
+    const int rows = (capacity + columns - 1) / columns;
+
+    uint32_t bucketCount = 1;
+    while (bucketCount < (uint32_t)capacity) bucketCount <<= 1;
+
+    GlyphCache* cache = AllocatorAlloc(sizeof(GlyphCache));
+    if (cache == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    *cache = (GlyphCache){ 0 };
+    cache->entries = AllocatorAlloc(capacity * sizeof(GlyphEntry));
+    cache->links = AllocatorAlloc(capacity * sizeof(LruLink));
+    cache->buckets = AllocatorAlloc(bucketCount * sizeof(int));
+    if (cache->entries == NULL || cache->links == NULL || cache->buckets == NULL) {
+        GlyphCacheDestroy(cache);
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    cache->atlas = SurfaceCreate(columns * cellWidth, rows * cellHeight, &FORMAT_COVERAGE8);
+    // SurfaceCreate has already reported the error
+    if (cache->atlas.pixels == NULL) {
+        GlyphCacheDestroy(cache);
+        return NULL;
+    }
+
+    cache->cellWidth = cellWidth;
+    cache->cellHeight = cellHeight;
+    cache->columns = columns;
+    cache->capacity = capacity;
+    cache->bucketMask = bucketCount - 1;
+    cache->lru = (LruList){ -1, -1 };
+    cache->stats.capacity = capacity;
+    for (uint32_t i = 0; i < bucketCount; ++i) {
+        cache->buckets[i] = -1;
+    }
+
+    return cache;
+}
+
+static inline uint32_t GlyphBucket(const GlyphCache* cache, uint32_t key) {
+    return (key * 2654435761u) & cache->bucketMask;
+}
+
+static inline uint8_t* GlyphCell(const GlyphCache* cache, int index) {
+    const int cx = (index % cache->columns) * cache->cellWidth;
+    const int cy = (index / cache->columns) * cache->cellHeight;
+    return (uint8_t*)cache->atlas.pixels + cy * cache->atlas.stride + cx;
+}
+
+const GlyphEntry* GlyphCacheFind(GlyphCache* cache, uint32_t key) {
+    for (int i = cache->buckets[GlyphBucket(cache, key)]; i != -1; i = cache->entries[i].hashNext) {
+        if (cache->entries[i].key == key) {
+            LruTouch(&cache->lru, cache->links, i);
+            ++cache->stats.hits;
+            return &cache->entries[i];
+        }
+    }
+    ++cache->stats.misses;
+    return NULL;
+}
+
+static int GlyphCacheAcquire(GlyphCache* cache) {
+    if (cache->used < cache->capacity) {
+        return cache->used++;
+    }
+
+    const int victim = cache->lru.tail;
+    LruUnlink(&cache->lru, cache->links, victim);
+
+    int* link = &cache->buckets[GlyphBucket(cache, cache->entries[victim].key)];
+    while (*link != victim) {
+        link = &cache->entries[*link].hashNext;
+    }
+    *link = cache->entries[victim].hashNext;
+
+    ++cache->stats.evictions;
+    return victim;
+}
+
+const GlyphEntry* GlyphCacheInsert(GlyphCache* cache, uint32_t key, const uint8_t* coverage, int pitch, int width,
+                                   int height, int left, int top) {
+    if (width > cache->cellWidth || height > cache->cellHeight) return NULL;
+
+    const int index = GlyphCacheAcquire(cache);
+    GlyphEntry* e = &cache->entries[index];
+    e->key = key;
+    e->left = (int16_t)left;
+    e->top = (int16_t)top;
+    e->width = (uint16_t)width;
+    e->height = (uint16_t)height;
+
+    uint8_t* cell = GlyphCell(cache, index);
+    for (int row = 0; row < height; ++row) {
+        memcpy(cell + row * cache->atlas.stride, coverage + row * pitch, width);
+    }
+
+    const uint32_t bucket = GlyphBucket(cache, key);
+    e->hashNext = cache->buckets[bucket];
+    cache->buckets[bucket] = index;
+    LruPushFront(&cache->lru, cache->links, index);
+
+    return e;
+}
+
+const uint8_t* GlyphCacheCoverage(const GlyphCache* cache, const GlyphEntry* entry) {
+    return GlyphCell(cache, (int)(entry - cache->entries));
+}
+
+static void ShapeCacheEvict(ShapeCache* cache, int index) {
+    ShapedRun* run = &cache->runs[index];
+    LruUnlink(&cache->lru, cache->links, index);
+
+    int* link = &cache->buckets[run->hash & (SHAPE_CACHE_BUCKETS - 1)];
+    while (*link != index) {
+        link = &cache->runs[*link].hashNext;
+    }
+    *link = run->hashNext;
+
+    cache->bytes -= run->bytes;
+    AllocatorFree(run->text);
+    run->text = NULL;
+    run->hashNext = cache->freeList;
+    cache->freeList = index;
+}
+
+void ShapeCacheInit(ShapeCache* cache) {
+    for (int i = 0; i < SHAPE_CACHE_BUCKETS; ++i) {
+        cache->buckets[i] = -1;
+    }
+    for (int i = 0; i < FONT_SHAPE_CACHE_MAX_RUNS; ++i) {
+        cache->runs[i].text = NULL;
+        cache->runs[i].hashNext = i + 1 < FONT_SHAPE_CACHE_MAX_RUNS ? i + 1 : -1;
+    }
+    cache->freeList = 0;
+    cache->bytes = 0;
+    cache->lru = (LruList){ -1, -1 };
+}
+
+void ShapeCacheClear(ShapeCache* cache) {
+    while (cache->lru.tail != -1) {
+        ShapeCacheEvict(cache, cache->lru.tail);
+    }
+}
+
+uint32_t ShapeCacheHash(const char* text, int length, uint32_t direction, uint32_t script) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; ++i) {
+        hash ^= (uint8_t)text[i];
+        hash *= 16777619u;
+    }
+    hash ^= direction;
+    hash *= 16777619u;
+    hash ^= script;
+    hash *= 16777619u;
+    return hash;
+}
+
+const ShapedRun* ShapeCacheFind(ShapeCache* cache, const char* text, int length, uint32_t direction,
+                                uint32_t script) {
+    const uint32_t hash = ShapeCacheHash(text, length, direction, script);
+    for (int i = cache->buckets[hash & (SHAPE_CACHE_BUCKETS - 1)]; i != -1; i = cache->runs[i].hashNext) {
+        const ShapedRun* run = &cache->runs[i];
+        if (run->hash == hash && run->length == length && run->direction == direction && run->script == script &&
+            memcmp(run->text, text, length) == 0) {
+            LruTouch(&cache->lru, cache->links, i);
+            return run;
+        }
+    }
+    return NULL;
+}
+
+const ShapedRun* ShapeCacheInsert(ShapeCache* cache, const char* text, int length, uint32_t direction,
+                                  uint32_t script, unsigned int glyphCount, const void* infos, size_t infoSize,
+                                  const void* positions, size_t positionSize) {
+    const size_t infosOffset = ((size_t)length + 3) & ~(size_t)3;
+    const size_t infosBytes = glyphCount * infoSize;
+    const size_t positionsBytes = glyphCount * positionSize;
+    const size_t bytes = infosOffset + infosBytes + positionsBytes;
+    if (bytes > FONT_SHAPE_CACHE_BUDGET) return NULL;
+
+    while (cache->freeList == -1 || cache->bytes + bytes > FONT_SHAPE_CACHE_BUDGET) {
+        ShapeCacheEvict(cache, cache->lru.tail);
+    }
+
+    char* block = AllocatorAlloc(bytes);
+    if (block == NULL) return NULL;
+
+    const int index = cache->freeList;
+    ShapedRun* run = &cache->runs[index];
+    cache->freeList = run->hashNext;
+
+    run->hash = ShapeCacheHash(text, length, direction, script);
+    run->length = length;
+    run->direction = direction;
+    run->script = script;
+    run->glyphCount = glyphCount;
+    run->bytes = bytes;
+    run->text = block;
+    run->infos = block + infosOffset;
+    run->positions = block + infosOffset + infosBytes;
+    memcpy(run->text, text, length);
+    memcpy(run->infos, infos, infosBytes);
+    memcpy(run->positions, positions, positionsBytes);
+
+    const uint32_t bucket = run->hash & (SHAPE_CACHE_BUCKETS - 1);
+    run->hashNext = cache->buckets[bucket];
+    cache->buckets[bucket] = index;
+    LruPushFront(&cache->lru, cache->links, index);
+    cache->bytes += bytes;
+
+    return run;
+}
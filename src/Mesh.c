@@ -0,0 +1,399 @@
+#include <math.h>
+#include <stddef.h>
+
+#include "Allocator.h"
+#include "Error.h"
+#include "Mesh.h"
+#include "internal/Damage.h"
+#include "internal/Profile.h"
+#include "internal/Rasterizer.h"
+#include "internal/Scanline.h"
+
+// Sides of the view volume, every vertex has bits of sides it is outside of
+#define CLIP_LEFT         (1 << 0)
+#define CLIP_RIGHT        (1 << 1)
+#define CLIP_BOTTOM       (1 << 2)
+#define CLIP_TOP          (1 << 3)
+#define CLIP_NEAR         (1 << 4)
+#define CLIP_FAR          (1 << 5)
+// Sides of the guard band around surface. Rasterizer skips pixels outside of surface by itself, so triangles only
+// have to be clipped by them when they leave the range of its fixed-point coordinates
+#define CLIP_GUARD_LEFT   (1 << 6)
+#define CLIP_GUARD_RIGHT  (1 << 7)
+#define CLIP_GUARD_BOTTOM (1 << 8)
+#define CLIP_GUARD_TOP    (1 << 9)
+// Planes triangles are really clipped by, consecutive bits
+#define CLIP_FIRST_PLANE  CLIP_NEAR
+#define CLIP_PLANE_COUNT  6
+#define CLIP_PLANES       (CLIP_NEAR | CLIP_FAR | CLIP_GUARD_LEFT | CLIP_GUARD_RIGHT | CLIP_GUARD_BOTTOM | CLIP_GUARD_TOP)
+
+// Every plane can add one vertex to the clipped polygon
+#define MAX_CLIPPED_VERTICES (3 + CLIP_PLANE_COUNT)
+
+typedef struct TransformedVertex {
+    float x;        // clip coordinates
+    float y;
+    float z;
+    float w;
+    float screenX;  // valid when vertex is inside all CLIP_PLANES
+    float screenY;
+    float depth;
+    uint32_t clip;
+} TransformedVertex;
+
+// Vertex of a polygon being clipped, attributes are interpolated at points where its edges cross planes
+typedef struct ClipVertex {
+    float x;
+    float y;
+    float z;
+    float w;
+    float u;
+    float v;
+    float color[4];
+    const TransformedVertex* source;  // vertex of the mesh this is, NULL for points added by clipping
+} ClipVertex;
+
+typedef struct Viewport {
+    float halfWidth;
+    float halfHeight;
+    float guardX;  // sides of guard band in normalized device coordinates
+    float guardY;
+} Viewport;
+
+Mat4 Mat4Identity(void) {
+    return Mat4Scaling(1.0f, 1.0f, 1.0f);
+}
+
+Mat4 Mat4Multiply(const Mat4* a, const Mat4* b) {
+    Mat4 result;
+    for (int row = 0; row < 4; ++row) {
+        for (int column = 0; column < 4; ++column) {
+            result.m[row][column] = a->m[row][0] * b->m[0][column] + a->m[row][1] * b->m[1][column] +
+                                    a->m[row][2] * b->m[2][column] + a->m[row][3] * b->m[3][column];
+        }
+    }
+    return result;
+}
+
+Mat4 Mat4Translation(float x, float y, float z) {
+    return (Mat4){ {
+        { 1.0f, 0.0f, 0.0f, x },
+        { 0.0f, 1.0f, 0.0f, y },
+        { 0.0f, 0.0f, 1.0f, z },
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+    } };
+}
+
+Mat4 Mat4Scaling(float x, float y, float z) {
+    return (Mat4){ {
+        { x, 0.0f, 0.0f, 0.0f },
+        { 0.0f, y, 0.0f, 0.0f },
+        { 0.0f, 0.0f, z, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+    } };
+}
+
+Mat4 Mat4RotationX(float angle) {
+    const float c = cosf(angle);
+    const float s = sinf(angle);
+    return (Mat4){ {
+        { 1.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, c, -s, 0.0f },
+        { 0.0f, s, c, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+    } };
+}
+
+Mat4 Mat4RotationY(float angle) {
+    const float c = cosf(angle);
+    const float s = sinf(angle);
+    return (Mat4){ {
+        { c, 0.0f, s, 0.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f },
+        { -s, 0.0f, c, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+    } };
+}
+
+Mat4 Mat4RotationZ(float angle) {
+    const float c = cosf(angle);
+    const float s = sinf(angle);
+    return (Mat4){ {
+        { c, -s, 0.0f, 0.0f },
+        { s, c, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+    } };
+}
+
+Mat4 Mat4Perspective(float fovY, float aspect, float near, float far) {
+    if (fovY <= 0.0f || aspect <= 0.0f || near <= 0.0f || far <= near) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return Mat4Identity();
+    }
+    const float f = 1.0f / tanf(fovY * 0.5f);
+    return (Mat4){ {
+        { f / aspect, 0.0f, 0.0f, 0.0f },
+        { 0.0f, f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, (far + near) / (near - far), 2.0f * far * near / (near - far) },
+        { 0.0f, 0.0f, -1.0f, 0.0f },
+    } };
+}
+
+Mesh MeshCreate(const MeshVertex* vertices, int vertexCount, const uint16_t* indices, int triangleCount) {
+    if (vertices == NULL || vertexCount <= 0 || vertexCount > UINT16_MAX + 1 || triangleCount < 0 ||
+        (indices == NULL && triangleCount > 0)) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return (Mesh){ 0 };
+    }
+
+    void* transformed = AllocatorAlloc((size_t)vertexCount * sizeof(TransformedVertex));
+    if (transformed == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return (Mesh){ 0 };
+    }
+    return (Mesh){ vertices, vertexCount, indices, triangleCount, transformed };
+}
+
+void MeshDestroy(Mesh* mesh) {
+    if (mesh == NULL) return;
+    AllocatorFree(mesh->transformed);
+    *mesh = (Mesh){ 0 };
+}
+
+static uint32_t ClipCode(float x, float y, float z, float w, const Viewport* viewport) {
+    uint32_t clip = 0;
+    if (x < -w) clip |= CLIP_LEFT;
+    if (x > w) clip |= CLIP_RIGHT;
+    if (y < -w) clip |= CLIP_BOTTOM;
+    if (y > w) clip |= CLIP_TOP;
+    // points at w = 0 can't be projected, with usual projections they are behind the near plane anyway
+    if (z < -w || w <= 0.0f) clip |= CLIP_NEAR;
+    if (z > w) clip |= CLIP_FAR;
+    if (x < -viewport->guardX * w) clip |= CLIP_GUARD_LEFT;
+    if (x > viewport->guardX * w) clip |= CLIP_GUARD_RIGHT;
+    if (y < -viewport->guardY * w) clip |= CLIP_GUARD_BOTTOM;
+    if (y > viewport->guardY * w) clip |= CLIP_GUARD_TOP;
+    return clip;
+}
+
+static inline void Project(const Viewport* viewport, float x, float y, float z, float w, Vertex* out, float* depth) {
+    const float invW = 1.0f / w;
+    out->x = (x * invW + 1.0f) * viewport->halfWidth - 0.5f;
+    out->y = (1.0f - y * invW) * viewport->halfHeight - 0.5f;
+    out->w = w;
+    *depth = (z * invW + 1.0f) * (0.5f * DEPTH_FAR);
+}
+
+static float PlaneDistance(const ClipVertex* vertex, uint32_t plane, const Viewport* viewport) {
+    switch (plane) {
+        case CLIP_NEAR: return vertex->z + vertex->w;
+        case CLIP_FAR: return vertex->w - vertex->z;
+        case CLIP_GUARD_LEFT: return vertex->x + viewport->guardX * vertex->w;
+        case CLIP_GUARD_RIGHT: return viewport->guardX * vertex->w - vertex->x;
+        case CLIP_GUARD_BOTTOM: return vertex->y + viewport->guardY * vertex->w;
+        case CLIP_GUARD_TOP: return viewport->guardY * vertex->w - vertex->y;
+        default: return 0.0f;
+    }
+}
+
+static ClipVertex Intersect(const ClipVertex* inside, const ClipVertex* outside, float dInside, float dOutside) {
+    const float t = dInside / (dInside - dOutside);
+    ClipVertex result = {
+        inside->x + (outside->x - inside->x) * t,
+        inside->y + (outside->y - inside->y) * t,
+        inside->z + (outside->z - inside->z) * t,
+        inside->w + (outside->w - inside->w) * t,
+        inside->u + (outside->u - inside->u) * t,
+        inside->v + (outside->v - inside->v) * t,
+        { 0.0f },
+        NULL,
+    };
+    for (int c = 0; c < 4; ++c) {
+        result.color[c] = inside->color[c] + (outside->color[c] - inside->color[c]) * t;
+    }
+    return result;
+}
+
+// Sutherland-Hodgman, returns count of vertices left
+static int ClipPolygon(ClipVertex* out, const ClipVertex* in, int count, uint32_t plane, const Viewport* viewport) {
+    int result = 0;
+    float dCurrent = PlaneDistance(&in[0], plane, viewport);
+    for (int i = 0; i < count; ++i) {
+        const ClipVertex* current = &in[i];
+        const ClipVertex* next = &in[i + 1 < count ? i + 1 : 0];
+        const float dNext = PlaneDistance(next, plane, viewport);
+        if (dCurrent >= 0.0f) out[result++] = *current;
+        // intersection is always computed from the inside vertex, so triangles sharing the edge split it equally
+        if (dCurrent >= 0.0f && dNext < 0.0f) out[result++] = Intersect(current, next, dCurrent, dNext);
+        if (dCurrent < 0.0f && dNext >= 0.0f) out[result++] = Intersect(next, current, dNext, dCurrent);
+        dCurrent = dNext;
+    }
+    return result;
+}
+
+static ClipVertex ToClipVertex(const TransformedVertex* transformed, const MeshVertex* vertex) {
+    return (ClipVertex){
+        transformed->x, transformed->y, transformed->z, transformed->w, vertex->u, vertex->v,
+        { vertex->color.r, vertex->color.g, vertex->color.b, vertex->color.a },
+        transformed,
+    };
+}
+
+static uint8_t ToChannel(float value) {
+    return (uint8_t)(value + 0.5f);
+}
+
+static void ClipAndDrawTriangle(Surface surface, const DepthBuffer* depthBuffer, const Mesh* mesh,
+                                const Viewport* viewport, const uint16_t indices[3], uint32_t planes,
+                                const Surface* texture, TriangleFlags flags) {
+    const TransformedVertex* transformed = mesh->transformed;
+    ClipVertex buffers[2][MAX_CLIPPED_VERTICES];
+    for (int i = 0; i < 3; ++i) {
+        buffers[0][i] = ToClipVertex(&transformed[indices[i]], &mesh->vertices[indices[i]]);
+    }
+
+    int count = 3;
+    int current = 0;
+    for (int p = 0; p < CLIP_PLANE_COUNT && count >= 3; ++p) {
+        const uint32_t plane = (uint32_t)CLIP_FIRST_PLANE << p;
+        if ((planes & plane) == 0) continue;
+        count = ClipPolygon(buffers[1 - current], buffers[current], count, plane, viewport);
+        current = 1 - current;
+    }
+    if (count < 3) return;
+
+    Vertex projected[MAX_CLIPPED_VERTICES];
+    float depth[MAX_CLIPPED_VERTICES];
+    for (int i = 0; i < count; ++i) {
+        const ClipVertex* vertex = &buffers[current][i];
+        if (!(vertex->w > 0.0f)) return;
+        // vertices of the mesh keep their projection, so edges shared with triangles that weren't clipped match
+        if (vertex->source != NULL) {
+            projected[i].x = vertex->source->screenX;
+            projected[i].y = vertex->source->screenY;
+            projected[i].w = vertex->w;
+            depth[i] = vertex->source->depth;
+        }
+        else {
+            Project(viewport, vertex->x, vertex->y, vertex->z, vertex->w, &projected[i], &depth[i]);
+        }
+        projected[i].u = vertex->u;
+        projected[i].v = vertex->v;
+        projected[i].color = (Color){
+            ToChannel(vertex->color[0]), ToChannel(vertex->color[1]),
+            ToChannel(vertex->color[2]), ToChannel(vertex->color[3]),
+        };
+    }
+
+    // clipped polygon is convex, so it's drawn as a fan
+    for (int i = 1; i + 1 < count; ++i) {
+        const Vertex* vertices[3] = { &projected[0], &projected[i], &projected[i + 1] };
+        const float fanDepth[3] = { depth[0], depth[i], depth[i + 1] };
+        RasterizeTriangle(surface, vertices, texture, flags, depthBuffer, fanDepth);
+    }
+}
+
+// Sign of the determinant of x, y and w is the winding of the projected triangle, also for vertices behind the camera
+static inline bool FacesAway(const TransformedVertex* a, const TransformedVertex* b, const TransformedVertex* c) {
+    const float det = a->x * (b->y * c->w - c->y * b->w) - a->y * (b->x * c->w - c->x * b->w) +
+                      a->w * (b->x * c->y - c->x * b->y);
+    return !(det > 0.0f);
+}
+
+// Bounds are set to the rect around projected vertices, unless some of them have to be clipped first
+static void TransformVertices(const Mesh* mesh, const Mat4* transform, const Viewport* viewport, Rect* bounds) {
+    const float (*m)[4] = transform->m;
+    TransformedVertex* out = mesh->transformed;
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    bool projected = true;
+    for (int i = 0; i < mesh->vertexCount; ++i) {
+        const MeshVertex* in = &mesh->vertices[i];
+        TransformedVertex vertex;
+        vertex.x = m[0][0] * in->x + m[0][1] * in->y + m[0][2] * in->z + m[0][3];
+        vertex.y = m[1][0] * in->x + m[1][1] * in->y + m[1][2] * in->z + m[1][3];
+        vertex.z = m[2][0] * in->x + m[2][1] * in->y + m[2][2] * in->z + m[2][3];
+        vertex.w = m[3][0] * in->x + m[3][1] * in->y + m[3][2] * in->z + m[3][3];
+        vertex.clip = ClipCode(vertex.x, vertex.y, vertex.z, vertex.w, viewport);
+        if (vertex.clip & CLIP_PLANES) {
+            projected = false;
+        }
+        else {
+            Vertex screen;
+            Project(viewport, vertex.x, vertex.y, vertex.z, vertex.w, &screen, &vertex.depth);
+            vertex.screenX = screen.x;
+            vertex.screenY = screen.y;
+            minX = fminf(minX, screen.x);
+            minY = fminf(minY, screen.y);
+            maxX = fmaxf(maxX, screen.x);
+            maxY = fmaxf(maxY, screen.y);
+        }
+        out[i] = vertex;
+    }
+    if (projected) {
+        *bounds = (Rect){
+            (int)floorf(minX), (int)floorf(minY), (int)ceilf(maxX - minX) + 2, (int)ceilf(maxY - minY) + 2
+        };
+    }
+}
+
+void DrawMesh(Surface surface, const DepthBuffer* depth, Mesh* mesh, const Mat4* transform, const Surface* texture,
+              TriangleFlags flags) {
+    if (mesh == NULL || mesh->transformed == NULL || transform == NULL ||
+        (texture != NULL && texture->pixels == NULL) ||
+        (depth != NULL && (depth->values == NULL || depth->width != surface.width ||
+                           depth->height != surface.height))) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    PROFILE_BEGIN();
+
+    const float guardLimit = (float)TRIANGLE_GUARD_BAND - 1.0f;
+    const Viewport viewport = {
+        0.5f * (float)surface.width,
+        0.5f * (float)surface.height,
+        fmaxf(1.0f, guardLimit / (0.5f * (float)surface.width) - 1.0f),
+        fmaxf(1.0f, guardLimit / (0.5f * (float)surface.height) - 1.0f),
+    };
+    const Rect surfaceRect = { 0, 0, surface.width, surface.height };
+    Rect bounds = surfaceRect;
+    TransformVertices(mesh, transform, &viewport, &bounds);
+    Rect damaged;
+    if (RectIntersection(&surfaceRect, &bounds, &damaged)) DamageAdd(surface, damaged);
+
+    // culling is done here, before clipping, so the rasterizer doesn't repeat it
+    const bool cull = (flags & TRIANGLE_FLAG_CULL_BACK) != 0;
+    flags &= ~TRIANGLE_FLAG_CULL_BACK;
+
+    const TransformedVertex* transformed = mesh->transformed;
+    for (int t = 0; t < mesh->triangleCount; ++t) {
+        const uint16_t* indices = &mesh->indices[t * 3];
+        if (indices[0] >= mesh->vertexCount || indices[1] >= mesh->vertexCount ||
+            indices[2] >= mesh->vertexCount) continue;
+        const TransformedVertex* a = &transformed[indices[0]];
+        const TransformedVertex* b = &transformed[indices[1]];
+        const TransformedVertex* c = &transformed[indices[2]];
+        if (a->clip & b->clip & c->clip) continue;
+        if (cull && FacesAway(a, b, c)) continue;
+
+        const uint32_t planes = (a->clip | b->clip | c->clip) & CLIP_PLANES;
+        if (planes != 0) {
+            ClipAndDrawTriangle(surface, depth, mesh, &viewport, indices, planes, texture, flags);
+            continue;
+        }
+
+        const TransformedVertex* corners[3] = { a, b, c };
+        Vertex screen[3];
+        float screenDepth[3];
+        for (int i = 0; i < 3; ++i) {
+            const MeshVertex* vertex = &mesh->vertices[indices[i]];
+            screen[i] = (Vertex){
+                corners[i]->screenX, corners[i]->screenY, corners[i]->w, vertex->u, vertex->v, vertex->color
+            };
+            screenDepth[i] = corners[i]->depth;
+        }
+        const Vertex* vertices[3] = { &screen[0], &screen[1], &screen[2] };
+        RasterizeTriangle(surface, vertices, texture, flags, depth, screenDepth);
+    }
+    PROFILE_END(PROFILE_ZONE_DRAW_MESH);
+}
@@ -0,0 +1,439 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Allocator.h"
+#include "Error.h"
+#include "Path.h"
+#include "internal/Damage.h"
+#include "internal/Inlines.h"
+#include "internal/Profile.h"
+#include "internal/Scanline.h"
+
+// Uniform subdivision of long or sharply bent curves is capped, the error bound isn't kept past that
+#define PATH_MAX_CURVE_SEGMENTS 256
+
+typedef struct PathEdge {
+    float x0, y0;
+    float x1, y1;  // y0 < y1
+    float dxdy;
+    float dir;     // 1 for edges going down, -1 for edges going up
+} PathEdge;
+
+Path PathCreate(void) {
+    return (Path){ 0 };
+}
+
+void PathDestroy(Path* path) {
+    if (path == NULL) return;
+    AllocatorFree(path->points);
+    AllocatorFree(path->contours);
+    AllocatorFree(path->scratch);
+    *path = (Path){ 0 };
+}
+
+void PathReset(Path* path) {
+    if (path == NULL) return;
+    path->count = 0;
+    path->contourCount = 0;
+    path->start = (Point){ 0.0f, 0.0f };
+    path->closed = false;
+}
+
+static bool Reserve(void** data, int* capacity, int needed, size_t elementSize) {
+    if (needed <= *capacity) return true;
+    int newCapacity = *capacity > 0 ? *capacity : 64;
+    while (newCapacity < needed) newCapacity *= 2;
+
+    void* memory = AllocatorAlloc((size_t)newCapacity * elementSize);
+    if (memory == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return false;
+    }
+    if (*data != NULL) {
+        memcpy(memory, *data, (size_t)*capacity * elementSize);
+        AllocatorFree(*data);
+    }
+    *data = memory;
+    *capacity = newCapacity;
+    return true;
+}
+
+static void BeginContour(Path* path, Point p) {
+    // a contour with just a move doesn't have any edges, so it's replaced
+    if (path->contourCount > 0 && path->contours[path->contourCount - 1] == path->count - 1) {
+        path->points[path->count - 1] = p;
+    }
+    else {
+        if (!Reserve((void**)&path->contours, &path->contourCapacity, path->contourCount + 1, sizeof(int))) return;
+        if (!Reserve((void**)&path->points, &path->capacity, path->count + 1, sizeof(Point))) return;
+        path->contours[path->contourCount++] = path->count;
+        path->points[path->count++] = p;
+    }
+    path->start = p;
+    path->closed = false;
+}
+
+static Point CurrentPoint(Path* path) {
+    if (path->contourCount == 0 || path->closed) {
+        BeginContour(path, path->start);
+    }
+    return path->points[path->count - 1];
+}
+
+static void AddPoint(Path* path, Point p) {
+    if (!Reserve((void**)&path->points, &path->capacity, path->count + 1, sizeof(Point))) return;
+    path->points[path->count++] = p;
+}
+
+void PathMoveTo(Path* path, float x, float y) {
+    if (path == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    BeginContour(path, (Point){ x, y });
+}
+
+void PathLineTo(Path* path, float x, float y) {
+    if (path == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    CurrentPoint(path);
+    AddPoint(path, (Point){ x, y });
+}
+
+static int CurveSegments(float distance) {
+    const int segments = (int)ceilf(sqrtf(distance / PATH_FLATTEN_TOLERANCE));
+    return segments < 1 ? 1 : segments > PATH_MAX_CURVE_SEGMENTS ? PATH_MAX_CURVE_SEGMENTS : segments;
+}
+
+void PathQuadTo(Path* path, float cx, float cy, float x, float y) {
+    if (path == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    const Point p0 = CurrentPoint(path);
+
+    // n lines are within |p0 - 2c + p| / (4 * n^2) of the curve
+    const float ddx = p0.x - 2.0f * cx + x;
+    const float ddy = p0.y - 2.0f * cy + y;
+    const int segments = CurveSegments(sqrtf(ddx * ddx + ddy * ddy) * 0.25f);
+    if (!Reserve((void**)&path->points, &path->capacity, path->count + segments, sizeof(Point))) return;
+
+    for (int i = 1; i < segments; ++i) {
+        const float t = (float)i / (float)segments;
+        const float u = 1.0f - t;
+        path->points[path->count++] = (Point){
+            u * u * p0.x + 2.0f * u * t * cx + t * t * x,
+            u * u * p0.y + 2.0f * u * t * cy + t * t * y
+        };
+    }
+    path->points[path->count++] = (Point){ x, y };
+}
+
+void PathCubicTo(Path* path, float c1x, float c1y, float c2x, float c2y, float x, float y) {
+    if (path == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    const Point p0 = CurrentPoint(path);
+
+    // n lines are within 3 * max(|p0 - 2c1 + c2|, |c1 - 2c2 + p|) / (4 * n^2) of the curve
+    const float ax = p0.x - 2.0f * c1x + c2x;
+    const float ay = p0.y - 2.0f * c1y + c2y;
+    const float bx = c1x - 2.0f * c2x + x;
+    const float by = c1y - 2.0f * c2y + y;
+    const float dd = sqrtf(fmaxf(ax * ax + ay * ay, bx * bx + by * by));
+    const int segments = CurveSegments(dd * 0.75f);
+    if (!Reserve((void**)&path->points, &path->capacity, path->count + segments, sizeof(Point))) return;
+
+    for (int i = 1; i < segments; ++i) {
+        const float t = (float)i / (float)segments;
+        const float u = 1.0f - t;
+        const float w0 = u * u * u;
+        const float w1 = 3.0f * u * u * t;
+        const float w2 = 3.0f * u * t * t;
+        const float w3 = t * t * t;
+        path->points[path->count++] = (Point){
+            w0 * p0.x + w1 * c1x + w2 * c2x + w3 * x,
+            w0 * p0.y + w1 * c1y + w2 * c2y + w3 * y
+        };
+    }
+    path->points[path->count++] = (Point){ x, y };
+}
+
+void PathClose(Path* path) {
+    if (path == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    // contours are closed implicitly when filled, this only makes next one start at beginning of this one
+    path->closed = true;
+}
+
+// Pieces of an edge left of the surface are moved onto its left border, where they still cover everything right of
+// them. Pieces right of it don't cover any pixel and are dropped
+static void AddClippedEdge(PathEdge* edges, int* count, float x0, float y0, float x1, float y1, float width,
+                           float height) {
+    if (y0 == y1) return;
+    if ((y0 <= 0.0f && y1 <= 0.0f) || (y0 >= height && y1 >= height)) return;
+
+    float splits[4] = { 0.0f, 1.0f, 1.0f, 1.0f };
+    int splitCount = 1;
+    if (x0 != x1) {
+        const float borders[2] = { 0.0f, width };
+        for (int i = 0; i < 2; ++i) {
+            const float t = (borders[i] - x0) / (x1 - x0);
+            if (t > 0.0f && t < 1.0f) splits[splitCount++] = t;
+        }
+        if (splitCount == 3 && splits[1] > splits[2]) {
+            const float t = splits[1];
+            splits[1] = splits[2];
+            splits[2] = t;
+        }
+    }
+    splits[splitCount] = 1.0f;
+
+    for (int i = 0; i < splitCount; ++i) {
+        const float ta = splits[i];
+        const float tb = splits[i + 1];
+        float xa = x0 + (x1 - x0) * ta;
+        float xb = x0 + (x1 - x0) * tb;
+        const float ya = y0 + (y1 - y0) * ta;
+        const float yb = y0 + (y1 - y0) * tb;
+        const float mid = 0.5f * (xa + xb);
+        if (mid >= width || ya == yb) continue;
+        if (mid <= 0.0f) {
+            xa = 0.0f;
+            xb = 0.0f;
+        }
+        xa = fminf(fmaxf(xa, 0.0f), width);
+        xb = fminf(fmaxf(xb, 0.0f), width);
+
+        PathEdge* edge = &edges[(*count)++];
+        if (ya < yb) {
+            *edge = (PathEdge){ xa, ya, xb, yb, 0.0f, 1.0f };
+        }
+        else {
+            *edge = (PathEdge){ xb, yb, xa, ya, 0.0f, -1.0f };
+        }
+        edge->dxdy = (edge->x1 - edge->x0) / (edge->y1 - edge->y0);
+    }
+}
+
+static int CompareEdges(const void* a, const void* b) {
+    const PathEdge* ea = a;
+    const PathEdge* eb = b;
+    return (ea->y0 > eb->y0) - (ea->y0 < eb->y0);
+}
+
+// Adds area covered right of a line going from (x, top) to (xNext, top + |d|) within a row. Every cell gets the
+// difference of coverage from the previous one, so summing the row from the left gives coverage of each pixel.
+// Based on font-rs by Raph Levien
+static void AccumulateLine(float* acc, float x, float xNext, float d) {
+    const float x0 = fminf(x, xNext);
+    const float x1 = fmaxf(x, xNext);
+    const float x0Floor = floorf(x0);
+    const int x0i = (int)x0Floor;
+    const float x1Ceil = ceilf(x1);
+    const int x1i = (int)x1Ceil;
+
+    if (x1i <= x0i + 1) {
+        const float xmf = 0.5f * (x + xNext) - x0Floor;
+        acc[x0i] += d - d * xmf;
+        acc[x0i + 1] += d * xmf;
+        return;
+    }
+
+    const float s = 1.0f / (x1 - x0);
+    const float x0f = x0 - x0Floor;
+    const float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+    const float x1f = x1 - x1Ceil + 1.0f;
+    const float am = 0.5f * s * x1f * x1f;
+    acc[x0i] += d * a0;
+    if (x1i == x0i + 2) {
+        acc[x0i + 1] += d * (1.0f - a0 - am);
+    }
+    else {
+        const float a1 = s * (1.5f - x0f);
+        acc[x0i + 1] += d * (a1 - a0);
+        for (int i = x0i + 2; i < x1i - 1; ++i) {
+            acc[i] += d * s;
+        }
+        const float a2 = a1 + (float)(x1i - x0i - 3) * s;
+        acc[x1i - 1] += d * (1.0f - a2 - am);
+    }
+    acc[x1i] += d * am;
+}
+
+static inline int CoverageToAlpha(float winding, bool evenOdd) {
+    float coverage = fabsf(winding);
+    if (evenOdd) {
+        coverage -= 2.0f * floorf(coverage * 0.5f);
+        if (coverage > 1.0f) coverage = 2.0f - coverage;
+    }
+    else if (coverage > 1.0f) {
+        coverage = 1.0f;
+    }
+    return (int)(coverage * 255.0f + 0.5f);
+}
+
+static void FillCoverageSpan(const BlendFill* fill, int y, int x0, int x1, int alpha, Color color, uint32_t pixel) {
+    if (alpha == 255 && color.a == 255) {
+        FillHLine(fill->surface, y, x0, x1, pixel);
+    }
+    else {
+        BlendFillHLine(fill, y, x0, x1, (Color){ color.r, color.g, color.b, (uint8_t)DIV255(color.a * alpha) });
+    }
+}
+
+// Composites cells [minX, maxX) of one row of accumulated coverage and clears them. Fully covered runs are filled as
+// spans, edge pixels are blended one by one
+static void CompositeRow(const BlendFill* fill, int y, float* acc, int minX, int maxX, bool evenOdd, Color color,
+                         uint32_t pixel) {
+    const Surface surface = fill->surface;
+    const uint8_t bpp = surface.format->bytesPerPixel;
+    uint8_t* row = (uint8_t*)surface.pixels + y * surface.stride;
+    const int end = maxX < surface.width ? maxX : surface.width;
+    float winding = 0.0f;
+    int alpha = 0;
+    int runStart = -1;
+    int blended = 0;
+
+    for (int x = minX; x < end; ++x) {
+        // inside runs and gaps between edges cells stay empty, so coverage is converted only where it changes
+        if (acc[x] != 0.0f) {
+            winding += acc[x];
+            alpha = CoverageToAlpha(winding, evenOdd);
+        }
+        if (alpha == 255) {
+            if (runStart < 0) runStart = x;
+            continue;
+        }
+        if (runStart >= 0) {
+            FillCoverageSpan(fill, y, runStart, x, 255, color, pixel);
+            runStart = -1;
+        }
+        const int a = DIV255(color.a * alpha);
+        if (a == 0) continue;
+        BlendColorToPixel(row + x * bpp, color, a, 255 - a, bpp, surface.format);
+        ++blended;
+    }
+    PROFILE_PIXELS(blended);
+
+    // edges right of the surface are dropped, so coverage past the last touched cell stays the same until its end
+    const int rest = end < surface.width ? alpha : 0;
+    if (runStart >= 0 && rest == 255) {
+        FillCoverageSpan(fill, y, runStart, surface.width, 255, color, pixel);
+    }
+    else {
+        if (runStart >= 0) FillCoverageSpan(fill, y, runStart, end, 255, color, pixel);
+        if (rest > 0) FillCoverageSpan(fill, y, end, surface.width, rest, color, pixel);
+    }
+
+    memset(acc + minX, 0, (size_t)(maxX - minX) * sizeof(float));
+}
+
+void DrawPath(Surface surface, Path* path, FillRule rule, Color color) {
+    if (path == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    if (path->count < 2 || color.a == 0) return;
+
+    float minX = path->points[0].x, maxX = minX;
+    float minY = path->points[0].y, maxY = minY;
+    for (int i = 1; i < path->count; ++i) {
+        minX = fminf(minX, path->points[i].x);
+        maxX = fmaxf(maxX, path->points[i].x);
+        minY = fminf(minY, path->points[i].y);
+        maxY = fmaxf(maxY, path->points[i].y);
+    }
+    // pixels half a pixel away from the outline are partly covered
+    if (maxX + 0.5f <= 0.0f || minX - 0.5f >= (float)surface.width ||
+        maxY + 0.5f <= 0.0f || minY - 0.5f >= (float)surface.height) {
+        return;
+    }
+    DamageAdd(surface, (Rect){
+        (int)floorf(minX), (int)floorf(minY), (int)ceilf(maxX - minX) + 2, (int)ceilf(maxY - minY) + 2
+    });
+    PROFILE_BEGIN();
+
+    // every edge is split into at most 3 pieces by surface borders, one row of coverage has 2 cells of slack for
+    // lines ending on the right border
+    const int maxEdges = path->count * 3;
+    const size_t edgesBytes = (size_t)maxEdges * sizeof(PathEdge);
+    const size_t activeBytes = (size_t)maxEdges * sizeof(int);
+    const size_t bytes = edgesBytes + activeBytes + (size_t)(surface.width + 2) * sizeof(float);
+    if (bytes > path->scratchSize) {
+        AllocatorFree(path->scratch);
+        path->scratchSize = 0;
+        path->scratch = AllocatorAlloc(bytes);
+        if (path->scratch == NULL) {
+            THROW_ERROR(ERR_OUT_OF_MEMORY);
+            PROFILE_END(PROFILE_ZONE_DRAW_PATH);
+            return;
+        }
+        path->scratchSize = bytes;
+    }
+    PathEdge* edges = path->scratch;
+    int* active = (int*)((uint8_t*)path->scratch + edgesBytes);
+    float* acc = (float*)((uint8_t*)path->scratch + edgesBytes + activeBytes);
+    memset(acc, 0, (size_t)(surface.width + 2) * sizeof(float));
+
+    // points have pixel centers at integers, coverage cells have them at .5
+    const float width = (float)surface.width;
+    const float height = (float)surface.height;
+    int edgeCount = 0;
+    for (int c = 0; c < path->contourCount; ++c) {
+        const int first = path->contours[c];
+        const int last = c + 1 < path->contourCount ? path->contours[c + 1] : path->count;
+        for (int i = first; i < last; ++i) {
+            const Point a = path->points[i];
+            const Point b = path->points[i + 1 < last ? i + 1 : first];
+            AddClippedEdge(edges, &edgeCount, a.x + 0.5f, a.y + 0.5f, b.x + 0.5f, b.y + 0.5f, width, height);
+        }
+    }
+    qsort(edges, edgeCount, sizeof(PathEdge), CompareEdges);
+
+    const bool evenOdd = rule == FILL_RULE_EVEN_ODD;
+    const uint32_t pixel = ColorToPixel(surface.format, color);
+    const BlendFill fill = BlendFillInit(surface);
+    int next = 0;
+    int activeCount = 0;
+    const int startY = edgeCount > 0 && edges[0].y0 > 0.0f ? (int)edges[0].y0 : 0;
+
+    for (int y = startY; y < surface.height && (next < edgeCount || activeCount > 0); ++y) {
+        const float top = (float)y;
+        const float bottom = top + 1.0f;
+        while (next < edgeCount && edges[next].y0 < bottom) {
+            active[activeCount++] = next++;
+        }
+
+        int rowMinX = surface.width + 2;
+        int rowMaxX = -1;
+        for (int i = 0; i < activeCount; ++i) {
+            const PathEdge* edge = &edges[active[i]];
+            if (edge->y1 <= top) {
+                active[i--] = active[--activeCount];
+                continue;
+            }
+            const float y0 = fmaxf(top, edge->y0);
+            const float y1 = fminf(bottom, edge->y1);
+            if (y1 <= y0) continue;
+            const float x0 = edge->x0 + (y0 - edge->y0) * edge->dxdy;
+            const float x1 = edge->x0 + (y1 - edge->y0) * edge->dxdy;
+            AccumulateLine(acc, x0, x1, (y1 - y0) * edge->dir);
+
+            const int lo = (int)floorf(fminf(x0, x1));
+            const int hi = (int)ceilf(fmaxf(x0, x1)) + 2;
+            if (lo < rowMinX) rowMinX = lo;
+            if (hi > rowMaxX) rowMaxX = hi;
+        }
+        if (rowMaxX >= 0) {
+            CompositeRow(&fill, y, acc, rowMinX, rowMaxX, evenOdd, color, pixel);
+        }
+    }
+    PROFILE_END(PROFILE_ZONE_DRAW_PATH);
+}
@@ -1,6 +1,7 @@
 #include <stddef.h>
 
 #include "Color.h"
+#include "internal/Inlines.h"
 #include "PixelFormat.h"
 
 const PixelFormat FORMAT_RGBA8888 = {
@@ -155,7 +156,93 @@ const PixelFormat FORMAT_BGR233 = {
     .bytesPerPixel = 1,
 };
 
+const PixelFormat FORMAT_RGBA8888_PREMUL = {
+    .rMask = 0xFF000000,
+    .gMask = 0x00FF0000,
+    .bMask = 0x0000FF00,
+    .aMask = 0x000000FF,
+
+    .rShift = 24,
+    .gShift = 16,
+    .bShift = 8,
+    .aShift = 0,
+
+    .rLoss = 0,
+    .gLoss = 0,
+    .bLoss = 0,
+    .aLoss = 0,
+
+    .bytesPerPixel = 4,
+    .premultiplied = true,
+};
+
+const PixelFormat FORMAT_ABGR8888_PREMUL = {
+    .rMask = 0x000000FF,
+    .gMask = 0x0000FF00,
+    .bMask = 0x00FF0000,
+    .aMask = 0xFF000000,
+
+    .rShift = 0,
+    .gShift = 8,
+    .bShift = 16,
+    .aShift = 24,
+
+    .rLoss = 0,
+    .gLoss = 0,
+    .bLoss = 0,
+    .aLoss = 0,
+
+    .bytesPerPixel = 4,
+    .premultiplied = true,
+};
+
+const PixelFormat FORMAT_ARGB8888_PREMUL = {
+    .rMask = 0x00FF0000,
+    .gMask = 0x0000FF00,
+    .bMask = 0x000000FF,
+    .aMask = 0xFF000000,
+
+    .rShift = 16,
+    .gShift = 8,
+    .bShift = 0,
+    .aShift = 24,
+
+    .rLoss = 0,
+    .gLoss = 0,
+    .bLoss = 0,
+    .aLoss = 0,
+
+    .bytesPerPixel = 4,
+    .premultiplied = true,
+};
+
+const PixelFormat FORMAT_BGRA8888_PREMUL = {
+    .rMask = 0x0000FF00,
+    .gMask = 0x00FF0000,
+    .bMask = 0xFF000000,
+    .aMask = 0x000000FF,
+
+    .rShift = 8,
+    .gShift = 16,
+    .bShift = 24,
+    .aShift = 0,
+
+    .rLoss = 0,
+    .gLoss = 0,
+    .bLoss = 0,
+    .aLoss = 0,
+
+    .bytesPerPixel = 4,
+    .premultiplied = true,
+};
+
 uint32_t ColorToPixel(const PixelFormat* format, Color color) {
+    if (format->premultiplied) {
+        color.r = DIV255_ROUND(color.r * color.a);
+        color.g = DIV255_ROUND(color.g * color.a);
+        color.b = DIV255_ROUND(color.b * color.a);
+    }
+
     const uint32_t r = (color.r >> format->rLoss) << format->rShift;
     const uint32_t g = (color.g >> format->gLoss) << format->gShift;
     const uint32_t b = (color.b >> format->bLoss) << format->bShift;
@@ -164,6 +251,12 @@ uint32_t ColorToPixel(const PixelFormat* format, Color color) {
     return r | g | b | a;
 }
 
+static inline uint8_t Unpremultiply(uint8_t c, uint8_t a) {
+    if (a == 0) return 0;
+    const int value = (c * 255 + (a >> 1)) / a;
+    return (value > 255) ? 255 : value;
+}
+
 Color PixelToColor(const PixelFormat* format, uint32_t pixel) {
     Color color;
     color.r = ((pixel & format->rMask) >> format->rShift) << format->rLoss;
@@ -171,6 +264,12 @@ Color PixelToColor(const PixelFormat* format, uint32_t pixel) {
     color.b = ((pixel & format->bMask) >> format->bShift) << format->bLoss;
     color.a = (format->aMask == 0) ? 255 : ((pixel & format->aMask) >> format->aShift) << format->aLoss;
 
+    if (format->premultiplied) {
+        color.r = Unpremultiply(color.r, color.a);
+        color.g = Unpremultiply(color.g, color.a);
+        color.b = Unpremultiply(color.b, color.a);
+    }
+
     return color;
 }
 
@@ -183,6 +282,11 @@ static const PixelFormat* formats[] = {
     &FORMAT_BGR565,
     &FORMAT_RGB332,
     &FORMAT_BGR233,
+    // premultiplied formats have the same masks, so they are placed last to never shadow straight ones
+    &FORMAT_RGBA8888_PREMUL,
+    &FORMAT_ABGR8888_PREMUL,
+    &FORMAT_ARGB8888_PREMUL,
+    &FORMAT_BGRA8888_PREMUL,
 };
 static const int numFormats = sizeof(formats) / sizeof(formats[0]);
 
@@ -0,0 +1,325 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "Allocator.h"
+#include "Cpu.h"
+#include "Error.h"
+#include "Profiler.h"
+#include "internal/Profile.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define THREAD_LOCAL __declspec(thread)
+#define AtomicFetchIncrement(p) (_InterlockedIncrement((volatile long*)(p)) - 1)
+#else
+#define THREAD_LOCAL _Thread_local
+#define AtomicFetchIncrement(p) __atomic_fetch_add(p, 1, __ATOMIC_RELAXED)
+#endif
+
+typedef struct Profiler {
+    bool enabled;
+    bool suspended;
+    int depth;  // zones entered on the drawing thread
+    double frameStart;
+    ProfileFrame current;
+    ProfileFrame history[PROFILER_HISTORY_SIZE];
+    int newest;
+    int count;
+} Profiler;
+
+static Profiler profiler = { 0 };
+
+typedef struct TraceEvent {
+    const char* name;
+    const char* argName;
+    long long arg;
+    double start;
+    double end;
+} TraceEvent;
+
+// Written only by the thread that claimed it
+typedef struct TraceBuffer {
+    TraceEvent* events;
+    int count;
+    int dropped;
+} TraceBuffer;
+
+typedef struct Trace {
+    bool recording;
+    unsigned session;  // increased by every ProfilerTraceBegin, so threads know their buffer is gone
+    int capacity;      // events per buffer
+    int bufferCount;
+    int claimed;       // buffers taken by threads, may exceed bufferCount
+    TraceBuffer* buffers;
+    TraceEvent* events;
+    double origin;
+    double frameStart;
+    uint64_t frameIndex;
+} Trace;
+
+static Trace trace = { 0 };
+
+static THREAD_LOCAL TraceBuffer* threadBuffer = NULL;
+static THREAD_LOCAL unsigned threadSession = 0;
+
+static double Now(void) {
+    struct timespec t;
+    timespec_get(&t, TIME_UTC);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+bool ProfilerIsAvailable(void) {
+#ifdef LGL_PROFILE
+    return true;
+#else
+    return false;
+#endif  // LGL_PROFILE
+}
+
+void ProfilerSetEnabled(bool enabled) {
+    if (!ProfilerIsAvailable() || enabled == profiler.enabled) return;
+    profiler.enabled = enabled;
+    // time when profiler was off doesn't belong to any frame
+    profiler.frameStart = Now();
+}
+
+bool ProfilerIsEnabled(void) {
+    return profiler.enabled;
+}
+
+void ProfilerReset(void) {
+    const bool enabled = profiler.enabled;
+    profiler = (Profiler){ .enabled = enabled, .frameStart = Now() };
+}
+
+static void TraceRecord(const char* name, const char* argName, long long arg, double start, double end) {
+    if (threadSession != trace.session) {
+        const int index = AtomicFetchIncrement(&trace.claimed);
+        threadBuffer = index < trace.bufferCount ? &trace.buffers[index] : NULL;
+        threadSession = trace.session;
+    }
+    if (threadBuffer == NULL) return;
+    if (threadBuffer->count == trace.capacity) {
+        ++threadBuffer->dropped;
+        return;
+    }
+    threadBuffer->events[threadBuffer->count++] = (TraceEvent){ name, argName, arg, start, end };
+}
+
+void ProfilerNextFrame(void) {
+    if (trace.recording) {
+        const double now = Now();
+        TraceRecord("Frame", "index", (long long)trace.frameIndex++, trace.frameStart, now);
+        trace.frameStart = now;
+    }
+    if (!profiler.enabled) return;
+
+    const double now = Now();
+    profiler.current.seconds = now - profiler.frameStart;
+    profiler.frameStart = now;
+
+    profiler.newest = (profiler.newest + 1) % PROFILER_HISTORY_SIZE;
+    profiler.history[profiler.newest] = profiler.current;
+    if (profiler.count < PROFILER_HISTORY_SIZE) ++profiler.count;
+
+    profiler.current = (ProfileFrame){ .index = profiler.current.index + 1 };
+}
+
+const ProfileFrame* ProfilerGetCurrentFrame(void) {
+    return &profiler.current;
+}
+
+const ProfileFrame* ProfilerGetFrame(int age) {
+    if (age < 0 || age >= profiler.count) return NULL;
+    return &profiler.history[(profiler.newest - age + PROFILER_HISTORY_SIZE) % PROFILER_HISTORY_SIZE];
+}
+
+int ProfilerGetFrameCount(void) {
+    return profiler.count;
+}
+
+const char* ProfileZoneName(ProfileZone zone) {
+    switch (zone) {
+        case PROFILE_ZONE_FILL_RECT:              return "FillRect";
+        case PROFILE_ZONE_BLEND_FILL_RECT:        return "BlendFillRect";
+        case PROFILE_ZONE_SURFACE_FILL:           return "SurfaceFill";
+        case PROFILE_ZONE_SURFACE_BLIT:           return "SurfaceBlit";
+        case PROFILE_ZONE_SURFACE_CONVERT:        return "SurfaceConvert";
+        case PROFILE_ZONE_DRAW_RECT:              return "DrawRect";
+        case PROFILE_ZONE_DRAW_CIRCLE:            return "DrawCircle";
+        case PROFILE_ZONE_DRAW_TRIANGLE:          return "DrawTriangle";
+        case PROFILE_ZONE_DRAW_TRIANGLE_SHADED:   return "DrawTriangleShaded";
+        case PROFILE_ZONE_DRAW_TRIANGLE_TEXTURED: return "DrawTriangleTextured";
+        case PROFILE_ZONE_DRAW_MESH:              return "DrawMesh";
+        case PROFILE_ZONE_DRAW_LINE:              return "DrawLine";
+        case PROFILE_ZONE_DRAW_LINE_AA:           return "DrawLineAA";
+        case PROFILE_ZONE_DRAW_POLYLINE:          return "DrawPolyline";
+        case PROFILE_ZONE_DRAW_POLYGON:           return "DrawPolygon";
+        case PROFILE_ZONE_DRAW_PATH:              return "DrawPath";
+        case PROFILE_ZONE_BITMAP_FONT_TEXT:       return "DrawTextBitmapFont";
+        case PROFILE_ZONE_FONT_TEXT:              return "DrawFontText";
+        case PROFILE_ZONE_TRANSFORM:              return "Transform";
+        case PROFILE_ZONE_COMMAND_BUFFER_SUBMIT:  return "CommandBufferSubmit";
+        case PROFILE_ZONE_WINDOW_END_FRAME:       return "WindowEndFrame";
+        default: return "";
+    }
+}
+
+bool ProfilerTraceBegin(int maxEventsPerThread) {
+    if (!ProfilerIsAvailable()) return false;
+    if (maxEventsPerThread <= 0) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return false;
+    }
+    ProfilerTraceFree();
+
+    // command buffers use a thread per core by default, the extra buffer is for the thread submitting them
+    const int bufferCount = CpuGetCoreCount() + 1;
+    trace.buffers = AllocatorAlloc(bufferCount * sizeof(TraceBuffer));
+    trace.events = AllocatorAlloc((size_t)bufferCount * maxEventsPerThread * sizeof(TraceEvent));
+    if (trace.buffers == NULL || trace.events == NULL) {
+        ProfilerTraceFree();
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return false;
+    }
+    for (int i = 0; i < bufferCount; ++i) {
+        trace.buffers[i] = (TraceBuffer){ trace.events + (size_t)i * maxEventsPerThread, 0, 0 };
+    }
+    trace.capacity = maxEventsPerThread;
+    trace.bufferCount = bufferCount;
+    // thread starting the trace is the one drawing frames, it gets a buffer even when there are more threads than
+    // buffers
+    trace.claimed = 1;
+    ++trace.session;
+    threadBuffer = &trace.buffers[0];
+    threadSession = trace.session;
+    trace.origin = Now();
+    trace.frameStart = trace.origin;
+    trace.frameIndex = 0;
+    trace.recording = true;
+    return true;
+}
+
+void ProfilerTraceEnd(void) {
+    trace.recording = false;
+}
+
+bool ProfilerIsTracing(void) {
+    return trace.recording;
+}
+
+int ProfilerTraceGetEventCount(void) {
+    int count = 0;
+    for (int i = 0; i < trace.bufferCount; ++i) {
+        count += trace.buffers[i].count;
+    }
+    return count;
+}
+
+int ProfilerTraceGetDroppedCount(void) {
+    int count = 0;
+    for (int i = 0; i < trace.bufferCount; ++i) {
+        count += trace.buffers[i].dropped;
+    }
+    return count;
+}
+
+bool ProfilerTraceSave(const char* path) {
+    if (!ProfilerIsAvailable()) return false;
+    if (path == NULL || trace.recording || trace.buffers == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return false;
+    }
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return false;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"LGL\"}}");
+    for (int i = 0; i < trace.bufferCount; ++i) {
+        const TraceBuffer* buffer = &trace.buffers[i];
+        if (buffer->count == 0 && buffer->dropped == 0) continue;
+        // thread 0 started the trace, others are numbered in order of their first event
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}}",
+                i, i);
+        // durations are complete events ("X"), which is a begin/end pair stored once
+        for (int j = 0; j < buffer->count; ++j) {
+            const TraceEvent* event = &buffer->events[j];
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"LGL\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    event->name, i, (event->start - trace.origin) * 1e6, (event->end - event->start) * 1e6);
+            if (event->argName != NULL) {
+                fprintf(f, ",\"args\":{\"%s\":%lld}", event->argName, event->arg);
+            }
+            fprintf(f, "}");
+        }
+    }
+    fprintf(f, "\n]}\n");
+
+    const bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+void ProfilerTraceFree(void) {
+    AllocatorFree(trace.events);
+    AllocatorFree(trace.buffers);
+    const unsigned session = trace.session;
+    trace = (Trace){ .session = session };
+}
+
+#ifdef LGL_PROFILE
+// Pixel counters of the calling thread. Scopes remember them on entry and take the difference on exit, so nested
+// scopes count their pixels without a stack. zonePixels skips pixels drawn while suspended
+static THREAD_LOCAL uint64_t threadPixels = 0;
+static THREAD_LOCAL uint64_t zonePixels = 0;
+
+ProfileScope ProfilerBeginZone(void) {
+    const bool traced = trace.recording;
+    // nested zones only add their pixels to the outer one
+    const bool active = profiler.enabled && !profiler.suspended && profiler.depth == 0;
+    if (!active && !traced) return (ProfileScope){ 0 };
+    if (active) profiler.depth = 1;
+    return (ProfileScope){ Now(), threadPixels, zonePixels, active, traced };
+}
+
+void ProfilerEndZone(ProfileScope scope, ProfileZone zone) {
+    if (!scope.active && !scope.traced) return;
+    const double now = Now();
+    if (scope.active) {
+        ProfileZoneStats* stats = &profiler.current.zones[zone];
+        stats->seconds += now - scope.start;
+        stats->pixels += zonePixels - scope.zonePixels;
+        ++stats->calls;
+        profiler.depth = 0;
+    }
+    if (scope.traced) {
+        // zones ending while suspended run on workers. CommandBufferSubmit ends after it and counts pixels of all
+        // threads itself, so tiles drawn by the submitting thread must not be added again
+        const uint64_t pixels = profiler.suspended ? threadPixels - scope.pixels : zonePixels - scope.zonePixels;
+        TraceRecord(ProfileZoneName(zone), "pixels", (long long)pixels, scope.start, now);
+    }
+}
+
+void ProfilerAddPixels(long long pixels) {
+    if (pixels <= 0) return;
+    threadPixels += (uint64_t)pixels;
+    if (!profiler.suspended) zonePixels += (uint64_t)pixels;
+}
+
+ProfileScope ProfilerBeginSpan(void) {
+    if (!trace.recording) return (ProfileScope){ 0 };
+    return (ProfileScope){ Now(), threadPixels, zonePixels, false, true };
+}
+
+void ProfilerEndSpan(ProfileScope scope, const char* name, const char* argName, long long arg) {
+    if (!scope.traced) return;
+    TraceRecord(name, argName, arg, scope.start, Now());
+}
+
+void ProfilerSuspend(bool suspended) {
+    profiler.suspended = suspended;
+}
+#endif  // LGL_PROFILE
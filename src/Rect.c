@@ -17,3 +17,13 @@ bool RectIntersection(const Rect* a, const Rect* b, Rect* result) {
 
     return true;
 }
+
+// Smallest rect containing both rects
+Rect RectUnion(const Rect* a, const Rect* b) {
+    const int x1 = (a->x < b->x) ? a->x : b->x;
+    const int y1 = (a->y < b->y) ? a->y : b->y;
+    const int x2 = ((a->x + a->width) > (b->x + b->width)) ? (a->x + a->width) : (b->x + b->width);
+    const int y2 = ((a->y + a->height) > (b->y + b->height)) ? (a->y + a->height) : (b->y + b->height);
+
+    return (Rect){ x1, y1, x2 - x1, y2 - y1 };
+}
@@ -0,0 +1,421 @@
+#include "Cpu.h"
+#include "internal/Inlines.h"
+#include "internal/RowKernels.h"
+
+#ifdef LGL_SIMD_DISPATCH
+#include <immintrin.h>
+#endif  // LGL_SIMD_DISPATCH
+
+static bool GetChannelByte(uint32_t mask, uint8_t shift, uint8_t loss, int8_t* index) {
+    if (mask == 0) {
+        *index = -1;
+        return true;
+    }
+    if (loss != 0 || (shift & 7) != 0 || mask != (0xFFu << shift)) return false;
+    *index = (int8_t)(shift >> 3);
+    return true;
+}
+
+bool GetByteLayout(const PixelFormat* format, ByteLayout* layout) {
+    if (format->bytesPerPixel != 4) return false;
+    return GetChannelByte(format->rMask, format->rShift, format->rLoss, &layout->r) &&
+           GetChannelByte(format->gMask, format->gShift, format->gLoss, &layout->g) &&
+           GetChannelByte(format->bMask, format->bShift, format->bLoss, &layout->b) &&
+           GetChannelByte(format->aMask, format->aShift, format->aLoss, &layout->a);
+}
+
+RowShuffle MakeRowShuffle(ByteLayout src, ByteLayout dst) {
+    uint8_t bytes[4] = { 0x80, 0x80, 0x80, 0x80 };
+    uint32_t fill = 0;
+
+    if (dst.r >= 0 && src.r >= 0) bytes[dst.r] = (uint8_t)src.r;
+    if (dst.g >= 0 && src.g >= 0) bytes[dst.g] = (uint8_t)src.g;
+    if (dst.b >= 0 && src.b >= 0) bytes[dst.b] = (uint8_t)src.b;
+    if (dst.a >= 0) {
+        // source without alpha is opaque, the same way PixelToColor treats it
+        if (src.a >= 0) bytes[dst.a] = (uint8_t)src.a;
+        else fill = 0xFFu << (dst.a << 3);
+    }
+
+    RowShuffle shuffle;
+    for (int i = 0; i < 16; ++i) {
+        const uint8_t b = bytes[i & 3];
+        shuffle.mask[i] = (b == 0x80) ? 0x80 : (uint8_t)((i & ~3) + b);
+    }
+    shuffle.fill = fill;
+    return shuffle;
+}
+
+#ifdef LGL_SIMD_DISPATCH
+
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+// Every byte is blended with (s * m + d * (255 - a)) / 255, where m is source alpha for color bytes and 255 for
+// alpha byte. For alpha byte it gives a + d * (255 - a) / 255, so all four bytes share one formula and match
+// BlendColors exactly.
+static inline uint32_t BlendPixel(uint32_t s, uint32_t d, int alphaShift) {
+    const uint32_t a = (s >> alphaShift) & 0xFF;
+    const uint32_t invA = 255 - a;
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        const uint32_t m = (shift == alphaShift) ? 255 : a;
+        const uint32_t v = ((s >> shift) & 0xFF) * m + ((d >> shift) & 0xFF) * invA;
+        out |= DIV255(v) << shift;
+    }
+    return out;
+}
+
+static inline uint32_t ShufflePixel(uint32_t s, const RowShuffle* shuffle) {
+    uint32_t out = shuffle->fill;
+    for (int i = 0; i < 4; ++i) {
+        const uint8_t b = shuffle->mask[i];
+        if (b != 0x80) out |= ((s >> (b << 3)) & 0xFF) << (i << 3);
+    }
+    return out;
+}
+
+// Shuffle mask copying alpha byte into all bytes of its pixel, and mask selecting alpha bytes
+static inline void MakeAlphaMasks(int alphaShift, uint8_t broadcast[16], uint8_t alphaBytes[16]) {
+    const int index = alphaShift >> 3;
+    for (int i = 0; i < 16; ++i) {
+        broadcast[i] = (uint8_t)((i & ~3) + index);
+        alphaBytes[i] = ((i & 3) == index) ? 0xFF : 0x00;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// SSE4.1 - 4 pixels per iteration
+
+TARGET_SSE41 static inline __m128i Div255_SSE41(__m128i x) {
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
+
+TARGET_SSE41 static inline __m128i Blend_SSE41(__m128i s, __m128i d, __m128i broadcast, __m128i alphaBytes) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i a = _mm_shuffle_epi8(s, broadcast);
+    const __m128i m = _mm_or_si128(a, alphaBytes);
+    const __m128i invA = _mm_xor_si128(a, _mm_set1_epi8((char)0xFF));
+
+    const __m128i lo = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(m, zero)),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(invA, zero))
+    );
+    const __m128i hi = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(m, zero)),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(invA, zero))
+    );
+
+    return _mm_packus_epi16(Div255_SSE41(lo), Div255_SSE41(hi));
+}
+
+TARGET_SSE41 static void BlendRow_SSE41(uint32_t* dst, const uint32_t* src, int n, int alphaShift) {
+    uint8_t broadcastBytes[16], alphaBytesBytes[16];
+    MakeAlphaMasks(alphaShift, broadcastBytes, alphaBytesBytes);
+    const __m128i broadcast = _mm_loadu_si128((const __m128i*)broadcastBytes);
+    const __m128i alphaBytes = _mm_loadu_si128((const __m128i*)alphaBytesBytes);
+
+    int i = 0;
+    for (; i + 3 < n; i += 4) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), Blend_SSE41(s, d, broadcast, alphaBytes));
+    }
+    for (; i < n; ++i) {
+        dst[i] = BlendPixel(src[i], dst[i], alphaShift);
+    }
+}
+
+TARGET_SSE41 static void BlendSolidRow_SSE41(uint32_t* dst, int n, uint32_t pixel, uint8_t alpha, int alphaShift) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i a = _mm_set1_epi8((char)alpha);
+    const __m128i alphaBytes = _mm_set1_epi32((int)(0xFFu << alphaShift));
+    const __m128i m = _mm_or_si128(a, alphaBytes);
+    const __m128i invA = _mm_unpacklo_epi8(_mm_set1_epi8((char)(255 - alpha)), zero);
+    // source part of the sum is the same for every pixel
+    const __m128i sm = _mm_mullo_epi16(
+        _mm_unpacklo_epi8(_mm_set1_epi32((int)pixel), zero),
+        _mm_unpacklo_epi8(m, zero)
+    );
+
+    int i = 0;
+    for (; i + 3 < n; i += 4) {
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i lo = _mm_add_epi16(sm, _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invA));
+        const __m128i hi = _mm_add_epi16(sm, _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invA));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(Div255_SSE41(lo), Div255_SSE41(hi)));
+    }
+    const uint32_t src = (pixel & ~(0xFFu << alphaShift)) | ((uint32_t)alpha << alphaShift);
+    for (; i < n; ++i) {
+        dst[i] = BlendPixel(src, dst[i], alphaShift);
+    }
+}
+
+TARGET_SSE41 static inline __m128i Div255Round_SSE41(__m128i x) {
+    const __m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Premultiplied blend is s + d * (255 - a) / 255 for every byte, so source needs no multiplication at all
+TARGET_SSE41 static inline __m128i BlendPremul_SSE41(__m128i s, __m128i d, __m128i invA) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = Div255Round_SSE41(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(invA, zero)));
+    const __m128i hi = Div255Round_SSE41(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(invA, zero)));
+    return _mm_adds_epu8(s, _mm_packus_epi16(lo, hi));
+}
+
+TARGET_SSE41 static void BlendPremulRow_SSE41(uint32_t* dst, const uint32_t* src, int n, int alphaShift) {
+    uint8_t broadcastBytes[16], alphaBytesBytes[16];
+    MakeAlphaMasks(alphaShift, broadcastBytes, alphaBytesBytes);
+    const __m128i broadcast = _mm_loadu_si128((const __m128i*)broadcastBytes);
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+
+    int i = 0;
+    for (; i + 3 < n; i += 4) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i invA = _mm_xor_si128(_mm_shuffle_epi8(s, broadcast), ones);
+        _mm_storeu_si128((__m128i*)(dst + i), BlendPremul_SSE41(s, d, invA));
+    }
+    for (; i < n; ++i) {
+        dst[i] = BlendPremultipliedPixel(src[i], dst[i], alphaShift);
+    }
+}
+
+TARGET_SSE41 static void BlendPremulSolidRow_SSE41(uint32_t* dst, int n, uint32_t pixel, int alphaShift) {
+    const __m128i s = _mm_set1_epi32((int)pixel);
+    const __m128i invA = _mm_set1_epi8((char)(255 - ((pixel >> alphaShift) & 0xFF)));
+
+    int i = 0;
+    for (; i + 3 < n; i += 4) {
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), BlendPremul_SSE41(s, d, invA));
+    }
+    for (; i < n; ++i) {
+        dst[i] = BlendPremultipliedPixel(pixel, dst[i], alphaShift);
+    }
+}
+
+TARGET_SSE41 static void ShuffleRow_SSE41(uint32_t* dst, const uint32_t* src, int n, const RowShuffle* shuffle) {
+    const __m128i mask = _mm_loadu_si128((const __m128i*)shuffle->mask);
+    const __m128i fill = _mm_set1_epi32((int)shuffle->fill);
+
+    int i = 0;
+    for (; i + 3 < n; i += 4) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_shuffle_epi8(s, mask), fill));
+    }
+    for (; i < n; ++i) {
+        dst[i] = ShufflePixel(src[i], shuffle);
+    }
+}
+
+TARGET_SSE41 static void ShuffleBlendRow_SSE41(uint32_t* dst, const uint32_t* src, int n, const RowShuffle* shuffle,
+                                               int alphaShift) {
+    uint8_t broadcastBytes[16], alphaBytesBytes[16];
+    MakeAlphaMasks(alphaShift, broadcastBytes, alphaBytesBytes);
+    const __m128i broadcast = _mm_loadu_si128((const __m128i*)broadcastBytes);
+    const __m128i alphaBytes = _mm_loadu_si128((const __m128i*)alphaBytesBytes);
+    const __m128i mask = _mm_loadu_si128((const __m128i*)shuffle->mask);
+    const __m128i fill = _mm_set1_epi32((int)shuffle->fill);
+
+    int i = 0;
+    for (; i + 3 < n; i += 4) {
+        const __m128i s = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i)), mask), fill);
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), Blend_SSE41(s, d, broadcast, alphaBytes));
+    }
+    for (; i < n; ++i) {
+        dst[i] = BlendPixel(ShufflePixel(src[i], shuffle), dst[i], alphaShift);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// AVX2 - 8 pixels per iteration, byte shuffles and unpacking work within 128-bit lanes, which is enough for pixels
+
+TARGET_AVX2 static inline __m256i Div255_AVX2(__m256i x) {
+    return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8)), 8);
+}
+
+TARGET_AVX2 static inline __m256i Blend_AVX2(__m256i s, __m256i d, __m256i broadcast, __m256i alphaBytes) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i a = _mm256_shuffle_epi8(s, broadcast);
+    const __m256i m = _mm256_or_si256(a, alphaBytes);
+    const __m256i invA = _mm256_xor_si256(a, _mm256_set1_epi8((char)0xFF));
+
+    const __m256i lo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(m, zero)),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(invA, zero))
+    );
+    const __m256i hi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(m, zero)),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(invA, zero))
+    );
+
+    return _mm256_packus_epi16(Div255_AVX2(lo), Div255_AVX2(hi));
+}
+
+TARGET_AVX2 static inline __m256i LoadMask_AVX2(const uint8_t bytes[16]) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)bytes));
+}
+
+TARGET_AVX2 static void BlendRow_AVX2(uint32_t* dst, const uint32_t* src, int n, int alphaShift) {
+    uint8_t broadcastBytes[16], alphaBytesBytes[16];
+    MakeAlphaMasks(alphaShift, broadcastBytes, alphaBytesBytes);
+    const __m256i broadcast = LoadMask_AVX2(broadcastBytes);
+    const __m256i alphaBytes = LoadMask_AVX2(alphaBytesBytes);
+
+    int i = 0;
+    for (; i + 7 < n; i += 8) {
+        const __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), Blend_AVX2(s, d, broadcast, alphaBytes));
+    }
+    for (; i < n; ++i) {
+        dst[i] = BlendPixel(src[i], dst[i], alphaShift);
+    }
+}
+
+TARGET_AVX2 static void BlendSolidRow_AVX2(uint32_t* dst, int n, uint32_t pixel, uint8_t alpha, int alphaShift) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i a = _mm256_set1_epi8((char)alpha);
+    const __m256i alphaBytes = _mm256_set1_epi32((int)(0xFFu << alphaShift));
+    const __m256i m = _mm256_or_si256(a, alphaBytes);
+    const __m256i invA = _mm256_unpacklo_epi8(_mm256_set1_epi8((char)(255 - alpha)), zero);
+    const __m256i sm = _mm256_mullo_epi16(
+        _mm256_unpacklo_epi8(_mm256_set1_epi32((int)pixel), zero),
+        _mm256_unpacklo_epi8(m, zero)
+    );
+
+    int i = 0;
+    for (; i + 7 < n; i += 8) {
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        const __m256i lo = _mm256_add_epi16(sm, _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), invA));
+        const __m256i hi = _mm256_add_epi16(sm, _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), invA));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(Div255_AVX2(lo), Div255_AVX2(hi)));
+    }
+    const uint32_t src = (pixel & ~(0xFFu << alphaShift)) | ((uint32_t)alpha << alphaShift);
+    for (; i < n; ++i) {
+        dst[i] = BlendPixel(src, dst[i], alphaShift);
+    }
+}
+
+TARGET_AVX2 static inline __m256i Div255Round_AVX2(__m256i x) {
+    const __m256i t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+TARGET_AVX2 static inline __m256i BlendPremul_AVX2(__m256i s, __m256i d, __m256i invA) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lo = Div255Round_AVX2(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(invA, zero))
+    );
+    const __m256i hi = Div255Round_AVX2(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(invA, zero))
+    );
+    return _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi));
+}
+
+TARGET_AVX2 static void BlendPremulRow_AVX2(uint32_t* dst, const uint32_t* src, int n, int alphaShift) {
+    uint8_t broadcastBytes[16], alphaBytesBytes[16];
+    MakeAlphaMasks(alphaShift, broadcastBytes, alphaBytesBytes);
+    const __m256i broadcast = LoadMask_AVX2(broadcastBytes);
+    const __m256i ones = _mm256_set1_epi8((char)0xFF);
+
+    int i = 0;
+    for (; i + 7 < n; i += 8) {
+        const __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        const __m256i invA = _mm256_xor_si256(_mm256_shuffle_epi8(s, broadcast), ones);
+        _mm256_storeu_si256((__m256i*)(dst + i), BlendPremul_AVX2(s, d, invA));
+    }
+    for (; i < n; ++i) {
+        dst[i] = BlendPremultipliedPixel(src[i], dst[i], alphaShift);
+    }
+}
+
+TARGET_AVX2 static void BlendPremulSolidRow_AVX2(uint32_t* dst, int n, uint32_t pixel, int alphaShift) {
+    const __m256i s = _mm256_set1_epi32((int)pixel);
+    const __m256i invA = _mm256_set1_epi8((char)(255 - ((pixel >> alphaShift) & 0xFF)));
+
+    int i = 0;
+    for (; i + 7 < n; i += 8) {
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), BlendPremul_AVX2(s, d, invA));
+    }
+    for (; i < n; ++i) {
+        dst[i] = BlendPremultipliedPixel(pixel, dst[i], alphaShift);
+    }
+}
+
+TARGET_AVX2 static void ShuffleRow_AVX2(uint32_t* dst, const uint32_t* src, int n, const RowShuffle* shuffle) {
+    const __m256i mask = LoadMask_AVX2(shuffle->mask);
+    const __m256i fill = _mm256_set1_epi32((int)shuffle->fill);
+
+    int i = 0;
+    for (; i + 7 < n; i += 8) {
+        const __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_shuffle_epi8(s, mask), fill));
+    }
+    for (; i < n; ++i) {
+        dst[i] = ShufflePixel(src[i], shuffle);
+    }
+}
+
+TARGET_AVX2 static void ShuffleBlendRow_AVX2(uint32_t* dst, const uint32_t* src, int n, const RowShuffle* shuffle,
+                                             int alphaShift) {
+    uint8_t broadcastBytes[16], alphaBytesBytes[16];
+    MakeAlphaMasks(alphaShift, broadcastBytes, alphaBytesBytes);
+    const __m256i broadcast = LoadMask_AVX2(broadcastBytes);
+    const __m256i alphaBytes = LoadMask_AVX2(alphaBytesBytes);
+    const __m256i mask = LoadMask_AVX2(shuffle->mask);
+    const __m256i fill = _mm256_set1_epi32((int)shuffle->fill);
+
+    int i = 0;
+    for (; i + 7 < n; i += 8) {
+        const __m256i s = _mm256_or_si256(
+            _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + i)), mask),
+            fill
+        );
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), Blend_AVX2(s, d, broadcast, alphaBytes));
+    }
+    for (; i < n; ++i) {
+        dst[i] = BlendPixel(ShufflePixel(src[i], shuffle), dst[i], alphaShift);
+    }
+}
+
+static const RowKernels kernelsSSE41 = {
+    .blendRow = BlendRow_SSE41,
+    .blendSolidRow = BlendSolidRow_SSE41,
+    .shuffleRow = ShuffleRow_SSE41,
+    .shuffleBlendRow = ShuffleBlendRow_SSE41,
+    .blendPremulRow = BlendPremulRow_SSE41,
+    .blendPremulSolidRow = BlendPremulSolidRow_SSE41,
+};
+
+static const RowKernels kernelsAVX2 = {
+    .blendRow = BlendRow_AVX2,
+    .blendSolidRow = BlendSolidRow_AVX2,
+    .shuffleRow = ShuffleRow_AVX2,
+    .shuffleBlendRow = ShuffleBlendRow_AVX2,
+    .blendPremulRow = BlendPremulRow_AVX2,
+    .blendPremulSolidRow = BlendPremulSolidRow_AVX2,
+};
+
+// NULL means that callers should use their own scalar or SSE2 code
+const RowKernels* GetRowKernels(void) {
+    switch (CpuGetSimdLevel()) {
+        case SIMD_LEVEL_AVX2: return &kernelsAVX2;
+        case SIMD_LEVEL_SSE4_1: return &kernelsSSE41;
+        default: return NULL;
+    }
+}
+
+#else
+
+const RowKernels* GetRowKernels(void) {
+    return NULL;
+}
+
+#endif  // LGL_SIMD_DISPATCH
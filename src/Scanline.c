@@ -0,0 +1,299 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Allocator.h"
+#include "Error.h"
+#include "internal/Inlines.h"
+#include "internal/Profile.h"
+#include "internal/Scanline.h"
+
+void FillHLine(Surface surface, int y, int x0, int x1, uint32_t color) {
+    if (y < 0 || y >= surface.height) return;
+
+    if (x0 < 0) x0 = 0;
+    if (x1 > surface.width) x1 = surface.width;
+    if (x0 >= x1) return;
+
+    const int bpp = surface.format->bytesPerPixel;
+    const int w = x1 - x0;
+    PROFILE_PIXELS(w);
+
+    uint8_t* row = (uint8_t*)surface.pixels + y * surface.stride + x0 * bpp;
+
+    switch (bpp) {
+        case 1: {
+            color |= color << 8;
+            color |= color << 16;
+            const int quads = w >> 2;
+            const int offset = quads << 2;
+            int rest = w & 3;
+            Memset4(row, color, quads);
+            uint8_t* p = row + offset;
+            while (rest--) {
+                *p++ = (uint8_t)color;
+            }
+        } break;
+        case 2: {
+            color |= color << 16;
+            const int pairs = w >> 1;
+            const int offset = pairs << 2;
+            const int odd = w & 1;
+            Memset4(row, color, pairs);
+            if (odd) {
+                *(uint16_t*)(row + offset) = (uint16_t)color;
+            }
+        } break;
+        case 4: {
+            Memset4(row, color, w);
+        } break;
+        default: break;
+    }
+}
+
+void BlendFillHLine(const BlendFill* fill, int y, int x0, int x1, Color color) {
+    if (y < 0 || y >= fill->surface.height) return;
+
+    if (x0 < 0) x0 = 0;
+    if (x1 > fill->surface.width) x1 = fill->surface.width;
+    if (x0 >= x1) return;
+
+    PROFILE_PIXELS(x1 - x0);
+    BlendFillClipped(fill, (Rect){ x0, y, x1 - x0, 1 }, color);
+}
+
+static inline fixed_t SaturateFixed(int64_t value) {
+    if (value < INT32_MIN) return INT32_MIN;
+    if (value > INT32_MAX) return INT32_MAX;
+    return (fixed_t)value;
+}
+
+// First row whose center is at or below y
+static inline int RowAtOrBelow(fixed_t y) {
+    return FIXED_INT_PART(y + (FIXED_ONE >> 1) - 1);
+}
+
+bool EdgeListInit(EdgeList* list, int maxEdges, int width, int height) {
+    if (list == NULL || maxEdges <= 0) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return false;
+    }
+    const size_t bytes = (size_t)maxEdges * (sizeof(ScanEdge) + sizeof(int));
+    list->edges = AllocatorAlloc(bytes);
+    if (list->edges == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return false;
+    }
+    list->count = 0;
+    list->capacity = maxEdges;
+    list->width = width;
+    list->height = height;
+    list->minY = height;
+    list->maxY = 0;
+    return true;
+}
+
+void EdgeListFree(EdgeList* list) {
+    if (list == NULL) return;
+    AllocatorFree(list->edges);
+    list->edges = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+void EdgeListAdd(EdgeList* list, fixed_t x0, fixed_t y0, fixed_t x1, fixed_t y1) {
+    int winding = 1;
+    if (y0 > y1) {
+        fixed_t t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+        winding = -1;
+    }
+    const int row0 = RowAtOrBelow(y0);
+    const int row1 = RowAtOrBelow(y1);
+    if (row0 >= row1 || row1 <= 0 || row0 >= list->height) return;
+    // pixels left of an edge don't depend on it
+    if (x0 >= TO_FIXED(list->width) && x1 >= TO_FIXED(list->width)) return;
+    if (list->count == list->capacity) return;
+
+    // differences of far apart coordinates don't fit in 32 bits, and neither does the slope of a nearly flat edge
+    const int64_t dx = (int64_t)x1 - x0;
+    const int64_t dy = (int64_t)y1 - y0;
+    const fixed_t dxdy = SaturateFixed(dx * FIXED_ONE / dy);
+    const fixed_t centerY = row0 * FIXED_ONE + (FIXED_ONE >> 1);
+    ScanEdge* edge = &list->edges[list->count++];
+    edge->x = SaturateFixed(x0 + (((int64_t)(centerY - y0) * dxdy) >> FIXED_SHIFT));
+    edge->dxdy = dxdy;
+    edge->y0 = row0;
+    edge->y1 = row1;
+    edge->winding = winding;
+
+    if (row0 < list->minY) list->minY = row0;
+    if (row1 > list->maxY) list->maxY = row1;
+}
+
+static int CompareEdges(const void* a, const void* b) {
+    const ScanEdge* ea = a;
+    const ScanEdge* eb = b;
+    return (ea->y0 > eb->y0) - (ea->y0 < eb->y0);
+}
+
+void EdgeListFill(EdgeList* list, Surface surface, bool evenOdd, Color color) {
+    if (list == NULL || list->count == 0 || color.a == 0) return;
+
+    ScanEdge* edges = list->edges;
+    int* active = (int*)(edges + list->capacity);
+    qsort(edges, list->count, sizeof(ScanEdge), CompareEdges);
+
+    const bool opaque = color.a == 255;
+    const uint32_t pixel = ColorToPixel(surface.format, color);
+    const BlendFill fill = BlendFillInit(surface);
+    const int startY = list->minY > 0 ? list->minY : 0;
+    const int endY = list->maxY < surface.height ? list->maxY : surface.height;
+    int next = 0;
+    int activeCount = 0;
+
+    for (int y = startY; y < endY; ++y) {
+        // edges starting above the surface are moved to its first row when they become active
+        while (next < list->count && edges[next].y0 <= y) {
+            ScanEdge* edge = &edges[next];
+            if (edge->y0 < y) {
+                edge->x += (fixed_t)((int64_t)(y - edge->y0) * edge->dxdy);
+            }
+            active[activeCount++] = next++;
+        }
+
+        // active edges are kept sorted by x; they rarely swap between rows, so insertion sort is almost free
+        int kept = 0;
+        for (int i = 0; i < activeCount; ++i) {
+            const int index = active[i];
+            if (edges[index].y1 <= y) continue;
+            const fixed_t x = edges[index].x;
+            int j = kept++;
+            while (j > 0 && edges[active[j - 1]].x > x) {
+                active[j] = active[j - 1];
+                --j;
+            }
+            active[j] = index;
+        }
+        activeCount = kept;
+
+        int winding = 0;
+        int spanStart = 0;
+        for (int i = 0; i < activeCount; ++i) {
+            const ScanEdge* edge = &edges[active[i]];
+            const bool wasInside = evenOdd ? (winding & 1) != 0 : winding != 0;
+            winding += edge->winding;
+            const bool inside = evenOdd ? (winding & 1) != 0 : winding != 0;
+            if (wasInside == inside) continue;
+
+            const int x = RowAtOrBelow(edge->x);
+            if (inside) {
+                spanStart = x;
+            }
+            else if (opaque) {
+                FillHLine(surface, y, spanStart, x, pixel);
+            }
+            else {
+                BlendFillHLine(&fill, y, spanStart, x, color);
+            }
+        }
+        // edges right of the surface aren't stored, so the last span may end there
+        if (evenOdd ? (winding & 1) != 0 : winding != 0) {
+            if (opaque) {
+                FillHLine(surface, y, spanStart, surface.width, pixel);
+            }
+            else {
+                BlendFillHLine(&fill, y, spanStart, surface.width, color);
+            }
+        }
+
+        for (int i = 0; i < activeCount; ++i) {
+            edges[active[i]].x += edges[active[i]].dxdy;
+        }
+    }
+}
+
+// Divisions rounding towards minus infinity, divisor is positive
+static inline int64_t FloorDiv(int64_t n, int64_t d) {
+    const int64_t q = n / d;
+    return (n % d != 0 && n < 0) ? q - 1 : q;
+}
+
+static inline int64_t CeilDiv(int64_t n, int64_t d) {
+    return -FloorDiv(-n, d);
+}
+
+bool TriangleSetupInit(TriangleSetup* setup, const int32_t x[3], const int32_t y[3], int width, int height) {
+    int64_t vx[3], vy[3];
+    for (int i = 0; i < 3; ++i) {
+        vx[i] = x[i];
+        vy[i] = y[i];
+    }
+    setup->area = (vx[1] - vx[0]) * (vy[2] - vy[0]) - (vy[1] - vy[0]) * (vx[2] - vx[0]);
+    if (setup->area == 0) return false;
+    if (setup->area < 0) {
+        int64_t t = vx[1]; vx[1] = vx[2]; vx[2] = t;
+        t = vy[1]; vy[1] = vy[2]; vy[2] = t;
+        setup->area = -setup->area;
+    }
+
+    const int64_t minY = vy[0] < vy[1] ? (vy[0] < vy[2] ? vy[0] : vy[2]) : (vy[1] < vy[2] ? vy[1] : vy[2]);
+    const int64_t maxY = vy[0] > vy[1] ? (vy[0] > vy[2] ? vy[0] : vy[2]) : (vy[1] > vy[2] ? vy[1] : vy[2]);
+    const int64_t firstRow = CeilDiv(minY, TRIANGLE_SUBPIXEL_ONE);
+    const int64_t lastRow = FloorDiv(maxY, TRIANGLE_SUBPIXEL_ONE);
+    setup->y = firstRow > 0 ? (int)firstRow : 0;
+    setup->maxY = lastRow < height - 1 ? (int)lastRow : height - 1;
+    setup->width = width;
+    if (setup->y > setup->maxY || width <= 0) return false;
+
+    for (int i = 0; i < 3; ++i) {
+        const int j = i < 2 ? i + 1 : 0;
+        const int64_t dx = vx[j] - vx[i];
+        const int64_t dy = vy[j] - vy[i];
+        TriangleEdge* edge = &setup->edges[i];
+        // E(p) = dx * (p.y - y) - dy * (p.x - x), with y pointing down edges going up are on the left side; pixels
+        // exactly on top and left edges are inside, others need E >= 1
+        const int64_t bias = (dy < 0 || (dy == 0 && dx > 0)) ? 0 : 1;
+        edge->stepX = -dy * TRIANGLE_SUBPIXEL_ONE;
+        edge->stepY = dx * TRIANGLE_SUBPIXEL_ONE;
+        edge->divisor = edge->stepX != 0 ? (edge->stepX > 0 ? edge->stepX : -edge->stepX) : 1;
+        const int64_t c = dy * vx[i] - dx * vy[i] + edge->stepY * setup->y - bias;
+        edge->quotient = FloorDiv(c, edge->divisor);
+        edge->remainder = c - edge->quotient * edge->divisor;
+        edge->rowQuotient = FloorDiv(edge->stepY, edge->divisor);
+        edge->rowRemainder = edge->stepY - edge->rowQuotient * edge->divisor;
+    }
+    return true;
+}
+
+int TriangleSetupNextSpans(TriangleSetup* setup, TriangleSpan* spans, int maxSpans) {
+    int count = 0;
+    while (count < maxSpans && setup->y <= setup->maxY) {
+        // E + stepX * x >= 0 gives x >= -quotient for left edges and x <= quotient for right ones
+        int64_t left = 0;
+        int64_t right = setup->width - 1;
+        for (int i = 0; i < 3; ++i) {
+            TriangleEdge* edge = &setup->edges[i];
+            if (edge->stepX > 0) {
+                if (-edge->quotient > left) left = -edge->quotient;
+            }
+            else if (edge->stepX < 0) {
+                if (edge->quotient < right) right = edge->quotient;
+            }
+            else if (edge->quotient < 0) {
+                right = -1;
+            }
+            edge->quotient += edge->rowQuotient;
+            edge->remainder += edge->rowRemainder;
+            if (edge->remainder >= edge->divisor) {
+                edge->remainder -= edge->divisor;
+                ++edge->quotient;
+            }
+        }
+        const int row = setup->y++;
+        if (left <= right) {
+            spans[count++] = (TriangleSpan){ row, (int)left, (int)right + 1 };
+        }
+    }
+    return count;
+}
@@ -1,15 +1,19 @@
-#if defined(__SSE4_1__)
-#include <smmintrin.h>
-#elif defined(__SSE2__)
+#ifdef __SSE2__
 #include <emmintrin.h>
-#endif
+#endif  // __SSE2__
 #include <string.h>
 
 #include "Allocator.h"
 #include "Color.h"
+#include "Cpu.h"
 #include "Error.h"
 #include "FillRect.h"
+#include "internal/Blit.h"
+#include "internal/Convert.h"
+#include "internal/Damage.h"
 #include "internal/Inlines.h"
+#include "internal/Profile.h"
+#include "internal/RowKernels.h"
 #include "PixelFormat.h"
 #include "Surface.h"
 
@@ -32,7 +36,7 @@ Surface SurfaceCreate(int width, int height, const PixelFormat* format) {
         flags |= SURFACE_FLAG_HAS_ALPHA;
     }
 
-    return (Surface){ width, height, pixels, stride, flags, format };
+    return (Surface){ width, height, pixels, stride, flags, format, NULL };
 }
 
 Surface SurfaceCreateFromBuffer(int width, int height, const PixelFormat* format, void* buffer) {
@@ -57,7 +61,7 @@ Surface SurfaceCreateFromBuffer(int width, int height, const PixelFormat* format
         }
     }
 
-    return (Surface){ width, height, buffer, stride, flags, format };
+    return (Surface){ width, height, buffer, stride, flags, format, NULL };
 }
 
 Surface SurfaceGetSubsurface(Surface surface, Rect rect) {
@@ -74,17 +78,19 @@ Surface SurfaceGetSubsurface(Surface surface, Rect rect) {
     uint8_t* pixels = surface.pixels + y * surface.stride + x * surface.format->bytesPerPixel;
     const SurfaceFlags flags = surface.flags | SURFACE_FLAG_PREALLOCATED;
 
-    return (Surface){ w, h, pixels, surface.stride, flags, surface.format };
+    return (Surface){ w, h, pixels, surface.stride, flags, surface.format, NULL };
 }
 
 Surface SurfaceGetSubsurfaceUnchecked(Surface surface, Rect rect) {
     uint8_t* pixels = surface.pixels + rect.y * surface.stride + rect.x * surface.format->bytesPerPixel;
     const SurfaceFlags flags = surface.flags | SURFACE_FLAG_PREALLOCATED;
-    return (Surface){ rect.width, rect.height, pixels, surface.stride, flags, surface.format };
+    return (Surface){ rect.width, rect.height, pixels, surface.stride, flags, surface.format, NULL };
 }
 
 void SurfaceDestroy(Surface* surface) {
-    if (surface == NULL || (surface->flags & SURFACE_FLAG_PREALLOCATED)) return;
+    if (surface == NULL) return;
+    SurfaceUncompileRle(surface);
+    if (surface->flags & SURFACE_FLAG_PREALLOCATED) return;
     AllocatorFree(surface->pixels);
     *surface = (Surface){ 0 };
 }
@@ -108,8 +114,12 @@ Surface SurfaceConvert(Surface surface, const PixelFormat* format) {
         return (Surface){ 0 };
     }
 
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)surface.width * surface.height);
+
     if (surface.format == format) {
         Surface copy = SurfaceCopy(surface);
+        PROFILE_END(PROFILE_ZONE_SURFACE_CONVERT);
         return copy;
     }
 
@@ -127,18 +137,21 @@ Surface SurfaceConvert(Surface surface, const PixelFormat* format) {
         converted.flags |= SURFACE_FLAG_HAS_ALPHA;
     }
 
+    PROFILE_END(PROFILE_ZONE_SURFACE_CONVERT);
     return converted;
 }
 
 void SurfaceFill(Surface surface, Color color) {
     const Rect rect = { 0, 0, surface.width, surface.height };
     if (color.a == 0) return;
+    PROFILE_BEGIN();
     if (color.a == 255) {
         FillRect(surface, &rect, ColorToPixel(surface.format, color));
     }
     else {
         BlendFillRect(surface, &rect, color);
     }
+    PROFILE_END(PROFILE_ZONE_SURFACE_FILL);
 }
 
 static void BlitSameFormat(Surface dest, Surface src, int x, int y, Rect clipped) {
@@ -186,36 +199,23 @@ static inline __m128i PackRGBA_SSE2(__m128i r, __m128i g, __m128i b, __m128i a,
     );
 }
 
-// On SSE4.2 operation _mm_mullo_epi32 is present, but on SSE2 it has to be emulated
-#ifndef __SSE4_1__
-static inline __m128i _mm_mullo_epi32(__m128i a, __m128i b) {
-    const __m128i a_lo = _mm_and_si128(a, _mm_set1_epi32(0xFFFF));
-    const __m128i b_lo = _mm_and_si128(b, _mm_set1_epi32(0xFFFF));
-
-    const __m128i a_hi = _mm_srli_epi32(a, 16);
-    const __m128i b_hi = _mm_srli_epi32(b, 16);
-
-    const __m128i lo = _mm_mullo_epi16(a_lo, b_lo);
-    __m128i hi = _mm_mullo_epi16(a_hi, b_lo);
-    __m128i mid = _mm_mullo_epi16(a_lo, b_hi);
-
-    hi = _mm_slli_epi32(hi, 16);
-    mid = _mm_slli_epi32(mid, 16);
-
-    return _mm_add_epi32(lo, _mm_add_epi32(hi, mid));
+// Exact x / 255 for x in [0, 255 * 255], so results are the same as in BlendColors
+static inline __m128i Div255_SSE2(__m128i x) {
+    return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), _mm_srli_epi32(x, 8)), 8);
 }
-#endif  // __SSE4_1__
 
+// Channels and alpha are both at most 255, so product fits in low 16 bits of every 32-bit lane
+// and _mm_mullo_epi16 can be used instead of _mm_mullo_epi32, which is not available on SSE2
 static inline __m128i BlendChannel_SSE2(__m128i s, __m128i d, __m128i a) {
     const __m128i inv255 = _mm_set1_epi32(255);
     const __m128i ia = _mm_sub_epi32(inv255, a);
 
-    const __m128i sm = _mm_mullo_epi32(s, a);
-    const __m128i dm = _mm_mullo_epi32(d, ia);
+    const __m128i sm = _mm_mullo_epi16(s, a);
+    const __m128i dm = _mm_mullo_epi16(d, ia);
 
     const __m128i sum = _mm_add_epi32(sm, dm);
 
-    return _mm_srli_epi32(sum, 8);
+    return Div255_SSE2(sum);
 }
 
 static inline void BlendRGBA_SSE2(
@@ -230,8 +230,8 @@ static inline void BlendRGBA_SSE2(
     const __m128i inv255 = _mm_set1_epi32(255);
     const __m128i ia = _mm_sub_epi32(inv255, sa);
 
-    const __m128i da_m = _mm_mullo_epi32(da, ia);
-    *oa = _mm_add_epi32(sa, _mm_srli_epi32(da_m, 8));
+    const __m128i da_m = _mm_mullo_epi16(da, ia);
+    *oa = _mm_add_epi32(sa, Div255_SSE2(da_m));
 }
 
 static void BlitSameFormatA_SSE2(Surface dest, Surface src, int x, int y, Rect clipped) {
@@ -283,7 +283,7 @@ static void BlitSameFormatA_SSE2(Surface dest, Surface src, int x, int y, Rect c
     }
 }
 
-#else
+#endif // __SSE2__
 
 // for now, LGL blitting supports ONLY 4-byte colors with alpha channel
 static void BlitSameFormatA(Surface dest, Surface src, int x, int y, Rect clipped) {
@@ -321,7 +321,67 @@ static void BlitSameFormatA(Surface dest, Surface src, int x, int y, Rect clippe
     }
 }
 
-#endif // __SSE2__
+// Same as BlitSameFormatA, but for byte-aligned formats blended with runtime selected SSE4.1 or AVX2 kernel
+static void BlitSameFormatA_Kernels(Surface dest, Surface src, int x, int y, Rect clipped, const RowKernels* kernels) {
+    const int alphaShift = dest.format->aShift;
+
+    uint8_t* dstRow = (uint8_t*)dest.pixels + clipped.y * dest.stride + (clipped.x << 2);
+    const uint8_t* srcRow = (uint8_t*)src.pixels + (clipped.y - y) * src.stride + ((clipped.x - x) << 2);
+
+    for (int iy = 0; iy < clipped.height; ++iy) {
+        kernels->blendRow((uint32_t*)dstRow, (const uint32_t*)srcRow, clipped.width, alphaShift);
+        dstRow += dest.stride;
+        srcRow += src.stride;
+    }
+}
+
+// Premultiplied formats blend with s + d * (255 - a) / 255, which needs no per-channel multiplication of source
+static void BlitSameFormatPremultipliedA(Surface dest, Surface src, int x, int y, Rect clipped,
+                                         const RowKernels* kernels) {
+    const int alphaShift = dest.format->aShift;
+
+    uint8_t* dstRow = (uint8_t*)dest.pixels + clipped.y * dest.stride + (clipped.x << 2);
+    const uint8_t* srcRow = (uint8_t*)src.pixels + (clipped.y - y) * src.stride + ((clipped.x - x) << 2);
+
+    for (int iy = 0; iy < clipped.height; ++iy) {
+        uint32_t* d = (uint32_t*)dstRow;
+        const uint32_t* s = (const uint32_t*)srcRow;
+        if (kernels != NULL) {
+            kernels->blendPremulRow(d, s, clipped.width, alphaShift);
+        }
+        else {
+            for (int ix = 0; ix < clipped.width; ++ix) {
+                d[ix] = BlendPremultipliedPixel(s[ix], d[ix], alphaShift);
+            }
+        }
+        dstRow += dest.stride;
+        srcRow += src.stride;
+    }
+}
+
+// Byte shuffle between two byte-aligned 32-bit formats blended with runtime selected kernel
+static void BlitDifferentFormatA_Kernels(Surface dest, Surface src, int x, int y, Rect clipped,
+                                         const RowKernels* kernels, const RowShuffle* shuffle) {
+    const int alphaShift = dest.format->aShift;
+
+    uint8_t* dstRow = (uint8_t*)dest.pixels + clipped.y * dest.stride + (clipped.x << 2);
+    const uint8_t* srcRow = (uint8_t*)src.pixels + (clipped.y - y) * src.stride + ((clipped.x - x) << 2);
+
+    for (int iy = 0; iy < clipped.height; ++iy) {
+        kernels->shuffleBlendRow((uint32_t*)dstRow, (const uint32_t*)srcRow, clipped.width, shuffle, alphaShift);
+        dstRow += dest.stride;
+        srcRow += src.stride;
+    }
+}
+
+// Returns kernels only when both formats can be handled by them
+static const RowKernels* GetBlitKernels(const PixelFormat* destFormat, const PixelFormat* srcFormat,
+                                        ByteLayout* destLayout, ByteLayout* srcLayout) {
+    const RowKernels* kernels = GetRowKernels();
+    if (kernels == NULL) return NULL;
+    if (!GetByteLayout(destFormat, destLayout) || !GetByteLayout(srcFormat, srcLayout)) return NULL;
+    return kernels;
+}
 
 #define LOAD_PIXEL(ptr, bpp)         \
     ((bpp) == 1 ? *(uint8_t*)(ptr) : \
@@ -338,39 +398,33 @@ static void BlitSameFormatA(Surface dest, Surface src, int x, int y, Rect clippe
         }                                                         \
     } while (0)
 
+// Conversion kernel for the format pair is chosen once, then every row is converted with it
 static void BlitDifferentFormat(Surface dest, Surface src, int x, int y, Rect clipped) {
+    PixelConverter converter;
+    PixelConverterInit(&converter, dest.format, src.format);
+
     const int srcBpp  = src.format->bytesPerPixel;
     const int destBpp = dest.format->bytesPerPixel;
 
-    const int w = clipped.width;
-    const int h = clipped.height;
-
     const uint8_t* srcRow = (uint8_t*)src.pixels + (clipped.y - y) * src.stride + (clipped.x - x) * srcBpp;
-
     uint8_t* destRow = (uint8_t*)dest.pixels + clipped.y * dest.stride + clipped.x * destBpp;
 
-    for (int iy = 0; iy < h; ++iy) {
-        const uint8_t* srcPixel  = srcRow;
-        uint8_t* destPixel = destRow;
-
-        for (int ix = 0; ix < w; ++ix) {
-            const uint32_t srcValue = LOAD_PIXEL(srcPixel, srcBpp);
-
-            const Color c = PixelToColor(src.format, srcValue);
-            const uint32_t dstValue = ColorToPixel(dest.format, c);
-
-            STORE_PIXEL(destPixel, destBpp, dstValue);
-
-            srcPixel += srcBpp;
-            destPixel += destBpp;
-        }
-
+    for (int iy = 0; iy < clipped.height; ++iy) {
+        converter.convertRow(destRow, srcRow, clipped.width, &converter);
         srcRow += src.stride;
         destRow += dest.stride;
     }
 }
 
 static void BlitDifferentFormatA(Surface dest, Surface src, int x, int y, Rect clipped) {
+    ByteLayout destLayout, srcLayout;
+    const RowKernels* kernels = GetBlitKernels(dest.format, src.format, &destLayout, &srcLayout);
+    if (kernels != NULL && destLayout.a >= 0 && !dest.format->premultiplied && !src.format->premultiplied) {
+        const RowShuffle shuffle = MakeRowShuffle(srcLayout, destLayout);
+        BlitDifferentFormatA_Kernels(dest, src, x, y, clipped, kernels, &shuffle);
+        return;
+    }
+
     const int w = clipped.width;
     const int h = clipped.height;
 
@@ -389,12 +443,11 @@ static void BlitDifferentFormatA(Surface dest, Surface src, int x, int y, Rect c
             const Color srcColor = PixelToColor(src.format, srcValue);
 
             const uint8_t a = srcColor.a;
-            if (a == 0) continue;
             if (a == 255) {
                 const uint32_t out = ColorToPixel(dest.format, srcColor);
                 STORE_PIXEL(dstPixel, destBpp, out);
             }
-            else {
+            else if (a != 0) {
                 const uint32_t dstValue = LOAD_PIXEL(dstPixel, destBpp);
                 Color dstColor = PixelToColor(dest.format, dstValue);
 
@@ -477,27 +530,95 @@ static void BlitDifferentFormatCKey(Surface dest, Surface src, int x, int y, Rec
     }
 }
 
-void SurfaceBlit(Surface dest, Surface src, int x, int y) {
-    const Rect destRect = { 0, 0, dest.width, dest.height };
-    const Rect srcRect = { x, y, src.width, src.height };
-    Rect clipped;
-    if (!RectIntersection(&srcRect, &destRect, &clipped)) return;
+static void BlitSameFormatADispatch(Surface dest, Surface src, int x, int y, Rect clipped) {
+    ByteLayout layout;
+    const bool byteAligned = GetByteLayout(dest.format, &layout) && layout.a >= 0;
+    const RowKernels* kernels = byteAligned ? GetRowKernels() : NULL;
+    if (byteAligned && dest.format->premultiplied) {
+        BlitSameFormatPremultipliedA(dest, src, x, y, clipped, kernels);
+        return;
+    }
+    if (kernels != NULL) {
+        BlitSameFormatA_Kernels(dest, src, x, y, clipped, kernels);
+        return;
+    }
+#ifdef __SSE2__
+    if (CpuGetSimdLevel() >= SIMD_LEVEL_SSE2 && !dest.format->premultiplied) {
+        BlitSameFormatA_SSE2(dest, src, x, y, clipped);
+        return;
+    }
+#endif  // __SSE2__
+    BlitSameFormatA(dest, src, x, y, clipped);
+}
+
+// Run of non-transparent pixels in one row of compiled surface, pixels between runs are skipped
+typedef struct RleRun {
+    int x;
+    int length;
+    bool blend;  // translucent pixels, otherwise opaque ones which are copied
+} RleRun;
+
+typedef struct RleData {
+    SurfaceFlags mode;  // SURFACE_FLAG_HAS_COLOR_KEY or SURFACE_FLAG_HAS_ALPHA, depending on what was compiled
+    int* rows;          // height + 1 indices of the first run in every row
+    RleRun* runs;
+} RleData;
+
+static void BlitRle(Surface dest, Surface src, int x, int y, Rect clipped) {
+    const RleData* rle = src.rle;
+    const bool formatsEqual = (src.format == dest.format);
+    const int srcBpp = src.format->bytesPerPixel;
+    const int destBpp = dest.format->bytesPerPixel;
+    const int clipStart = clipped.x - x;
+    const int clipEnd = clipStart + clipped.width;
+
+    PixelConverter converter;
+    if (!formatsEqual) {
+        PixelConverterInit(&converter, dest.format, src.format);
+    }
+
+    for (int iy = clipped.y; iy < clipped.y + clipped.height; ++iy) {
+        const int row = iy - y;
+        const uint8_t* srcRow = (uint8_t*)src.pixels + row * src.stride;
+        uint8_t* destRow = (uint8_t*)dest.pixels + iy * dest.stride + x * destBpp;
 
+        for (int i = rle->rows[row]; i < rle->rows[row + 1]; ++i) {
+            const RleRun run = rle->runs[i];
+            // runs are sorted, so nothing visible is left in this row
+            if (run.x >= clipEnd) break;
+
+            const int start = (run.x > clipStart) ? run.x : clipStart;
+            const int end = (run.x + run.length < clipEnd) ? run.x + run.length : clipEnd;
+            if (start >= end) continue;
+
+            if (run.blend) {
+                const Rect runRect = { x + start, iy, end - start, 1 };
+                if (formatsEqual) BlitSameFormatADispatch(dest, src, x, y, runRect);
+                else BlitDifferentFormatA(dest, src, x, y, runRect);
+            }
+            else if (formatsEqual) {
+                memcpy(destRow + start * destBpp, srcRow + start * srcBpp, (end - start) * srcBpp);
+            }
+            else {
+                converter.convertRow(destRow + start * destBpp, srcRow + start * srcBpp, end - start, &converter);
+            }
+        }
+    }
+}
+
+void BlitClipped(Surface dest, Surface src, int x, int y, Rect clipped) {
     const bool formatsEqual = (src.format == dest.format);
 
-    if (src.flags & SURFACE_FLAG_HAS_COLOR_KEY) {
+    if (src.rle != NULL && (src.flags & ((const RleData*)src.rle)->mode)) {
+        BlitRle(dest, src, x, y, clipped);
+    }
+    else if (src.flags & SURFACE_FLAG_HAS_COLOR_KEY) {
         if (formatsEqual) BlitSameFormatCKey(dest, src, x, y, clipped);
         else BlitDifferentFormatCKey(dest, src, x, y, clipped);
     }
     else if (src.flags & SURFACE_FLAG_HAS_ALPHA) {
-        if (formatsEqual)
-#ifdef __SSE2__
-            BlitSameFormatA_SSE2(dest, src, x, y, clipped);
-#else
-            BlitSameFormatA(dest, src, x, y, clipped);
-#endif
-        else
-            BlitDifferentFormatA(dest, src, x, y, clipped);
+        if (formatsEqual) BlitSameFormatADispatch(dest, src, x, y, clipped);
+        else BlitDifferentFormatA(dest, src, x, y, clipped);
     }
     else {
         if (formatsEqual) BlitSameFormat(dest, src, x, y, clipped);
@@ -505,7 +626,20 @@ void SurfaceBlit(Surface dest, Surface src, int x, int y) {
     }
 }
 
+void SurfaceBlit(Surface dest, Surface src, int x, int y) {
+    const Rect destRect = { 0, 0, dest.width, dest.height };
+    const Rect srcRect = { x, y, src.width, src.height };
+    Rect clipped;
+    if (!RectIntersection(&srcRect, &destRect, &clipped)) return;
+    DamageAdd(dest, clipped);
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)clipped.width * clipped.height);
+    BlitClipped(dest, src, x, y, clipped);
+    PROFILE_END(PROFILE_ZONE_SURFACE_BLIT);
+}
+
 void SurfaceSetColorKey(Surface* surface, Color color) {
+    SurfaceUncompileRle(surface);
     surface->flags &= 0x000000FF;  // clear color key components, but leave flags
     surface->flags |= SURFACE_FLAG_HAS_COLOR_KEY;
 
@@ -576,6 +710,80 @@ Color SurfaceGetColorKey(Surface surface) {
 }
 
 void SurfaceUnsetColorKey(Surface* surface) {
+    SurfaceUncompileRle(surface);
     surface->flags &= 0x000000FF;
     surface->flags &= ~SURFACE_FLAG_HAS_COLOR_KEY;
 }
+
+// 0 - transparent, 1 - opaque, 2 - translucent
+static int ClassifyPixel(const Surface* surface, uint32_t pixel, SurfaceFlags mode, uint32_t key) {
+    if (mode == SURFACE_FLAG_HAS_COLOR_KEY) return (pixel == key) ? 0 : 1;
+    const uint8_t a = PixelToColor(surface->format, pixel).a;
+    return (a == 0) ? 0 : (a == 255) ? 1 : 2;
+}
+
+// Returns number of runs in the surface, also stores them when rle is given
+static int ScanRuns(const Surface* surface, SurfaceFlags mode, RleData* rle) {
+    const int bpp = surface->format->bytesPerPixel;
+    const uint32_t key = ColorToPixel(surface->format, SurfaceGetColorKey(*surface));
+    int count = 0;
+
+    for (int y = 0; y < surface->height; ++y) {
+        const uint8_t* row = (uint8_t*)surface->pixels + y * surface->stride;
+        if (rle != NULL) rle->rows[y] = count;
+
+        int x = 0;
+        while (x < surface->width) {
+            const int type = ClassifyPixel(surface, LOAD_PIXEL(row + x * bpp, bpp), mode, key);
+            int end = x + 1;
+            while (end < surface->width &&
+                   ClassifyPixel(surface, LOAD_PIXEL(row + end * bpp, bpp), mode, key) == type) {
+                ++end;
+            }
+            if (type != 0) {
+                if (rle != NULL) rle->runs[count] = (RleRun){ x, end - x, type == 2 };
+                ++count;
+            }
+            x = end;
+        }
+    }
+    if (rle != NULL) rle->rows[surface->height] = count;
+
+    return count;
+}
+
+bool SurfaceCompileRle(Surface* surface) {
+    if (surface == NULL || surface->pixels == NULL || surface->format == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return false;
+    }
+
+    SurfaceFlags mode;
+    if (surface->flags & SURFACE_FLAG_HAS_COLOR_KEY) mode = SURFACE_FLAG_HAS_COLOR_KEY;
+    else if (surface->flags & SURFACE_FLAG_HAS_ALPHA) mode = SURFACE_FLAG_HAS_ALPHA;
+    else return false;  // without transparency plain blit is already optimal
+
+    SurfaceUncompileRle(surface);
+
+    // first pass only counts runs, so everything fits in one allocation
+    const int numRuns = ScanRuns(surface, mode, NULL);
+    const size_t rowsSize = (surface->height + 1) * sizeof(int);
+    RleData* rle = AllocatorAlloc(sizeof(RleData) + rowsSize + numRuns * sizeof(RleRun));
+    if (rle == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return false;
+    }
+    rle->mode = mode;
+    rle->rows = (int*)(rle + 1);
+    rle->runs = (RleRun*)((uint8_t*)rle->rows + rowsSize);
+    ScanRuns(surface, mode, rle);
+
+    surface->rle = rle;
+    return true;
+}
+
+void SurfaceUncompileRle(Surface* surface) {
+    if (surface == NULL || surface->rle == NULL) return;
+    AllocatorFree(surface->rle);
+    surface->rle = NULL;
+}
@@ -0,0 +1,203 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "Allocator.h"
+#include "Error.h"
+#include "internal/ThreadPool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#define LGL_THREADS
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE CondVar;
+#define MutexInit(m) InitializeCriticalSection(m)
+#define MutexDestroy(m) DeleteCriticalSection(m)
+#define MutexLock(m) EnterCriticalSection(m)
+#define MutexUnlock(m) LeaveCriticalSection(m)
+#define CondVarInit(c) InitializeConditionVariable(c)
+#define CondVarDestroy(c) ((void)(c))
+#define CondVarWait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define CondVarBroadcast(c) WakeAllConditionVariable(c)
+#define CondVarSignal(c) WakeConditionVariable(c)
+#elif defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define LGL_THREADS
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t CondVar;
+#define MutexInit(m) pthread_mutex_init(m, NULL)
+#define MutexDestroy(m) pthread_mutex_destroy(m)
+#define MutexLock(m) pthread_mutex_lock(m)
+#define MutexUnlock(m) pthread_mutex_unlock(m)
+#define CondVarInit(c) pthread_cond_init(c, NULL)
+#define CondVarDestroy(c) pthread_cond_destroy(c)
+#define CondVarWait(c, m) pthread_cond_wait(c, m)
+#define CondVarBroadcast(c) pthread_cond_broadcast(c)
+#define CondVarSignal(c) pthread_cond_signal(c)
+#endif
+
+struct ThreadPool {
+    int threadCount;
+    ThreadPoolTask task;
+    void* context;
+    int count;
+    int next;
+    int finished;
+#ifdef LGL_THREADS
+    Thread* threads;
+    Mutex mutex;
+    CondVar wake;
+    CondVar done;
+    unsigned generation;  // increased by every ThreadPoolRun, so workers know there is new work
+    bool quit;
+#endif  // LGL_THREADS
+};
+
+#ifdef LGL_THREADS
+// Called with mutex locked, returns with it locked
+static void RunTasks(ThreadPool* pool) {
+    while (pool->next < pool->count) {
+        const int index = pool->next++;
+        MutexUnlock(&pool->mutex);
+        pool->task(pool->context, index);
+        MutexLock(&pool->mutex);
+        if (++pool->finished == pool->count) {
+            CondVarSignal(&pool->done);
+        }
+    }
+}
+
+static void WorkerLoop(ThreadPool* pool) {
+    MutexLock(&pool->mutex);
+    unsigned seen = pool->generation;
+    for (;;) {
+        while (!pool->quit && pool->generation == seen) {
+            CondVarWait(&pool->wake, &pool->mutex);
+        }
+        if (pool->quit) break;
+        seen = pool->generation;
+        RunTasks(pool);
+    }
+    MutexUnlock(&pool->mutex);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI WorkerMain(LPVOID arg) {
+    WorkerLoop(arg);
+    return 0;
+}
+
+static bool StartThread(Thread* thread, ThreadPool* pool) {
+    *thread = CreateThread(NULL, 0, WorkerMain, pool, 0, NULL);
+    return *thread != NULL;
+}
+
+static void JoinThread(Thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+static void* WorkerMain(void* arg) {
+    WorkerLoop(arg);
+    return NULL;
+}
+
+static bool StartThread(Thread* thread, ThreadPool* pool) {
+    return pthread_create(thread, NULL, WorkerMain, pool) == 0;
+}
+
+static void JoinThread(Thread thread) {
+    pthread_join(thread, NULL);
+}
+#endif
+#endif  // LGL_THREADS
+
+ThreadPool* ThreadPoolCreate(int threadCount) {
+    if (threadCount < 1) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return NULL;
+    }
+
+    ThreadPool* pool = AllocatorAlloc(sizeof(ThreadPool));
+    if (pool == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    *pool = (ThreadPool){ .threadCount = 1 };
+
+#ifdef LGL_THREADS
+    const int workers = threadCount - 1;
+    if (workers == 0) return pool;
+
+    pool->threads = AllocatorAlloc(workers * sizeof(Thread));
+    if (pool->threads == NULL) {
+        // one thread is still a working pool
+        return pool;
+    }
+    MutexInit(&pool->mutex);
+    CondVarInit(&pool->wake);
+    CondVarInit(&pool->done);
+    for (int i = 0; i < workers; ++i) {
+        if (!StartThread(&pool->threads[i], pool)) break;
+        ++pool->threadCount;
+    }
+#endif  // LGL_THREADS
+
+    return pool;
+}
+
+void ThreadPoolDestroy(ThreadPool* pool) {
+    if (pool == NULL) return;
+
+#ifdef LGL_THREADS
+    if (pool->threads != NULL) {
+        MutexLock(&pool->mutex);
+        pool->quit = true;
+        CondVarBroadcast(&pool->wake);
+        MutexUnlock(&pool->mutex);
+
+        for (int i = 0; i < pool->threadCount - 1; ++i) {
+            JoinThread(pool->threads[i]);
+        }
+        CondVarDestroy(&pool->wake);
+        CondVarDestroy(&pool->done);
+        MutexDestroy(&pool->mutex);
+        AllocatorFree(pool->threads);
+    }
+#endif  // LGL_THREADS
+
+    AllocatorFree(pool);
+}
+
+int ThreadPoolGetThreadCount(const ThreadPool* pool) {
+    return pool != NULL ? pool->threadCount : 1;
+}
+
+void ThreadPoolRun(ThreadPool* pool, int count, ThreadPoolTask task, void* context) {
+    if (count <= 0) return;
+
+    if (pool->threadCount == 1 || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            task(context, i);
+        }
+        return;
+    }
+
+#ifdef LGL_THREADS
+    MutexLock(&pool->mutex);
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    pool->next = 0;
+    pool->finished = 0;
+    ++pool->generation;
+    CondVarBroadcast(&pool->wake);
+
+    RunTasks(pool);
+    while (pool->finished < pool->count) {
+        CondVarWait(&pool->done, &pool->mutex);
+    }
+    MutexUnlock(&pool->mutex);
+#endif  // LGL_THREADS
+}
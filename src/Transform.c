@@ -1,10 +1,27 @@
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif  // __SSE2__
 #include <math.h>
 #include <string.h>
 
 #include "Allocator.h"
+#include "Cpu.h"
+#include "Error.h"
+#include "internal/Blit.h"
+#include "internal/Convert.h"
+#include "internal/Damage.h"
 #include "internal/FixedPoint.h"
+#include "internal/Inlines.h"
+#include "internal/Profile.h"
+#include "internal/RowKernels.h"
 #include "Transform.h"
 
+// Filtered scaling weights are fractions of this, small enough for 16-bit multiplies of _mm_madd_epi16
+#define SCALE_WEIGHT_BITS 14
+#define SCALE_WEIGHT_ONE (1 << SCALE_WEIGHT_BITS)
+// Horizontally filtered rows keep channels with this many fraction bits, so they also fit int16
+#define SCALE_ROW_BITS 7
+
 #define MAKE_FLIP_X_FUNCTION(TYPE, BYTES)                                     \
 static void FlipX##BYTES(Surface surface) {                                   \
     const int last = surface.width - 1;                                       \
@@ -24,15 +41,22 @@ MAKE_FLIP_X_FUNCTION(uint16_t, 2)
 MAKE_FLIP_X_FUNCTION(uint32_t, 4)
 
 void TransformFlipX(Surface surface) {
+    DamageAdd(surface, (Rect){ 0, 0, surface.width, surface.height });
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)surface.width * surface.height);
     switch (surface.format->bytesPerPixel) {
         case 1: FlipX1(surface); break;
         case 2: FlipX2(surface); break;
         case 4: FlipX4(surface); break;
         default: break;
     }
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
 }
 
 void TransformFlipY(Surface surface) {
+    DamageAdd(surface, (Rect){ 0, 0, surface.width, surface.height });
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)surface.width * surface.height);
     const int stride = surface.stride;
     const int lastRow = surface.height - 1;
 
@@ -50,6 +74,7 @@ void TransformFlipY(Surface surface) {
     }
 
     AllocatorFree(temp);
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
 }
 
 static const fixed_t sinLUT[360] = {
@@ -91,7 +116,68 @@ static inline fixed_t CosDeg(int angle) {
     return sinLUT[angle];
 }
 
-Surface TransformRotate(Surface src, int angle) {
+// Transformed pixels go straight to the destination when SurfaceBlit would only copy them. Otherwise runs of them
+// are gathered in buffer and passed to the same blit paths, so blitting transforms doesn't need a temporary surface.
+// Buffer holds runs of several rows, for transforms producing them together
+#define TRANSFORM_RUN_PIXELS 128
+#define TRANSFORM_RUN_ROWS 3
+
+typedef struct TransformTarget {
+    Surface dest;
+    Surface src;    // format, flags and color key of transformed pixels
+    bool direct;
+    uint32_t buffer[TRANSFORM_RUN_ROWS][TRANSFORM_RUN_PIXELS];
+} TransformTarget;
+
+// With copy, pixels are written as they are even when source has alpha or color key, like into a new surface
+static void TargetInit(TransformTarget* target, Surface dest, Surface src, bool copy) {
+    target->dest = dest;
+    target->src = src;
+    target->direct = copy || (src.format == dest.format &&
+                              !(src.flags & (SURFACE_FLAG_HAS_ALPHA | SURFACE_FLAG_HAS_COLOR_KEY)));
+}
+
+// How many of remaining pixels fit into one run
+static inline int TargetRunLength(const TransformTarget* target, int remaining) {
+    return (target->direct || remaining <= TRANSFORM_RUN_PIXELS) ? remaining : TRANSFORM_RUN_PIXELS;
+}
+
+// Where pixels of run starting at x, y of destination are written, row picks one of buffered runs
+static inline void* TargetBegin(TransformTarget* target, int row, int x, int y) {
+    if (!target->direct) return target->buffer[row];
+    return (uint8_t*)target->dest.pixels + y * target->dest.stride + x * target->dest.format->bytesPerPixel;
+}
+
+static inline void TargetEnd(TransformTarget* target, int row, int x, int y, int n) {
+    if (target->direct || n <= 0) return;
+    Surface run = target->src;
+    run.width = n;
+    run.height = 1;
+    run.pixels = target->buffer[row];
+    run.stride = n * run.format->bytesPerPixel;
+    run.rle = NULL;
+    BlitClipped(target->dest, run, x, y, (Rect){ x, y, n, 1 });
+}
+
+// Part of area visible in dest, false when nothing is
+static bool ClipTransformBlit(Surface dest, Surface src, Rect area, Rect* clipped) {
+    if (dest.pixels == NULL || dest.format == NULL || src.pixels == NULL || src.format == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return false;
+    }
+    const Rect destRect = { 0, 0, dest.width, dest.height };
+    return RectIntersection(&area, &destRect, clipped);
+}
+
+// Rotation is done around the center of src, the result is centered in the bounding box of rotated corners
+typedef struct Rotation {
+    fixed_t cosA;
+    fixed_t sinA;
+    int width;
+    int height;
+} Rotation;
+
+static Rotation MakeRotation(Surface src, int angle) {
     angle %= 360;
     if (angle < 0) angle += 360;
 
@@ -109,8 +195,6 @@ Surface TransformRotate(Surface src, int angle) {
     fixed_t maxX = -1 << 30;
     fixed_t maxY = -1 << 30;
 
-    const int bpp = src.format->bytesPerPixel;
-
     for (int i = 0; i < 4; ++i) {
         const int x = cornersX[i] - (cw >> 1);
         const int y = cornersY[i] - (ch >> 1);
@@ -127,145 +211,1202 @@ Surface TransformRotate(Surface src, int angle) {
         if (yf > maxY) maxY = yf;
     }
 
-    const int newW = maxX - minX;
-    const int newH = maxY - minY;
+    return (Rotation){ cosA, sinA, maxX - minX, maxY - minY };
+}
 
-    const Surface dst = SurfaceCreate(newW, newH, src.format);
+// Source position of destination pixel x, y is u + x * du + y * duRow, v + x * dv + y * dvRow, in source pixels with
+// FIXED_SHIFT fraction bits. Positions are stepped exactly, so rows can be clipped to the source before walking them
+typedef struct Rotozoom {
+    int64_t u;
+    int64_t v;
+    int64_t du;
+    int64_t dv;
+    int64_t duRow;
+    int64_t dvRow;
+} Rotozoom;
 
-    const int srcCX = cw >> 1;
-    const int srcCY = ch >> 1;
+typedef void (*RotozoomRunFunction)(void* out, Surface src, int64_t u, int64_t v, int64_t du, int64_t dv, int n);
 
-    const int dstCX = newW >> 1;
-    const int dstCY = newH >> 1;
+#define MAKE_ROTOZOOM_NEAREST_FUNCTION(TYPE, BYTES)                                                               \
+static void RotozoomNearest##BYTES(void* out, Surface src, int64_t u, int64_t v, int64_t du, int64_t dv, int n) { \
+    TYPE* dst = out;                                                                                              \
+    for (int i = 0; i < n; ++i) {                                                                                 \
+        const TYPE* row = (const TYPE*)((const uint8_t*)src.pixels + (int)(v >> FIXED_SHIFT) * src.stride);     \
+        dst[i] = row[u >> FIXED_SHIFT];                                                                           \
+        u += du;                                                                                                  \
+        v += dv;                                                                                                  \
+    }                                                                                                             \
+}
 
-    for (int y = 0; y < newH; ++y) {
-        for (int x = 0; x < newW; ++x) {
-            const int dx = x - dstCX;
-            const int dy = y - dstCY;
+MAKE_ROTOZOOM_NEAREST_FUNCTION(uint8_t, 1)
+MAKE_ROTOZOOM_NEAREST_FUNCTION(uint16_t, 2)
+MAKE_ROTOZOOM_NEAREST_FUNCTION(uint32_t, 4)
 
-            const fixed_t sxFP = FIXED_MUL(TO_FIXED(dx), cosA) + FIXED_MUL(TO_FIXED(dy), sinA) + TO_FIXED(srcCX);
-            const fixed_t syFP = -FIXED_MUL(TO_FIXED(dx), sinA) + FIXED_MUL(TO_FIXED(dy), cosA) + TO_FIXED(srcCY);
+// Source pixel centers are at .5 and weights have 8 bits. Positions are inside of src, so only the second tap on
+// each axis and the first one before the first center can fall outside and have to be clamped
+static inline void BilinearTaps(int64_t position, int last, int* first, int* second, int* weight) {
+    position -= FIXED_ONE >> 1;
+    const int index = (int)(position >> FIXED_SHIFT);
+    *weight = (int)(position >> (FIXED_SHIFT - 8)) & 0xFF;
+    *first = index < 0 ? 0 : index;
+    *second = index + 1 > last ? last : index + 1;
+}
 
-            const int sx = FIXED_INT_PART(sxFP);
-            const int sy = FIXED_INT_PART(syFP);
+// 32-bit pixels with 8-bit channels are blended without unpacking them
+static void RotozoomBilinear4(void* out, Surface src, int64_t u, int64_t v, int64_t du, int64_t dv, int n) {
+    uint32_t* dst = out;
+    for (int i = 0; i < n; ++i) {
+        int x0, x1, y0, y1, fx, fy;
+        BilinearTaps(u, src.width - 1, &x0, &x1, &fx);
+        BilinearTaps(v, src.height - 1, &y0, &y1, &fy);
+        const uint32_t* row0 = (const uint32_t*)((const uint8_t*)src.pixels + y0 * src.stride);
+        const uint32_t* row1 = (const uint32_t*)((const uint8_t*)src.pixels + y1 * src.stride);
+        const uint32_t top = LerpPixelBytes(row0[x0], row0[x1], fx);
+        const uint32_t bottom = LerpPixelBytes(row1[x0], row1[x1], fx);
+        dst[i] = LerpPixelBytes(top, bottom, fy);
+        u += du;
+        v += dv;
+    }
+}
 
-            const uint8_t* srcPixel = (uint8_t*)src.pixels + sy * src.stride + sx * bpp;
-            uint8_t* dstPixel = (uint8_t*)dst.pixels + y * dst.stride + x * bpp;
+#ifdef __SSE2__
+// Same lerps as RotozoomBilinear4, each of them one _mm_madd_epi16 of pairs of taps with pairs of weights
+static void RotozoomBilinear4_SSE2(void* out, Surface src, int64_t u, int64_t v, int64_t du, int64_t dv, int n) {
+    uint32_t* dst = out;
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < n; ++i) {
+        int x0, x1, y0, y1, fx, fy;
+        BilinearTaps(u, src.width - 1, &x0, &x1, &fx);
+        BilinearTaps(v, src.height - 1, &y0, &y1, &fy);
+        const uint32_t* row0 = (const uint32_t*)((const uint8_t*)src.pixels + y0 * src.stride);
+        const uint32_t* row1 = (const uint32_t*)((const uint8_t*)src.pixels + y1 * src.stride);
+        const __m128i weightsX = _mm_set1_epi32((fx << 16) | (256 - fx));
+        const __m128i weightsY = _mm_set1_epi32((fy << 16) | (256 - fy));
 
-            if (sx >= 0 && sx < cw && sy >= 0 && sy < ch) {
-                switch (bpp) {
-                    case 1: {
-                        *dstPixel = *srcPixel;
-                    } break;
-                    case 2: {
-                        *(uint16_t*)dstPixel = *(uint16_t*)srcPixel;
-                    } break;
-                    case 4: {
-                        *(uint32_t*)dstPixel = *(uint32_t*)srcPixel;
-                    } break;
-                    default: break;
-                }
-            }
+        // channels of both taps of a row interleaved as 16-bit pairs
+        const __m128i top = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)row0[x0]), _mm_cvtsi32_si128((int)row0[x1]));
+        const __m128i bottom = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)row1[x0]), _mm_cvtsi32_si128((int)row1[x1]));
+        const __m128i topLerp = _mm_srli_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(top, zero), weightsX), 8);
+        const __m128i bottomLerp = _mm_srli_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(bottom, zero), weightsX), 8);
+
+        const __m128i rows = _mm_packs_epi32(topLerp, bottomLerp);
+        const __m128i pairs = _mm_unpacklo_epi16(rows, _mm_srli_si128(rows, 8));
+        __m128i pixel = _mm_srli_epi32(_mm_madd_epi16(pairs, weightsY), 8);
+        pixel = _mm_packs_epi32(pixel, pixel);
+        dst[i] = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(pixel, pixel));
+        u += du;
+        v += dv;
+    }
+}
+#endif  // __SSE2__
+
+// 5-6-5 pixel with green moved to the upper half, so every channel has room for 5-bit weights
+static inline uint32_t Spread565(uint16_t pixel) {
+    return (pixel | ((uint32_t)pixel << 16)) & 0x07E0F81F;
+}
+
+static inline uint32_t LerpSpread565(uint32_t a, uint32_t b, int f) {
+    return ((a * (uint32_t)(32 - f) + b * (uint32_t)f) >> 5) & 0x07E0F81F;
+}
+
+static void RotozoomBilinear565(void* out, Surface src, int64_t u, int64_t v, int64_t du, int64_t dv, int n) {
+    uint16_t* dst = out;
+    for (int i = 0; i < n; ++i) {
+        int x0, x1, y0, y1, fx, fy;
+        BilinearTaps(u, src.width - 1, &x0, &x1, &fx);
+        BilinearTaps(v, src.height - 1, &y0, &y1, &fy);
+        const uint16_t* row0 = (const uint16_t*)((const uint8_t*)src.pixels + y0 * src.stride);
+        const uint16_t* row1 = (const uint16_t*)((const uint8_t*)src.pixels + y1 * src.stride);
+        const uint32_t top = LerpSpread565(Spread565(row0[x0]), Spread565(row0[x1]), fx >> 3);
+        const uint32_t bottom = LerpSpread565(Spread565(row1[x0]), Spread565(row1[x1]), fx >> 3);
+        const uint32_t pixel = LerpSpread565(top, bottom, fy >> 3);
+        dst[i] = (uint16_t)(pixel | (pixel >> 16));
+        u += du;
+        v += dv;
+    }
+}
+
+static inline uint32_t LoadPixel(const uint8_t* pixel, int bpp) {
+    switch (bpp) {
+        case 1: return *pixel;
+        case 2: return *(const uint16_t*)pixel;
+        case 4: return *(const uint32_t*)pixel;
+        default: return 0;
+    }
+}
+
+static inline void StorePixel(uint8_t* pixel, int bpp, uint32_t value) {
+    switch (bpp) {
+        case 1: *pixel = (uint8_t)value; break;
+        case 2: *(uint16_t*)pixel = (uint16_t)value; break;
+        case 4: *(uint32_t*)pixel = value; break;
+        default: break;
+    }
+}
+
+// Other formats are blended channel by channel
+static void RotozoomBilinearColor(void* out, Surface src, int64_t u, int64_t v, int64_t du, int64_t dv, int n) {
+    const PixelFormat* format = src.format;
+    const int bpp = format->bytesPerPixel;
+    uint8_t* dst = out;
+    for (int i = 0; i < n; ++i) {
+        int x0, x1, y0, y1, fx, fy;
+        BilinearTaps(u, src.width - 1, &x0, &x1, &fx);
+        BilinearTaps(v, src.height - 1, &y0, &y1, &fy);
+        const uint8_t* row0 = (const uint8_t*)src.pixels + y0 * src.stride;
+        const uint8_t* row1 = (const uint8_t*)src.pixels + y1 * src.stride;
+        const Color c00 = UnpackPixel(format, LoadPixel(row0 + x0 * bpp, bpp));
+        const Color c10 = UnpackPixel(format, LoadPixel(row0 + x1 * bpp, bpp));
+        const Color c01 = UnpackPixel(format, LoadPixel(row1 + x0 * bpp, bpp));
+        const Color c11 = UnpackPixel(format, LoadPixel(row1 + x1 * bpp, bpp));
+        const int w00 = (256 - fx) * (256 - fy);
+        const int w10 = fx * (256 - fy);
+        const int w01 = (256 - fx) * fy;
+        const int w11 = fx * fy;
+        const Color color = {
+            (uint8_t)((c00.r * w00 + c10.r * w10 + c01.r * w01 + c11.r * w11 + 32768) >> 16),
+            (uint8_t)((c00.g * w00 + c10.g * w10 + c01.g * w01 + c11.g * w11 + 32768) >> 16),
+            (uint8_t)((c00.b * w00 + c10.b * w10 + c01.b * w01 + c11.b * w11 + 32768) >> 16),
+            (uint8_t)((c00.a * w00 + c10.a * w10 + c01.a * w01 + c11.a * w11 + 32768) >> 16),
+        };
+        StorePixel(dst + i * bpp, bpp, PackColor(format, color));
+        u += du;
+        v += dv;
+    }
+}
+
+static RotozoomRunFunction GetRotozoomRun(Surface src, bool bilinear) {
+    ByteLayout layout;
+    const PixelFormat* format = src.format;
+    if (bilinear) {
+        if (GetByteLayout(format, &layout)) {
+#ifdef __SSE2__
+            if (CpuGetSimdLevel() >= SIMD_LEVEL_SSE2) return RotozoomBilinear4_SSE2;
+#endif  // __SSE2__
+            return RotozoomBilinear4;
+        }
+        if (format->bytesPerPixel == 2 && format->gMask == 0x07E0 && (format->rMask | format->bMask) == 0xF81F) {
+            return RotozoomBilinear565;
+        }
+        return RotozoomBilinearColor;
+    }
+    switch (src.format->bytesPerPixel) {
+        case 1: return RotozoomNearest1;
+        case 2: return RotozoomNearest2;
+        case 4: return RotozoomNearest4;
+        default: return NULL;
+    }
+}
+
+// Floor of a / b for b > 0
+static inline int64_t FloorDiv(int64_t a, int64_t b) {
+    const int64_t q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+// Narrows steps first..end (exclusive) to those where 0 <= position + i * step < limit
+static void ClipSourceSpan(int64_t position, int64_t step, int64_t limit, int* first, int* end) {
+    int64_t lo, hi;
+    if (step == 0) {
+        if (position >= 0 && position < limit) return;
+        lo = 0;
+        hi = 0;
+    }
+    else if (step > 0) {
+        lo = -FloorDiv(position, step);
+        hi = -FloorDiv(position - limit, step);
+    }
+    else {
+        lo = FloorDiv(position - limit, -step) + 1;
+        hi = FloorDiv(position, -step) + 1;
+    }
+    if (lo > *first) *first = (lo < *end) ? (int)lo : *end;
+    if (hi < *end) *end = (hi > *first) ? (int)hi : *first;
+}
+
+// Walks only the part of every row of clipped whose positions land inside of src
+static void RotozoomToTarget(TransformTarget* target, Surface src, const Rotozoom* steps, Rect clipped,
+                             RotozoomRunFunction run) {
+    const int64_t limitU = (int64_t)src.width << FIXED_SHIFT;
+    const int64_t limitV = (int64_t)src.height << FIXED_SHIFT;
+
+    for (int iy = clipped.y; iy < clipped.y + clipped.height; ++iy) {
+        int64_t u = steps->u + clipped.x * steps->du + iy * steps->duRow;
+        int64_t v = steps->v + clipped.x * steps->dv + iy * steps->dvRow;
+        int first = 0;
+        int end = clipped.width;
+        ClipSourceSpan(u, steps->du, limitU, &first, &end);
+        ClipSourceSpan(v, steps->dv, limitV, &first, &end);
+        u += first * steps->du;
+        v += first * steps->dv;
+
+        for (int i = first; i < end;) {
+            const int n = TargetRunLength(target, end - i);
+            run(TargetBegin(target, 0, clipped.x + i, iy), src, u, v, steps->du, steps->dv, n);
+            TargetEnd(target, 0, clipped.x + i, iy, n);
+            u += n * steps->du;
+            v += n * steps->dv;
+            i += n;
         }
     }
+}
+
+// Rotated box is placed at x, y of the target. Destination center maps to the source center, and source position
+// steps by (cos, -sin) along destination rows
+static Rotozoom RotationSteps(Surface src, const Rotation* rotation, int x, int y) {
+    const int64_t cosA = rotation->cosA;
+    const int64_t sinA = rotation->sinA;
+    const int64_t dstCX = x + (rotation->width >> 1);
+    const int64_t dstCY = y + (rotation->height >> 1);
+    return (Rotozoom){
+        .u = -dstCX * cosA - dstCY * sinA + ((int64_t)(src.width >> 1) << FIXED_SHIFT),
+        .v = dstCX * sinA - dstCY * cosA + ((int64_t)(src.height >> 1) << FIXED_SHIFT),
+        .du = cosA,
+        .dv = -sinA,
+        .duRow = sinA,
+        .dvRow = cosA,
+    };
+}
+
+Surface TransformRotate(Surface src, int angle) {
+    PROFILE_BEGIN();
+    const Rotation rotation = MakeRotation(src, angle);
+    const Surface dst = SurfaceCreate(rotation.width, rotation.height, src.format);
+    if (dst.pixels == NULL) {
+        PROFILE_END(PROFILE_ZONE_TRANSFORM);
+        return dst;
+    }
 
+    TransformTarget target;
+    TargetInit(&target, dst, src, true);
+    const Rotozoom steps = RotationSteps(src, &rotation, 0, 0);
+    RotozoomToTarget(&target, src, &steps, (Rect){ 0, 0, dst.width, dst.height }, GetRotozoomRun(src, false));
+
+    PROFILE_PIXELS((long long)dst.width * dst.height);
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
     return dst;
 }
 
-#define MAKE_SCALE_FUNCTION(TYPE, BYTES)                                                                          \
-static Surface Scale##BYTES(Surface src, Surface dest, int scaleX, int scaleY, int lastSrcRow, int lastSrcCol) {  \
-    for (int y = 0; y < dest.height; ++y) {                                                                       \
-        int srcY = FIXED_INT_PART(y * scaleY);                                                                    \
-        if (srcY >= src.height) srcY = lastSrcRow;                                                                \
-        const TYPE* srcRow = (TYPE*)((uint8_t*)src.pixels + srcY * src.stride);                                   \
-        TYPE* dstRow = (TYPE*)((uint8_t*)dest.pixels + y * dest.stride);                                          \
-        for (int x = 0; x < dest.width; ++x) {                                                                    \
-            int srcX = FIXED_INT_PART(x * scaleX);                                                                \
-            if (srcX >= src.width) srcX = lastSrcCol;                                                             \
-            dstRow[x] = srcRow[srcX];                                                                             \
-        }                                                                                                         \
+void TransformRotateBlit(Surface dest, Surface src, int x, int y, int angle) {
+    if (src.pixels == NULL || src.format == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    const Rotation rotation = MakeRotation(src, angle);
+    Rect clipped;
+    if (!ClipTransformBlit(dest, src, (Rect){ x, y, rotation.width, rotation.height }, &clipped)) return;
+    DamageAdd(dest, clipped);
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)clipped.width * clipped.height);
+
+    TransformTarget target;
+    TargetInit(&target, dest, src, false);
+    const Rotozoom steps = RotationSteps(src, &rotation, x, y);
+    RotozoomToTarget(&target, src, &steps, clipped, GetRotozoomRun(src, false));
+
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
+}
+
+// Draws src mapped by steps over the part of dest covered by the destination-space corners of src. Without blend,
+// pixels are only converted, ignoring alpha and color key of src
+static void AffineToDest(Surface dest, Surface src, const Rotozoom* steps, const double cornersX[4],
+                         const double cornersY[4], ScaleFilter filter, bool blend) {
+    double minX = cornersX[0], minY = cornersY[0], maxX = cornersX[0], maxY = cornersY[0];
+    for (int i = 1; i < 4; ++i) {
+        if (cornersX[i] < minX) minX = cornersX[i];
+        if (cornersX[i] > maxX) maxX = cornersX[i];
+        if (cornersY[i] < minY) minY = cornersY[i];
+        if (cornersY[i] > maxY) maxY = cornersY[i];
+    }
+    // box only limits rows and columns searched for spans, so it may be a pixel too big
+    const double bound = 1 << 30;
+    if (maxX < 0.0 || maxY < 0.0 || minX >= dest.width || minY >= dest.height) return;
+    const int left = (int)floor(minX < -bound ? -bound : minX);
+    const int top = (int)floor(minY < -bound ? -bound : minY);
+    const int right = (int)ceil(maxX > bound ? bound : maxX);
+    const int bottom = (int)ceil(maxY > bound ? bound : maxY);
+    Rect clipped;
+    if (!ClipTransformBlit(dest, src, (Rect){ left, top, right - left + 1, bottom - top + 1 }, &clipped)) return;
+
+    if (!blend) src.flags &= ~(uint32_t)(SURFACE_FLAG_HAS_ALPHA | SURFACE_FLAG_HAS_COLOR_KEY);
+    // blending key color into its neighbours would make the edges of keyed sprites visible
+    const bool bilinear = filter != SCALE_FILTER_NEAREST && !(src.flags & SURFACE_FLAG_HAS_COLOR_KEY);
+    const RotozoomRunFunction run = GetRotozoomRun(src, bilinear);
+    if (run == NULL) return;
+
+    DamageAdd(dest, clipped);
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)clipped.width * clipped.height);
+    TransformTarget target;
+    TargetInit(&target, dest, src, false);
+    RotozoomToTarget(&target, src, steps, clipped, run);
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
+}
+
+void TransformRotozoomBlit(Surface dest, Surface src, int x, int y, int32_t angle, int32_t scale, int pivotX,
+                           int pivotY, ScaleFilter filter) {
+    if (dest.pixels == NULL || src.pixels == NULL || src.format == NULL || scale <= 0) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    const double radians = (double)angle / FIXED_ONE * (3.14159265358979323846 / 180.0);
+    const double factor = (double)scale / FIXED_ONE;
+    const double c = cos(radians);
+    const double s = sin(radians);
+
+    // src corners placed around pivot, rotated clockwise and scaled
+    double cornersX[4], cornersY[4];
+    for (int i = 0; i < 4; ++i) {
+        const double cx = ((i & 1) ? src.width : 0) - pivotX;
+        const double cy = ((i & 2) ? src.height : 0) - pivotY;
+        cornersX[i] = x + factor * (c * cx - s * cy);
+        cornersY[i] = y + factor * (s * cx + c * cy);
+    }
+
+    // inverse of the rotation and scaling, per destination pixel, positions are sampled at pixel centers
+    const double unit = (double)FIXED_ONE / factor;
+    Rotozoom steps = {
+        .du = llround(c * unit),
+        .dv = llround(-s * unit),
+        .duRow = llround(s * unit),
+        .dvRow = llround(c * unit),
+    };
+    const int64_t halfX = 2 * (int64_t)x - 1;
+    const int64_t halfY = 2 * (int64_t)y - 1;
+    steps.u = ((int64_t)pivotX << FIXED_SHIFT) - (halfX * steps.du + halfY * steps.duRow) / 2;
+    steps.v = ((int64_t)pivotY << FIXED_SHIFT) - (halfX * steps.dv + halfY * steps.dvRow) / 2;
+
+    AffineToDest(dest, src, &steps, cornersX, cornersY, filter, true);
+}
+
+void SurfaceBlitTransformed(Surface dest, Surface src, const Mat2x3* matrix, ScaleFilter filter, bool blend) {
+    if (dest.pixels == NULL || src.pixels == NULL || src.format == NULL || matrix == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    const double a = (double)matrix->m[0][0] / FIXED_ONE;
+    const double b = (double)matrix->m[0][1] / FIXED_ONE;
+    const double c = (double)matrix->m[1][0] / FIXED_ONE;
+    const double d = (double)matrix->m[1][1] / FIXED_ONE;
+    const double tx = (double)matrix->m[0][2] / FIXED_ONE;
+    const double ty = (double)matrix->m[1][2] / FIXED_ONE;
+    const double det = a * d - b * c;
+    if (det == 0.0) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+
+    double cornersX[4], cornersY[4];
+    for (int i = 0; i < 4; ++i) {
+        const double cx = (i & 1) ? src.width : 0;
+        const double cy = (i & 2) ? src.height : 0;
+        cornersX[i] = a * cx + b * cy + tx;
+        cornersY[i] = c * cx + d * cy + ty;
+    }
+
+    // inverse matrix gives source position of destination pixel centers, steps larger than any source are clamped,
+    // they leave at most one pixel of a row inside of it anyway
+    const double unit = FIXED_ONE / det;
+    const double limit = (double)((int64_t)1 << 40);
+    const double inverse[4] = { d * unit, -b * unit, -c * unit, a * unit };
+    int64_t step[4];
+    for (int i = 0; i < 4; ++i) {
+        step[i] = llround(inverse[i] < -limit ? -limit : (inverse[i] > limit ? limit : inverse[i]));
+    }
+    const double originX = 0.5 - tx;
+    const double originY = 0.5 - ty;
+    const double u = (inverse[0] * originX + inverse[1] * originY);
+    const double v = (inverse[2] * originX + inverse[3] * originY);
+    const double originLimit = (double)((int64_t)1 << 60);
+    if (fabs(u) > originLimit || fabs(v) > originLimit) return;
+    const Rotozoom steps = {
+        .u = llround(u),
+        .v = llround(v),
+        .du = step[0],
+        .dv = step[2],
+        .duRow = step[1],
+        .dvRow = step[3],
+    };
+    AffineToDest(dest, src, &steps, cornersX, cornersY, filter, blend);
+}
+
+// Two pixels are loaded before they are stored, so loads don't wait for stores that might alias them
+#define MAKE_SCALE_RUN_FUNCTION(TYPE, BYTES)                                                                      \
+static void ScaleRun##BYTES(void* out, const void* srcRow, int64_t srcX, fixed_t stepX, int n) {                \
+    TYPE* dst = out;                                                                                              \
+    const TYPE* row = srcRow;                                                                                     \
+    int i = 0;                                                                                                    \
+    for (; i + 1 < n; i += 2) {                                                                                   \
+        const TYPE first = row[srcX >> FIXED_SHIFT];                                                              \
+        const TYPE second = row[(srcX + stepX) >> FIXED_SHIFT];                                                   \
+        dst[i] = first;                                                                                           \
+        dst[i + 1] = second;                                                                                      \
+        srcX += 2 * (int64_t)stepX;                                                                               \
     }                                                                                                             \
-    return dest;                                                                                                  \
+    if (i < n) dst[i] = row[srcX >> FIXED_SHIFT];                                                                 \
 }
 
-MAKE_SCALE_FUNCTION(uint8_t, 1)
-MAKE_SCALE_FUNCTION(uint16_t, 2)
-MAKE_SCALE_FUNCTION(uint32_t, 4)
+MAKE_SCALE_RUN_FUNCTION(uint8_t, 1)
+MAKE_SCALE_RUN_FUNCTION(uint16_t, 2)
+MAKE_SCALE_RUN_FUNCTION(uint32_t, 4)
 
-Surface TransformScale(Surface src, int destWidth, int destHeight) {
-    const Surface dest = SurfaceCreate(destWidth, destHeight, src.format);
+// Scaled surface of destWidth x destHeight is placed at x, y of the target. Source positions are multiples of the
+// scale, which is rounded down, so they never reach past the last source pixel
+static void ScaleToTarget(TransformTarget* target, Surface src, int x, int y, int destWidth, int destHeight,
+                          Rect clipped) {
+    void (*scaleRun)(void*, const void*, int64_t, fixed_t, int);
+    switch (src.format->bytesPerPixel) {
+        case 1: scaleRun = ScaleRun1; break;
+        case 2: scaleRun = ScaleRun2; break;
+        case 4: scaleRun = ScaleRun4; break;
+        default: return;
+    }
     const fixed_t scaleX = FIXED_DIV(src.width, destWidth);
     const fixed_t scaleY = FIXED_DIV(src.height, destHeight);
-    const int lastSrcRow = src.height - 1;
-    const int lastSrcCol = src.width - 1;
+    const int right = clipped.x + clipped.width;
+
+    for (int iy = clipped.y; iy < clipped.y + clipped.height; ++iy) {
+        const int srcY = (int)(((int64_t)(iy - y) * scaleY) >> FIXED_SHIFT);
+        const uint8_t* srcRow = (const uint8_t*)src.pixels + srcY * src.stride;
+        for (int ix = clipped.x; ix < right;) {
+            const int n = TargetRunLength(target, right - ix);
+            scaleRun(TargetBegin(target, 0, ix, iy), srcRow, (int64_t)(ix - x) * scaleX, scaleX, n);
+            TargetEnd(target, 0, ix, iy, n);
+            ix += n;
+        }
+    }
+}
+
+Surface TransformScale(Surface src, int destWidth, int destHeight) {
+    const Surface dest = SurfaceCreate(destWidth, destHeight, src.format);
+    if (dest.pixels == NULL) return dest;
+
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)destWidth * destHeight);
+    TransformTarget target;
+    TargetInit(&target, dest, src, true);
+    ScaleToTarget(&target, src, 0, 0, destWidth, destHeight, (Rect){ 0, 0, destWidth, destHeight });
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
+    return dest;
+}
+
+void TransformScaleBlit(Surface dest, Surface src, int x, int y, int destWidth, int destHeight) {
+    if (destWidth <= 0 || destHeight <= 0) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    Rect clipped;
+    if (!ClipTransformBlit(dest, src, (Rect){ x, y, destWidth, destHeight }, &clipped)) return;
+    DamageAdd(dest, clipped);
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)clipped.width * clipped.height);
 
+    TransformTarget target;
+    TargetInit(&target, dest, src, false);
+    ScaleToTarget(&target, src, x, y, destWidth, destHeight, clipped);
+
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
+}
+
+// Source pixels contributing to every destination pixel along one axis
+typedef struct ScaleAxis {
+    int* first;        // first source pixel of every destination pixel
+    int* count;
+    int16_t* weights;  // maxTaps per destination pixel, first count of them sum to SCALE_WEIGHT_ONE
+    int maxTaps;
+} ScaleAxis;
+
+static bool UsesArea(int srcSize, int destSize, ScaleFilter filter) {
+    return filter == SCALE_FILTER_AREA || (filter == SCALE_FILTER_AUTO && destSize < srcSize);
+}
+
+static int ScaleAxisMaxTaps(int srcSize, int destSize, bool area) {
+    return area ? (srcSize + destSize - 1) / destSize + 1 : 2;
+}
+
+// Pixel centers of both sizes are aligned, bilinear weights come from the two nearest source centers and area ones
+// from the part of every source pixel covered by the destination one
+static void BuildScaleAxis(ScaleAxis* axis, int srcSize, int destSize, bool area) {
+    const double scale = (double)srcSize / destSize;
+    for (int d = 0; d < destSize; ++d) {
+        int16_t* weights = axis->weights + (size_t)d * axis->maxTaps;
+        memset(weights, 0, (size_t)axis->maxTaps * sizeof(int16_t));
+
+        if (!area) {
+            const double center = (d + 0.5) * scale - 0.5;
+            int first = (int)floor(center);
+            double fraction = center - first;
+            if (first < 0) {
+                first = 0;
+                fraction = 0.0;
+            }
+            if (first >= srcSize - 1) {
+                first = srcSize - 1;
+                fraction = 0.0;
+            }
+            const int next = (int)(fraction * SCALE_WEIGHT_ONE + 0.5);
+            axis->first[d] = first;
+            axis->count[d] = next == 0 ? 1 : 2;
+            weights[0] = (int16_t)(SCALE_WEIGHT_ONE - next);
+            weights[1] = (int16_t)next;
+            continue;
+        }
+
+        const double start = d * scale;
+        const double end = (d + 1) * scale;
+        int first = (int)floor(start);
+        int last = (int)ceil(end);
+        if (last > srcSize) last = srcSize;
+        int count = 0;
+        int sum = 0;
+        int largest = 0;
+        for (int i = first; i < last; ++i) {
+            const double covered = fmin(end, i + 1.0) - fmax(start, (double)i);
+            const int weight = (int)(covered / scale * SCALE_WEIGHT_ONE + 0.5);
+            // rounded to nothing at the start, so the next pixel becomes the first one
+            if (weight == 0 && count == 0) {
+                ++first;
+                continue;
+            }
+            if (count == axis->maxTaps) break;
+            weights[count] = (int16_t)weight;
+            if (weight > weights[largest]) largest = count;
+            sum += weight;
+            ++count;
+        }
+        // rounding errors go to the largest weight, so a solid color stays exactly the same
+        weights[largest] = (int16_t)(weights[largest] + SCALE_WEIGHT_ONE - sum);
+        while (count > 1 && weights[count - 1] == 0) --count;
+        axis->first[d] = first;
+        axis->count[d] = count;
+    }
+}
+
+// Every channel of 32-bit pixels with 8-bit channels, in the order of bytes in memory
+static void ScaleRowHorizontal(int16_t* out, const uint32_t* src, const ScaleAxis* axis, int width) {
+    const int rounding = 1 << (SCALE_WEIGHT_BITS - SCALE_ROW_BITS - 1);
+#ifdef __SSE2__
+    if (CpuGetSimdLevel() >= SIMD_LEVEL_SSE2) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi32(rounding);
+        for (int d = 0; d < width; ++d) {
+            const uint32_t* pixels = src + axis->first[d];
+            const int16_t* weights = axis->weights + (size_t)d * axis->maxTaps;
+            const int count = axis->count[d];
+            __m128i sum = round;
+            // channels of two pixels are interleaved, so one madd multiplies and adds both
+            int k = 0;
+            for (; k + 1 < count; k += 2) {
+                const __m128i pair = _mm_unpacklo_epi8(
+                    _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)pixels[k]), _mm_cvtsi32_si128((int)pixels[k + 1])),
+                    zero
+                );
+                const __m128i w = _mm_set1_epi32((int)((uint32_t)(uint16_t)weights[k + 1] << 16 |
+                                                       (uint16_t)weights[k]));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, w));
+            }
+            if (k < count) {
+                const __m128i single = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)pixels[k]), zero),
+                                                         zero);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(single, _mm_set1_epi32((uint16_t)weights[k])));
+            }
+            sum = _mm_srai_epi32(sum, SCALE_WEIGHT_BITS - SCALE_ROW_BITS);
+            _mm_storel_epi64((__m128i*)(out + d * 4), _mm_packs_epi32(sum, sum));
+        }
+        return;
+    }
+#endif  // __SSE2__
+    for (int d = 0; d < width; ++d) {
+        const uint8_t* bytes = (const uint8_t*)(src + axis->first[d]);
+        const int16_t* weights = axis->weights + (size_t)d * axis->maxTaps;
+        int sum[4] = { rounding, rounding, rounding, rounding };
+        for (int k = 0; k < axis->count[d]; ++k) {
+            for (int c = 0; c < 4; ++c) {
+                sum[c] += bytes[k * 4 + c] * weights[k];
+            }
+        }
+        for (int c = 0; c < 4; ++c) {
+            out[d * 4 + c] = (int16_t)(sum[c] >> (SCALE_WEIGHT_BITS - SCALE_ROW_BITS));
+        }
+    }
+}
+
+// Weighted sum of horizontally filtered rows, n channels long, back to bytes
+static void ScaleRowVertical(uint8_t* out, const int16_t* const* rows, const int16_t* weights, int count, int n) {
+    const int shift = SCALE_WEIGHT_BITS + SCALE_ROW_BITS;
+    int i = 0;
+#ifdef __SSE2__
+    if (CpuGetSimdLevel() >= SIMD_LEVEL_SSE2) {
+        const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+        for (; i + 7 < n; i += 8) {
+            __m128i lo = round;
+            __m128i hi = round;
+            int k = 0;
+            for (; k + 1 < count; k += 2) {
+                const __m128i a = _mm_loadu_si128((const __m128i*)(rows[k] + i));
+                const __m128i b = _mm_loadu_si128((const __m128i*)(rows[k + 1] + i));
+                const __m128i w = _mm_set1_epi32((int)((uint32_t)(uint16_t)weights[k + 1] << 16 |
+                                                       (uint16_t)weights[k]));
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+            }
+            if (k < count) {
+                const __m128i a = _mm_loadu_si128((const __m128i*)(rows[k] + i));
+                const __m128i w = _mm_set1_epi32((uint16_t)weights[k]);
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, _mm_setzero_si128()), w));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, _mm_setzero_si128()), w));
+            }
+            const __m128i words = _mm_packs_epi32(_mm_srai_epi32(lo, shift), _mm_srai_epi32(hi, shift));
+            _mm_storel_epi64((__m128i*)(out + i), _mm_packus_epi16(words, words));
+        }
+    }
+#endif  // __SSE2__
+    for (; i < n; ++i) {
+        int sum = 1 << (shift - 1);
+        for (int k = 0; k < count; ++k) {
+            sum += rows[k][i] * weights[k];
+        }
+        sum >>= shift;
+        out[i] = (uint8_t)(sum > 255 ? 255 : sum);
+    }
+}
+
+// Straight alpha is filtered premultiplied, otherwise transparent pixels, usually black, darken the edges of
+// opaque ones. Alpha is at shift in every pixel, opaque pixels stay as they are
+static void PremultiplyRow(uint32_t* dst, const uint32_t* src, int n, int shift) {
+    for (int i = 0; i < n; ++i) {
+        const uint32_t pixel = src[i];
+        const uint32_t alpha = (pixel >> shift) & 0xFF;
+        if (alpha == 255) {
+            dst[i] = pixel;
+            continue;
+        }
+        uint32_t out = alpha << shift;
+        for (int c = 0; c < 32; c += 8) {
+            if (c == shift) continue;
+            out |= DIV255_ROUND(((pixel >> c) & 0xFF) * alpha) << c;
+        }
+        dst[i] = out;
+    }
+}
+
+static void UnpremultiplyRow(uint32_t* pixels, int n, int shift) {
+    for (int i = 0; i < n; ++i) {
+        const uint32_t pixel = pixels[i];
+        const uint32_t alpha = (pixel >> shift) & 0xFF;
+        if (alpha == 255) continue;
+        uint32_t out = alpha << shift;
+        if (alpha != 0) {
+            for (int c = 0; c < 32; c += 8) {
+                if (c == shift) continue;
+                const uint32_t value = (((pixel >> c) & 0xFF) * 255 + alpha / 2) / alpha;
+                out |= (value > 255 ? 255 : value) << c;
+            }
+        }
+        pixels[i] = out;
+    }
+}
+
+static size_t AlignScratch(size_t size) {
+    return (size + 15) & ~(size_t)15;
+}
+
+// Separable filter: every source row that is needed is filtered horizontally once into a small ring of rows, and
+// every destination row is a weighted sum of some of them. Formats without 8-bit channels in bytes are converted
+// to ARGB8888 and back one row at a time, straight alpha is premultiplied before filtering and restored after it
+static void ScaleFiltered(Surface src, Surface dest, ScaleFilter filter) {
+    ByteLayout layout;
+    const bool direct = GetByteLayout(src.format, &layout) && src.format == dest.format;
+    const bool straight = src.format->aMask != 0 && !src.format->premultiplied;
+    const int alphaShift = direct ? src.format->aShift : FORMAT_ARGB8888.aShift;
+    const bool areaX = UsesArea(src.width, dest.width, filter);
+    const bool areaY = UsesArea(src.height, dest.height, filter);
+    ScaleAxis axisX = { .maxTaps = ScaleAxisMaxTaps(src.width, dest.width, areaX) };
+    ScaleAxis axisY = { .maxTaps = ScaleAxisMaxTaps(src.height, dest.height, areaY) };
+    const size_t rowChannels = (size_t)dest.width * 4;
+
+    const size_t sizes[] = {
+        AlignScratch((size_t)dest.width * 2 * sizeof(int)),
+        AlignScratch((size_t)dest.width * axisX.maxTaps * sizeof(int16_t)),
+        AlignScratch((size_t)dest.height * 2 * sizeof(int)),
+        AlignScratch((size_t)dest.height * axisY.maxTaps * sizeof(int16_t)),
+        AlignScratch((size_t)axisY.maxTaps * rowChannels * sizeof(int16_t)),
+        AlignScratch((size_t)axisY.maxTaps * sizeof(int)),
+        AlignScratch((size_t)axisY.maxTaps * sizeof(int16_t*)),
+        direct && !straight ? 0 : AlignScratch((size_t)src.width * sizeof(uint32_t)),
+        direct ? 0 : AlignScratch((size_t)dest.width * sizeof(uint32_t)),
+    };
+    size_t total = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) total += sizes[i];
+    uint8_t* scratch = AllocatorAlloc(total);
+    if (scratch == NULL) {
+        THROW_ERROR(ERR_OUT_OF_MEMORY);
+        return;
+    }
+
+    uint8_t* next = scratch;
+    axisX.first = (int*)next;
+    axisX.count = axisX.first + dest.width;
+    next += sizes[0];
+    axisX.weights = (int16_t*)next;
+    next += sizes[1];
+    axisY.first = (int*)next;
+    axisY.count = axisY.first + dest.height;
+    next += sizes[2];
+    axisY.weights = (int16_t*)next;
+    next += sizes[3];
+    int16_t* ring = (int16_t*)next;
+    next += sizes[4];
+    int* ringRows = (int*)next;
+    next += sizes[5];
+    const int16_t** rows = (const int16_t**)next;
+    next += sizes[6];
+    uint32_t* srcRow = (uint32_t*)next;
+    next += sizes[7];
+    uint32_t* destRow = (uint32_t*)next;
+
+    BuildScaleAxis(&axisX, src.width, dest.width, areaX);
+    BuildScaleAxis(&axisY, src.height, dest.height, areaY);
+    for (int i = 0; i < axisY.maxTaps; ++i) ringRows[i] = -1;
+
+    PixelConverter toArgb, fromArgb;
+    if (!direct) {
+        PixelConverterInit(&toArgb, &FORMAT_ARGB8888, src.format);
+        PixelConverterInit(&fromArgb, dest.format, &FORMAT_ARGB8888);
+    }
+
+    for (int y = 0; y < dest.height; ++y) {
+        const int first = axisY.first[y];
+        const int count = axisY.count[y];
+        // rows needed by destination rows only move down, so a slot is reused after its row is no longer needed
+        for (int k = 0; k < count; ++k) {
+            const int row = first + k;
+            const int slot = row % axisY.maxTaps;
+            int16_t* filtered = ring + (size_t)slot * rowChannels;
+            if (ringRows[slot] != row) {
+                const void* pixels = (const uint8_t*)src.pixels + (size_t)row * src.stride;
+                if (!direct) {
+                    toArgb.convertRow(srcRow, pixels, src.width, &toArgb);
+                    pixels = srcRow;
+                }
+                if (straight) {
+                    PremultiplyRow(srcRow, pixels, src.width, alphaShift);
+                    pixels = srcRow;
+                }
+                ScaleRowHorizontal(filtered, pixels, &axisX, dest.width);
+                ringRows[slot] = row;
+            }
+            rows[k] = filtered;
+        }
+
+        uint8_t* out = (uint8_t*)dest.pixels + (size_t)y * dest.stride;
+        const int16_t* weights = axisY.weights + (size_t)y * axisY.maxTaps;
+        if (direct) {
+            ScaleRowVertical(out, rows, weights, count, (int)rowChannels);
+            if (straight) UnpremultiplyRow((uint32_t*)out, dest.width, alphaShift);
+        }
+        else {
+            ScaleRowVertical((uint8_t*)destRow, rows, weights, count, (int)rowChannels);
+            if (straight) UnpremultiplyRow(destRow, dest.width, alphaShift);
+            fromArgb.convertRow(out, destRow, dest.width, &fromArgb);
+        }
+    }
+    AllocatorFree(scratch);
+}
+
+Surface TransformScaleFiltered(Surface src, int destWidth, int destHeight, ScaleFilter filter) {
+    if (src.pixels == NULL || src.format == NULL || destWidth <= 0 || destHeight <= 0) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return (Surface){ 0 };
+    }
+    if (filter == SCALE_FILTER_NEAREST) return TransformScale(src, destWidth, destHeight);
+
+    const Surface dest = SurfaceCreate(destWidth, destHeight, src.format);
+    if (dest.pixels == NULL) return dest;
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)destWidth * destHeight);
+    ScaleFiltered(src, dest, filter);
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
+    return dest;
+}
+
+// Pixel-art upscalers turn every source pixel E into a square of factor x factor destination pixels, picked from its
+// neighbourhood A B C / D E F / G H I. Edge pixels of src are repeated outwards. Run functions produce n pixels
+// from column x on of every destination row of source row srcY. The neighbourhood slides along the row, so every
+// source pixel is loaded once per row it's a part of. Kernels see neighbours as CELL, which LOAD makes of pixels
+// with whatever PREPARE declares
+typedef void (*UpscaleRunFunction)(void* const out[], Surface src, int x, int srcY, int n);
+
+#define MAKE_UPSCALE_RUN_FUNCTION(NAME, TYPE, FACTOR, CELL, PREPARE, LOAD, KERNEL)                   \
+static void NAME(void* const out[], Surface src, int x, int srcY, int n) {                           \
+    PREPARE                                                                                          \
+    const int last = src.width - 1;                                                                  \
+    const int upperY = srcY > 0 ? srcY - 1 : 0;                                                      \
+    const int lowerY = srcY < src.height - 1 ? srcY + 1 : srcY;                                      \
+    const TYPE* upper = (const TYPE*)((const uint8_t*)src.pixels + upperY * src.stride);             \
+    const TYPE* row = (const TYPE*)((const uint8_t*)src.pixels + srcY * src.stride);                 \
+    const TYPE* lower = (const TYPE*)((const uint8_t*)src.pixels + lowerY * src.stride);             \
+    TYPE* const dst0 = out[0];                                                                       \
+    TYPE* const dst1 = out[1];                                                                       \
+    TYPE* const dst2 = FACTOR > 2 ? out[2] : NULL;                                                   \
+    (void)dst2;                                                                                      \
+                                                                                                     \
+    int srcX = x / FACTOR;                                                                           \
+    const int endX = (x + n + FACTOR - 1) / FACTOR;                                                  \
+    const int left = srcX > 0 ? srcX - 1 : 0;                                                        \
+    CELL A = LOAD(upper[left]);                                                                      \
+    CELL B = LOAD(upper[srcX]);                                                                      \
+    CELL D = LOAD(row[left]);                                                                        \
+    CELL E = LOAD(row[srcX]);                                                                        \
+    CELL G = LOAD(lower[left]);                                                                      \
+    CELL H = LOAD(lower[srcX]);                                                                      \
+    /* Scale2x doesn't look at corners */                                                            \
+    (void)A;                                                                                         \
+    (void)G;                                                                                         \
+                                                                                                     \
+    /* i is the first column of srcX in output, negative when the run starts inside of its square */ \
+    for (int i = srcX * FACTOR - x; srcX < endX; ++srcX, i += FACTOR) {                              \
+        const int right = srcX < last ? srcX + 1 : last;                                             \
+        const CELL C = LOAD(upper[right]);                                                           \
+        const CELL F = LOAD(row[right]);                                                             \
+        const CELL I = LOAD(lower[right]);                                                           \
+        if (i >= 0 && i + FACTOR <= n) KERNEL(UPSCALE_PUT, A, B, C, D, E, F, G, H, I);               \
+        else KERNEL(UPSCALE_PUT_CLIPPED, A, B, C, D, E, F, G, H, I);                                 \
+        A = B;                                                                                       \
+        B = C;                                                                                       \
+        D = E;                                                                                       \
+        E = F;                                                                                       \
+        G = H;                                                                                       \
+        H = I;                                                                                       \
+    }                                                                                                \
+}
+
+// Kernels store the pixels of E's square with these, by their row and column in the square
+#define UPSCALE_PUT(ROW, COLUMN, PIXEL) dst##ROW[i + (COLUMN)] = (PIXEL)
+#define UPSCALE_PUT_CLIPPED(ROW, COLUMN, PIXEL)                                     \
+    do {                                                                            \
+        if (i + (COLUMN) >= 0 && i + (COLUMN) < n) UPSCALE_PUT(ROW, COLUMN, PIXEL); \
+    } while (0)
+#define UPSCALE_LOAD_PIXEL(pixel) (pixel)
+
+// Quarters of E are E, or its neighbours towards the corner of the quarter when they are equal, unless E lies on a
+// straight edge (B == H or D == F)
+#define SCALE2X_KERNEL(PUT, A, B, C, D, E, F, G, H, I) \
+    do {                                               \
+        if (B != H && D != F) {                        \
+            PUT(0, 0, (D == B) ? D : E);               \
+            PUT(0, 1, (B == F) ? F : E);               \
+            PUT(1, 0, (D == H) ? D : E);               \
+            PUT(1, 1, (H == F) ? F : E);               \
+        }                                              \
+        else {                                         \
+            PUT(0, 0, E);                              \
+            PUT(0, 1, E);                              \
+            PUT(1, 0, E);                              \
+            PUT(1, 1, E);                              \
+        }                                              \
+    } while (0)
+
+// Like Scale2x for corners, edge ninths take the neighbour on their side when it continues a diagonal that doesn't
+// also run through the corner next to them
+#define SCALE3X_KERNEL(PUT, A, B, C, D, E, F, G, H, I)                     \
+    do {                                                                   \
+        if (B != H && D != F) {                                            \
+            PUT(0, 0, (D == B) ? D : E);                                   \
+            PUT(0, 1, ((D == B && E != C) || (B == F && E != A)) ? B : E); \
+            PUT(0, 2, (B == F) ? F : E);                                   \
+            PUT(1, 0, ((D == B && E != G) || (D == H && E != A)) ? D : E); \
+            PUT(1, 1, E);                                                  \
+            PUT(1, 2, ((B == F && E != I) || (H == F && E != C)) ? F : E); \
+            PUT(2, 0, (D == H) ? D : E);                                   \
+            PUT(2, 1, ((D == H && E != I) || (H == F && E != G)) ? H : E); \
+            PUT(2, 2, (H == F) ? F : E);                                   \
+        }                                                                  \
+        else {                                                             \
+            for (int k = 0; k < 3; ++k) {                                  \
+                PUT(0, k, E);                                              \
+                PUT(1, k, E);                                              \
+                PUT(2, k, E);                                              \
+            }                                                              \
+        }                                                                  \
+    } while (0)
+
+MAKE_UPSCALE_RUN_FUNCTION(Scale2xRun1, uint8_t, 2, uint8_t, , UPSCALE_LOAD_PIXEL, SCALE2X_KERNEL)
+MAKE_UPSCALE_RUN_FUNCTION(Scale2xRun2, uint16_t, 2, uint16_t, , UPSCALE_LOAD_PIXEL, SCALE2X_KERNEL)
+MAKE_UPSCALE_RUN_FUNCTION(Scale2xRun4, uint32_t, 2, uint32_t, , UPSCALE_LOAD_PIXEL, SCALE2X_KERNEL)
+MAKE_UPSCALE_RUN_FUNCTION(Scale3xRun1, uint8_t, 3, uint8_t, , UPSCALE_LOAD_PIXEL, SCALE3X_KERNEL)
+MAKE_UPSCALE_RUN_FUNCTION(Scale3xRun2, uint16_t, 3, uint16_t, , UPSCALE_LOAD_PIXEL, SCALE3X_KERNEL)
+MAKE_UPSCALE_RUN_FUNCTION(Scale3xRun4, uint32_t, 3, uint32_t, , UPSCALE_LOAD_PIXEL, SCALE3X_KERNEL)
+
+#ifdef __SSE2__
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Scale2x of four source pixels at once, with unaligned loads of the row shifted by one pixel either way for D and
+// F. Squares cut by the run and pixels without a neighbour in the row on both sides are left to Scale2xRun4
+static void Scale2xRun4_SSE2(void* const out[], Surface src, int x, int srcY, int n) {
+    int first = (x + 1) >> 1;
+    if (first < 1) first = 1;
+    int end = (x + n) >> 1;
+    if (end > src.width - 1) end = src.width - 1;
+    const int count = (end - first) & ~3;
+    if (count <= 0) {
+        Scale2xRun4(out, src, x, srcY, n);
+        return;
+    }
+
+    const int upperY = srcY > 0 ? srcY - 1 : 0;
+    const int lowerY = srcY < src.height - 1 ? srcY + 1 : srcY;
+    const uint32_t* upper = (const uint32_t*)((const uint8_t*)src.pixels + upperY * src.stride);
+    const uint32_t* row = (const uint32_t*)((const uint8_t*)src.pixels + srcY * src.stride);
+    const uint32_t* lower = (const uint32_t*)((const uint8_t*)src.pixels + lowerY * src.stride);
+    uint32_t* upperDst = (uint32_t*)out[0] - x;
+    uint32_t* lowerDst = (uint32_t*)out[1] - x;
+    const __m128i ones = _mm_set1_epi32(-1);
+
+    for (int srcX = first; srcX < first + count; srcX += 4) {
+        const __m128i B = _mm_loadu_si128((const __m128i*)(upper + srcX));
+        const __m128i D = _mm_loadu_si128((const __m128i*)(row + srcX - 1));
+        const __m128i E = _mm_loadu_si128((const __m128i*)(row + srcX));
+        const __m128i F = _mm_loadu_si128((const __m128i*)(row + srcX + 1));
+        const __m128i H = _mm_loadu_si128((const __m128i*)(lower + srcX));
+        const __m128i edge = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F)), ones);
+        const __m128i E0 = Select(_mm_and_si128(edge, _mm_cmpeq_epi32(D, B)), D, E);
+        const __m128i E1 = Select(_mm_and_si128(edge, _mm_cmpeq_epi32(B, F)), F, E);
+        const __m128i E2 = Select(_mm_and_si128(edge, _mm_cmpeq_epi32(D, H)), D, E);
+        const __m128i E3 = Select(_mm_and_si128(edge, _mm_cmpeq_epi32(H, F)), F, E);
+        _mm_storeu_si128((__m128i*)(upperDst + 2 * srcX), _mm_unpacklo_epi32(E0, E1));
+        _mm_storeu_si128((__m128i*)(upperDst + 2 * srcX + 4), _mm_unpackhi_epi32(E0, E1));
+        _mm_storeu_si128((__m128i*)(lowerDst + 2 * srcX), _mm_unpacklo_epi32(E2, E3));
+        _mm_storeu_si128((__m128i*)(lowerDst + 2 * srcX + 4), _mm_unpackhi_epi32(E2, E3));
+    }
+
+    const int head = 2 * first - x;
+    const int tail = 2 * (first + count) - x;
+    if (head > 0) Scale2xRun4(out, src, x, srcY, head);
+    if (tail < n) {
+        void* const rest[2] = { (uint32_t*)out[0] + tail, (uint32_t*)out[1] + tail };
+        Scale2xRun4(rest, src, x + tail, srcY, n - tail);
+    }
+}
+#endif  // __SSE2__
+
+// hq2x-style filter. Neighbours count as different from E when they differ in luma, chroma or alpha by more than the
+// thresholds of hq2x. Corners of E cut by a diagonal between two similar neighbours are blended with them, and
+// corners next to a single different pixel get a quarter of it. Channels are blended as bytes in any order
+typedef struct Hq2xCell {
+    uint32_t pixel;  // 8-bit channels, in the order of src for byte-aligned formats
+    uint64_t key;    // y, u, v and alpha in 16-bit lanes
+} Hq2xCell;
+
+// Thresholds of y, u, v and alpha added to lanes of key differences, biased so no lane borrows from the next one and
+// the top bits of lanes tell whether a difference lies within the threshold
+#define HQ2X_ABOVE_MIN 0x8030800680078030ull  // 0x8000 + threshold
+#define HQ2X_ABOVE_MAX 0x7FCF7FF97FF87FCFull  // 0x7FFF - threshold
+#define HQ2X_LANE_TOPS 0x8000800080008000ull
+
+static inline uint64_t Hq2xKey(int r, int g, int b, int a) {
+    const uint64_t y = (uint32_t)(77 * r + 150 * g + 29 * b) >> 8;
+    const uint64_t u = (uint32_t)(32768 - 43 * r - 85 * g + 128 * b) >> 8;
+    const uint64_t v = (uint32_t)(32768 + 128 * r - 107 * g - 21 * b) >> 8;
+    return y | (u << 16) | (v << 32) | ((uint64_t)a << 48);
+}
+
+static inline Hq2xCell Hq2xCellBytes(uint32_t pixel, ByteLayout layout) {
+    const int a = layout.a >= 0 ? (int)(pixel >> (layout.a * 8)) & 0xFF : 255;
+    const int r = (int)(pixel >> (layout.r * 8)) & 0xFF;
+    const int g = (int)(pixel >> (layout.g * 8)) & 0xFF;
+    const int b = (int)(pixel >> (layout.b * 8)) & 0xFF;
+    return (Hq2xCell){ pixel, Hq2xKey(r, g, b, a) };
+}
+
+static inline Hq2xCell Hq2xCellColor(const PixelFormat* format, uint32_t pixel) {
+    const Color c = UnpackPixel(format, pixel);
+    const uint32_t bytes = c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24);
+    return (Hq2xCell){ bytes, Hq2xKey(c.r, c.g, c.b, c.a) };
+}
+
+static inline uint32_t Hq2xColorToPixel(const PixelFormat* format, uint32_t bytes) {
+    const Color c = { (uint8_t)bytes, (uint8_t)(bytes >> 8), (uint8_t)(bytes >> 16), (uint8_t)(bytes >> 24) };
+    return PackColor(format, c);
+}
+
+// Without branches, as neighbours of noisy pixels are similar at random
+static inline bool Hq2xSimilar(uint64_t a, uint64_t b) {
+    const uint64_t aboveMin = a + HQ2X_ABOVE_MIN - b;
+    const uint64_t aboveMax = a + HQ2X_ABOVE_MAX - b;
+    return (aboveMin & ~aboveMax & HQ2X_LANE_TOPS) == HQ2X_LANE_TOPS;
+}
+
+// Bytes of e, x and y weighted by eighths
+static inline uint32_t MixBytes(uint32_t e, uint32_t x, uint32_t y, uint32_t we, uint32_t wx, uint32_t wy) {
+    const uint32_t rb = ((e & 0x00FF00FF) * we + (x & 0x00FF00FF) * wx + (y & 0x00FF00FF) * wy) >> 3;
+    const uint32_t ag = ((e >> 8) & 0x00FF00FF) * we + ((x >> 8) & 0x00FF00FF) * wx + ((y >> 8) & 0x00FF00FF) * wy;
+    return (rb & 0x00FF00FF) | ((ag << 5) & 0xFF00FF00);
+}
+
+// Quarter of e towards corner, which lies between e's neighbours side1 and side2, given which of them are similar
+// to e and whether sides are similar to each other
+static inline uint32_t Hq2xQuarter(uint32_t e, uint32_t corner, uint32_t side1, uint32_t side2, bool similarCorner,
+                                   bool similar1, bool similar2, bool similarSides) {
+    if (!similar1 && !similar2 && similarSides) {
+        // corner of a shape is rounded off, a diagonal line through e and corner only a bit
+        if (similarCorner) return MixBytes(e, side1, side2, 4, 2, 2);
+        return MixBytes(e, side1, side2, 2, 3, 3);
+    }
+    if (similar1 && similar2 && !similarCorner) return MixBytes(e, corner, corner, 6, 1, 1);
+    return e;
+}
+
+// Quarters of E in the order of rows
+static inline void Hq2xSquare(uint32_t out[4], Hq2xCell A, Hq2xCell B, Hq2xCell C, Hq2xCell D, Hq2xCell E,
+                              Hq2xCell F, Hq2xCell G, Hq2xCell H, Hq2xCell I) {
+    const bool a = Hq2xSimilar(E.key, A.key);
+    const bool b = Hq2xSimilar(E.key, B.key);
+    const bool c = Hq2xSimilar(E.key, C.key);
+    const bool d = Hq2xSimilar(E.key, D.key);
+    const bool f = Hq2xSimilar(E.key, F.key);
+    const bool g = Hq2xSimilar(E.key, G.key);
+    const bool h = Hq2xSimilar(E.key, H.key);
+    const bool i = Hq2xSimilar(E.key, I.key);
+    out[0] = Hq2xQuarter(E.pixel, A.pixel, B.pixel, D.pixel, a, b, d, Hq2xSimilar(B.key, D.key));
+    out[1] = Hq2xQuarter(E.pixel, C.pixel, B.pixel, F.pixel, c, b, f, Hq2xSimilar(B.key, F.key));
+    out[2] = Hq2xQuarter(E.pixel, G.pixel, H.pixel, D.pixel, g, h, d, Hq2xSimilar(H.key, D.key));
+    out[3] = Hq2xQuarter(E.pixel, I.pixel, H.pixel, F.pixel, i, h, f, Hq2xSimilar(H.key, F.key));
+}
+
+#define HQ2X_KERNEL(PUT, A, B, C, D, E, F, G, H, I)      \
+    do {                                                 \
+        uint32_t quarters[4];                            \
+        Hq2xSquare(quarters, A, B, C, D, E, F, G, H, I); \
+        PUT(0, 0, HQ2X_STORE(quarters[0]));              \
+        PUT(0, 1, HQ2X_STORE(quarters[1]));              \
+        PUT(1, 0, HQ2X_STORE(quarters[2]));              \
+        PUT(1, 1, HQ2X_STORE(quarters[3]));              \
+    } while (0)
+
+#define HQ2X_LOAD_BYTES(pixel) Hq2xCellBytes(pixel, layout)
+#define HQ2X_LOAD_COLOR(pixel) Hq2xCellColor(src.format, pixel)
+#define HQ2X_STORE(bytes) (bytes)
+MAKE_UPSCALE_RUN_FUNCTION(Hq2xRunBytes, uint32_t, 2, Hq2xCell, ByteLayout layout; GetByteLayout(src.format, &layout);,
+                          HQ2X_LOAD_BYTES, HQ2X_KERNEL)
+#undef HQ2X_STORE
+#define HQ2X_STORE(bytes) Hq2xColorToPixel(src.format, bytes)
+MAKE_UPSCALE_RUN_FUNCTION(Hq2xRun1, uint8_t, 2, Hq2xCell, , HQ2X_LOAD_COLOR, HQ2X_KERNEL)
+MAKE_UPSCALE_RUN_FUNCTION(Hq2xRun2, uint16_t, 2, Hq2xCell, , HQ2X_LOAD_COLOR, HQ2X_KERNEL)
+MAKE_UPSCALE_RUN_FUNCTION(Hq2xRun4, uint32_t, 2, Hq2xCell, , HQ2X_LOAD_COLOR, HQ2X_KERNEL)
+#undef HQ2X_STORE
+
+static UpscaleRunFunction GetScale2xRun(Surface src) {
     switch (src.format->bytesPerPixel) {
-        case 1: return Scale1(src, dest, scaleX, scaleY, lastSrcRow, lastSrcCol);
-        case 2: return Scale2(src, dest, scaleX, scaleY, lastSrcRow, lastSrcCol);
-        case 4: return Scale4(src, dest, scaleX, scaleY, lastSrcRow, lastSrcCol);
-        default: return dest;
-    }
-}
-
-// Note:
-// Src surface can be a clip of a bigger surface, thus (src.width * bpp != src.stride).
-// That's why B/D/E/F/H calculations can't be performed with array indexing.
-// However, dst surface is a new surface created by TransformScale, so (src.width * bpp == src.stride).
-// Thanks to this, is dstPixels array indexing can be used.
-#define MAKE_SCALE2X_FUNCTION(TYPE, BYTES)                                                             \
-static void Scale2x##BYTES(Surface src, Surface dst) {                                                 \
-    const int lastSrcRow = src.height - 1;                                                             \
-    const int lastSrcCol = src.width - 1;                                                              \
-    const int dw = dst.width;                                                                          \
-    TYPE* dstPixels = (TYPE*)dst.pixels;                                                               \
-                                                                                                       \
-    const int BSHIFT = BYTES >> 1;                                                                     \
-                                                                                                       \
-    for (int y = 0; y < src.height; ++y) {                                                             \
-        for (int x = 0; x < src.width; ++x) {                                                          \
-            const int upperY = y - 1 < 0 ? 0 : y - 1;                                                  \
-            const int lowerY = y + 1 >= src.height ? lastSrcRow : y + 1;                               \
-            const int leftX = x - 1 < 0 ? 0 : x - 1;                                                   \
-            const int rightX = x + 1 >= src.width ? lastSrcCol : x + 1;                                \
-                                                                                                       \
-            const TYPE B = *(TYPE*)((uint8_t*)src.pixels + upperY * src.stride + (     x << BSHIFT));  \
-            const TYPE D = *(TYPE*)((uint8_t*)src.pixels +      y * src.stride + ( leftX << BSHIFT));  \
-            const TYPE E = *(TYPE*)((uint8_t*)src.pixels +      y * src.stride + (     x << BSHIFT));  \
-            const TYPE F = *(TYPE*)((uint8_t*)src.pixels +      y * src.stride + (rightX << BSHIFT));  \
-            const TYPE H = *(TYPE*)((uint8_t*)src.pixels + lowerY * src.stride + (     x << BSHIFT));  \
-                                                                                                       \
-            TYPE E0, E1, E2, E3;                                                                       \
-            if (B != H && D != F) {                                                                    \
-                E0 = (D == B) ? D : E;                                                                 \
-                E1 = (B == F) ? F : E;                                                                 \
-                E2 = (D == H) ? D : E;                                                                 \
-                E3 = (H == F) ? F : E;                                                                 \
-            } else {                                                                                   \
-                E0 = E1 = E2 = E3 = E;                                                                 \
-            }                                                                                          \
-                                                                                                       \
-            const int dx = x << 1;                                                                     \
-            const int dy = y << 1;                                                                     \
-                                                                                                       \
-            dstPixels[dy * dw + dx] = E0;                                                              \
-            dstPixels[dy * dw + (dx + 1)] = E1;                                                        \
-            dstPixels[(dy + 1) * dw + dx] = E2;                                                        \
-            dstPixels[(dy + 1) * dw + (dx + 1)] = E3;                                                  \
-        }                                                                                              \
-    }                                                                                                  \
-}
-
-MAKE_SCALE2X_FUNCTION(uint8_t, 1)
-MAKE_SCALE2X_FUNCTION(uint16_t, 2)
-MAKE_SCALE2X_FUNCTION(uint32_t, 4)
+        case 1: return Scale2xRun1;
+        case 2: return Scale2xRun2;
+        case 4:
+#ifdef __SSE2__
+            if (CpuGetSimdLevel() >= SIMD_LEVEL_SSE2) return Scale2xRun4_SSE2;
+#endif  // __SSE2__
+            return Scale2xRun4;
+        default: return NULL;
+    }
+}
 
-Surface TransformScale2x(Surface original) {
-    const Surface scaled = SurfaceCreate(original.width << 1, original.height << 1, original.format);
-    switch (original.format->bytesPerPixel) {
-        case 1: Scale2x1(original, scaled); break;
-        case 2: Scale2x2(original, scaled); break;
-        case 4: Scale2x4(original, scaled); break;
-        default: break;
+static UpscaleRunFunction GetScale3xRun(Surface src) {
+    switch (src.format->bytesPerPixel) {
+        case 1: return Scale3xRun1;
+        case 2: return Scale3xRun2;
+        case 4: return Scale3xRun4;
+        default: return NULL;
+    }
+}
+
+static UpscaleRunFunction GetHq2xRun(Surface src) {
+    ByteLayout layout;
+    if (GetByteLayout(src.format, &layout) && layout.r >= 0 && layout.g >= 0 && layout.b >= 0) return Hq2xRunBytes;
+    switch (src.format->bytesPerPixel) {
+        case 1: return Hq2xRun1;
+        case 2: return Hq2xRun2;
+        case 4: return Hq2xRun4;
+        default: return NULL;
+    }
+}
+
+// Scaled surface is placed at x, y of the target. All destination rows of a source row are produced together, those
+// outside of clipped into spare rows of the buffer
+static void UpscaleToTarget(TransformTarget* target, Surface src, int x, int y, Rect clipped, int factor,
+                            UpscaleRunFunction run) {
+    const int right = clipped.x + clipped.width;
+    const int bottom = clipped.y + clipped.height;
+
+    for (int srcY = (clipped.y - y) / factor; y + srcY * factor < bottom; ++srcY) {
+        const int top = y + srcY * factor;
+        const bool partial = top < clipped.y || top + factor > bottom;
+        for (int ix = clipped.x; ix < right;) {
+            int n = TargetRunLength(target, right - ix);
+            if (partial && n > TRANSFORM_RUN_PIXELS) n = TRANSFORM_RUN_PIXELS;
+            void* out[TRANSFORM_RUN_ROWS];
+            for (int r = 0; r < factor; ++r) {
+                const bool visible = top + r >= clipped.y && top + r < bottom;
+                out[r] = visible ? TargetBegin(target, r, ix, top + r) : target->buffer[r];
+            }
+            run(out, src, ix - x, srcY, n);
+            for (int r = 0; r < factor; ++r) {
+                if (top + r >= clipped.y && top + r < bottom) TargetEnd(target, r, ix, top + r, n);
+            }
+            ix += n;
+        }
     }
+}
+
+static Surface Upscale(Surface src, int factor, UpscaleRunFunction (*getRun)(Surface)) {
+    const Surface scaled = SurfaceCreate(src.width * factor, src.height * factor, src.format);
+    if (scaled.pixels == NULL) return scaled;
+    const UpscaleRunFunction run = getRun(src);
+    if (run == NULL) return scaled;
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)scaled.width * scaled.height);
+    TransformTarget target;
+    TargetInit(&target, scaled, src, true);
+    UpscaleToTarget(&target, src, 0, 0, (Rect){ 0, 0, scaled.width, scaled.height }, factor, run);
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
     return scaled;
 }
+
+static void UpscaleBlit(Surface dest, Surface src, int x, int y, int factor, UpscaleRunFunction (*getRun)(Surface)) {
+    Rect clipped;
+    if (!ClipTransformBlit(dest, src, (Rect){ x, y, src.width * factor, src.height * factor }, &clipped)) return;
+    DamageAdd(dest, clipped);
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)clipped.width * clipped.height);
+
+    TransformTarget target;
+    TargetInit(&target, dest, src, false);
+    const UpscaleRunFunction run = getRun(src);
+    if (run != NULL) UpscaleToTarget(&target, src, x, y, clipped, factor, run);
+
+    PROFILE_END(PROFILE_ZONE_TRANSFORM);
+}
+
+Surface TransformScale2x(Surface original) {
+    return Upscale(original, 2, GetScale2xRun);
+}
+
+void TransformScale2xBlit(Surface dest, Surface src, int x, int y) {
+    UpscaleBlit(dest, src, x, y, 2, GetScale2xRun);
+}
+
+Surface TransformScale3x(Surface original) {
+    return Upscale(original, 3, GetScale3xRun);
+}
+
+void TransformScale3xBlit(Surface dest, Surface src, int x, int y) {
+    UpscaleBlit(dest, src, x, y, 3, GetScale3xRun);
+}
+
+Surface TransformHq2x(Surface original) {
+    return Upscale(original, 2, GetHq2xRun);
+}
+
+void TransformHq2xBlit(Surface dest, Surface src, int x, int y) {
+    UpscaleBlit(dest, src, x, y, 2, GetHq2xRun);
+}
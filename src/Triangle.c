@@ -0,0 +1,431 @@
+#include <math.h>
+#include <stddef.h>
+
+#include "DepthBuffer.h"
+#include "Error.h"
+#include "Triangle.h"
+#include "internal/Damage.h"
+#include "internal/FixedPoint.h"
+#include "internal/Inlines.h"
+#include "internal/Profile.h"
+#include "internal/Rasterizer.h"
+#include "internal/Scanline.h"
+
+// Perspective-correct texture coordinates are computed at both ends of runs this long and interpolated between them
+#define PERSPECTIVE_RUN_SHIFT 4
+#define PERSPECTIVE_RUN (1 << PERSPECTIVE_RUN_SHIFT)
+
+// Interpolated values are kept in 16.16 fixed point, so texture coordinates further than this are clamped
+#define MAX_TEXEL_COORD 16384.0f
+
+// Depth is stepped with this many fraction bits, stored values are its integer part
+#define DEPTH_FRACTION_BITS 12
+
+// Attribute changing linearly on screen, its value at pixel (x, y) is value + (x - originX) * dx + (y - originY) * dy
+typedef struct Gradient {
+    float value;
+    float dx;
+    float dy;
+} Gradient;
+
+typedef struct Shading {
+    Surface texture;
+    bool textured;
+    bool bilinear;
+    bool blend;
+    bool perspective;
+    bool modulate;      // vertex colors aren't all white, so texels are multiplied by them
+    float originX;      // gradients are relative to the first vertex, which keeps them precise far from (0, 0)
+    float originY;
+    Gradient color[4];  // r, g, b, a plus 0.5, so rounding errors of stepping don't leave [0, 256)
+    Gradient u;         // texel coordinates, divided by w for perspective
+    Gradient v;
+    Gradient q;         // 1 / w
+    Gradient depth;     // plus 0.5 like colors
+} Shading;
+
+// Values of a span at its current pixel and their change per pixel
+typedef struct SpanCursor {
+    fixed_t color[4];
+    fixed_t colorStep[4];
+    fixed_t u;
+    fixed_t v;
+    fixed_t du;
+    fixed_t dv;
+    int32_t depth;
+    int32_t depthStep;
+} SpanCursor;
+
+static Gradient MakeGradient(const double x[3], const double y[3], const float a[3], double invDet) {
+    const double a1 = (double)a[1] - a[0];
+    const double a2 = (double)a[2] - a[0];
+    return (Gradient){
+        a[0],
+        (float)((a1 * (y[2] - y[0]) - a2 * (y[1] - y[0])) * invDet),
+        (float)((a2 * (x[1] - x[0]) - a1 * (x[2] - x[0])) * invDet),
+    };
+}
+
+static inline float GradientAt(const Shading* shading, const Gradient* gradient, float x, float y) {
+    return gradient->value + (x - shading->originX) * gradient->dx + (y - shading->originY) * gradient->dy;
+}
+
+static inline fixed_t TexelToFixed(float texel) {
+    // NaN fails both comparisons and lands on the lower limit
+    if (!(texel > -MAX_TEXEL_COORD)) texel = -MAX_TEXEL_COORD;
+    if (texel > MAX_TEXEL_COORD) texel = MAX_TEXEL_COORD;
+    return (fixed_t)(texel * (float)FIXED_ONE);
+}
+
+static inline fixed_t ChannelToFixed(float channel) {
+    if (!(channel > 0.5f)) channel = 0.5f;
+    if (channel > 255.5f) channel = 255.5f;
+    return (fixed_t)(channel * (float)FIXED_ONE);
+}
+
+static inline int32_t DepthToFixed(float depth) {
+    if (!(depth > 0.5f)) depth = 0.5f;
+    if (depth > DEPTH_FAR + 0.5f) depth = DEPTH_FAR + 0.5f;
+    return (int32_t)(depth * (float)(1 << DEPTH_FRACTION_BITS));
+}
+
+// Stores depth of a pixel that is nearer than the stored one, returns whether it should be drawn
+static inline bool TestDepth(uint16_t* stored, int32_t depth) {
+    const uint16_t value = (uint16_t)(depth >> DEPTH_FRACTION_BITS);
+    if (value >= *stored) return false;
+    *stored = value;
+    return true;
+}
+
+static inline int ClampInt(int value, int max) {
+    if (value < 0) return 0;
+    return value > max ? max : value;
+}
+
+static inline uint32_t LoadPixel(const uint8_t* pixel, uint8_t bpp) {
+    switch (bpp) {
+        case 1: return *pixel;
+        case 2: return *(const uint16_t*)pixel;
+        case 4: return *(const uint32_t*)pixel;
+        default: return 0;
+    }
+}
+
+static inline Color FetchTexel(Surface texture, int x, int y) {
+    const uint8_t bpp = texture.format->bytesPerPixel;
+    const uint8_t* pixel = (const uint8_t*)texture.pixels + y * texture.stride + x * bpp;
+    return UnpackPixel(texture.format, LoadPixel(pixel, bpp));
+}
+
+static inline Color SampleNearest(Surface texture, fixed_t u, fixed_t v) {
+    return FetchTexel(texture, ClampInt(FIXED_INT_PART(u), texture.width - 1),
+                      ClampInt(FIXED_INT_PART(v), texture.height - 1));
+}
+
+// Texel centers are at .5, weights have 8 bits
+static inline Color SampleBilinear(Surface texture, fixed_t u, fixed_t v) {
+    u -= FIXED_ONE >> 1;
+    v -= FIXED_ONE >> 1;
+    const int fx = (u >> (FIXED_SHIFT - 8)) & 0xFF;
+    const int fy = (v >> (FIXED_SHIFT - 8)) & 0xFF;
+    const int x0 = ClampInt(FIXED_INT_PART(u), texture.width - 1);
+    const int x1 = ClampInt(FIXED_INT_PART(u) + 1, texture.width - 1);
+    const int y0 = ClampInt(FIXED_INT_PART(v), texture.height - 1);
+    const int y1 = ClampInt(FIXED_INT_PART(v) + 1, texture.height - 1);
+
+    // channels of 32-bit texels have 8 bits each, so they can be filtered before unpacking
+    if (texture.format->bytesPerPixel == 4) {
+        const uint32_t* row0 = (const uint32_t*)((const uint8_t*)texture.pixels + y0 * texture.stride);
+        const uint32_t* row1 = (const uint32_t*)((const uint8_t*)texture.pixels + y1 * texture.stride);
+        const uint32_t top = LerpPixelBytes(row0[x0], row0[x1], fx);
+        const uint32_t bottom = LerpPixelBytes(row1[x0], row1[x1], fx);
+        return UnpackPixel(texture.format, LerpPixelBytes(top, bottom, fy));
+    }
+
+    const Color c00 = FetchTexel(texture, x0, y0);
+    const Color c10 = FetchTexel(texture, x1, y0);
+    const Color c01 = FetchTexel(texture, x0, y1);
+    const Color c11 = FetchTexel(texture, x1, y1);
+    const int w00 = (256 - fx) * (256 - fy);
+    const int w10 = fx * (256 - fy);
+    const int w01 = (256 - fx) * fy;
+    const int w11 = fx * fy;
+    return (Color){
+        (uint8_t)((c00.r * w00 + c10.r * w10 + c01.r * w01 + c11.r * w11 + 32768) >> 16),
+        (uint8_t)((c00.g * w00 + c10.g * w10 + c01.g * w01 + c11.g * w11 + 32768) >> 16),
+        (uint8_t)((c00.b * w00 + c10.b * w10 + c01.b * w01 + c11.b * w11 + 32768) >> 16),
+        (uint8_t)((c00.a * w00 + c10.a * w10 + c01.a * w01 + c11.a * w11 + 32768) >> 16),
+    };
+}
+
+// Everything the loop reads is copied to locals first, otherwise every pixel store could alias it and force reloads
+static void ShadeRun(const Shading* shading, Surface surface, uint8_t* pixel, uint16_t* depth, int count,
+                     SpanCursor* cursor) {
+    const PixelFormat format = *surface.format;
+    const PixelFormat texelFormat = shading->textured ? *shading->texture.format : format;
+    Surface texture = shading->texture;
+    texture.format = &texelFormat;
+    const bool textured = shading->textured;
+    const bool bilinear = shading->bilinear;
+    const bool modulate = shading->modulate;
+    const bool blend = shading->blend;
+    const bool shaded = !textured || modulate;
+    const uint8_t bpp = format.bytesPerPixel;
+    SpanCursor c = *cursor;
+
+    for (int i = 0; i < count; ++i, pixel += bpp) {
+        if (depth == NULL || TestDepth(&depth[i], c.depth)) {
+            const Color vertex = {
+                (uint8_t)FIXED_INT_PART(c.color[0]),
+                (uint8_t)FIXED_INT_PART(c.color[1]),
+                (uint8_t)FIXED_INT_PART(c.color[2]),
+                (uint8_t)FIXED_INT_PART(c.color[3]),
+            };
+            Color color = vertex;
+            if (textured) {
+                color = bilinear ? SampleBilinear(texture, c.u, c.v) : SampleNearest(texture, c.u, c.v);
+                if (modulate) {
+                    color.r = (uint8_t)DIV255(color.r * vertex.r);
+                    color.g = (uint8_t)DIV255(color.g * vertex.g);
+                    color.b = (uint8_t)DIV255(color.b * vertex.b);
+                    color.a = (uint8_t)DIV255(color.a * vertex.a);
+                }
+            }
+
+            if (!blend || color.a == 255) {
+                SetPixel(pixel, PackColor(&format, color), bpp);
+            }
+            else if (color.a != 0) {
+                BlendColorToPixel(pixel, color, color.a, 255 - color.a, bpp, &format);
+            }
+        }
+
+        if (shaded) {
+            for (int k = 0; k < 4; ++k) {
+                c.color[k] += c.colorStep[k];
+            }
+        }
+        c.u += c.du;
+        c.v += c.dv;
+        c.depth += c.depthStep;
+    }
+    *cursor = c;
+}
+
+static inline const uint8_t* NearestTexel(Surface texture, fixed_t u, fixed_t v, uint8_t bpp) {
+    const int x = ClampInt(FIXED_INT_PART(u), texture.width - 1);
+    const int y = ClampInt(FIXED_INT_PART(v), texture.height - 1);
+    return (const uint8_t*)texture.pixels + y * texture.stride + x * bpp;
+}
+
+// Nearest texels of a texture in the same format as surface, without colors to multiply by or alpha to blend. Depth
+// test has its own loop, so runs without it don't pay for it
+#define MAKE_COPY_RUN_FUNCTION(TYPE, BYTES)                                                                         \
+static void CopyRun##BYTES(Surface texture, uint8_t* dest, uint16_t* depth, int count, SpanCursor* cursor) {        \
+    TYPE* out = (TYPE*)dest;                                                                                        \
+    const fixed_t du = cursor->du;                                                                                  \
+    const fixed_t dv = cursor->dv;                                                                                  \
+    fixed_t u = cursor->u;                                                                                          \
+    fixed_t v = cursor->v;                                                                                          \
+    if (depth == NULL) {                                                                                            \
+        for (int i = 0; i < count; ++i, u += du, v += dv) {                                                         \
+            out[i] = *(const TYPE*)NearestTexel(texture, u, v, BYTES);                                              \
+        }                                                                                                           \
+    }                                                                                                               \
+    else {                                                                                                          \
+        int32_t z = cursor->depth;                                                                                  \
+        for (int i = 0; i < count; ++i, u += du, v += dv, z += cursor->depthStep) {                                 \
+            if (TestDepth(&depth[i], z)) out[i] = *(const TYPE*)NearestTexel(texture, u, v, BYTES);                 \
+        }                                                                                                           \
+        cursor->depth = z;                                                                                          \
+    }                                                                                                               \
+    cursor->u = u;                                                                                                  \
+    cursor->v = v;                                                                                                  \
+}
+
+MAKE_COPY_RUN_FUNCTION(uint8_t, 1)
+MAKE_COPY_RUN_FUNCTION(uint16_t, 2)
+MAKE_COPY_RUN_FUNCTION(uint32_t, 4)
+
+// Depth is NULL when pixels aren't depth-tested
+static void DrawRun(const Shading* shading, Surface surface, uint8_t* pixel, uint16_t* depth, int count,
+                    SpanCursor* cursor, bool copy) {
+    if (!copy) {
+        ShadeRun(shading, surface, pixel, depth, count, cursor);
+        return;
+    }
+    switch (surface.format->bytesPerPixel) {
+        case 1: CopyRun1(shading->texture, pixel, depth, count, cursor); break;
+        case 2: CopyRun2(shading->texture, pixel, depth, count, cursor); break;
+        case 4: CopyRun4(shading->texture, pixel, depth, count, cursor); break;
+        default: break;
+    }
+}
+
+void RasterizeTriangle(Surface surface, const Vertex* vertices[3], const Surface* texture, TriangleFlags flags,
+                       const DepthBuffer* depthBuffer, const float depth[3]) {
+    int32_t sx[3], sy[3];
+    for (int i = 0; i < 3; ++i) {
+        sx[i] = FloatToSubpixel(vertices[i]->x);
+        sy[i] = FloatToSubpixel(vertices[i]->y);
+    }
+    if (flags & TRIANGLE_FLAG_CULL_BACK) {
+        // y grows downwards, so clockwise triangles have positive area
+        const int64_t area = (int64_t)(sx[1] - sx[0]) * (sy[2] - sy[0]) - (int64_t)(sy[1] - sy[0]) * (sx[2] - sx[0]);
+        if (area > 0) return;
+    }
+    TriangleSetup setup;
+    if (!TriangleSetupInit(&setup, sx, sy, surface.width, surface.height)) return;
+
+    // gradients are computed from snapped vertices, so they match pixels chosen by the setup
+    double x[3], y[3];
+    for (int i = 0; i < 3; ++i) {
+        x[i] = (double)sx[i] / TRIANGLE_SUBPIXEL_ONE;
+        y[i] = (double)sy[i] / TRIANGLE_SUBPIXEL_ONE;
+    }
+    const double invDet = 1.0 / ((x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]));
+
+    Shading shading = {
+        .textured = texture != NULL,
+        .bilinear = texture != NULL && (flags & TRIANGLE_FLAG_BILINEAR) != 0,
+        .blend = (flags & TRIANGLE_FLAG_BLEND) != 0,
+        .originX = (float)x[0],
+        .originY = (float)y[0],
+    };
+    bool white = true;
+    for (int c = 0; c < 4; ++c) {
+        float channel[3];
+        for (int i = 0; i < 3; ++i) {
+            const Color color = vertices[i]->color;
+            const uint8_t value = c == 0 ? color.r : c == 1 ? color.g : c == 2 ? color.b : color.a;
+            white = white && value == 255;
+            channel[i] = (float)value + 0.5f;
+        }
+        shading.color[c] = MakeGradient(x, y, channel, invDet);
+    }
+
+    bool copy = false;
+    if (texture != NULL) {
+        shading.texture = *texture;
+        shading.modulate = !white;
+        shading.perspective = (flags & TRIANGLE_FLAG_PERSPECTIVE) != 0 &&
+                              vertices[0]->w > 0.0f && vertices[1]->w > 0.0f && vertices[2]->w > 0.0f;
+        float u[3], v[3], q[3];
+        for (int i = 0; i < 3; ++i) {
+            q[i] = shading.perspective ? 1.0f / vertices[i]->w : 1.0f;
+            u[i] = vertices[i]->u * (float)texture->width * q[i];
+            v[i] = vertices[i]->v * (float)texture->height * q[i];
+        }
+        shading.u = MakeGradient(x, y, u, invDet);
+        shading.v = MakeGradient(x, y, v, invDet);
+        shading.q = MakeGradient(x, y, q, invDet);
+        copy = !shading.bilinear && !shading.modulate && texture->format == surface.format &&
+               (!shading.blend || (texture->flags & SURFACE_FLAG_HAS_ALPHA) == 0);
+    }
+
+    const bool depthTested = depthBuffer != NULL && depthBuffer->values != NULL;
+    if (depthTested) {
+        const float value[3] = { depth[0] + 0.5f, depth[1] + 0.5f, depth[2] + 0.5f };
+        shading.depth = MakeGradient(x, y, value, invDet);
+    }
+
+    SpanCursor cursor = { 0 };
+    for (int c = 0; c < 4; ++c) {
+        cursor.colorStep[c] = (fixed_t)(shading.color[c].dx * (float)FIXED_ONE);
+    }
+    cursor.depthStep = (int32_t)(shading.depth.dx * (float)(1 << DEPTH_FRACTION_BITS));
+    if (!shading.perspective) {
+        cursor.du = (fixed_t)(shading.u.dx * (float)FIXED_ONE);
+        cursor.dv = (fixed_t)(shading.v.dx * (float)FIXED_ONE);
+    }
+
+    const uint8_t bpp = surface.format->bytesPerPixel;
+    TriangleSpan spans[TRIANGLE_BLOCK_ROWS];
+    int count;
+    while ((count = TriangleSetupNextSpans(&setup, spans, TRIANGLE_BLOCK_ROWS)) > 0) {
+        for (int s = 0; s < count; ++s) {
+            const TriangleSpan span = spans[s];
+            const float fx = (float)span.x0;
+            const float fy = (float)span.y;
+            uint8_t* pixel = (uint8_t*)surface.pixels + span.y * surface.stride + span.x0 * bpp;
+            uint16_t* depthRow = NULL;
+            PROFILE_PIXELS(span.x1 - span.x0);
+            for (int c = 0; c < 4; ++c) {
+                cursor.color[c] = ChannelToFixed(GradientAt(&shading, &shading.color[c], fx, fy));
+            }
+            if (depthTested) {
+                depthRow = depthBuffer->values + (size_t)span.y * depthBuffer->width + span.x0;
+                cursor.depth = DepthToFixed(GradientAt(&shading, &shading.depth, fx, fy));
+            }
+            if (!shading.perspective) {
+                cursor.u = TexelToFixed(GradientAt(&shading, &shading.u, fx, fy));
+                cursor.v = TexelToFixed(GradientAt(&shading, &shading.v, fx, fy));
+                DrawRun(&shading, surface, pixel, depthRow, span.x1 - span.x0, &cursor, copy);
+                continue;
+            }
+
+            // one division per end of a run, texture coordinates are stepped linearly inside it
+            float q = GradientAt(&shading, &shading.q, fx, fy);
+            float uq = GradientAt(&shading, &shading.u, fx, fy);
+            float vq = GradientAt(&shading, &shading.v, fx, fy);
+            float u = uq / q;
+            float v = vq / q;
+            for (int x = span.x0; x < span.x1; x += PERSPECTIVE_RUN) {
+                const int run = span.x1 - x < PERSPECTIVE_RUN ? span.x1 - x : PERSPECTIVE_RUN;
+                q += shading.q.dx * (float)run;
+                uq += shading.u.dx * (float)run;
+                vq += shading.v.dx * (float)run;
+                const float nextU = uq / q;
+                const float nextV = vq / q;
+                const float invRun = run == PERSPECTIVE_RUN ? 1.0f / PERSPECTIVE_RUN : 1.0f / (float)run;
+                cursor.u = TexelToFixed(u);
+                cursor.v = TexelToFixed(v);
+                cursor.du = TexelToFixed((nextU - u) * invRun);
+                cursor.dv = TexelToFixed((nextV - v) * invRun);
+                DrawRun(&shading, surface, pixel, depthRow, run, &cursor, copy);
+                pixel += run * bpp;
+                if (depthRow != NULL) depthRow += run;
+                u = nextU;
+                v = nextV;
+            }
+        }
+    }
+}
+
+// Returns false for triangles outside of surface
+static bool AddTriangleDamage(Surface surface, const Vertex* v1, const Vertex* v2, const Vertex* v3) {
+    const float minX = fminf(v1->x, fminf(v2->x, v3->x));
+    const float maxX = fmaxf(v1->x, fmaxf(v2->x, v3->x));
+    const float minY = fminf(v1->y, fminf(v2->y, v3->y));
+    const float maxY = fmaxf(v1->y, fmaxf(v2->y, v3->y));
+    if (maxX < 0.0f || maxY < 0.0f || minX >= (float)surface.width || minY >= (float)surface.height) return false;
+    DamageAdd(surface, (Rect){
+        (int)floorf(minX), (int)floorf(minY), (int)ceilf(maxX - minX) + 2, (int)ceilf(maxY - minY) + 2
+    });
+    return true;
+}
+
+void DrawTriangleShaded(Surface surface, const Vertex* v1, const Vertex* v2, const Vertex* v3, TriangleFlags flags) {
+    if (v1 == NULL || v2 == NULL || v3 == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    if (!AddTriangleDamage(surface, v1, v2, v3)) return;
+    PROFILE_BEGIN();
+    const Vertex* vertices[3] = { v1, v2, v3 };
+    RasterizeTriangle(surface, vertices, NULL, flags, NULL, NULL);
+    PROFILE_END(PROFILE_ZONE_DRAW_TRIANGLE_SHADED);
+}
+
+void DrawTriangleTextured(Surface surface, const Vertex* v1, const Vertex* v2, const Vertex* v3, Surface texture,
+                          TriangleFlags flags) {
+    if (v1 == NULL || v2 == NULL || v3 == NULL || texture.pixels == NULL) {
+        THROW_ERROR(ERR_INVALID_PARAMS);
+        return;
+    }
+    if (!AddTriangleDamage(surface, v1, v2, v3)) return;
+    PROFILE_BEGIN();
+    const Vertex* vertices[3] = { v1, v2, v3 };
+    RasterizeTriangle(surface, vertices, &texture, flags, NULL, NULL);
+    PROFILE_END(PROFILE_ZONE_DRAW_TRIANGLE_TEXTURED);
+}
@@ -2,6 +2,7 @@
 #include <TFT_eSPI.h>
 
 #include "Window.h"
+#include "internal/Profile.h"
 
 typedef struct Platform {
     TFT_eSPI tft;
@@ -70,6 +71,14 @@ void WindowSetTitle(const char* title) {
 
 void WindowBeginFrame() {}
 
+void WindowSetBufferCount(int count) {
+    (void)count;
+}
+
+Surface WindowGetSurface(void) {
+    return platform.surface;
+}
+
 static void FrameTick() {
     int64_t now = esp_timer_get_time();
     const double frameTime = (double)(now - timeHandling.lastFrameUs) / 1000000.0;
@@ -93,6 +102,8 @@ static void FrameTick() {
 }
 
 void WindowEndFrame() {
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)platform.surface.width * platform.surface.height);
 #ifdef USE_RGB332
     const int width = platform.surface.width;
     const int height = platform.surface.height;
@@ -114,8 +125,10 @@ void WindowEndFrame() {
 #else
     platform.tft.pushImage(0, 0, platform.surface.width, platform.surface.height, (uint16_t*)platform.surface.pixels);
 #endif
+    PROFILE_END(PROFILE_ZONE_WINDOW_END_FRAME);
 
     FrameTick();
+    ProfilerNextFrame();
 }
 
 void WindowSetTargetFPS(int fps) {
@@ -0,0 +1,223 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "Headless.h"
+#include "Image.h"
+#include "Input.h"
+#include "Window.h"
+#include "internal/Profile.h"
+
+#define DEFAULT_FRAME_TIME (1.0 / 60.0)
+#define MAX_DUMP_PATH 512
+
+typedef struct Platform {
+    Surface surface;
+    int shouldClose;
+    bool dump;
+    char dumpFormat[MAX_DUMP_PATH];
+    int frameCount;
+    int frameLimit;
+} Platform;
+
+typedef struct TimeHandling {
+    double targetFrameTime;
+    double frameTime;  // virtual step, negative when not set by the user
+    double deltaTime;
+    double time;
+    struct timespec startTime;
+    struct timespec lastFrameTime;
+} TimeHandling;
+
+static Platform platform = { 0 };
+static TimeHandling timeHandling = { .frameTime = -1.0 };
+
+// --------------------------------------------------------------------------------------------------------------------
+
+bool IsKeyPressed(KeyboardKey key) {
+    (void)key;
+    return false;
+}
+
+bool IsKeyDown(KeyboardKey key) {
+    (void)key;
+    return false;
+}
+
+bool IsKeyReleased(KeyboardKey key) {
+    (void)key;
+    return false;
+}
+
+int GetMouseX() {
+    return 0;
+}
+
+int GetMouseY() {
+    return 0;
+}
+
+void GetMousePosition(int* x, int* y) {
+    if (x) *x = 0;
+    if (y) *y = 0;
+}
+
+int GetMouseWheelMove() {
+    return 0;
+}
+
+bool IsMouseButtonPressed(MouseButton button) {
+    (void)button;
+    return false;
+}
+
+bool IsMouseButtonDown(MouseButton button) {
+    (void)button;
+    return false;
+}
+
+bool IsMouseButtonReleased(MouseButton button) {
+    (void)button;
+    return false;
+}
+
+void SetMousePosition(int x, int y) {
+    (void)x;
+    (void)y;
+}
+
+void CursorShow() {}
+
+void CursorHide() {}
+
+bool IsCursorHidden() {
+    return false;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static double TimespecToSeconds(struct timespec t) {
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static void InitTimer(void) {
+    timespec_get(&timeHandling.startTime, TIME_UTC);
+    timeHandling.lastFrameTime = timeHandling.startTime;
+    timeHandling.deltaTime = 0.0;
+    timeHandling.time = 0.0;
+}
+
+static double VirtualFrameTime(void) {
+    if (timeHandling.frameTime >= 0.0) return timeHandling.frameTime;
+    return timeHandling.targetFrameTime > 0.0 ? timeHandling.targetFrameTime : DEFAULT_FRAME_TIME;
+}
+
+static void FrameTick(void) {
+    const double step = VirtualFrameTime();
+    if (step > 0.0) {
+        timeHandling.deltaTime = step;
+        timeHandling.time += step;
+        return;
+    }
+
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    timeHandling.deltaTime = TimespecToSeconds(now) - TimespecToSeconds(timeHandling.lastFrameTime);
+    timeHandling.time = TimespecToSeconds(now) - TimespecToSeconds(timeHandling.startTime);
+    timeHandling.lastFrameTime = now;
+}
+
+Surface WindowInit(int width, int height, const char* title) {
+    if (width <= 0 || height <= 0 || title == NULL) return (Surface){ 0 };
+
+    platform.surface = SurfaceCreate(width, height, &FORMAT_ARGB8888);
+    platform.shouldClose = 0;
+    platform.frameCount = 0;
+    InitTimer();
+
+    return platform.surface;
+}
+
+void WindowDestroy() {
+    SurfaceDestroy(&platform.surface);
+}
+
+void WindowSetClose(bool close) {
+    platform.shouldClose = close;
+}
+
+bool WindowShouldClose() {
+    return platform.shouldClose || (platform.frameLimit > 0 && platform.frameCount >= platform.frameLimit);
+}
+
+void WindowSetTitle(const char* title) {
+    (void)title;
+}
+
+void WindowBeginFrame() {}
+
+void WindowSetBufferCount(int count) {
+    (void)count;
+}
+
+Surface WindowGetSurface(void) {
+    return platform.surface;
+}
+
+void WindowEndFrame() {
+    PROFILE_BEGIN();
+    if (platform.dump) {
+        char path[MAX_DUMP_PATH];
+        snprintf(path, sizeof(path), platform.dumpFormat, platform.frameCount);
+        ImageSaveBMP(platform.surface, path);
+        PROFILE_PIXELS((long long)platform.surface.width * platform.surface.height);
+    }
+    ++platform.frameCount;
+    PROFILE_END(PROFILE_ZONE_WINDOW_END_FRAME);
+
+    FrameTick();
+    ProfilerNextFrame();
+}
+
+void WindowSetTargetFPS(int fps) {
+    if (fps <= 0) {
+        timeHandling.targetFrameTime = 0.0;
+    }
+    else {
+        timeHandling.targetFrameTime = 1.0 / (double)fps;
+    }
+}
+
+float WindowGetFrameTime(void) {
+    return (float)timeHandling.deltaTime;
+}
+
+double WindowGetTime(void) {
+    if (VirtualFrameTime() > 0.0) return timeHandling.time;
+
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return TimespecToSeconds(now) - TimespecToSeconds(timeHandling.startTime);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+void HeadlessSetFrameDump(const char* pathFormat) {
+    platform.dump = pathFormat != NULL;
+    if (!platform.dump) return;
+    strncpy(platform.dumpFormat, pathFormat, MAX_DUMP_PATH - 1);
+    platform.dumpFormat[MAX_DUMP_PATH - 1] = '\0';
+}
+
+void HeadlessSetFrameTime(double seconds) {
+    timeHandling.frameTime = seconds < 0.0 ? 0.0 : seconds;
+}
+
+void HeadlessSetFrameLimit(int frames) {
+    platform.frameLimit = frames < 0 ? 0 : frames;
+}
+
+int HeadlessGetFrameCount(void) {
+    return platform.frameCount;
+}
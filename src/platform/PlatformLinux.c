@@ -6,14 +6,27 @@
 #include <unistd.h>
 #include <X11/keysym.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <X11/extensions/XShm.h>
 
 #include "Input.h"
 #include "Window.h"
+#include "internal/Damage.h"
+#include "internal/Profile.h"
 
 #define MAX_KEYS 256
 #define MAX_MOUSE_BUTTONS 8
 
+// Shared memory image that frames are rendered into. It can't be written while X server still reads it
+typedef struct PresentBuffer {
+    XImage* image;
+    XShmSegmentInfo shmInfo;
+    Surface surface;
+    bool pending;  // XShmPutImage was sent, but its completion event was not received yet
+    bool stale;    // other buffers were presented since this one was drawn into
+    Rect staleRect;
+} PresentBuffer;
+
 typedef struct Platform {
     Display* display;
     Window window;
@@ -21,9 +34,11 @@ typedef struct Platform {
     int shouldClose;
     Surface surface;
     Atom wmDeleteWindow;
-    XImage* image;
     GC gc;
-    XShmSegmentInfo shmInfo;
+    int completionEvent;
+    int bufferCount;
+    int current;
+    PresentBuffer buffers[WINDOW_MAX_BUFFERS];
 } Platform;
 
 typedef struct TimeHandling {
@@ -55,7 +70,7 @@ typedef struct MouseState {
     char wheelMove;    
 } MouseState;
 
-static Platform platform = { 0 };
+static Platform platform = { .bufferCount = 1 };
 static TimeHandling timeHandling = { 0 };
 static KeyboardState keys = { 0 };
 static MouseState mouse = { 0 };
@@ -283,6 +298,101 @@ bool IsCursorHidden() {
 static void InitTimer(void);
 static void FrameTick(void);
 
+static bool CreatePresentBuffer(PresentBuffer* buffer, int width, int height) {
+    buffer->image = XShmCreateImage(
+        platform.display,
+        XDefaultVisual(platform.display, platform.screen),
+        XDefaultDepth(platform.display, platform.screen),
+        ZPixmap,
+        NULL,
+        &buffer->shmInfo,
+        width,
+        height
+    );
+    if (buffer->image == NULL) return false;
+
+    buffer->shmInfo.shmid = shmget(
+        IPC_PRIVATE,
+        buffer->image->bytes_per_line * buffer->image->height,
+        IPC_CREAT | 0777
+    );
+    if (buffer->shmInfo.shmid < 0) {
+        XDestroyImage(buffer->image);
+        return false;
+    }
+    buffer->shmInfo.shmaddr = buffer->image->data = shmat(buffer->shmInfo.shmid, NULL, 0);
+    buffer->shmInfo.readOnly = False;
+    const bool attached = buffer->shmInfo.shmaddr != (char*)-1 && XShmAttach(platform.display, &buffer->shmInfo);
+    shmctl(buffer->shmInfo.shmid, IPC_RMID, 0);
+    if (!attached) {
+        if (buffer->shmInfo.shmaddr != (char*)-1) shmdt(buffer->shmInfo.shmaddr);
+        buffer->image->data = NULL;
+        XDestroyImage(buffer->image);
+        return false;
+    }
+
+    // WindowInit on X11 uses shared memory for faster displaying, so user's allocator is not used here
+    buffer->surface = (Surface){
+        .width = width,
+        .height = height,
+        .pixels = buffer->shmInfo.shmaddr,
+        .stride = buffer->image->bytes_per_line,
+        .flags = SURFACE_FLAG_NONE,
+        .format = &FORMAT_ARGB8888
+    };
+    buffer->pending = false;
+    buffer->stale = false;
+    return true;
+}
+
+static void DestroyPresentBuffer(PresentBuffer* buffer) {
+    XShmDetach(platform.display, &buffer->shmInfo);
+    // image data is shared memory, so it must not be freed by Xlib
+    buffer->image->data = NULL;
+    XDestroyImage(buffer->image);
+    shmdt(buffer->shmInfo.shmaddr);
+}
+
+static Bool IsCompletionOf(Display* display, XEvent* event, XPointer arg) {
+    (void)display;
+    const PresentBuffer* buffer = (const PresentBuffer*)arg;
+    return event->type == platform.completionEvent &&
+           ((XShmCompletionEvent*)event)->shmseg == buffer->shmInfo.shmseg;
+}
+
+static void HandleCompletionEvent(XEvent event) {
+    const ShmSeg segment = ((XShmCompletionEvent*)&event)->shmseg;
+    for (int i = 0; i < platform.bufferCount; ++i) {
+        if (platform.buffers[i].shmInfo.shmseg == segment) {
+            platform.buffers[i].pending = false;
+        }
+    }
+}
+
+// Blocks until X server is done reading current buffer and brings it up to date with last presented frame
+static void AcquireCurrentBuffer(void) {
+    PresentBuffer* buffer = &platform.buffers[platform.current];
+    if (buffer->pending) {
+        TRACE_BEGIN();
+        XEvent event;
+        XIfEvent(platform.display, &event, IsCompletionOf, (XPointer)buffer);
+        buffer->pending = false;
+        TRACE_END("WaitForPresent", "buffer", platform.current);
+    }
+    if (buffer->stale) {
+        // newest frame is in buffer that was presented last
+        const int last = (platform.current + platform.bufferCount - 1) % platform.bufferCount;
+        const Surface from = platform.buffers[last].surface;
+        const Rect* rect = &buffer->staleRect;
+        const int rowSize = rect->width * from.format->bytesPerPixel;
+        for (int y = rect->y; y < rect->y + rect->height; ++y) {
+            const size_t offset = (size_t)y * from.stride + (size_t)rect->x * from.format->bytesPerPixel;
+            memcpy((uint8_t*)buffer->surface.pixels + offset, (const uint8_t*)from.pixels + offset, rowSize);
+        }
+        buffer->stale = false;
+    }
+}
+
 Surface WindowInit(int width, int height, const char* title) {
     if (width <= 0 || height <= 0 || title == NULL) return (Surface){ 0 };
 
@@ -290,6 +400,11 @@ Surface WindowInit(int width, int height, const char* title) {
     if (platform.display == NULL) {
         return (Surface){ 0 };
     }
+    if (!XShmQueryExtension(platform.display)) {
+        XCloseDisplay(platform.display);
+        platform.display = NULL;
+        return (Surface){ 0 };
+    }
     platform.screen = XDefaultScreen(platform.display);
 
     platform.window = XCreateSimpleWindow(
@@ -313,39 +428,26 @@ Surface WindowInit(int width, int height, const char* title) {
     platform.wmDeleteWindow = XInternAtom(platform.display, "WM_DELETE_WINDOW", False);
     XSetWMProtocols(platform.display, platform.window, &platform.wmDeleteWindow, 1);
 
-    platform.image = XShmCreateImage(
-        platform.display,
-        XDefaultVisual(platform.display, platform.screen),
-        XDefaultDepth(platform.display, platform.screen),
-        ZPixmap,
-        NULL,
-        &platform.shmInfo,
-        width,
-        height
-    );
     platform.gc = XCreateGC(platform.display, platform.window, 0, NULL);
-
-    // WindowInit on X11 uses shared memory for faster displaying, so user's allocator is not used here
-    Surface surface = {
-        .width = width,
-        .height = height,
-        .pixels = NULL,
-        .stride = width * FORMAT_ARGB8888.bytesPerPixel,
-        .flags = SURFACE_FLAG_NONE,
-        .format = &FORMAT_ARGB8888
-    };
-    platform.surface = surface;
-    platform.shmInfo.shmid = shmget(
-        IPC_PRIVATE,
-        platform.image->bytes_per_line * platform.image->height,
-        IPC_CREAT | 0777
-    );
-    platform.shmInfo.shmaddr =
-        platform.image->data =
-        platform.surface.pixels = shmat(platform.shmInfo.shmid, NULL, 0);
-    platform.shmInfo.readOnly = False;
-    XShmAttach(platform.display, &platform.shmInfo);
-    shmctl(platform.shmInfo.shmid, IPC_RMID, 0);
+    platform.completionEvent = XShmGetEventBase(platform.display) + ShmCompletion;
+
+    for (int i = 0; i < platform.bufferCount; ++i) {
+        if (!CreatePresentBuffer(&platform.buffers[i], width, height)) {
+            // fewer buffers only means less overlap between rendering and presenting
+            if (i == 0) {
+                // closing display frees window and GC too
+                XCloseDisplay(platform.display);
+                platform.display = NULL;
+                return (Surface){ 0 };
+            }
+            platform.bufferCount = i;
+            break;
+        }
+    }
+    platform.current = 0;
+    platform.surface = platform.buffers[0].surface;
+    DamageSetTarget(&platform.surface);
+    DamageAddFull();
 
     XMapWindow(platform.display, platform.window);
 
@@ -355,8 +457,12 @@ Surface WindowInit(int width, int height, const char* title) {
 }
 
 void WindowDestroy() {
-    XShmDetach(platform.display, &platform.shmInfo);
-    shmdt(platform.shmInfo.shmaddr);
+    DamageSetTarget(NULL);
+    // X server must not read segments that are about to be detached
+    XSync(platform.display, False);
+    for (int i = 0; i < platform.bufferCount; ++i) {
+        DestroyPresentBuffer(&platform.buffers[i]);
+    }
     XUnmapWindow(platform.display, platform.window);
     XCloseDisplay(platform.display);
 }
@@ -473,27 +579,73 @@ void WindowBeginFrame() {
             case ClientMessage: {
                 HandleClientMessageEvent(event);
             } break;
-            default: break;
+            case Expose: {
+                DamageAddFull();
+            } break;
+            default: {
+                if (event.type == platform.completionEvent) HandleCompletionEvent(event);
+            } break;
         }
     }
+
+    AcquireCurrentBuffer();
 }
 
-void WindowEndFrame() {
-    XShmPutImage(
-        platform.display,
-        platform.window,
-        platform.gc,
-        platform.image,
-        0, 0,
-        0, 0,
-        platform.surface.width,
-        platform.surface.height,
-        False
-    );
+void WindowSetBufferCount(int count) {
+    // buffers are created by WindowInit
+    if (platform.display != NULL) return;
+    platform.bufferCount = count < 1 ? 1 : count > WINDOW_MAX_BUFFERS ? WINDOW_MAX_BUFFERS : count;
+}
 
-    XSync(platform.display, False);
+Surface WindowGetSurface(void) {
+    return platform.surface;
+}
+
+void WindowEndFrame() {
+    PROFILE_BEGIN();
+    Rect rects[DAMAGE_MAX_RECTS];
+    const int count = DamageCollect(rects, DAMAGE_MAX_RECTS);
+
+    if (count > 0) {
+        PresentBuffer* buffer = &platform.buffers[platform.current];
+        for (int i = 0; i < count; ++i) {
+            PROFILE_PIXELS((long long)rects[i].width * rects[i].height);
+            // only last request reports completion, X server handles requests in order
+            XShmPutImage(
+                platform.display,
+                platform.window,
+                platform.gc,
+                buffer->image,
+                rects[i].x, rects[i].y,
+                rects[i].x, rects[i].y,
+                rects[i].width,
+                rects[i].height,
+                i == count - 1
+            );
+        }
+        buffer->pending = true;
+        XFlush(platform.display);
+
+        if (platform.bufferCount > 1) {
+            // without damage tracking every frame is drawn and presented whole, so copying it to other buffers
+            // would be wasted
+            for (int i = 0; i < platform.bufferCount; ++i) {
+                if (i == platform.current || !DamageIsEnabled()) continue;
+                PresentBuffer* other = &platform.buffers[i];
+                for (int j = 0; j < count; ++j) {
+                    other->staleRect = other->stale ? RectUnion(&other->staleRect, &rects[j]) : rects[j];
+                    other->stale = true;
+                }
+            }
+            platform.current = (platform.current + 1) % platform.bufferCount;
+            platform.surface = platform.buffers[platform.current].surface;
+            DamageSetTarget(&platform.surface);
+        }
+    }
+    PROFILE_END(PROFILE_ZONE_WINDOW_END_FRAME);
 
     FrameTick();
+    ProfilerNextFrame();
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -6,6 +6,7 @@
 
 #include "Input.h"
 #include "Window.h"
+#include "internal/Profile.h"
 
 #define MAX_KEYS 256
 #define MAX_MOUSE_BUTTONS 8
@@ -428,7 +429,17 @@ void WindowBeginFrame() {
     }
 }
 
+void WindowSetBufferCount(int count) {
+    (void)count;
+}
+
+Surface WindowGetSurface(void) {
+    return platform.surface;
+}
+
 void WindowEndFrame() {
+    PROFILE_BEGIN();
+    PROFILE_PIXELS((long long)platform.surface.width * platform.surface.height);
     HDC dc = GetDC(platform.hwnd);
 
     StretchDIBits(dc,
@@ -441,8 +452,10 @@ void WindowEndFrame() {
     );
 
     ReleaseDC(platform.hwnd, dc);
+    PROFILE_END(PROFILE_ZONE_WINDOW_END_FRAME);
 
     FrameTick();
+    ProfilerNextFrame();
 }
 
 // --------------------------------------------------------------------------------------------------------------------
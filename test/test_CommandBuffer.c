@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Color.h"
+#include "CommandBuffer.h"
+#include "Draw.h"
+#include "FillRect.h"
+#include "PixelFormat.h"
+#include "Surface.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Convert.c")
+TEST_SOURCE_FILE("Cpu.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("RowKernels.c")
+TEST_SOURCE_FILE("Scanline.c")
+TEST_SOURCE_FILE("ThreadPool.c")
+
+#define WIDTH 203
+#define HEIGHT 141
+#define SHAPES 300
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static Color RandomColor(bool opaque) {
+    const Color color = { rand() & 0xFF, rand() & 0xFF, rand() & 0xFF, opaque ? 255 : rand() & 0xFF };
+    return color;
+}
+
+static int RandomCoord(int size) {
+    return rand() % (size + 60) - 30;
+}
+
+// Draws the same random scene immediately onto expected and through the command buffer onto actual
+static void DrawScene(Surface expected, Surface actual, Surface sprite, CommandBuffer* buffer, unsigned seed) {
+    srand(seed);
+    for (int i = 0; i < SHAPES; ++i) {
+        const int x1 = RandomCoord(WIDTH), y1 = RandomCoord(HEIGHT);
+        const int x2 = RandomCoord(WIDTH), y2 = RandomCoord(HEIGHT);
+        const int x3 = RandomCoord(WIDTH), y3 = RandomCoord(HEIGHT);
+        const Color color = RandomColor(rand() & 1);
+
+        switch (rand() % 6) {
+            case 0: {
+                const Rect rect = { x1, y1, rand() % 80, rand() % 80 };
+                const uint32_t pixel = ColorToPixel(expected.format, color);
+                FillRect(expected, &rect, pixel);
+                CommandBufferFillRect(buffer, &rect, pixel);
+            } break;
+            case 1: {
+                DrawRect(expected, x1, y1, x2 / 2, y2 / 2, color);
+                CommandBufferDrawRect(buffer, x1, y1, x2 / 2, y2 / 2, color);
+            } break;
+            case 2: {
+                DrawCircle(expected, x1, y1, x2 % 70, color);
+                CommandBufferDrawCircle(buffer, x1, y1, x2 % 70, color);
+            } break;
+            case 3: {
+                DrawTriangle(expected, x1, y1, x2, y2, x3, y3, color);
+                CommandBufferDrawTriangle(buffer, x1, y1, x2, y2, x3, y3, color);
+            } break;
+            case 4: {
+                DrawLine(expected, x1, y1, x2, y2, color);
+                CommandBufferDrawLine(buffer, x1, y1, x2, y2, color);
+            } break;
+            case 5: {
+                SurfaceBlit(expected, sprite, x1, y1);
+                CommandBufferBlit(buffer, sprite, x1, y1);
+            } break;
+            default: break;
+        }
+    }
+    CommandBufferSubmit(buffer, actual);
+}
+
+static void AssertSameAsImmediate(const PixelFormat* format, int threadCount) {
+    Surface expected = SurfaceCreate(WIDTH, HEIGHT, format);
+    Surface actual = SurfaceCreate(WIDTH, HEIGHT, format);
+    Surface sprite = SurfaceCreate(37, 29, &FORMAT_RGBA8888);
+    for (int i = 0; i < sprite.width * sprite.height; ++i) {
+        ((uint32_t*)sprite.pixels)[i] = ColorToPixel(sprite.format, RandomColor(i & 1));
+    }
+    CommandBuffer buffer = CommandBufferCreate(threadCount);
+
+    DrawScene(expected, actual, sprite, &buffer, 7);
+    TEST_ASSERT_EQUAL(0, memcmp(expected.pixels, actual.pixels, expected.stride * expected.height));
+    TEST_ASSERT_EQUAL(0, buffer.count);
+
+    CommandBufferDestroy(&buffer);
+    SurfaceDestroy(&sprite);
+    SurfaceDestroy(&expected);
+    SurfaceDestroy(&actual);
+}
+
+void test_CommandBufferShouldMatchImmediateModeOnOneThread() {
+    AssertSameAsImmediate(&FORMAT_ARGB8888, 1);
+}
+
+void test_CommandBufferShouldMatchImmediateModeOnManyThreads() {
+    AssertSameAsImmediate(&FORMAT_ARGB8888, 4);
+    AssertSameAsImmediate(&FORMAT_RGB565, 3);
+    AssertSameAsImmediate(&FORMAT_RGB332, 0);
+}
+
+void test_CommandsOutsideTargetShouldBeSkipped() {
+    Surface surface = SurfaceCreate(10, 10, &FORMAT_ARGB8888);
+    CommandBuffer buffer = CommandBufferCreate(2);
+
+    CommandBufferDrawRect(&buffer, 20, 0, 5, 5, RED);
+    CommandBufferDrawCircle(&buffer, -50, -50, 10, RED);
+    CommandBufferSubmit(&buffer, surface);
+
+    for (int i = 0; i < 100; ++i) {
+        TEST_ASSERT_EQUAL_HEX32(0, ((uint32_t*)surface.pixels)[i]);
+    }
+
+    CommandBufferDestroy(&buffer);
+    SurfaceDestroy(&surface);
+}
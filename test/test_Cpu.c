@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Color.h"
+#include "Cpu.h"
+#include "FillRect.h"
+#include "PixelFormat.h"
+#include "Rect.h"
+#include "Surface.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("RowKernels.c")
+
+#define WIDTH 37
+#define HEIGHT 5
+
+void setUp(void) {}
+void tearDown(void) {
+    CpuForceSimdLevel(SIMD_LEVEL_AUTO);
+}
+
+static void FillRandom(Surface surface, unsigned seed) {
+    srand(seed);
+    uint8_t* bytes = surface.pixels;
+    for (int i = 0; i < surface.stride * surface.height; ++i) {
+        bytes[i] = (uint8_t)rand();
+    }
+    // make sure that fully transparent and fully opaque pixels are present too
+    ((uint32_t*)surface.pixels)[0] = 0;
+    ((uint32_t*)surface.pixels)[1] = 0xFFFFFFFF;
+}
+
+// Blits random src onto random dest at every supported level and compares results with scalar one
+static void AssertBlitSameOnAllLevels(const PixelFormat* destFormat, const PixelFormat* srcFormat, bool alpha) {
+    Surface src = SurfaceCreate(WIDTH, HEIGHT, srcFormat);
+    Surface expected = SurfaceCreate(WIDTH + 3, HEIGHT, destFormat);
+    Surface actual = SurfaceCreate(WIDTH + 3, HEIGHT, destFormat);
+    FillRandom(src, 1);
+    if (!alpha) src.flags &= ~SURFACE_FLAG_HAS_ALPHA;
+
+    FillRandom(expected, 2);
+    CpuForceSimdLevel(SIMD_LEVEL_SCALAR);
+    SurfaceBlit(expected, src, 1, 0);
+
+    for (SimdLevel level = SIMD_LEVEL_SSE2; level <= CpuDetectSimdLevel(); ++level) {
+        FillRandom(actual, 2);
+        CpuForceSimdLevel(level);
+        SurfaceBlit(actual, src, 1, 0);
+        TEST_ASSERT_EQUAL_MESSAGE(0, memcmp(expected.pixels, actual.pixels, expected.stride * expected.height),
+                                  SimdLevelName(level));
+    }
+
+    SurfaceDestroy(&src);
+    SurfaceDestroy(&expected);
+    SurfaceDestroy(&actual);
+}
+
+void test_ForcedLevelShouldBeClampedToDetectedOne() {
+    CpuForceSimdLevel(SIMD_LEVEL_SCALAR);
+    TEST_ASSERT_EQUAL(SIMD_LEVEL_SCALAR, CpuGetSimdLevel());
+
+    CpuForceSimdLevel(SIMD_LEVEL_AVX2);
+    TEST_ASSERT_EQUAL(CpuDetectSimdLevel(), CpuGetSimdLevel());
+
+    CpuForceSimdLevel(SIMD_LEVEL_AUTO);
+    TEST_ASSERT_EQUAL(CpuDetectSimdLevel(), CpuGetSimdLevel());
+}
+
+void test_AlphaBlitShouldBeSameOnAllLevels() {
+    AssertBlitSameOnAllLevels(&FORMAT_RGBA8888, &FORMAT_RGBA8888, true);
+    AssertBlitSameOnAllLevels(&FORMAT_ARGB8888, &FORMAT_ARGB8888, true);
+}
+
+void test_ConvertingAlphaBlitShouldBeSameOnAllLevels() {
+    AssertBlitSameOnAllLevels(&FORMAT_ARGB8888, &FORMAT_RGBA8888, true);
+    AssertBlitSameOnAllLevels(&FORMAT_ABGR8888, &FORMAT_BGRA8888, true);
+}
+
+void test_ConvertingBlitShouldBeSameOnAllLevels() {
+    AssertBlitSameOnAllLevels(&FORMAT_ARGB8888, &FORMAT_RGBA8888, false);
+    AssertBlitSameOnAllLevels(&FORMAT_BGRA8888, &FORMAT_ABGR8888, false);
+}
+
+void test_BlendFillShouldBeSameOnAllLevels() {
+    Surface expected = SurfaceCreate(WIDTH, HEIGHT, &FORMAT_ARGB8888);
+    Surface actual = SurfaceCreate(WIDTH, HEIGHT, &FORMAT_ARGB8888);
+    const Rect rect = { 3, 1, WIDTH - 4, HEIGHT - 2 };
+    const Color color = { 0x12, 0x80, 0xF0, 0x6C };
+
+    FillRandom(expected, 3);
+    CpuForceSimdLevel(SIMD_LEVEL_SCALAR);
+    BlendFillRect(expected, &rect, color);
+
+    for (SimdLevel level = SIMD_LEVEL_SSE2; level <= CpuDetectSimdLevel(); ++level) {
+        FillRandom(actual, 3);
+        CpuForceSimdLevel(level);
+        BlendFillRect(actual, &rect, color);
+        TEST_ASSERT_EQUAL_MESSAGE(0, memcmp(expected.pixels, actual.pixels, expected.stride * expected.height),
+                                  SimdLevelName(level));
+    }
+
+    SurfaceDestroy(&expected);
+    SurfaceDestroy(&actual);
+}
+
+void test_PremultipliedAlphaBlitShouldBeSameOnAllLevels() {
+    AssertBlitSameOnAllLevels(&FORMAT_ARGB8888_PREMUL, &FORMAT_ARGB8888_PREMUL, true);
+    AssertBlitSameOnAllLevels(&FORMAT_RGBA8888_PREMUL, &FORMAT_RGBA8888_PREMUL, true);
+}
+
+void test_PremultipliedBlendFillShouldBeSameOnAllLevels() {
+    Surface expected = SurfaceCreate(WIDTH, HEIGHT, &FORMAT_ABGR8888_PREMUL);
+    Surface actual = SurfaceCreate(WIDTH, HEIGHT, &FORMAT_ABGR8888_PREMUL);
+    const Rect rect = { 0, 0, WIDTH, HEIGHT };
+    const Color color = { 0xF0, 0x40, 0x99, 0x80 };
+
+    FillRandom(expected, 4);
+    CpuForceSimdLevel(SIMD_LEVEL_SCALAR);
+    BlendFillRect(expected, &rect, color);
+
+    for (SimdLevel level = SIMD_LEVEL_SSE2; level <= CpuDetectSimdLevel(); ++level) {
+        FillRandom(actual, 4);
+        CpuForceSimdLevel(level);
+        BlendFillRect(actual, &rect, color);
+        TEST_ASSERT_EQUAL_MESSAGE(0, memcmp(expected.pixels, actual.pixels, expected.stride * expected.height),
+                                  SimdLevelName(level));
+    }
+
+    SurfaceDestroy(&expected);
+    SurfaceDestroy(&actual);
+}
@@ -0,0 +1,120 @@
+#include "FillRect.h"
+#include "PixelFormat.h"
+#include "Rect.h"
+#include "Surface.h"
+#include "Window.h"
+#include "internal/Damage.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("Rect.c")
+
+#define WIDTH 100
+#define HEIGHT 50
+
+static Surface window;
+static Rect rects[DAMAGE_MAX_RECTS];
+
+void setUp(void) {
+    window = SurfaceCreate(WIDTH, HEIGHT, &FORMAT_ARGB8888);
+    DamageSetTarget(&window);
+    WindowSetDamageTracking(true);
+    // first frame is always presented whole
+    DamageCollect(rects, DAMAGE_MAX_RECTS);
+}
+
+void tearDown(void) {
+    WindowSetDamageTracking(false);
+    DamageSetTarget(NULL);
+    SurfaceDestroy(&window);
+}
+
+static void AssertRect(Rect expected, Rect actual) {
+    TEST_ASSERT_EQUAL(expected.x, actual.x);
+    TEST_ASSERT_EQUAL(expected.y, actual.y);
+    TEST_ASSERT_EQUAL(expected.width, actual.width);
+    TEST_ASSERT_EQUAL(expected.height, actual.height);
+}
+
+void test_UnchangedFrameShouldHaveNoDamage() {
+    TEST_ASSERT_EQUAL(0, DamageCollect(rects, DAMAGE_MAX_RECTS));
+}
+
+void test_DisabledTrackingShouldPresentWholeFrame() {
+    WindowSetDamageTracking(false);
+
+    TEST_ASSERT_EQUAL(1, DamageCollect(rects, DAMAGE_MAX_RECTS));
+    AssertRect((Rect){ 0, 0, WIDTH, HEIGHT }, rects[0]);
+}
+
+void test_FillShouldDamageClippedRect() {
+    FillRect(window, &(Rect){ -5, 40, 20, 20 }, 0);
+
+    TEST_ASSERT_EQUAL(1, DamageCollect(rects, DAMAGE_MAX_RECTS));
+    AssertRect((Rect){ 0, 40, 15, 10 }, rects[0]);
+    TEST_ASSERT_EQUAL(0, DamageCollect(rects, DAMAGE_MAX_RECTS));
+}
+
+void test_SubsurfaceDamageShouldBeInWindowCoordinates() {
+    const Surface sub = SurfaceGetSubsurface(window, (Rect){ 30, 20, 10, 10 });
+    FillRect(sub, &(Rect){ 2, 3, 4, 5 }, 0);
+
+    TEST_ASSERT_EQUAL(1, DamageCollect(rects, DAMAGE_MAX_RECTS));
+    AssertRect((Rect){ 32, 23, 4, 5 }, rects[0]);
+}
+
+void test_OtherSurfacesShouldNotBeTracked() {
+    Surface other = SurfaceCreate(10, 10, &FORMAT_ARGB8888);
+    FillRect(other, &(Rect){ 0, 0, 10, 10 }, 0);
+    SurfaceDestroy(&other);
+
+    TEST_ASSERT_EQUAL(0, DamageCollect(rects, DAMAGE_MAX_RECTS));
+}
+
+void test_AdjacentAndContainedRectsShouldBeMerged() {
+    WindowMarkDirty((Rect){ 10, 10, 10, 5 });
+    WindowMarkDirty((Rect){ 20, 10, 10, 5 });
+    WindowMarkDirty((Rect){ 12, 11, 3, 3 });
+    WindowMarkDirty((Rect){ 60, 30, 5, 5 });
+
+    TEST_ASSERT_EQUAL(2, DamageCollect(rects, DAMAGE_MAX_RECTS));
+    AssertRect((Rect){ 10, 10, 20, 5 }, rects[0]);
+    AssertRect((Rect){ 60, 30, 5, 5 }, rects[1]);
+}
+
+void test_TooManyRectsShouldBeMergedIntoAvailableSlots() {
+    for (int i = 0; i < DAMAGE_MAX_RECTS + 4; ++i) {
+        WindowMarkDirty((Rect){ (i % 10) * 10, (i / 10) * 10, 1, 1 });
+    }
+
+    const int count = DamageCollect(rects, DAMAGE_MAX_RECTS);
+    TEST_ASSERT_TRUE(count > 1 && count <= DAMAGE_MAX_RECTS);
+    for (int i = 0; i < DAMAGE_MAX_RECTS + 4; ++i) {
+        const Rect pixel = { (i % 10) * 10, (i / 10) * 10, 1, 1 };
+        bool covered = false;
+        for (int j = 0; j < count; ++j) {
+            Rect common;
+            covered |= RectIntersection(&rects[j], &pixel, &common);
+        }
+        TEST_ASSERT_TRUE(covered);
+    }
+}
+
+void test_LargeDamageShouldPresentWholeFrame() {
+    WindowMarkDirty((Rect){ 0, 0, WIDTH, HEIGHT / 2 });
+    WindowMarkDirty((Rect){ 0, HEIGHT - 10, WIDTH / 2, 10 });
+    WindowMarkDirty((Rect){ WIDTH - 10, HEIGHT - 10, 10, 10 });
+
+    TEST_ASSERT_EQUAL(1, DamageCollect(rects, DAMAGE_MAX_RECTS));
+    AssertRect((Rect){ 0, 0, WIDTH, HEIGHT }, rects[0]);
+}
+
+void test_FullDamageShouldPresentWholeFrame() {
+    WindowMarkDirty((Rect){ 1, 1, 1, 1 });
+    DamageAddFull();
+
+    TEST_ASSERT_EQUAL(1, DamageCollect(rects, DAMAGE_MAX_RECTS));
+    AssertRect((Rect){ 0, 0, WIDTH, HEIGHT }, rects[0]);
+}
@@ -0,0 +1,307 @@
+#include "Draw.h"
+#include "PixelFormat.h"
+#include "Surface.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("FillRect.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("Scanline.c")
+
+static Surface surface;
+
+void setUp(void) {
+    surface = SurfaceCreate(20, 10, &FORMAT_ARGB8888);
+}
+
+void tearDown(void) {
+    SurfaceDestroy(&surface);
+}
+
+static uint32_t GetPixel(Surface s, int x, int y) {
+    return ((uint32_t*)((uint8_t*)s.pixels + y * s.stride))[x];
+}
+
+static int CountPixels(Surface s, uint32_t pixel) {
+    int count = 0;
+    for (int y = 0; y < s.height; ++y) {
+        for (int x = 0; x < s.width; ++x) {
+            if (GetPixel(s, x, y) == pixel) ++count;
+        }
+    }
+    return count;
+}
+
+void test_LineShouldIncludeBothEndpoints() {
+    const uint32_t red = ColorToPixel(surface.format, RED);
+
+    DrawLine(surface, 2, 3, 9, 7, RED);
+
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 2, 3));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 9, 7));
+    TEST_ASSERT_EQUAL(8, CountPixels(surface, red));
+}
+
+void test_AxisAlignedLinesShouldBeSpans() {
+    const uint32_t red = ColorToPixel(surface.format, RED);
+
+    DrawLine(surface, 15, 1, 3, 1, RED);
+    DrawLine(surface, 0, 9, 0, 4, RED);
+    DrawLine(surface, 5, 5, 5, 5, RED);
+
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 3, 1));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 15, 1));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 0, 4));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 5, 5));
+    TEST_ASSERT_EQUAL(13 + 6 + 1, CountPixels(surface, red));
+}
+
+void test_ClippedLineShouldMatchUnclippedOne() {
+    const int lines[][4] = {
+        { -50, -20, 70, 33 }, { 25, -3, -4, 12 }, { 3, 40, 17, -31 }, { -7, 9, 26, 8 }, { 19, 0, -1, 10 },
+    };
+    Surface big = SurfaceCreate(200, 100, &FORMAT_ARGB8888);
+    const int offsetX = 90;
+    const int offsetY = 45;
+
+    for (int i = 0; i < (int)(sizeof(lines) / sizeof(lines[0])); ++i) {
+        const int* l = lines[i];
+        DrawLine(surface, l[0], l[1], l[2], l[3], BLUE);
+        DrawLine(big, l[0] + offsetX, l[1] + offsetY, l[2] + offsetX, l[3] + offsetY, BLUE);
+    }
+
+    for (int y = 0; y < surface.height; ++y) {
+        for (int x = 0; x < surface.width; ++x) {
+            TEST_ASSERT_EQUAL_HEX32(GetPixel(big, x + offsetX, y + offsetY), GetPixel(surface, x, y));
+        }
+    }
+    SurfaceDestroy(&big);
+}
+
+void test_LineOutsideSurfaceShouldDrawNothing() {
+    DrawLine(surface, -10, -10, 30, -1, RED);
+    DrawLine(surface, 25, 0, 40, 9, RED);
+
+    TEST_ASSERT_EQUAL(0, CountPixels(surface, ColorToPixel(surface.format, RED)));
+}
+
+void test_AntiAliasedLineOnPixelRowShouldCoverItFully() {
+    const uint32_t white = ColorToPixel(surface.format, WHITE);
+
+    DrawLineAA(surface, 1.0f, 2.0f, 8.0f, 2.0f, WHITE);
+
+    for (int x = 2; x < 8; ++x) {
+        TEST_ASSERT_EQUAL_HEX32(white, GetPixel(surface, x, 2));
+        TEST_ASSERT_EQUAL_HEX32(0, GetPixel(surface, x, 1));
+        TEST_ASSERT_EQUAL_HEX32(0, GetPixel(surface, x, 3));
+    }
+}
+
+void test_AntiAliasedLineBetweenRowsShouldSplitCoverage() {
+    DrawLineAA(surface, 1.0f, 2.5f, 8.0f, 2.5f, WHITE);
+
+    for (int x = 2; x < 8; ++x) {
+        const Color upper = PixelToColor(surface.format, GetPixel(surface, x, 2));
+        const Color lower = PixelToColor(surface.format, GetPixel(surface, x, 3));
+        TEST_ASSERT_INT_WITHIN(2, 128, upper.r);
+        TEST_ASSERT_INT_WITHIN(2, 128, lower.r);
+    }
+}
+
+void test_AntiAliasedSteepLineShouldBeClippedToSurface() {
+    const uint32_t white = ColorToPixel(surface.format, WHITE);
+
+    DrawLineAA(surface, 4.0f, -100.0f, 4.0f, 100.0f, WHITE);
+    DrawLineAA(surface, -30.0f, -30.0f, -5.0f, 50.0f, WHITE);
+
+    for (int y = 0; y < surface.height; ++y) {
+        TEST_ASSERT_EQUAL_HEX32(white, GetPixel(surface, 4, y));
+    }
+    TEST_ASSERT_EQUAL(surface.height, CountPixels(surface, white));
+}
+
+void test_ThickLineShouldCoverPixelCentersInsideStroke() {
+    const uint32_t red = ColorToPixel(surface.format, RED);
+    const Point points[] = { { 2.0f, 4.0f }, { 10.0f, 4.0f } };
+    StrokeStyle style = { 3.0f, LINE_JOIN_MITER, LINE_CAP_BUTT, 4.0f };
+
+    DrawPolyline(surface, points, 2, false, &style, RED);
+    TEST_ASSERT_EQUAL(8 * 3, CountPixels(surface, red));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 2, 3));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 9, 5));
+
+    style.cap = LINE_CAP_SQUARE;
+    DrawPolyline(surface, points, 2, false, &style, RED);
+    TEST_ASSERT_EQUAL(11 * 3, CountPixels(surface, red));
+}
+
+void test_StrokeWithFarOffSurfacePointShouldCoverOnlyItsPixels() {
+    const uint32_t red = ColorToPixel(surface.format, RED);
+    const Point points[] = { { -50000.0f, 4.0f }, { 10.0f, 4.0f }, { 10.0f, 50000.0f } };
+    const StrokeStyle style = { 3.0f, LINE_JOIN_BEVEL, LINE_CAP_BUTT, 4.0f };
+
+    DrawPolyline(surface, points, 2, false, &style, RED);
+    TEST_ASSERT_EQUAL(10 * 3, CountPixels(surface, red));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 0, 3));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 9, 5));
+
+    // same stroke with points close to surface
+    const Point near[] = { { -10.0f, 4.0f }, { 10.0f, 4.0f }, { 10.0f, 20.0f } };
+    SurfaceFill(surface, BLACK);
+    DrawPolyline(surface, near, 3, false, &style, RED);
+    const int expected = CountPixels(surface, red);
+    SurfaceFill(surface, BLACK);
+    DrawPolyline(surface, points, 3, false, &style, RED);
+    TEST_ASSERT_EQUAL(expected, CountPixels(surface, red));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 10, 9));
+}
+
+void test_TranslucentStrokeShouldBlendEveryPixelOnce() {
+    const Point points[] = { { 1.0f, 1.0f }, { 9.0f, 8.0f }, { 12.0f, 1.5f }, { 18.0f, 8.0f }, { 12.5f, 8.0f } };
+    const LineJoin joins[] = { LINE_JOIN_MITER, LINE_JOIN_ROUND, LINE_JOIN_BEVEL };
+
+    for (int i = 0; i < 3; ++i) {
+        SurfaceFill(surface, BLACK);
+        const StrokeStyle style = { 2.5f, joins[i], LINE_CAP_ROUND, 4.0f };
+        DrawPolyline(surface, points, 5, i == 2, &style, (Color){ 0xFF, 0xFF, 0xFF, 0x80 });
+
+        const uint32_t blended = GetPixel(surface, 5, 4);
+        TEST_ASSERT_NOT_EQUAL(0xFF000000, blended);
+        for (int y = 0; y < surface.height; ++y) {
+            for (int x = 0; x < surface.width; ++x) {
+                const uint32_t pixel = GetPixel(surface, x, y);
+                TEST_ASSERT_TRUE(pixel == 0xFF000000 || pixel == blended);
+            }
+        }
+    }
+}
+
+void test_ClosedOutlineShouldLeaveInteriorEmpty() {
+    const uint32_t green = ColorToPixel(surface.format, GREEN);
+    const Point points[] = { { 2.0f, 2.0f }, { 12.0f, 2.0f }, { 12.0f, 7.0f }, { 2.0f, 7.0f } };
+    const StrokeStyle style = { 1.0f, LINE_JOIN_MITER, LINE_CAP_BUTT, 4.0f };
+
+    DrawPolyline(surface, points, 4, true, &style, GREEN);
+
+    TEST_ASSERT_EQUAL_HEX32(green, GetPixel(surface, 2, 2));
+    TEST_ASSERT_EQUAL_HEX32(green, GetPixel(surface, 12, 7));
+    TEST_ASSERT_EQUAL_HEX32(0, GetPixel(surface, 7, 4));
+    TEST_ASSERT_EQUAL(2 * 11 + 2 * 4, CountPixels(surface, green));
+}
+
+void test_ConcavePolygonShouldFillPixelCentersInside() {
+    const uint32_t blue = ColorToPixel(surface.format, BLUE);
+    const Point points[] = { { 2.0f, 1.0f }, { 5.0f, 1.0f }, { 5.0f, 6.0f }, { 9.0f, 6.0f }, { 9.0f, 8.0f }, { 2.0f, 8.0f } };
+
+    DrawPolygon(surface, points, 6, FILL_RULE_NON_ZERO, BLUE);
+
+    TEST_ASSERT_EQUAL(3 * 5 + 7 * 2, CountPixels(surface, blue));
+    TEST_ASSERT_EQUAL_HEX32(blue, GetPixel(surface, 2, 1));
+    TEST_ASSERT_EQUAL_HEX32(blue, GetPixel(surface, 8, 7));
+    TEST_ASSERT_EQUAL_HEX32(0, GetPixel(surface, 5, 5));
+}
+
+void test_FillRuleShouldDecideAboutOverlappingParts() {
+    const uint32_t blue = ColorToPixel(surface.format, BLUE);
+    // square going around twice
+    const Point points[] = {
+        { 2.0f, 2.0f }, { 8.0f, 2.0f }, { 8.0f, 8.0f }, { 2.0f, 8.0f },
+        { 2.0f, 2.0f }, { 8.0f, 2.0f }, { 8.0f, 8.0f }, { 2.0f, 8.0f },
+    };
+
+    DrawPolygon(surface, points, 8, FILL_RULE_EVEN_ODD, BLUE);
+    TEST_ASSERT_EQUAL(0, CountPixels(surface, blue));
+
+    DrawPolygon(surface, points, 8, FILL_RULE_NON_ZERO, BLUE);
+    TEST_ASSERT_EQUAL(6 * 6, CountPixels(surface, blue));
+}
+
+void test_PentagramCenterShouldBeHoleOnlyWithEvenOddRule() {
+    Surface big = SurfaceCreate(40, 40, &FORMAT_ARGB8888);
+    const uint32_t blue = ColorToPixel(big.format, BLUE);
+    const Point points[] = { { 20.0f, 1.0f }, { 31.0f, 36.0f }, { 2.0f, 14.0f }, { 38.0f, 14.0f }, { 9.0f, 36.0f } };
+
+    DrawPolygon(big, points, 5, FILL_RULE_EVEN_ODD, BLUE);
+    TEST_ASSERT_EQUAL_HEX32(0, GetPixel(big, 20, 20));
+    TEST_ASSERT_EQUAL_HEX32(blue, GetPixel(big, 20, 8));
+
+    DrawPolygon(big, points, 5, FILL_RULE_NON_ZERO, BLUE);
+    TEST_ASSERT_EQUAL_HEX32(blue, GetPixel(big, 20, 20));
+
+    SurfaceDestroy(&big);
+}
+
+void test_PolygonPartlyOutsideShouldBeClipped() {
+    const uint32_t blue = ColorToPixel(surface.format, BLUE);
+    const Point points[] = { { -100.0f, -100.0f }, { 100.0f, -100.0f }, { 100.0f, 100.0f }, { -100.0f, 100.0f } };
+
+    DrawPolygon(surface, points, 4, FILL_RULE_EVEN_ODD, BLUE);
+
+    TEST_ASSERT_EQUAL(surface.width * surface.height, CountPixels(surface, blue));
+}
+
+void test_PolygonWithFarOffSurfaceVertexShouldStillCoverSurface() {
+    const uint32_t blue = ColorToPixel(surface.format, BLUE);
+    const Point points[] = { { -50000.0f, 5.0f }, { 40.0f, -30.0f }, { 40.0f, 40.0f } };
+
+    DrawPolygon(surface, points, 3, FILL_RULE_NON_ZERO, BLUE);
+    TEST_ASSERT_EQUAL(surface.width * surface.height, CountPixels(surface, blue));
+
+    // edge from far vertex passes through surface
+    const Point sliver[] = { { -50000.0f, -50000.0f }, { 19.5f, 9.5f }, { 40.0f, 0.0f } };
+    SurfaceFill(surface, BLACK);
+    DrawPolygon(surface, sliver, 3, FILL_RULE_EVEN_ODD, BLUE);
+    TEST_ASSERT_EQUAL(10 + 9 + 8 + 7 + 6 + 5 + 4 + 3 + 2 + 1, CountPixels(surface, blue));
+    TEST_ASSERT_EQUAL_HEX32(blue, GetPixel(surface, 10, 0));
+    TEST_ASSERT_EQUAL_HEX32(blue, GetPixel(surface, 19, 9));
+    TEST_ASSERT_NOT_EQUAL(blue, GetPixel(surface, 9, 0));
+}
+
+void test_TriangleShouldSkipPixelsOnRightAndBottomEdges() {
+    const uint32_t red = ColorToPixel(surface.format, RED);
+
+    DrawTriangle(surface, 0, 0, 4, 0, 0, 4, RED);
+
+    TEST_ASSERT_EQUAL(4 + 3 + 2 + 1, CountPixels(surface, red));
+    TEST_ASSERT_EQUAL_HEX32(red, GetPixel(surface, 3, 0));
+    TEST_ASSERT_EQUAL_HEX32(0, GetPixel(surface, 4, 0));
+    TEST_ASSERT_EQUAL_HEX32(0, GetPixel(surface, 0, 4));
+}
+
+void test_TriangleFanShouldBlendEveryPixelOnce() {
+    // fan around a shared vertex, both windings and edges between pixel centers
+    const Point points[] = { { 1.3f, 0.7f }, { 17.6f, 1.2f }, { 18.4f, 8.9f }, { 0.2f, 9.1f } };
+    const Point center = { 9.4f, 4.6f };
+    SurfaceFill(surface, BLACK);
+
+    for (int i = 0; i < 4; ++i) {
+        const Point next = points[(i + 1) % 4];
+        if (i & 1) {
+            DrawTriangleF(surface, center, points[i], next, (Color){ 0xFF, 0xFF, 0xFF, 0x80 });
+        }
+        else {
+            DrawTriangleF(surface, next, points[i], center, (Color){ 0xFF, 0xFF, 0xFF, 0x80 });
+        }
+    }
+
+    const uint32_t blended = GetPixel(surface, 9, 4);
+    TEST_ASSERT_NOT_EQUAL(0xFF000000, blended);
+    for (int y = 2; y < 9; ++y) {
+        for (int x = 2; x < 17; ++x) {
+            TEST_ASSERT_EQUAL_HEX32(blended, GetPixel(surface, x, y));
+        }
+    }
+}
+
+void test_TriangleWithoutPixelCentersInsideShouldDrawNothing() {
+    const uint32_t red = ColorToPixel(surface.format, RED);
+
+    DrawTriangleF(surface, (Point){ 2.1f, 2.1f }, (Point){ 2.9f, 2.1f }, (Point){ 2.1f, 2.9f }, RED);
+    DrawTriangle(surface, 1, 1, 5, 5, 9, 9, RED);
+    TEST_ASSERT_EQUAL(0, CountPixels(surface, red));
+
+    DrawTriangleF(surface, (Point){ 2.9f, 1.9f }, (Point){ 3.2f, 2.1f }, (Point){ 2.9f, 2.1f }, RED);
+    TEST_ASSERT_EQUAL(1, CountPixels(surface, red));
+}
@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "Allocator.h"
+#include "Surface.h"
+#include "internal/FontCache.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Convert.c")
+TEST_SOURCE_FILE("Cpu.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("FillRect.c")
+TEST_SOURCE_FILE("FontCache.c")
+TEST_SOURCE_FILE("PixelFormat.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("RowKernels.c")
+
+// Cells of 4x4 pixels, three of them fit into the budget
+#define CELL 4
+#define CAPACITY 3
+#define BUDGET (CAPACITY * CELL * CELL)
+
+// Error.c isn't linked, errors are counted here instead of ending the test
+static int errors;
+
+void ThrowError(int code, const char* file, int line) {
+    (void)code;
+    (void)file;
+    (void)line;
+    ++errors;
+}
+
+// Fails allocation number failAt and counts blocks which weren't freed yet
+static Allocator* defaultAllocator;
+static int allocations;
+static int failAt;
+static int live;
+
+static void* TestAlloc(size_t bytes, void* user) {
+    (void)user;
+    if (allocations++ == failAt) return NULL;
+    ++live;
+    return defaultAllocator->alloc(bytes, defaultAllocator->user);
+}
+
+static void TestFree(void* ptr, void* user) {
+    (void)user;
+    if (ptr != NULL) --live;
+    defaultAllocator->free(ptr, defaultAllocator->user);
+}
+
+static Allocator testAllocator = { TestAlloc, TestFree, NULL };
+
+static GlyphCache* cache;
+static ShapeCache shapes;
+
+void setUp(void) {
+    errors = 0;
+    allocations = 0;
+    failAt = -1;
+    live = 0;
+    defaultAllocator = AllocatorGet();
+    AllocatorSetGlobal(&testAllocator);
+    cache = GlyphCacheCreate(CELL, CELL, BUDGET);
+    ShapeCacheInit(&shapes);
+}
+
+void tearDown(void) {
+    GlyphCacheDestroy(cache);
+    ShapeCacheClear(&shapes);
+    TEST_ASSERT_EQUAL(0, live);
+    AllocatorSetGlobal(defaultAllocator);
+}
+
+// Coverage of a glyph as the rasterizer would give it, different for every key
+static void RenderCoverage(uint32_t key, uint8_t coverage[CELL * CELL]) {
+    for (int i = 0; i < CELL * CELL; ++i) {
+        coverage[i] = (uint8_t)(key * 37 + i * 11);
+    }
+}
+
+static const GlyphEntry* Insert(uint32_t key) {
+    uint8_t coverage[CELL * CELL];
+    RenderCoverage(key, coverage);
+    return GlyphCacheInsert(cache, key, coverage, CELL, CELL, CELL, (int)key, -(int)key);
+}
+
+static void AssertCoverage(uint32_t key, const GlyphEntry* entry) {
+    uint8_t expected[CELL * CELL];
+    RenderCoverage(key, expected);
+    const uint8_t* coverage = GlyphCacheCoverage(cache, entry);
+    for (int y = 0; y < CELL; ++y) {
+        TEST_ASSERT_EQUAL_MEMORY(expected + y * CELL, coverage + y * cache->atlas.stride, CELL);
+    }
+    TEST_ASSERT_EQUAL(key, entry->key);
+    TEST_ASSERT_EQUAL((int)key, entry->left);
+    TEST_ASSERT_EQUAL(-(int)key, entry->top);
+}
+
+void test_RepeatedGlyphShouldHitCache() {
+    TEST_ASSERT_NULL(GlyphCacheFind(cache, 7));
+    Insert(7);
+    for (int i = 0; i < 4; ++i) {
+        const GlyphEntry* entry = GlyphCacheFind(cache, 7);
+        TEST_ASSERT_NOT_NULL(entry);
+        AssertCoverage(7, entry);
+    }
+
+    TEST_ASSERT_EQUAL(4, cache->stats.hits);
+    TEST_ASSERT_EQUAL(1, cache->stats.misses);
+    TEST_ASSERT_EQUAL(0, cache->stats.evictions);
+    TEST_ASSERT_EQUAL(CAPACITY, cache->stats.capacity);
+    TEST_ASSERT_EQUAL(1, cache->used);
+}
+
+void test_LeastRecentlyUsedGlyphShouldBeEvictedOverBudget() {
+    Insert(1);
+    Insert(2);
+    Insert(3);
+    GlyphCacheFind(cache, 1);
+    Insert(4);
+
+    TEST_ASSERT_EQUAL(1, cache->stats.evictions);
+    TEST_ASSERT_EQUAL(CAPACITY, cache->used);
+    TEST_ASSERT_NULL(GlyphCacheFind(cache, 2));
+    TEST_ASSERT_NOT_NULL(GlyphCacheFind(cache, 1));
+    TEST_ASSERT_NOT_NULL(GlyphCacheFind(cache, 3));
+    TEST_ASSERT_NOT_NULL(GlyphCacheFind(cache, 4));
+}
+
+void test_EvictedGlyphShouldReuseItsCell() {
+    const GlyphEntry* first = Insert(1);
+    const uint8_t* cell = GlyphCacheCoverage(cache, first);
+    Insert(2);
+    Insert(3);
+
+    const GlyphEntry* next = Insert(4);
+    TEST_ASSERT_EQUAL_PTR(first, next);
+    TEST_ASSERT_EQUAL_PTR(cell, GlyphCacheCoverage(cache, next));
+    AssertCoverage(4, next);
+}
+
+void test_EvictedGlyphShouldBeTheSameWhenInsertedAgain() {
+    AssertCoverage(1, Insert(1));
+    for (uint32_t key = 2; key < 2 + CAPACITY; ++key) {
+        Insert(key);
+    }
+    TEST_ASSERT_NULL(GlyphCacheFind(cache, 1));
+
+    // smaller glyph left in the cell doesn't leak into the one inserted after it
+    const uint8_t small = 255;
+    const GlyphEntry* entry = GlyphCacheInsert(cache, 9, &small, 1, 1, 1, 0, 0);
+    TEST_ASSERT_EQUAL(1, entry->width);
+    TEST_ASSERT_EQUAL(255, GlyphCacheCoverage(cache, entry)[0]);
+    Insert(1);
+
+    const GlyphEntry* again = GlyphCacheFind(cache, 1);
+    TEST_ASSERT_NOT_NULL(again);
+    TEST_ASSERT_EQUAL(CELL, again->width);
+    TEST_ASSERT_EQUAL(CELL, again->height);
+    AssertCoverage(1, again);
+}
+
+void test_GlyphBiggerThanCellShouldNotBeCached() {
+    uint8_t coverage[(CELL + 1) * CELL] = { 0 };
+    Insert(1);
+
+    TEST_ASSERT_NULL(GlyphCacheInsert(cache, 2, coverage, CELL + 1, CELL + 1, CELL, 0, 0));
+    TEST_ASSERT_NULL(GlyphCacheInsert(cache, 3, coverage, CELL, CELL, CELL + 1, 0, 0));
+    TEST_ASSERT_EQUAL(1, cache->used);
+    TEST_ASSERT_NOT_NULL(GlyphCacheFind(cache, 1));
+}
+
+void test_BudgetBelowOneCellShouldGiveNoCache() {
+    GlyphCacheDestroy(cache);
+    cache = GlyphCacheCreate(CELL, CELL, CELL * CELL - 1);
+
+    TEST_ASSERT_NULL(cache);
+    TEST_ASSERT_EQUAL(0, errors);
+}
+
+void test_FailedAllocationShouldFreeWholeCache() {
+    GlyphCacheDestroy(cache);
+    cache = NULL;
+
+    // cache, its entries, links and buckets, and the atlas last
+    for (failAt = 0; failAt < 5; ++failAt) {
+        allocations = 0;
+        errors = 0;
+        TEST_ASSERT_NULL(GlyphCacheCreate(CELL, CELL, BUDGET));
+        TEST_ASSERT_EQUAL(1, errors);
+        TEST_ASSERT_EQUAL(0, live);
+    }
+
+    failAt = -1;
+    allocations = 0;
+    cache = GlyphCacheCreate(CELL, CELL, BUDGET);
+    TEST_ASSERT_NOT_NULL(cache);
+    TEST_ASSERT_EQUAL(5, allocations);
+}
+
+// Direction and script as the shaper would get them, values of HB_DIRECTION_LTR and HB_SCRIPT_LATIN
+#define LTR 4
+#define RTL 5
+#define LATIN 0x4C61746E
+
+typedef struct TestInfo {
+    uint32_t glyph;
+    uint32_t cluster;
+} TestInfo;
+
+// Glyphs of the biggest run that fits into the budget
+#define MAX_GLYPHS (FONT_SHAPE_CACHE_BUDGET / (sizeof(TestInfo) + sizeof(int32_t)))
+
+static TestInfo infos[MAX_GLYPHS + 1];
+static int32_t advances[MAX_GLYPHS + 1];
+
+// Shaping result that differs for every text, one glyph per byte
+static const ShapedRun* InsertRun(const char* text, uint32_t direction) {
+    const int length = (int)strlen(text);
+    for (int i = 0; i < length; ++i) {
+        infos[i] = (TestInfo){ (uint32_t)text[i] * 3 + direction, (uint32_t)i };
+        advances[i] = text[i] + (int32_t)direction;
+    }
+    return ShapeCacheInsert(&shapes, text, length, direction, LATIN, (unsigned int)length, infos, sizeof(TestInfo),
+                            advances, sizeof(int32_t));
+}
+
+static const ShapedRun* FindRun(const char* text, uint32_t direction) {
+    return ShapeCacheFind(&shapes, text, (int)strlen(text), direction, LATIN);
+}
+
+static void AssertRun(const char* text, uint32_t direction, const ShapedRun* run) {
+    TEST_ASSERT_NOT_NULL(run);
+    const int length = (int)strlen(text);
+    TEST_ASSERT_EQUAL(length, run->glyphCount);
+    for (int i = 0; i < length; ++i) {
+        const TestInfo info = ((const TestInfo*)run->infos)[i];
+        TEST_ASSERT_EQUAL((uint32_t)text[i] * 3 + direction, info.glyph);
+        TEST_ASSERT_EQUAL(i, info.cluster);
+        TEST_ASSERT_EQUAL(text[i] + (int32_t)direction, ((const int32_t*)run->positions)[i]);
+    }
+}
+
+void test_ShapedRunShouldBeFoundByTextDirectionAndScript() {
+    const ShapedRun* inserted = InsertRun("Hello", LTR);
+    AssertRun("Hello", LTR, inserted);
+
+    TEST_ASSERT_EQUAL_PTR(inserted, FindRun("Hello", LTR));
+    TEST_ASSERT_NULL(FindRun("Hello", RTL));
+    TEST_ASSERT_NULL(ShapeCacheFind(&shapes, "Hello", 5, LTR, 0));
+    TEST_ASSERT_NULL(FindRun("Hell", LTR));
+    TEST_ASSERT_NULL(FindRun("Hellp", LTR));
+
+    // same text shaped differently is a separate run
+    AssertRun("Hello", RTL, InsertRun("Hello", RTL));
+    AssertRun("Hello", LTR, FindRun("Hello", LTR));
+    AssertRun("Hello", RTL, FindRun("Hello", RTL));
+}
+
+void test_HashShouldDependOnTextDirectionAndScript() {
+    const uint32_t hash = ShapeCacheHash("abc", 3, LTR, LATIN);
+    TEST_ASSERT_EQUAL(hash, ShapeCacheHash("abcd", 3, LTR, LATIN));
+    TEST_ASSERT_NOT_EQUAL(hash, ShapeCacheHash("abd", 3, LTR, LATIN));
+    TEST_ASSERT_NOT_EQUAL(hash, ShapeCacheHash("abc", 2, LTR, LATIN));
+    TEST_ASSERT_NOT_EQUAL(hash, ShapeCacheHash("abc", 3, RTL, LATIN));
+    TEST_ASSERT_NOT_EQUAL(hash, ShapeCacheHash("abc", 3, LTR, 0));
+}
+
+void test_RunsInSameBucketShouldBeKeptApart() {
+    // texts are searched until enough of them land in the bucket of the first one
+    enum { COLLIDING = 4 };
+    char texts[COLLIDING][16];
+    const uint32_t bucket = ShapeCacheHash("run0", 4, LTR, LATIN) & (SHAPE_CACHE_BUCKETS - 1);
+    int found = 0;
+    for (int i = 0; found < COLLIDING; ++i) {
+        char text[16];
+        snprintf(text, sizeof(text), "run%d", i);
+        if ((ShapeCacheHash(text, (int)strlen(text), LTR, LATIN) & (SHAPE_CACHE_BUCKETS - 1)) != bucket) continue;
+        strcpy(texts[found++], text);
+        InsertRun(text, LTR);
+    }
+
+    for (int i = 0; i < COLLIDING; ++i) {
+        AssertRun(texts[i], LTR, FindRun(texts[i], LTR));
+    }
+
+    // evicting the least recently used run unlinks it from the middle of the chain
+    for (int i = 0; i < FONT_SHAPE_CACHE_MAX_RUNS - COLLIDING; ++i) {
+        char text[16];
+        snprintf(text, sizeof(text), "other%d", i);
+        InsertRun(text, RTL);
+    }
+    FindRun(texts[0], LTR);
+    FindRun(texts[2], LTR);
+    FindRun(texts[3], LTR);
+    InsertRun("one more", RTL);
+
+    TEST_ASSERT_NULL(FindRun(texts[1], LTR));
+    AssertRun(texts[0], LTR, FindRun(texts[0], LTR));
+    AssertRun(texts[2], LTR, FindRun(texts[2], LTR));
+    AssertRun(texts[3], LTR, FindRun(texts[3], LTR));
+}
+
+void test_LeastRecentlyUsedRunShouldBeEvictedOverCount() {
+    char text[16];
+    for (int i = 0; i < FONT_SHAPE_CACHE_MAX_RUNS; ++i) {
+        snprintf(text, sizeof(text), "%d", i);
+        InsertRun(text, LTR);
+    }
+    FindRun("0", LTR);
+    InsertRun("new", LTR);
+
+    TEST_ASSERT_NULL(FindRun("1", LTR));
+    AssertRun("0", LTR, FindRun("0", LTR));
+    AssertRun("2", LTR, FindRun("2", LTR));
+    AssertRun("new", LTR, FindRun("new", LTR));
+}
+
+void test_RunsShouldBeEvictedToStayWithinBudget() {
+    // every run takes a bit more than a third of the budget
+    static char text[MAX_GLYPHS / 3 + 2];
+    for (int r = 0; r < 4; ++r) {
+        memset(text, 'a' + r, sizeof(text) - 1);
+        text[sizeof(text) - 1] = '\0';
+        TEST_ASSERT_NOT_NULL(InsertRun(text, LTR));
+        TEST_ASSERT_LESS_OR_EQUAL(FONT_SHAPE_CACHE_BUDGET, shapes.bytes);
+    }
+
+    memset(text, 'a', sizeof(text) - 1);
+    TEST_ASSERT_NULL(FindRun(text, LTR));
+    memset(text, 'b', sizeof(text) - 1);
+    TEST_ASSERT_NULL(FindRun(text, LTR));
+    memset(text, 'd', sizeof(text) - 1);
+    AssertRun(text, LTR, FindRun(text, LTR));
+}
+
+void test_RunBiggerThanBudgetShouldNotBeCached() {
+    static char text[MAX_GLYPHS + 2];
+    InsertRun("small", LTR);
+    memset(text, 'x', sizeof(text) - 1);
+
+    TEST_ASSERT_NULL(InsertRun(text, LTR));
+    TEST_ASSERT_NULL(FindRun(text, LTR));
+    AssertRun("small", LTR, FindRun("small", LTR));
+    TEST_ASSERT_EQUAL(0, errors);
+}
+
+void test_ClearedRunsShouldBeInsertedAgain() {
+    InsertRun("first", LTR);
+    InsertRun("second", LTR);
+
+    ShapeCacheClear(&shapes);
+    TEST_ASSERT_NULL(FindRun("first", LTR));
+    TEST_ASSERT_NULL(FindRun("second", LTR));
+    TEST_ASSERT_EQUAL(0, shapes.bytes);
+    GlyphCacheDestroy(cache);
+    cache = NULL;
+    TEST_ASSERT_EQUAL(0, live);
+
+    AssertRun("first", LTR, InsertRun("first", LTR));
+    AssertRun("first", LTR, FindRun("first", LTR));
+}
+
+void test_FailedRunAllocationShouldOnlySkipCaching() {
+    InsertRun("kept", LTR);
+    failAt = allocations;
+
+    TEST_ASSERT_NULL(InsertRun("lost", LTR));
+    TEST_ASSERT_EQUAL(0, errors);
+    TEST_ASSERT_NULL(FindRun("lost", LTR));
+    AssertRun("kept", LTR, FindRun("kept", LTR));
+
+    AssertRun("lost", LTR, InsertRun("lost", LTR));
+    AssertRun("lost", LTR, FindRun("lost", LTR));
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+
+#include "Headless.h"
+#include "Image.h"
+#include "PixelFormat.h"
+#include "Surface.h"
+#include "Window.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Convert.c")
+TEST_SOURCE_FILE("Cpu.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("FillRect.c")
+TEST_SOURCE_FILE("PlatformHeadless.c")
+TEST_SOURCE_FILE("Profiler.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("RowKernels.c")
+
+#define DUMP_FORMAT "headless_frame_%02d.bmp"
+#define FRAMES 3
+
+static Surface window;
+
+void setUp(void) {
+    window = WindowInit(4, 3, "Headless");
+}
+
+void tearDown(void) {
+    HeadlessSetFrameDump(NULL);
+    HeadlessSetFrameLimit(0);
+    WindowDestroy();
+}
+
+void test_VirtualClockShouldAdvanceByFrameTime() {
+    HeadlessSetFrameTime(0.25);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, WindowGetTime());
+
+    for (int i = 1; i <= FRAMES; ++i) {
+        WindowBeginFrame();
+        WindowEndFrame();
+        TEST_ASSERT_EQUAL_FLOAT(0.25f, WindowGetFrameTime());
+        TEST_ASSERT_EQUAL_DOUBLE(0.25 * i, WindowGetTime());
+    }
+
+    // a new window starts its clock again
+    WindowDestroy();
+    window = WindowInit(4, 3, "Headless");
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, WindowGetTime());
+    TEST_ASSERT_EQUAL(0, HeadlessGetFrameCount());
+}
+
+void test_WindowShouldCloseAtFrameLimit() {
+    HeadlessSetFrameLimit(FRAMES);
+
+    int frames = 0;
+    while (!WindowShouldClose()) {
+        WindowBeginFrame();
+        WindowEndFrame();
+        ++frames;
+        TEST_ASSERT_LESS_OR_EQUAL(FRAMES, frames);
+    }
+
+    TEST_ASSERT_EQUAL(FRAMES, frames);
+    TEST_ASSERT_EQUAL(FRAMES, HeadlessGetFrameCount());
+    HeadlessSetFrameLimit(0);
+    TEST_ASSERT_FALSE(WindowShouldClose());
+}
+
+void test_PresentedFramesShouldBeSavedAsBmp() {
+    const Color colors[FRAMES] = { RED, GREEN, BLUE };
+    HeadlessSetFrameDump(DUMP_FORMAT);
+
+    for (int i = 0; i < FRAMES; ++i) {
+        WindowBeginFrame();
+        SurfaceFill(window, colors[i]);
+        WindowEndFrame();
+    }
+    HeadlessSetFrameDump(NULL);
+    WindowEndFrame();
+
+    for (int i = 0; i < FRAMES; ++i) {
+        char path[64];
+        snprintf(path, sizeof(path), DUMP_FORMAT, i);
+        Surface frame = ImageLoadBMP(path);
+        TEST_ASSERT_EQUAL(window.width, frame.width);
+        TEST_ASSERT_EQUAL(window.height, frame.height);
+        TEST_ASSERT_EQUAL(4, frame.format->bytesPerPixel);
+        for (int y = 0; y < frame.height; ++y) {
+            for (int x = 0; x < frame.width; ++x) {
+                const uint8_t* row = (uint8_t*)frame.pixels + y * frame.stride;
+                const Color color = PixelToColor(frame.format, ((const uint32_t*)row)[x]);
+                TEST_ASSERT_EQUAL(colors[i].r, color.r);
+                TEST_ASSERT_EQUAL(colors[i].g, color.g);
+                TEST_ASSERT_EQUAL(colors[i].b, color.b);
+            }
+        }
+        SurfaceDestroy(&frame);
+        remove(path);
+    }
+
+    // frame presented after the dump was stopped isn't saved
+    char path[64];
+    snprintf(path, sizeof(path), DUMP_FORMAT, FRAMES);
+    FILE* file = fopen(path, "rb");
+    TEST_ASSERT_NULL(file);
+    if (file != NULL) fclose(file);
+}
@@ -0,0 +1,204 @@
+#include "DepthBuffer.h"
+#include "Mesh.h"
+#include "PixelFormat.h"
+#include "Surface.h"
+#include "Window.h"
+#include "internal/Damage.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("DepthBuffer.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("FillRect.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("Scanline.c")
+TEST_SOURCE_FILE("Triangle.c")
+
+static Surface surface;
+static DepthBuffer depth;
+
+void setUp(void) {
+    surface = SurfaceCreate(32, 32, &FORMAT_ARGB8888);
+    SurfaceFill(surface, BLACK);
+    depth = DepthBufferCreate(32, 32);
+}
+
+void tearDown(void) {
+    DepthBufferDestroy(&depth);
+    SurfaceDestroy(&surface);
+}
+
+static Color GetColor(int x, int y) {
+    return PixelToColor(surface.format, ((uint32_t*)((uint8_t*)surface.pixels + y * surface.stride))[x]);
+}
+
+// Square in normalized device coordinates, counter-clockwise
+static void DrawSquare(float size, float z, Color color, TriangleFlags flags) {
+    const MeshVertex vertices[4] = {
+        { -size, -size, z, 0.0f, 0.0f, color },
+        { size, -size, z, 0.0f, 0.0f, color },
+        { size, size, z, 0.0f, 0.0f, color },
+        { -size, size, z, 0.0f, 0.0f, color },
+    };
+    const uint16_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+    Mesh mesh = MeshCreate(vertices, 4, indices, 2);
+    const Mat4 identity = Mat4Identity();
+    DrawMesh(surface, &depth, &mesh, &identity, NULL, flags);
+    MeshDestroy(&mesh);
+}
+
+void test_CreatedDepthBufferShouldBeFar() {
+    TEST_ASSERT_EQUAL(DEPTH_FAR, depth.values[0]);
+    TEST_ASSERT_EQUAL(DEPTH_FAR, depth.values[32 * 32 - 1]);
+
+    depth.values[5] = 0;
+    DepthBufferClear(depth);
+    TEST_ASSERT_EQUAL(DEPTH_FAR, depth.values[5]);
+}
+
+void test_NearerSquareShouldHideFartherOneInAnyOrder() {
+    DrawSquare(0.5f, 0.5f, RED, TRIANGLE_FLAG_NONE);
+    DrawSquare(0.25f, -0.5f, GREEN, TRIANGLE_FLAG_NONE);
+    TEST_ASSERT_EQUAL(255, GetColor(16, 16).g);
+    TEST_ASSERT_EQUAL(255, GetColor(9, 9).r);
+
+    SurfaceFill(surface, BLACK);
+    DepthBufferClear(depth);
+    DrawSquare(0.25f, -0.5f, GREEN, TRIANGLE_FLAG_NONE);
+    DrawSquare(0.5f, 0.5f, RED, TRIANGLE_FLAG_NONE);
+    TEST_ASSERT_EQUAL(255, GetColor(16, 16).g);
+    TEST_ASSERT_EQUAL(0, GetColor(16, 16).r);
+    TEST_ASSERT_EQUAL(255, GetColor(9, 9).r);
+    TEST_ASSERT_EQUAL(0, GetColor(0, 0).r);
+}
+
+void test_BackFacesShouldBeCulled() {
+    const MeshVertex vertices[3] = {
+        { -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, WHITE },
+        { 0.5f, -0.5f, 0.0f, 0.0f, 0.0f, WHITE },
+        { 0.0f, 0.5f, 0.0f, 0.0f, 0.0f, WHITE },
+    };
+    const uint16_t indices[3] = { 0, 2, 1 };
+    const Mat4 identity = Mat4Identity();
+    Mesh mesh = MeshCreate(vertices, 3, indices, 1);
+
+    DrawMesh(surface, NULL, &mesh, &identity, NULL, TRIANGLE_FLAG_CULL_BACK);
+    TEST_ASSERT_EQUAL(0, GetColor(16, 16).r);
+
+    DrawMesh(surface, NULL, &mesh, &identity, NULL, TRIANGLE_FLAG_NONE);
+    TEST_ASSERT_EQUAL(255, GetColor(16, 16).r);
+    MeshDestroy(&mesh);
+}
+
+void test_TriangleBehindCameraShouldDrawNothing() {
+    const MeshVertex vertices[3] = {
+        { -1.0f, -1.0f, 2.0f, 0.0f, 0.0f, WHITE },
+        { 1.0f, -1.0f, 2.0f, 0.0f, 0.0f, WHITE },
+        { 0.0f, 1.0f, 2.0f, 0.0f, 0.0f, WHITE },
+    };
+    const uint16_t indices[3] = { 0, 1, 2 };
+    const Mat4 projection = Mat4Perspective(1.5f, 1.0f, 0.5f, 50.0f);
+    Mesh mesh = MeshCreate(vertices, 3, indices, 1);
+
+    DrawMesh(surface, &depth, &mesh, &projection, NULL, TRIANGLE_FLAG_NONE);
+
+    for (int y = 0; y < surface.height; ++y) {
+        for (int x = 0; x < surface.width; ++x) {
+            TEST_ASSERT_EQUAL(0, GetColor(x, y).r);
+        }
+    }
+    MeshDestroy(&mesh);
+}
+
+void test_ClippedFloorShouldBlendEveryPixelOnce() {
+    // grid of quads under the camera, from behind it far into the distance, so triangles cross the near plane
+    enum { N = 6 };
+    MeshVertex vertices[(N + 1) * (N + 1)];
+    uint16_t indices[N * N * 6];
+    for (int z = 0; z <= N; ++z) {
+        for (int x = 0; x <= N; ++x) {
+            vertices[z * (N + 1) + x] = (MeshVertex){
+                -30.0f + 60.0f * (float)x / N, -1.0f, 5.0f - 45.0f * (float)z / N, 0.0f, 0.0f,
+                (Color){ 255, 255, 255, 128 },
+            };
+        }
+    }
+    int count = 0;
+    for (int z = 0; z < N; ++z) {
+        for (int x = 0; x < N; ++x) {
+            const uint16_t i = (uint16_t)(z * (N + 1) + x);
+            const uint16_t quad[6] = { i, (uint16_t)(i + 1), (uint16_t)(i + N + 2), i, (uint16_t)(i + N + 2),
+                                       (uint16_t)(i + N + 1) };
+            for (int k = 0; k < 6; ++k) indices[count++] = quad[k];
+        }
+    }
+    const Mat4 projection = Mat4Perspective(1.5f, 1.0f, 0.5f, 50.0f);
+    Mesh mesh = MeshCreate(vertices, (N + 1) * (N + 1), indices, N * N * 2);
+
+    DrawMesh(surface, NULL, &mesh, &projection, NULL, TRIANGLE_FLAG_BLEND);
+
+    for (int y = 0; y < surface.height; ++y) {
+        for (int x = 0; x < surface.width; ++x) {
+            const int red = GetColor(x, y).r;
+            TEST_ASSERT_TRUE(red == 0 || (red >= 126 && red <= 130));
+        }
+    }
+    // floor is below the horizon and covers bottom of the view
+    TEST_ASSERT_EQUAL(0, GetColor(16, 10).r);
+    TEST_ASSERT_INT_WITHIN(2, 128, GetColor(16, 31).r);
+    TEST_ASSERT_INT_WITHIN(2, 128, GetColor(0, 31).r);
+    MeshDestroy(&mesh);
+}
+
+void test_TriangleInsideGuardBandShouldNotBeClipped() {
+    // sliver from pixel 1.5 to 16015.5, far past 4096 pixels but inside the guard band
+    const MeshVertex vertices[3] = {
+        { -0.875f, 0.875f, 0.0f, 0.0f, 0.0f, WHITE },
+        { 1000.0f, 0.875f, 0.0f, 0.0f, 0.0f, WHITE },
+        { -0.875f, 0.625f, 0.0f, 0.0f, 0.0f, WHITE },
+    };
+    const uint16_t indices[3] = { 0, 1, 2 };
+    const Mat4 identity = Mat4Identity();
+    Mesh mesh = MeshCreate(vertices, 3, indices, 1);
+    Rect rects[DAMAGE_MAX_RECTS];
+    DamageSetTarget(&surface);
+    WindowSetDamageTracking(true);
+    DamageCollect(rects, DAMAGE_MAX_RECTS);
+
+    DrawMesh(surface, NULL, &mesh, &identity, NULL, TRIANGLE_FLAG_NONE);
+
+    // clipped triangles damage whole surface, ones drawn directly only the rect around their vertices
+    TEST_ASSERT_EQUAL(1, DamageCollect(rects, DAMAGE_MAX_RECTS));
+    TEST_ASSERT_EQUAL(1, rects[0].y);
+    TEST_ASSERT_LESS_OR_EQUAL(6, rects[0].height);
+    TEST_ASSERT_EQUAL(255, GetColor(2, 3).r);
+    TEST_ASSERT_EQUAL(255, GetColor(31, 3).r);
+    TEST_ASSERT_EQUAL(0, GetColor(16, 10).r);
+    WindowSetDamageTracking(false);
+    DamageSetTarget(NULL);
+    MeshDestroy(&mesh);
+}
+
+void test_MeshShouldTakeTexelsFromTexture() {
+    Surface texture = SurfaceCreate(2, 1, &FORMAT_ARGB8888);
+    ((uint32_t*)texture.pixels)[0] = ColorToPixel(texture.format, RED);
+    ((uint32_t*)texture.pixels)[1] = ColorToPixel(texture.format, BLUE);
+    const MeshVertex vertices[4] = {
+        { -1.0f, -1.0f, 0.0f, 0.0f, 1.0f, WHITE },
+        { 1.0f, -1.0f, 0.0f, 1.0f, 1.0f, WHITE },
+        { 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, WHITE },
+        { -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, WHITE },
+    };
+    const uint16_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+    const Mat4 identity = Mat4Identity();
+    Mesh mesh = MeshCreate(vertices, 4, indices, 2);
+
+    DrawMesh(surface, &depth, &mesh, &identity, &texture, TRIANGLE_FLAG_PERSPECTIVE);
+
+    TEST_ASSERT_EQUAL(255, GetColor(2, 16).r);
+    TEST_ASSERT_EQUAL(255, GetColor(29, 16).b);
+    TEST_ASSERT_INT_WITHIN(1, DEPTH_FAR / 2, depth.values[16 * 32 + 16]);
+    MeshDestroy(&mesh);
+    SurfaceDestroy(&texture);
+}
@@ -0,0 +1,135 @@
+#include "Path.h"
+#include "PixelFormat.h"
+#include "Surface.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("FillRect.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("Scanline.c")
+
+static Surface surface;
+static Path path;
+
+void setUp(void) {
+    surface = SurfaceCreate(40, 30, &FORMAT_ARGB8888);
+    SurfaceFill(surface, BLACK);
+    path = PathCreate();
+}
+
+void tearDown(void) {
+    PathDestroy(&path);
+    SurfaceDestroy(&surface);
+}
+
+static int GetRed(int x, int y) {
+    return PixelToColor(surface.format, ((uint32_t*)((uint8_t*)surface.pixels + y * surface.stride))[x]).r;
+}
+
+static void AddRect(float x0, float y0, float x1, float y1) {
+    PathMoveTo(&path, x0, y0);
+    PathLineTo(&path, x1, y0);
+    PathLineTo(&path, x1, y1);
+    PathLineTo(&path, x0, y1);
+    PathClose(&path);
+}
+
+void test_RectOnPixelBordersShouldBeCoveredFully() {
+    AddRect(1.5f, 1.5f, 5.5f, 4.5f);
+
+    DrawPath(surface, &path, FILL_RULE_NON_ZERO, WHITE);
+
+    int covered = 0;
+    for (int y = 0; y < surface.height; ++y) {
+        for (int x = 0; x < surface.width; ++x) {
+            const int red = GetRed(x, y);
+            TEST_ASSERT_TRUE(red == 0 || red == 255);
+            if (red == 255) ++covered;
+        }
+    }
+    TEST_ASSERT_EQUAL(4 * 3, covered);
+    TEST_ASSERT_EQUAL(255, GetRed(2, 2));
+    TEST_ASSERT_EQUAL(255, GetRed(5, 4));
+}
+
+void test_EdgeThroughPixelCentersShouldCoverHalfOfThem() {
+    AddRect(2.0f, 1.5f, 6.0f, 3.5f);
+
+    DrawPath(surface, &path, FILL_RULE_NON_ZERO, WHITE);
+
+    TEST_ASSERT_INT_WITHIN(1, 128, GetRed(2, 2));
+    TEST_ASSERT_EQUAL(255, GetRed(3, 2));
+    TEST_ASSERT_EQUAL(255, GetRed(5, 3));
+    TEST_ASSERT_INT_WITHIN(1, 128, GetRed(6, 3));
+    TEST_ASSERT_EQUAL(0, GetRed(7, 3));
+}
+
+void test_CircleOfCubicsShouldCoverItsArea() {
+    // quarter circles approximated by cubics with control points 0.5523 * radius away
+    const float cx = 20.0f, cy = 15.0f, r = 12.0f, k = 0.5523f * 12.0f;
+    PathMoveTo(&path, cx + r, cy);
+    PathCubicTo(&path, cx + r, cy + k, cx + k, cy + r, cx, cy + r);
+    PathCubicTo(&path, cx - k, cy + r, cx - r, cy + k, cx - r, cy);
+    PathCubicTo(&path, cx - r, cy - k, cx - k, cy - r, cx, cy - r);
+    PathCubicTo(&path, cx + k, cy - r, cx + r, cy - k, cx + r, cy);
+    PathClose(&path);
+
+    DrawPath(surface, &path, FILL_RULE_NON_ZERO, WHITE);
+
+    long long sum = 0;
+    for (int y = 0; y < surface.height; ++y) {
+        for (int x = 0; x < surface.width; ++x) {
+            sum += GetRed(x, y);
+        }
+    }
+    // flattened circle is inscribed, so it can lose a strip as wide as the tolerance
+    const float area = (float)sum / 255.0f;
+    const float expected = 3.14159265f * r * r;
+    TEST_ASSERT_TRUE(area <= expected + 1.0f);
+    TEST_ASSERT_TRUE(area >= expected - 2.0f * 3.14159265f * r * PATH_FLATTEN_TOLERANCE);
+    TEST_ASSERT_EQUAL(255, GetRed(20, 15));
+    TEST_ASSERT_EQUAL(0, GetRed(20, 1));
+}
+
+void test_FillRuleShouldDecideAboutNestedContours() {
+    AddRect(4.5f, 4.5f, 20.5f, 20.5f);
+    AddRect(8.5f, 8.5f, 16.5f, 16.5f);
+
+    DrawPath(surface, &path, FILL_RULE_EVEN_ODD, WHITE);
+    TEST_ASSERT_EQUAL(255, GetRed(6, 6));
+    TEST_ASSERT_EQUAL(0, GetRed(12, 12));
+
+    DrawPath(surface, &path, FILL_RULE_NON_ZERO, WHITE);
+    TEST_ASSERT_EQUAL(255, GetRed(12, 12));
+}
+
+void test_PathLargerThanSurfaceShouldCoverItFully() {
+    AddRect(-100.0f, -50.0f, 300.0f, 200.0f);
+
+    DrawPath(surface, &path, FILL_RULE_NON_ZERO, WHITE);
+
+    for (int y = 0; y < surface.height; ++y) {
+        TEST_ASSERT_EQUAL(255, GetRed(0, y));
+        TEST_ASSERT_EQUAL(255, GetRed(surface.width - 1, y));
+    }
+}
+
+void test_ResetShouldKeepMemory() {
+    for (int i = 0; i < 100; ++i) {
+        PathLineTo(&path, (float)i, (float)(i % 7));
+    }
+    DrawPath(surface, &path, FILL_RULE_NON_ZERO, WHITE);
+    const Point* points = path.points;
+    const void* scratch = path.scratch;
+
+    PathReset(&path);
+    TEST_ASSERT_EQUAL(0, path.count);
+    PathQuadTo(&path, 10.0f, 0.0f, 10.0f, 10.0f);
+    DrawPath(surface, &path, FILL_RULE_NON_ZERO, WHITE);
+
+    TEST_ASSERT_EQUAL_PTR(points, path.points);
+    TEST_ASSERT_EQUAL_PTR(scratch, path.scratch);
+    TEST_ASSERT_EQUAL(0, path.points[0].x);
+}
@@ -130,3 +130,23 @@ void test_PixelToColorShouldProperlyConvertFromBGR233() {
 
     COMPARE_COLOR_COMPONENTS(expected, actual);
 }
+
+void test_ColorToPixelShouldPremultiplyColorForPremultipliedFormat() {
+    const uint32_t pixel = ColorToPixel(&FORMAT_RGBA8888_PREMUL, testedColor);
+    TEST_ASSERT_EQUAL_HEX32(0x93A2B1DD, pixel);
+}
+
+void test_PixelToColorShouldUnpremultiplyColorForPremultipliedFormat() {
+    const Color actual = PixelToColor(&FORMAT_RGBA8888_PREMUL, 0x93A2B1DD);
+    COMPARE_COLOR_COMPONENTS(testedColor, actual);
+}
+
+void test_PixelToColorShouldReturnTransparentBlackForZeroAlphaInPremultipliedFormat() {
+    const Color actual = PixelToColor(&FORMAT_ARGB8888_PREMUL, 0x00000000);
+    COMPARE_COLOR_COMPONENTS(((Color){ 0, 0, 0, 0 }), actual);
+}
+
+void test_FindPixelFormatByMasksShouldPreferStraightFormat() {
+    const PixelFormat* format = FindPixelFormatByMasks(0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    TEST_ASSERT_EQUAL_PTR(&FORMAT_ARGB8888, format);
+}
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Cpu.h"
+#include "Draw.h"
+#include "FillRect.h"
+#include "PixelFormat.h"
+#include "Profiler.h"
+#include "Surface.h"
+#include "internal/Profile.h"
+#include "internal/ThreadPool.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Cpu.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("Profiler.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("Scanline.c")
+TEST_SOURCE_FILE("ThreadPool.c")
+
+static Surface surface;
+
+void setUp(void) {
+    surface = SurfaceCreate(20, 10, &FORMAT_ARGB8888);
+    ProfilerSetEnabled(true);
+    ProfilerReset();
+}
+
+void tearDown(void) {
+    ProfilerTraceEnd();
+    ProfilerTraceFree();
+    ProfilerSetEnabled(false);
+    SurfaceDestroy(&surface);
+}
+
+typedef struct TraceTasks {
+    int threads;
+    int started;
+} TraceTasks;
+
+// Every task waits until all of them have started, so each thread of the pool runs exactly one
+static void TraceTask(void* context, int index) {
+    TraceTasks* tasks = context;
+    TRACE_BEGIN();
+    __atomic_add_fetch(&tasks->started, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&tasks->started, __ATOMIC_SEQ_CST) < tasks->threads) {
+    }
+    TRACE_END("Task", "index", index);
+}
+
+static char* ReadFile(const char* path) {
+    FILE* f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* text = calloc((size_t)size + 1, 1);
+    TEST_ASSERT_NOT_NULL(text);
+    TEST_ASSERT_EQUAL(size, (long)fread(text, 1, (size_t)size, f));
+    fclose(f);
+    return text;
+}
+
+static int CountOccurrences(const char* text, const char* pattern) {
+    int count = 0;
+    for (const char* s = strstr(text, pattern); s != NULL; s = strstr(s + 1, pattern)) {
+        ++count;
+    }
+    return count;
+}
+
+void test_ProfilerShouldBeAvailableInTests() {
+    TEST_ASSERT_TRUE(ProfilerIsAvailable());
+}
+
+void test_OutermostCallShouldGetTimeAndPixelsOfNestedCalls() {
+    DrawRect(surface, -5, 2, 10, 4, RED);
+
+    const ProfileFrame* frame = ProfilerGetCurrentFrame();
+    TEST_ASSERT_EQUAL(1, frame->zones[PROFILE_ZONE_DRAW_RECT].calls);
+    TEST_ASSERT_EQUAL(5 * 4, frame->zones[PROFILE_ZONE_DRAW_RECT].pixels);
+    TEST_ASSERT_EQUAL(0, frame->zones[PROFILE_ZONE_FILL_RECT].calls);
+    TEST_ASSERT_TRUE(frame->zones[PROFILE_ZONE_DRAW_RECT].seconds >= 0.0);
+}
+
+void test_ClippedBlitShouldCountOnlyWrittenPixels() {
+    Surface src = SurfaceCreate(8, 8, &FORMAT_ARGB8888);
+    src.flags &= ~SURFACE_FLAG_HAS_ALPHA;
+
+    SurfaceBlit(surface, src, 16, 6);
+    SurfaceBlit(surface, src, 100, 100);
+
+    const ProfileZoneStats* stats = &ProfilerGetCurrentFrame()->zones[PROFILE_ZONE_SURFACE_BLIT];
+    TEST_ASSERT_EQUAL(1, stats->calls);
+    TEST_ASSERT_EQUAL(4 * 4, stats->pixels);
+
+    SurfaceDestroy(&src);
+}
+
+void test_NextFrameShouldMoveCurrentFrameToHistory() {
+    const Rect rect = { 0, 0, 2, 2 };
+    FillRect(surface, &rect, 0);
+    ProfilerNextFrame();
+
+    TEST_ASSERT_EQUAL(1, ProfilerGetFrameCount());
+    TEST_ASSERT_EQUAL(1, ProfilerGetFrame(0)->zones[PROFILE_ZONE_FILL_RECT].calls);
+    TEST_ASSERT_EQUAL(4, ProfilerGetFrame(0)->zones[PROFILE_ZONE_FILL_RECT].pixels);
+    TEST_ASSERT_EQUAL(0, ProfilerGetCurrentFrame()->zones[PROFILE_ZONE_FILL_RECT].calls);
+    TEST_ASSERT_NULL(ProfilerGetFrame(1));
+}
+
+void test_HistoryShouldKeepNewestFrames() {
+    for (int i = 0; i < PROFILER_HISTORY_SIZE + 5; ++i) {
+        ProfilerNextFrame();
+    }
+
+    TEST_ASSERT_EQUAL(PROFILER_HISTORY_SIZE, ProfilerGetFrameCount());
+    TEST_ASSERT_EQUAL(PROFILER_HISTORY_SIZE + 4, ProfilerGetFrame(0)->index);
+    TEST_ASSERT_EQUAL(5, ProfilerGetFrame(PROFILER_HISTORY_SIZE - 1)->index);
+}
+
+void test_DisabledProfilerShouldNotRecord() {
+    ProfilerSetEnabled(false);
+    const Rect rect = { 0, 0, 2, 2 };
+    FillRect(surface, &rect, 0);
+    ProfilerNextFrame();
+
+    TEST_ASSERT_EQUAL(0, ProfilerGetFrameCount());
+    TEST_ASSERT_EQUAL(0, ProfilerGetCurrentFrame()->zones[PROFILE_ZONE_FILL_RECT].calls);
+}
+
+void test_TraceShouldRecordNestedCallsWithTheirPixels() {
+    TEST_ASSERT_TRUE(ProfilerTraceBegin(64));
+    DrawRect(surface, -5, 2, 10, 4, RED);
+    ProfilerTraceEnd();
+    TEST_ASSERT_TRUE(ProfilerTraceGetEventCount() > 1);
+
+    const char* path = "test_trace.json";
+    TEST_ASSERT_TRUE(ProfilerTraceSave(path));
+    FILE* f = fopen(path, "r");
+    TEST_ASSERT_NOT_NULL(f);
+    char json[4096] = { 0 };
+    fread(json, 1, sizeof(json) - 1, f);
+    fclose(f);
+    remove(path);
+
+    TEST_ASSERT_NOT_NULL(strstr(json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"name\":\"DrawRect\",\"cat\":\"LGL\",\"ph\":\"X\""));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"name\":\"FillRect\""));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"args\":{\"pixels\":20}"));
+}
+
+void test_TraceShouldDropEventsWhenBufferIsFull() {
+    TEST_ASSERT_TRUE(ProfilerTraceBegin(2));
+    const Rect rect = { 0, 0, 2, 2 };
+    for (int i = 0; i < 3; ++i) {
+        FillRect(surface, &rect, 0);
+    }
+    ProfilerTraceEnd();
+
+    TEST_ASSERT_EQUAL(2, ProfilerTraceGetEventCount());
+    TEST_ASSERT_EQUAL(1, ProfilerTraceGetDroppedCount());
+}
+
+void test_TraceShouldRecordFramesWithoutProfiler() {
+    ProfilerSetEnabled(false);
+    TEST_ASSERT_TRUE(ProfilerTraceBegin(16));
+    ProfilerNextFrame();
+    ProfilerNextFrame();
+    ProfilerTraceEnd();
+    ProfilerNextFrame();
+
+    TEST_ASSERT_FALSE(ProfilerIsTracing());
+    TEST_ASSERT_EQUAL(2, ProfilerTraceGetEventCount());
+    TEST_ASSERT_EQUAL(0, ProfilerGetFrameCount());
+}
+
+void test_TraceShouldMergeEventsOfWorkerThreads() {
+    // two threads more than there are buffers, the ones claiming a buffer last get none and their events are lost
+    const int buffers = CpuGetCoreCount() + 1;
+    ThreadPool* pool = ThreadPoolCreate(buffers + 2);
+    TraceTasks tasks = { ThreadPoolGetThreadCount(pool), 0 };
+    TEST_ASSERT_EQUAL(buffers + 2, tasks.threads);
+
+    // workers outlive a trace, so they have to claim a new buffer in the next one
+    for (int session = 0; session < 2; ++session) {
+        TEST_ASSERT_TRUE(ProfilerTraceBegin(4));
+        tasks.started = 0;
+        ThreadPoolRun(pool, tasks.threads, TraceTask, &tasks);
+        ProfilerTraceEnd();
+
+        TEST_ASSERT_EQUAL(buffers, ProfilerTraceGetEventCount());
+        TEST_ASSERT_EQUAL(0, ProfilerTraceGetDroppedCount());
+
+        const char* path = "test_trace_threads.json";
+        TEST_ASSERT_TRUE(ProfilerTraceSave(path));
+        char* json = ReadFile(path);
+        remove(path);
+
+        // every buffer belongs to one thread, so each tid has exactly one task
+        TEST_ASSERT_EQUAL(buffers, CountOccurrences(json, "\"name\":\"Task\""));
+        TEST_ASSERT_EQUAL(buffers, CountOccurrences(json, "\"name\":\"thread_name\""));
+        for (int tid = 0; tid < buffers; ++tid) {
+            char event[96];
+            snprintf(event, sizeof(event), "\"name\":\"Task\",\"cat\":\"LGL\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,", tid);
+            TEST_ASSERT_EQUAL(1, CountOccurrences(json, event));
+        }
+        free(json);
+    }
+
+    ThreadPoolDestroy(pool);
+}
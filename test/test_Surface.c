@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "PixelFormat.h"
 #include "Surface.h"
@@ -204,3 +205,101 @@ void test_ShouldBlitWhenSurfacesHaveDifferentFormats() {
 
     SurfaceDestroy(&dest);
 }
+
+void test_ConversionBetweenBuiltInFormatsShouldMatchColorConversion() {
+    const PixelFormat* formats[] = {
+        &FORMAT_RGBA8888, &FORMAT_ABGR8888, &FORMAT_ARGB8888, &FORMAT_BGRA8888,
+        &FORMAT_RGB565, &FORMAT_BGR565, &FORMAT_RGB332, &FORMAT_BGR233,
+    };
+    const int numFormats = sizeof(formats) / sizeof(formats[0]);
+
+    for (int i = 0; i < numFormats; ++i) {
+        // odd width checks both SIMD loops and scalar tails
+        Surface src = SurfaceCreate(19, 3, formats[i]);
+        uint8_t* bytes = src.pixels;
+        for (int j = 0; j < src.stride * src.height; ++j) {
+            bytes[j] = (uint8_t)(j * 37 + 11);
+        }
+
+        for (int k = 0; k < numFormats; ++k) {
+            Surface converted = SurfaceConvert(src, formats[k]);
+            const int srcBpp = formats[i]->bytesPerPixel;
+            const int dstBpp = formats[k]->bytesPerPixel;
+
+            for (int p = 0; p < src.width * src.height; ++p) {
+                uint32_t srcValue = 0, dstValue = 0;
+                memcpy(&srcValue, bytes + p * srcBpp, srcBpp);
+                memcpy(&dstValue, (uint8_t*)converted.pixels + p * dstBpp, dstBpp);
+                const uint32_t expected = ColorToPixel(formats[k], PixelToColor(formats[i], srcValue));
+                TEST_ASSERT_EQUAL_HEX32(expected, dstValue);
+            }
+
+            SurfaceDestroy(&converted);
+        }
+
+        SurfaceDestroy(&src);
+    }
+}
+
+void test_ConversionToPremultipliedFormatShouldMultiplyColorsByAlpha() {
+    uint32_t buffer[] = { 0xFF8040FF, 0xFF804080, 0x12345600 };
+    const Surface src = SurfaceCreateFromBuffer(3, 1, &FORMAT_RGBA8888, buffer);
+
+    Surface converted = SurfaceConvert(src, &FORMAT_ARGB8888_PREMUL);
+
+    const uint32_t expected[] = { 0xFFFF8040, 0x80804020, 0x00000000 };
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, converted.pixels, 3);
+
+    SurfaceDestroy(&converted);
+}
+
+// Blits the same sprite with and without compiled runs at positions clipped on every side
+static void AssertRleBlitMatchesPlainBlit(Surface sprite, const PixelFormat* destFormat) {
+    const int positions[][2] = { { 2, 1 }, { -3, -2 }, { 7, 4 }, { -1, 5 } };
+    Surface expected = SurfaceCreate(12, 8, destFormat);
+    Surface actual = SurfaceCreate(12, 8, destFormat);
+    Surface compiled = sprite;
+    TEST_ASSERT_TRUE(SurfaceCompileRle(&compiled));
+
+    for (int i = 0; i < 4; ++i) {
+        SurfaceFill(expected, (Color){ 10, 20, 30, 255 });
+        SurfaceFill(actual, (Color){ 10, 20, 30, 255 });
+        SurfaceBlit(expected, sprite, positions[i][0], positions[i][1]);
+        SurfaceBlit(actual, compiled, positions[i][0], positions[i][1]);
+        TEST_ASSERT_EQUAL_MEMORY(expected.pixels, actual.pixels, expected.stride * expected.height);
+    }
+
+    SurfaceUncompileRle(&compiled);
+    TEST_ASSERT_NULL(compiled.rle);
+    SurfaceDestroy(&expected);
+    SurfaceDestroy(&actual);
+}
+
+static Surface CreateSprite(void) {
+    Surface sprite = SurfaceCreate(9, 6, &FORMAT_ARGB8888);
+    uint32_t* pixels = sprite.pixels;
+    for (int i = 0; i < sprite.width * sprite.height; ++i) {
+        const uint32_t alpha = (i % 7 < 3) ? 0x00 : (i % 7 < 5) ? 0xFF : 0x80;
+        pixels[i] = (alpha << 24) | (uint32_t)(i * 0x030507);
+    }
+    return sprite;
+}
+
+void test_RleBlitOfAlphaSurfaceShouldMatchPlainBlit() {
+    Surface sprite = CreateSprite();
+
+    AssertRleBlitMatchesPlainBlit(sprite, &FORMAT_ARGB8888);
+    AssertRleBlitMatchesPlainBlit(sprite, &FORMAT_RGBA8888);
+
+    SurfaceDestroy(&sprite);
+}
+
+void test_RleBlitOfColorKeyedSurfaceShouldMatchPlainBlit() {
+    Surface sprite = CreateSprite();
+    SurfaceSetColorKey(&sprite, BLACK);
+
+    AssertRleBlitMatchesPlainBlit(sprite, &FORMAT_ARGB8888);
+    AssertRleBlitMatchesPlainBlit(sprite, &FORMAT_RGB565);
+
+    SurfaceDestroy(&sprite);
+}
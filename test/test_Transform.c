@@ -0,0 +1,399 @@
+#include "Cpu.h"
+#include "PixelFormat.h"
+#include "Surface.h"
+#include "Transform.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Convert.c")
+TEST_SOURCE_FILE("Cpu.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("RowKernels.c")
+
+static Surface surface;
+
+void setUp(void) {
+    surface = SurfaceCreate(4, 4, &FORMAT_ARGB8888);
+}
+
+void tearDown(void) {
+    SurfaceDestroy(&surface);
+    CpuForceSimdLevel(SIMD_LEVEL_AUTO);
+}
+
+static Color GetColor(Surface s, int x, int y) {
+    const uint8_t* pixel = (const uint8_t*)s.pixels + y * s.stride + x * s.format->bytesPerPixel;
+    switch (s.format->bytesPerPixel) {
+        case 1: return PixelToColor(s.format, *pixel);
+        case 2: return PixelToColor(s.format, *(const uint16_t*)pixel);
+        default: return PixelToColor(s.format, *(const uint32_t*)pixel);
+    }
+}
+
+static void SetColor(Surface s, int x, int y, Color color) {
+    uint8_t* pixel = (uint8_t*)s.pixels + y * s.stride + x * s.format->bytesPerPixel;
+    const uint32_t value = ColorToPixel(s.format, color);
+    switch (s.format->bytesPerPixel) {
+        case 1: *pixel = (uint8_t)value; break;
+        case 2: *(uint16_t*)pixel = (uint16_t)value; break;
+        default: *(uint32_t*)pixel = value; break;
+    }
+}
+
+static void FillCheckerboard(Surface s) {
+    for (int y = 0; y < s.height; ++y) {
+        for (int x = 0; x < s.width; ++x) {
+            SetColor(s, x, y, ((x + y) & 1) ? WHITE : BLACK);
+        }
+    }
+}
+
+void test_ScaleShouldRepeatNearestPixels() {
+    FillCheckerboard(surface);
+
+    Surface scaled = TransformScale(surface, 8, 8);
+
+    TEST_ASSERT_EQUAL(0, GetColor(scaled, 0, 0).r);
+    TEST_ASSERT_EQUAL(0, GetColor(scaled, 1, 1).r);
+    TEST_ASSERT_EQUAL(255, GetColor(scaled, 2, 0).r);
+    TEST_ASSERT_EQUAL(255, GetColor(scaled, 7, 5).r);
+    SurfaceDestroy(&scaled);
+}
+
+void test_AreaFilterShouldAverageCoveredPixels() {
+    FillCheckerboard(surface);
+
+    for (int level = SIMD_LEVEL_SCALAR; level <= SIMD_LEVEL_SSE2; ++level) {
+        CpuForceSimdLevel((SimdLevel)level);
+        Surface scaled = TransformScaleFiltered(surface, 2, 2, SCALE_FILTER_AREA);
+        for (int y = 0; y < 2; ++y) {
+            for (int x = 0; x < 2; ++x) {
+                TEST_ASSERT_INT_WITHIN(1, 128, GetColor(scaled, x, y).g);
+                TEST_ASSERT_EQUAL(255, GetColor(scaled, x, y).a);
+            }
+        }
+        SurfaceDestroy(&scaled);
+    }
+}
+
+void test_BilinearFilterShouldBlendBetweenPixelCenters() {
+    Surface line = SurfaceCreate(2, 1, &FORMAT_ARGB8888);
+    SetColor(line, 0, 0, BLACK);
+    SetColor(line, 1, 0, WHITE);
+
+    for (int level = SIMD_LEVEL_SCALAR; level <= SIMD_LEVEL_SSE2; ++level) {
+        CpuForceSimdLevel((SimdLevel)level);
+        Surface scaled = TransformScaleFiltered(line, 8, 2, SCALE_FILTER_BILINEAR);
+        // source centers land on destination x = 1.5 and 5.5, pixels beyond them are clamped
+        TEST_ASSERT_EQUAL(0, GetColor(scaled, 0, 0).r);
+        TEST_ASSERT_EQUAL(0, GetColor(scaled, 1, 1).r);
+        TEST_ASSERT_INT_WITHIN(1, 32, GetColor(scaled, 2, 0).r);
+        TEST_ASSERT_INT_WITHIN(1, 96, GetColor(scaled, 3, 0).r);
+        TEST_ASSERT_INT_WITHIN(1, 159, GetColor(scaled, 4, 1).r);
+        TEST_ASSERT_EQUAL(255, GetColor(scaled, 6, 0).r);
+        TEST_ASSERT_EQUAL(255, GetColor(scaled, 7, 1).r);
+        SurfaceDestroy(&scaled);
+    }
+    SurfaceDestroy(&line);
+}
+
+void test_FilteredScaleShouldKeepSolidColorExact() {
+    const Color color = { 37, 201, 90, 255 };
+    Surface solid = SurfaceCreate(7, 5, &FORMAT_ARGB8888);
+    SurfaceFill(solid, color);
+
+    const int sizes[][2] = { { 3, 2 }, { 11, 13 }, { 2, 9 }, { 1, 1 } };
+    for (int i = 0; i < 4; ++i) {
+        Surface scaled = TransformScaleFiltered(solid, sizes[i][0], sizes[i][1], SCALE_FILTER_AUTO);
+        for (int y = 0; y < scaled.height; ++y) {
+            for (int x = 0; x < scaled.width; ++x) {
+                const Color c = GetColor(scaled, x, y);
+                TEST_ASSERT_EQUAL(color.r, c.r);
+                TEST_ASSERT_EQUAL(color.g, c.g);
+                TEST_ASSERT_EQUAL(color.b, c.b);
+            }
+        }
+        SurfaceDestroy(&scaled);
+    }
+    SurfaceDestroy(&solid);
+}
+
+void test_FilteredScaleShouldNotDarkenHalfTransparentEdge() {
+    const Color color = { 200, 120, 40, 255 };
+    Surface edge = SurfaceCreate(2, 1, &FORMAT_ARGB8888);
+    SetColor(edge, 0, 0, color);
+    SetColor(edge, 1, 0, (Color){ 0, 0, 0, 0 });
+
+    for (int level = SIMD_LEVEL_SCALAR; level <= SIMD_LEVEL_SSE2; ++level) {
+        CpuForceSimdLevel((SimdLevel)level);
+        Surface scaled = TransformScaleFiltered(edge, 1, 1, SCALE_FILTER_AREA);
+        const Color c = GetColor(scaled, 0, 0);
+        TEST_ASSERT_INT_WITHIN(1, 128, c.a);
+        TEST_ASSERT_INT_WITHIN(1, color.r, c.r);
+        TEST_ASSERT_INT_WITHIN(1, color.g, c.g);
+        TEST_ASSERT_INT_WITHIN(1, color.b, c.b);
+        SurfaceDestroy(&scaled);
+    }
+    SurfaceDestroy(&edge);
+}
+
+void test_FilteredScaleShouldConvertFormatsWithoutByteChannels() {
+    Surface small = SurfaceCreate(4, 4, &FORMAT_RGB565);
+    FillCheckerboard(small);
+
+    Surface scaled = TransformScaleFiltered(small, 1, 1, SCALE_FILTER_AREA);
+
+    TEST_ASSERT_TRUE(scaled.format == &FORMAT_RGB565);
+    TEST_ASSERT_INT_WITHIN(8, 128, GetColor(scaled, 0, 0).r);
+    TEST_ASSERT_INT_WITHIN(8, 128, GetColor(scaled, 0, 0).g);
+    SurfaceDestroy(&scaled);
+    SurfaceDestroy(&small);
+}
+
+void test_ScaleBlitShouldClipAndSkipColorKey() {
+    FillCheckerboard(surface);
+    SurfaceSetColorKey(&surface, BLACK);
+    Surface dest = SurfaceCreate(8, 8, &FORMAT_ARGB8888);
+    SurfaceFill(dest, RED);
+
+    TransformScaleBlit(dest, surface, -2, 4, 8, 8);
+
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 0, 3).r);
+    TEST_ASSERT_EQUAL(0, GetColor(dest, 0, 3).g);
+    // scaled pixel (2, 0) is white, (4, 0) is keyed black
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 0, 4).g);
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 2, 4).r);
+    TEST_ASSERT_EQUAL(0, GetColor(dest, 2, 4).g);
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 3, 7).g);
+    TEST_ASSERT_EQUAL(0, GetColor(dest, 7, 7).g);
+    SurfaceDestroy(&dest);
+}
+
+void test_RotateBlitShouldMatchRotatedSurfaceAndKeepCorners() {
+    Surface src = SurfaceCreate(6, 6, &FORMAT_RGB565);
+    FillCheckerboard(src);
+    SetColor(src, 2, 2, BLUE);
+    Surface rotated = TransformRotate(src, 45);
+    Surface dest = SurfaceCreate(rotated.width, rotated.height, &FORMAT_ARGB8888);
+    SurfaceFill(dest, RED);
+
+    TransformRotateBlit(dest, src, 0, 0, 45);
+
+    // corner of the box is outside of the rotated source
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 0, 0).r);
+    TEST_ASSERT_EQUAL(0, GetColor(dest, 0, 0).b);
+    int blue = 0;
+    for (int y = 0; y < rotated.height; ++y) {
+        for (int x = 0; x < rotated.width; ++x) {
+            const Color expected = GetColor(rotated, x, y);
+            if (expected.b > 200 && expected.r == 0) ++blue;
+            if (expected.r == 0 && expected.g == 0 && expected.b == 0) continue;
+            TEST_ASSERT_EQUAL(expected.r, GetColor(dest, x, y).r);
+            TEST_ASSERT_EQUAL(expected.b, GetColor(dest, x, y).b);
+        }
+    }
+    TEST_ASSERT_TRUE(blue > 0);
+    SurfaceDestroy(&dest);
+    SurfaceDestroy(&rotated);
+    SurfaceDestroy(&src);
+}
+
+void test_Scale2xBlitShouldBlendLikeSurfaceBlit() {
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) SetColor(surface, x, y, (Color){ 255, 255, 255, 128 });
+    }
+    Surface dest = SurfaceCreate(8, 8, &FORMAT_ARGB8888);
+    SurfaceFill(dest, BLACK);
+
+    TransformScale2xBlit(dest, surface, 0, 0);
+
+    TEST_ASSERT_INT_WITHIN(1, 128, GetColor(dest, 0, 0).r);
+    TEST_ASSERT_INT_WITHIN(1, 128, GetColor(dest, 7, 7).g);
+    SurfaceDestroy(&dest);
+}
+
+void test_RotozoomWithoutRotationShouldMatchScaledBlit() {
+    FillCheckerboard(surface);
+    SetColor(surface, 1, 2, RED);
+    Surface expected = SurfaceCreate(12, 12, &FORMAT_ARGB8888);
+    Surface dest = SurfaceCreate(12, 12, &FORMAT_ARGB8888);
+    TransformScaleBlit(expected, surface, 2, 1, 8, 8);
+
+    // pivot at the top-left corner of src
+    TransformRotozoomBlit(dest, surface, 2, 1, 0, 2 << 16, 0, 0, SCALE_FILTER_NEAREST);
+
+    for (int y = 0; y < 12; ++y) {
+        for (int x = 0; x < 12; ++x) {
+            TEST_ASSERT_EQUAL(GetColor(expected, x, y).r, GetColor(dest, x, y).r);
+            TEST_ASSERT_EQUAL(GetColor(expected, x, y).g, GetColor(dest, x, y).g);
+        }
+    }
+    SurfaceDestroy(&dest);
+    SurfaceDestroy(&expected);
+}
+
+void test_RotozoomShouldRotateClockwiseAroundPivot() {
+    SurfaceFill(surface, BLACK);
+    SetColor(surface, 3, 0, RED);
+    SetColor(surface, 3, 3, BLUE);
+    Surface dest = SurfaceCreate(8, 8, &FORMAT_ARGB8888);
+    SurfaceFill(dest, GREEN);
+
+    // center of src at the center of dest, a quarter turn moves the top-right corner to the bottom-right one
+    TransformRotozoomBlit(dest, surface, 4, 4, 90 << 16, 1 << 16, 2, 2, SCALE_FILTER_NEAREST);
+
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 5, 5).r);
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 2, 5).b);
+    TEST_ASSERT_EQUAL(0, GetColor(dest, 3, 3).g);
+    // outside of the rotated source
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 1, 1).g);
+    TEST_ASSERT_EQUAL(255, GetColor(dest, 6, 6).g);
+    SurfaceDestroy(&dest);
+}
+
+void test_BilinearRotozoomShouldKeepSolidColorAndSkipColorKeyBlending() {
+    const Color color = { 37, 201, 90, 255 };
+    Surface solid = SurfaceCreate(5, 7, &FORMAT_RGB565);
+    SurfaceFill(solid, color);
+    Surface dest = SurfaceCreate(16, 16, &FORMAT_RGB565);
+
+    TransformRotozoomBlit(dest, solid, 8, 8, 33 << 16, 3 << 15, 2, 3, SCALE_FILTER_BILINEAR);
+
+    TEST_ASSERT_EQUAL(GetColor(solid, 0, 0).g, GetColor(dest, 8, 8).g);
+    TEST_ASSERT_EQUAL(GetColor(solid, 0, 0).r, GetColor(dest, 9, 7).r);
+
+    // keyed sources are sampled nearest, so no pixel mixes the key with the checkerboard
+    FillCheckerboard(surface);
+    SurfaceSetColorKey(&surface, BLACK);
+    Surface keyed = SurfaceCreate(16, 16, &FORMAT_ARGB8888);
+    SurfaceFill(keyed, RED);
+    TransformRotozoomBlit(keyed, surface, 8, 8, 20 << 16, 3 << 16, 2, 2, SCALE_FILTER_BILINEAR);
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            const Color c = GetColor(keyed, x, y);
+            TEST_ASSERT_TRUE((c.r == 255 && c.g == 0) || (c.r == 255 && c.g == 255));
+        }
+    }
+    SurfaceDestroy(&keyed);
+    SurfaceDestroy(&dest);
+    SurfaceDestroy(&solid);
+}
+
+void test_BlitTransformedShouldScaleAxesIndependently() {
+    FillCheckerboard(surface);
+    SetColor(surface, 1, 2, RED);
+    Surface expected = SurfaceCreate(12, 16, &FORMAT_ARGB8888);
+    Surface dest = SurfaceCreate(12, 16, &FORMAT_ARGB8888);
+    TransformScaleBlit(expected, surface, 1, 0, 8, 16);
+
+    const Mat2x3 matrix = { { { 2 << 16, 0, 1 << 16 }, { 0, 4 << 16, 0 } } };
+    SurfaceBlitTransformed(dest, surface, &matrix, SCALE_FILTER_NEAREST, true);
+
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 12; ++x) {
+            TEST_ASSERT_EQUAL(GetColor(expected, x, y).r, GetColor(dest, x, y).r);
+            TEST_ASSERT_EQUAL(GetColor(expected, x, y).g, GetColor(dest, x, y).g);
+        }
+    }
+    SurfaceDestroy(&dest);
+    SurfaceDestroy(&expected);
+}
+
+void test_SkewedBlitShouldCopyWithoutBlendingOnlyCoveredPixels() {
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) SetColor(surface, x, y, (Color){ (uint8_t)(x * 60), (uint8_t)(y * 60), 0, 0 });
+    }
+    surface.flags |= SURFACE_FLAG_HAS_ALPHA;
+    Surface dest = SurfaceCreate(10, 6, &FORMAT_RGB565);
+    SurfaceFill(dest, BLUE);
+
+    // x of src is shifted right by its y, so pixel x, y of dest shows x - y, y of src
+    const Mat2x3 matrix = { { { 1 << 16, 1 << 16, 0 }, { 0, 1 << 16, 0 } } };
+    SurfaceBlitTransformed(dest, surface, &matrix, SCALE_FILTER_NEAREST, false);
+
+    for (int y = 0; y < 6; ++y) {
+        for (int x = 0; x < 10; ++x) {
+            const Color c = GetColor(dest, x, y);
+            if (y < 4 && x - y >= 0 && x - y < 4) {
+                TEST_ASSERT_INT_WITHIN(8, (x - y) * 60, c.r);
+                TEST_ASSERT_INT_WITHIN(8, y * 60, c.g);
+                TEST_ASSERT_EQUAL(0, c.b);
+            }
+            else {
+                TEST_ASSERT_TRUE(c.b > 200);
+            }
+        }
+    }
+    SurfaceDestroy(&dest);
+}
+
+void test_Scale2xShouldGiveSameResultWithAndWithoutSimd() {
+    const Color palette[3] = { BLACK, WHITE, RED };
+    Surface src = SurfaceCreate(37, 5, &FORMAT_ARGB8888);
+    for (int y = 0; y < src.height; ++y) {
+        for (int x = 0; x < src.width; ++x) SetColor(src, x, y, palette[(x * x + y) % 3]);
+    }
+    CpuForceSimdLevel(SIMD_LEVEL_SCALAR);
+    Surface expected = TransformScale2x(src);
+    CpuForceSimdLevel(SIMD_LEVEL_AUTO);
+    Surface scaled = TransformScale2x(src);
+
+    for (int y = 0; y < scaled.height; ++y) {
+        for (int x = 0; x < scaled.width; ++x) {
+            TEST_ASSERT_EQUAL(GetColor(expected, x, y).r, GetColor(scaled, x, y).r);
+            TEST_ASSERT_EQUAL(GetColor(expected, x, y).g, GetColor(scaled, x, y).g);
+        }
+    }
+    SurfaceDestroy(&scaled);
+    SurfaceDestroy(&expected);
+    SurfaceDestroy(&src);
+}
+
+void test_Scale3xShouldFillCornersAlongDiagonalEdge() {
+    // white triangle in the top-left corner
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) SetColor(surface, x, y, (x + y <= 2) ? WHITE : BLACK);
+    }
+    Surface scaled = TransformScale3x(surface);
+    TEST_ASSERT_EQUAL(12, scaled.width);
+    TEST_ASSERT_EQUAL(12, scaled.height);
+
+    // black pixel 2, 1 gets a white corner towards the edge, white pixel 1, 1 a black one away from it
+    TEST_ASSERT_EQUAL(255, GetColor(scaled, 6, 3).r);
+    TEST_ASSERT_EQUAL(0, GetColor(scaled, 7, 4).r);
+    TEST_ASSERT_EQUAL(0, GetColor(scaled, 5, 5).r);
+    TEST_ASSERT_EQUAL(255, GetColor(scaled, 4, 4).r);
+    SurfaceDestroy(&scaled);
+}
+
+void test_Hq2xShouldKeepFlatAreasAndBlendCorners() {
+    SurfaceFill(surface, BLACK);
+    SetColor(surface, 1, 1, WHITE);
+    SetColor(surface, 2, 1, WHITE);
+    SetColor(surface, 1, 2, WHITE);
+    SetColor(surface, 2, 2, WHITE);
+    Surface scaled = TransformHq2x(surface);
+
+    // outer corner of the square is rounded off, inner quarters stay white
+    TEST_ASSERT_INT_WITHIN(1, 64, GetColor(scaled, 2, 2).g);
+    TEST_ASSERT_EQUAL(255, GetColor(scaled, 3, 2).g);
+    TEST_ASSERT_EQUAL(255, GetColor(scaled, 3, 3).g);
+    // black pixel next to the corner gets a bit of it
+    TEST_ASSERT_INT_WITHIN(1, 64, GetColor(scaled, 6, 6).g);
+    TEST_ASSERT_EQUAL(0, GetColor(scaled, 7, 7).g);
+    TEST_ASSERT_EQUAL(0, GetColor(scaled, 0, 0).g);
+    SurfaceDestroy(&scaled);
+
+    // formats without byte channels are blended through colors
+    const Color color = { 37, 201, 90, 255 };
+    Surface solid = SurfaceCreate(3, 3, &FORMAT_RGB565);
+    SurfaceFill(solid, color);
+    scaled = TransformHq2x(solid);
+    for (int y = 0; y < 6; ++y) {
+        for (int x = 0; x < 6; ++x) TEST_ASSERT_EQUAL(GetColor(solid, 0, 0).g, GetColor(scaled, x, y).g);
+    }
+    SurfaceDestroy(&scaled);
+    SurfaceDestroy(&solid);
+}
@@ -0,0 +1,131 @@
+#include "PixelFormat.h"
+#include "Surface.h"
+#include "Triangle.h"
+#include "unity.h"
+
+TEST_SOURCE_FILE("Allocator.c")
+TEST_SOURCE_FILE("Damage.c")
+TEST_SOURCE_FILE("Error.c")
+TEST_SOURCE_FILE("FillRect.c")
+TEST_SOURCE_FILE("Rect.c")
+TEST_SOURCE_FILE("Scanline.c")
+
+static Surface surface;
+static Surface texture;
+
+void setUp(void) {
+    surface = SurfaceCreate(16, 16, &FORMAT_ARGB8888);
+    SurfaceFill(surface, BLACK);
+    // 4x4 checkerboard of red and blue texels
+    texture = SurfaceCreate(4, 4, &FORMAT_ARGB8888);
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            ((uint32_t*)((uint8_t*)texture.pixels + y * texture.stride))[x] =
+                ColorToPixel(texture.format, ((x + y) & 1) ? BLUE : RED);
+        }
+    }
+}
+
+void tearDown(void) {
+    SurfaceDestroy(&texture);
+    SurfaceDestroy(&surface);
+}
+
+static Color GetColor(int x, int y) {
+    return PixelToColor(surface.format, ((uint32_t*)((uint8_t*)surface.pixels + y * surface.stride))[x]);
+}
+
+// Square from (x0, y0) to (x1, y1) made of two triangles with the whole texture on it
+static void DrawTexturedQuad(float x0, float y0, float x1, float y1, float w0, float w1, Color color,
+                             TriangleFlags flags) {
+    const Vertex v[4] = {
+        { x0, y0, w0, 0.0f, 0.0f, color },
+        { x1, y0, w1, 1.0f, 0.0f, color },
+        { x1, y1, w1, 1.0f, 1.0f, color },
+        { x0, y1, w0, 0.0f, 1.0f, color },
+    };
+    DrawTriangleTextured(surface, &v[0], &v[1], &v[2], texture, flags);
+    DrawTriangleTextured(surface, &v[0], &v[2], &v[3], texture, flags);
+}
+
+void test_ShadedTriangleShouldInterpolateVertexColors() {
+    const Vertex v1 = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, RED };
+    const Vertex v2 = { 15.0f, 0.0f, 1.0f, 0.0f, 0.0f, GREEN };
+    const Vertex v3 = { 0.0f, 15.0f, 1.0f, 0.0f, 0.0f, BLUE };
+
+    DrawTriangleShaded(surface, &v1, &v2, &v3, TRIANGLE_FLAG_NONE);
+
+    const Color corner = GetColor(0, 0);
+    TEST_ASSERT_EQUAL(255, corner.r);
+    TEST_ASSERT_EQUAL(0, corner.g);
+    const Color middle = GetColor(5, 5);
+    TEST_ASSERT_INT_WITHIN(1, 85, middle.r);
+    TEST_ASSERT_INT_WITHIN(1, 85, middle.g);
+    TEST_ASSERT_INT_WITHIN(1, 85, middle.b);
+    const Color edge = GetColor(7, 0);
+    TEST_ASSERT_INT_WITHIN(1, 136, edge.r);
+    TEST_ASSERT_INT_WITHIN(1, 119, edge.g);
+}
+
+void test_NearestTextureShouldMapTexelsToBlocks() {
+    DrawTexturedQuad(-0.5f, -0.5f, 7.5f, 7.5f, 1.0f, 1.0f, WHITE, TRIANGLE_FLAG_NONE);
+
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            const Color color = GetColor(x, y);
+            const bool blue = ((x / 2 + y / 2) & 1) != 0;
+            TEST_ASSERT_EQUAL(blue ? 0 : 255, color.r);
+            TEST_ASSERT_EQUAL(blue ? 255 : 0, color.b);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, GetColor(8, 3).r);
+    TEST_ASSERT_EQUAL(0, GetColor(8, 3).b);
+}
+
+void test_TextureShouldBeMultipliedByVertexColorAndBlended() {
+    DrawTexturedQuad(-0.5f, -0.5f, 7.5f, 7.5f, 1.0f, 1.0f, (Color){ 0xFF, 0xFF, 0xFF, 0x80 }, TRIANGLE_FLAG_BLEND);
+
+    TEST_ASSERT_INT_WITHIN(1, 128, GetColor(0, 0).r);
+    TEST_ASSERT_EQUAL(0, GetColor(0, 0).b);
+    TEST_ASSERT_INT_WITHIN(1, 128, GetColor(2, 0).b);
+}
+
+void test_BilinearFilterShouldBlendNeighbouringTexels() {
+    DrawTexturedQuad(-0.5f, -0.5f, 15.5f, 15.5f, 1.0f, 1.0f, WHITE, TRIANGLE_FLAG_BILINEAR);
+
+    // centers of texels are at pixels 1.5, 5.5, ..., so pixel 3.5 would be halfway between two of them
+    const Color between = GetColor(3, 1);
+    TEST_ASSERT_INT_WITHIN(40, 128, between.r);
+    TEST_ASSERT_INT_WITHIN(40, 128, between.b);
+    const Color corner = GetColor(0, 0);
+    TEST_ASSERT_EQUAL(255, corner.r);
+    TEST_ASSERT_EQUAL(0, corner.b);
+}
+
+void test_PerspectiveShouldShrinkFarTexels() {
+    SurfaceDestroy(&surface);
+    surface = SurfaceCreate(64, 4, &FORMAT_ARGB8888);
+
+    // right side is three times further away, so the middle of texture is at 3/4 of the width on screen; coordinates
+    // are exact at pixels 0, 16, 32 and 48
+    DrawTexturedQuad(-0.5f, -0.5f, 63.5f, 3.5f, 1.0f, 3.0f, WHITE, TRIANGLE_FLAG_PERSPECTIVE);
+    TEST_ASSERT_EQUAL(255, GetColor(32, 0).b);
+    TEST_ASSERT_EQUAL(255, GetColor(48, 0).r);
+
+    DrawTexturedQuad(-0.5f, -0.5f, 63.5f, 3.5f, 1.0f, 3.0f, WHITE, TRIANGLE_FLAG_NONE);
+    TEST_ASSERT_EQUAL(255, GetColor(32, 0).r);
+    TEST_ASSERT_EQUAL(255, GetColor(48, 0).b);
+}
+
+void test_TextureInOtherFormatShouldBeConverted() {
+    Surface converted = SurfaceConvert(texture, &FORMAT_RGB565);
+    SurfaceDestroy(&texture);
+    texture = converted;
+
+    DrawTexturedQuad(-0.5f, -0.5f, 7.5f, 7.5f, 1.0f, 1.0f, WHITE, TRIANGLE_FLAG_NONE);
+
+    // RGB565 has 5 bits of red and blue
+    TEST_ASSERT_INT_WITHIN(8, 255, GetColor(0, 0).r);
+    TEST_ASSERT_EQUAL(0, GetColor(0, 0).b);
+    TEST_ASSERT_INT_WITHIN(8, 255, GetColor(7, 4).b);
+}